@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 Ulrich Hecht
+
+// Notifications across the Jailhouse communication areas
+
+// A doorbell is a counter in the shared memory. The producer publishes its
+// data with release semantics and then rings the doorbell; the consumer
+// remembers the count it has seen and reads the data (with acquire
+// semantics) once it has changed. Ringing also executes "sev", so a consumer
+// waiting in "wfe" wakes up right away.
+
+// There is no interrupt from the bare-metal cell to Linux, so a Linux-side
+// consumer cannot block until the doorbell rings. comm_wait() spins for a
+// while and then sleeps in growing steps. The time spent spinning adapts to
+// how busy the channel is: it is doubled when the doorbell rings while
+// spinning, and halved when the consumer had to go to sleep.
+
+// The sleeps are kept short because the wakeup latency of an idle channel
+// is what a program doing a libc call now and then sees on every call, and
+// the timer slack of the waiting thread is cut to 1 us so that they are not
+// stretched by the default 50 us (see test/comm_latency.c).
+
+#ifndef _COMM_NOTIFY_H
+#define _COMM_NOTIFY_H
+
+#include <stdint.h>
+
+struct comm_doorbell {
+    uint32_t count;
+};
+
+#if defined(__arm__) || defined(__aarch64__)
+#define comm_wait_for_event() asm volatile("wfe" ::: "memory")
+#define comm_send_event() asm volatile("sev" ::: "memory")
+#else
+// test builds on other hosts
+#include <sched.h>
+#define comm_wait_for_event() sched_yield()
+#define comm_send_event() do {} while (0)
+#endif
+
+static inline void comm_ring(struct comm_doorbell *db)
+{
+    __atomic_fetch_add(&db->count, 1, __ATOMIC_RELEASE);
+    comm_send_event();
+}
+
+static inline uint32_t comm_count(struct comm_doorbell *db)
+{
+    return __atomic_load_n(&db->count, __ATOMIC_ACQUIRE);
+}
+
+#ifndef ALLWINNER_BARE_METAL
+
+#include <time.h>
+#include <sys/prctl.h>
+
+#define COMM_SPIN_MIN_NS	100000		// 100 us
+#define COMM_SPIN_MAX_NS	100000000	// 100 ms
+#define COMM_SLEEP_MIN_NS	10000		// 10 us
+#define COMM_SLEEP_MAX_NS	50000		// 50 us
+
+struct comm_waiter {
+    uint32_t seen;	// doorbell count when the last wait returned
+    uint32_t spin_ns;
+};
+
+static inline void comm_waiter_init(struct comm_waiter *w, struct comm_doorbell *db)
+{
+    w->seen = comm_count(db);
+    w->spin_ns = COMM_SPIN_MIN_NS;
+    prctl(PR_SET_TIMERSLACK, 1000UL);	// ns, for the calling thread
+}
+
+static inline uint64_t comm_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Waits until the doorbell has rung since the last wait returned.
+static inline void comm_wait(struct comm_waiter *w, struct comm_doorbell *db)
+{
+    uint32_t count = comm_count(db);
+    if (count != w->seen) {
+        w->seen = count;
+        return;
+    }
+
+    uint64_t start = comm_now_ns();
+    do {
+        comm_wait_for_event();
+        count = comm_count(db);
+        if (count != w->seen) {
+            w->seen = count;
+            if (w->spin_ns < COMM_SPIN_MAX_NS)
+                w->spin_ns *= 2;
+            return;
+        }
+    } while (comm_now_ns() - start < w->spin_ns);
+
+    struct timespec ts = { 0, COMM_SLEEP_MIN_NS };
+    for (;;) {
+        nanosleep(&ts, NULL);
+        count = comm_count(db);
+        if (count != w->seen)
+            break;
+        ts.tv_nsec *= 2;
+        if (ts.tv_nsec > COMM_SLEEP_MAX_NS)
+            ts.tv_nsec = COMM_SLEEP_MAX_NS;
+    }
+
+    w->seen = count;
+    if (w->spin_ns > COMM_SPIN_MIN_NS)
+        w->spin_ns /= 2;
+}
+
+#endif
+
+#endif
@@ -164,6 +164,7 @@ rule jh_link
 
 build libc_server.o: jh_cc libc_server.c
 build libc_server: jh_link libc_server.o
+  jh_ldflags = -lpthread
 build sdl_server.o: jh_cc sdl_server.c
 build sdl_server: jh_link sdl_server.o
   jh_ldflags = -lSDL2
@@ -57,6 +57,7 @@ extern "C" {
 	extern void invalidate_data_cache(void) __attribute__ ((optimize (3)));
 	extern void clean_data_cache(void) __attribute__ ((optimize (3)));
 	extern void invalidate_data_cache_l1_only(void) __attribute__ ((optimize (3)));
+	extern void CleanAndInvalidateDataCacheRange(void *addr, unsigned size);
 #endif
 
 #ifdef __cplusplus
@@ -34,7 +34,10 @@
 namespace artnet {
 static constexpr char NODE_ID[] = "Art-Net";			///< Array of 8 characters, the final character is a null termination. Value = A r t - N e t 0x00
 static constexpr auto MERGE_TIMEOUT_SECONDS = 10;
+static constexpr auto MERGE_SOURCES_PER_PORT = 2;			///< Average, the merge sources are pooled over all the output ports
 static constexpr auto NETWORK_DATA_LOSS_TIMEOUT = 10;	///< Seconds
+static constexpr auto RUN_MAX_PACKETS = 16;				///< Packets handled in one ArtNetNode::Run()
+static constexpr auto UDP_QUEUE_DEPTH = 80;				///< Room for a back-to-back burst of 64 universes followed by ArtSync
 }  // namespace artnet
 
 /**
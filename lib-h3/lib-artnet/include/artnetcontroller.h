@@ -41,6 +41,15 @@
 #define DMX_MAX_VALUE 255
 #endif
 
+namespace artnetcontroller {
+static constexpr uint32_t MAX_FRAME_UNIVERSES = 128;		///< A full frame is sent, the remaining universes follow in the next batch
+static constexpr uint32_t MAX_UNICAST_SUBSCRIBERS = 40;	///< More subscribers for a universe and it is broadcast
+static constexpr uint32_t FRAME_SENT_TIMEOUT_MILLIS = 100;
+static constexpr uint32_t MAX_FRAME_PACKETS = MAX_FRAME_UNIVERSES * MAX_UNICAST_SUBSCRIBERS;
+static constexpr uint32_t MAX_FRAME_DESTINATIONS = ARTNET_POLL_TABLE_SIZE_ENRIES + 1;	///< The nodes and the broadcast address
+static constexpr uint32_t FRAME_DESTINATION_HASH = 512;		///< Power of 2, at least twice MAX_FRAME_DESTINATIONS
+}  // namespace artnetcontroller
+
 struct TArtNetController {
 	uint32_t nIPAddressLocal;
 	uint32_t nIPAddressBroadcast;
@@ -62,6 +71,16 @@ public:
 	void HandleSync();
 	void HandleBlackout();
 
+	/**
+	 * Frame level output: the universes added are sent by CommitFrame(), grouped per destination,
+	 * followed by a single ArtSync. A universe added twice in the same frame is sent once, with the last data.
+	 */
+	void BeginFrame() {
+		m_nFrameUniverses = 0;
+	}
+	void AddUniverse(uint16_t nUniverse, const uint8_t *pDmxData, uint16_t nLength, uint8_t nPortIndex = 0);
+	void CommitFrame();
+
 	void SetRunTableCleanup(bool bDoTableCleanup) {
 		m_bDoTableCleanup = bDoTableCleanup;
 	}
@@ -107,6 +126,11 @@ private:
 	void HandleTrigger();
 	void ActiveUniversesAdd(uint16_t nUniverse);
 	void ActiveUniversesClear();
+	uint16_t SetDmx(struct TArtDmx *pArtDmx, uint16_t nUniverse, const uint8_t *pDmxData, uint16_t nLength, uint8_t nPortIndex);
+	void AllocateFrame();
+	void AddFramePacket(uint32_t nIp, uint32_t nUniverseIndex);
+	void SendFrame();
+	void WaitFrameSent();
 
 private:
 	struct TArtNetController m_tArtNetController;
@@ -124,6 +148,31 @@ private:
 	uint32_t m_nActiveUniverses{0};
 	uint32_t m_nMaster{DMX_MAX_VALUE};
 
+	static constexpr uint16_t FRAME_PACKET_END = 0xFFFF;
+
+	struct FrameDestination {
+		uint32_t nIp;
+		uint16_t nFirst;	///< Index in m_pFramePackets
+		uint16_t nLast;
+		uint16_t nSlot;		///< Index in m_pFrameDestinationHash
+	};
+
+	struct FramePacket {
+		uint16_t nUniverseIndex;
+		uint16_t nNext;
+	};
+
+	struct TArtDmx *m_pFrameArtDmx{nullptr};
+	uint16_t m_nFrameLength[artnetcontroller::MAX_FRAME_UNIVERSES];
+	uint32_t m_nFrameUniverses{0};
+	FrameDestination *m_pFrameDestinations{nullptr};
+	uint32_t m_nFrameDestinations{0};
+	FramePacket *m_pFramePackets{nullptr};
+	uint32_t m_nFramePackets{0};
+	uint16_t *m_pFrameDestinationHash{nullptr};
+	uint32_t m_nFrameSequence{0};
+	bool m_bFrameInFlight{false};
+
 public:
 	static ArtNetController *Get() {
 		return s_pThis;
@@ -36,6 +36,8 @@
 #include "packets.h"
 
 #include "lightset.h"
+#include "lightsetportlookup.h"
+#include "lightsetmergeengine.h"
 #include "ledblink.h"
 
 #include "artnettimecode.h"
@@ -132,12 +134,6 @@ struct TGenericPort {
 struct TOutputPort {
 	uint8_t data[ArtNet::DMX_LENGTH];	///< Data sent
 	uint16_t nLength;					///< Length of sent DMX data
-	uint8_t dataA[ArtNet::DMX_LENGTH];	///< The data received from Port A
-	uint32_t nMillisA;					///< The latest time of the data received from Port A
-	uint32_t ipA;						///< The IP address for port A
-	uint8_t dataB[ArtNet::DMX_LENGTH];	///< The data received from Port B
-	uint32_t nMillisB;					///< The latest time of the data received from Port B
-	uint32_t ipB;						///< The IP address for Port B
 	ArtNetMerge mergeMode;				///< \ref ArtNetMerge
 	bool IsDataPending;					///< ArtDMX received and waiting for ArtSync
 	bool bIsEnabled;					///< Is the port enabled ?
@@ -297,8 +293,9 @@ private:
 	void FillDiagData(void);
 #endif
 
-	void GetType();
+	TOpCodes GetType(uint16_t nBytesReceived) const;
 
+	void HandlePacket(void *pBuffer, uint16_t nBytesReceived);
 	void HandlePoll();
 	void HandleDmx();
 	void HandleSync();
@@ -313,10 +310,9 @@ private:
 	void HandleTrigger();
 
 	uint16_t MakePortAddress(uint16_t, uint8_t nPage = 0);
+	void UpdatePortLookup();
 
-	bool IsMergedDmxDataChanged(uint8_t, const uint8_t *, uint16_t);
-	void CheckMergeTimeouts(uint8_t);
-	bool IsDmxDataChanged(uint8_t, const uint8_t *, uint16_t);
+	void UpdateMergeState(uint32_t nPortIndex);
 
 	void SendPollRelply(bool);
 	void SendTod(uint8_t nPortId = 0);
@@ -348,13 +344,16 @@ private:
 	struct TArtNetNode m_Node;
 	struct TArtNetNodeState m_State;
 
-	struct TArtNetPacket m_ArtNetPacket;
+	union UArtPacket *m_pArtPacket { nullptr };	///< Points into the network receive buffer, valid until RecvRelease()
+	uint32_t m_nIPAddressFrom { 0 };
 	struct TArtPollReply m_PollReply;
 #if defined ( ENABLE_SENDDIAG )
 	struct TArtDiagData m_DiagData;
 #endif
 
 	struct TOutputPort m_OutputPorts[ARTNET_NODE_MAX_PORTS_OUTPUT];
+	LightSetPortLookup<ARTNET_NODE_MAX_PORTS_OUTPUT> m_OutputPortLookup;	///< Port-Address -> output ports
+	LightSetMergeEngine m_MergeEngine { ARTNET_NODE_MAX_PORTS_OUTPUT, ARTNET_NODE_MAX_PORTS_OUTPUT * artnet::MERGE_SOURCES_PER_PORT };
 	struct TInputPort m_InputPorts[ARTNET_NODE_MAX_PORTS_INPUT];
 
 	bool m_bDirectUpdate { false };
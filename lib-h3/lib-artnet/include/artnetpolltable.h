@@ -41,7 +41,9 @@ enum TArtNetPollInterval {
 enum TArtNetPollTableSizes {
 	ARTNET_POLL_TABLE_SIZE_ENRIES = 255,
 	ARTNET_POLL_TABLE_SIZE_NODE_UNIVERSES = 64,
-	ARTNET_POLL_TABLE_SIZE_UNIVERSES = 512
+	ARTNET_POLL_TABLE_SIZE_UNIVERSES = 512,
+	ARTNET_POLL_TABLE_HASH_NODES = 512,		///< Power of 2, at least twice ARTNET_POLL_TABLE_SIZE_ENRIES
+	ARTNET_POLL_TABLE_HASH_UNIVERSES = 1024	///< Power of 2, at least twice ARTNET_POLL_TABLE_SIZE_UNIVERSES
 };
 
 struct TArtNetNodeEntryUniverse {
@@ -67,9 +69,13 @@ struct TArtNetPollTableUniverses {
 struct TArtNetPollTableClean {
 	uint32_t nTableIndex;
 	uint32_t nUniverseIndex;
-	bool bOffLine;
 };
 
+/**
+ * The nodes and the universes are kept in dense arrays, removing an entry moves the last one into its place.
+ * Both are indexed by an open addressing hash table (linear probing, backward shift deletion),
+ * keyed by the IP address and by the Port-Address.
+ */
 class ArtNetPollTable {
 public:
 	ArtNetPollTable();
@@ -90,13 +96,32 @@ public:
 private:
 	uint16_t MakePortAddress(uint8_t nNetSwitch, uint8_t nSubSwitch, uint8_t nUniverse);
 	void ProcessUniverse(uint32_t nIpAddress, uint16_t nUniverse);
-	void RemoveIpAddress(uint32_t nEntry, uint32_t nIpAddressIndex);
+	void RemoveIpAddress(uint16_t nUniverse, uint32_t nIpAddress);
+	void RemoveNode(uint32_t nIndex);
+	void RemoveUniverse(uint32_t nIndex);
+
+	uint32_t FindNodeSlot(uint32_t nIpAddress) const;
+	uint32_t FindUniverseSlot(uint16_t nUniverse) const;
+	void NodeHashRemove(uint32_t nSlot);
+	void UniverseHashRemove(uint32_t nSlot);
+
+	static uint32_t HashIpAddress(uint32_t nIpAddress) {
+		return (nIpAddress * 2654435769U) >> (32 - 9);
+	}
+
+	static uint32_t HashUniverse(uint16_t nUniverse) {
+		return ((static_cast<uint32_t>(nUniverse) * 40503U) & 0xFFFF) >> (16 - 10);
+	}
 
 private:
+	static constexpr uint16_t HASH_EMPTY = 0xFFFF;
+
 	TArtNetNodeEntry *m_pPollTable;
 	uint32_t m_nPollTableEntries{0};
 	TArtNetPollTableUniverses *m_pTableUniverses;
 	uint32_t m_nTableUniversesEntries{0};
+	uint16_t *m_pNodeHash;
+	uint16_t *m_pUniverseHash;
 	TArtNetPollTableClean m_tTableClean;
 };
 
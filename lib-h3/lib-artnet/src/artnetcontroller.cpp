@@ -43,6 +43,10 @@
 
 #define ARTNET_MIN_HEADER_SIZE		12
 
+static_assert(artnetcontroller::FRAME_DESTINATION_HASH == (1U << 9), "AddFramePacket() expects 9 bits");
+static_assert(artnetcontroller::FRAME_DESTINATION_HASH >= 2 * artnetcontroller::MAX_FRAME_DESTINATIONS, "There must always be a free slot");
+static_assert(artnetcontroller::MAX_FRAME_PACKETS < 0xFFFF, "Packet index is 16 bits");
+
 static uint16_t s_ActiveUniverses[ARTNET_POLL_TABLE_SIZE_UNIVERSES] __attribute__ ((aligned (4)));
 
 ArtNetController *ArtNetController::s_pThis = nullptr;
@@ -91,6 +95,18 @@ ArtNetController::ArtNetController()
 ArtNetController::~ArtNetController() {
 	DEBUG_ENTRY
 
+	delete[] m_pFrameDestinationHash;
+	m_pFrameDestinationHash = nullptr;
+
+	delete[] m_pFramePackets;
+	m_pFramePackets = nullptr;
+
+	delete[] m_pFrameDestinations;
+	m_pFrameDestinations = nullptr;
+
+	delete[] m_pFrameArtDmx;
+	m_pFrameArtDmx = nullptr;
+
 	delete m_pArtNetPacket;
 	m_pArtNetPacket = nullptr;
 
@@ -119,15 +135,16 @@ void ArtNetController::Stop() {
 	DEBUG_EXIT
 }
 
-void ArtNetController::HandleDmxOut(uint16_t nUniverse, const uint8_t *pDmxData, uint16_t nLength, uint8_t nPortIndex) {
-	DEBUG_ENTRY
-
-	ActiveUniversesAdd(nUniverse);
+/**
+ * @return The ArtDmx packet length, the DMX512 data length is rounded up to an even number
+ */
+uint16_t ArtNetController::SetDmx(struct TArtDmx *pArtDmx, uint16_t nUniverse, const uint8_t *pDmxData, uint16_t nLength, uint8_t nPortIndex) {
+	if (nLength > ArtNet::DMX_LENGTH) {
+		nLength = ArtNet::DMX_LENGTH;
+	}
 
-	m_pArtDmx->Physical = nPortIndex;
-	m_pArtDmx->PortAddress = nUniverse;
-	m_pArtDmx->LengthHi = static_cast<uint8_t>((nLength & 0xFF00) >> 8);
-	m_pArtDmx->Length = static_cast<uint8_t>(nLength & 0xFF);
+	pArtDmx->Physical = nPortIndex;
+	pArtDmx->PortAddress = nUniverse;
 
 	// The sequence number is used to ensure that ArtDmx packets are used in the correct order.
 	// This field is incremented in the range 0x01 to 0xff to allow the receiving node to resequence packets.
@@ -137,16 +154,35 @@ void ArtNetController::HandleDmxOut(uint16_t nUniverse, const uint8_t *pDmxData,
 		m_pArtDmx->Sequence = 1;
 	}
 
+	pArtDmx->Sequence = m_pArtDmx->Sequence;
+
 	if (__builtin_expect((m_nMaster == DMX_MAX_VALUE), 1)) {
-		memcpy(m_pArtDmx->Data, pDmxData, nLength);
+		memcpy(pArtDmx->Data, pDmxData, nLength);
 	} else if (m_nMaster == 0) {
-		memset(m_pArtDmx->Data, 0, nLength);
+		memset(pArtDmx->Data, 0, nLength);
 	} else {
 		for (uint32_t i = 0; i < nLength; i++) {
-			m_pArtDmx->Data[i] = ((m_nMaster * static_cast<uint32_t>(pDmxData[i])) / DMX_MAX_VALUE) & 0xFF;
+			pArtDmx->Data[i] = ((m_nMaster * static_cast<uint32_t>(pDmxData[i])) / DMX_MAX_VALUE) & 0xFF;
 		}
 	}
 
+	if ((nLength & 0x1) != 0) {
+		pArtDmx->Data[nLength++] = 0;
+	}
+
+	pArtDmx->LengthHi = static_cast<uint8_t>((nLength & 0xFF00) >> 8);
+	pArtDmx->Length = static_cast<uint8_t>(nLength & 0xFF);
+
+	return static_cast<uint16_t>(sizeof(struct TArtDmx) - ArtNet::DMX_LENGTH + nLength);
+}
+
+void ArtNetController::HandleDmxOut(uint16_t nUniverse, const uint8_t *pDmxData, uint16_t nLength, uint8_t nPortIndex) {
+	DEBUG_ENTRY
+
+	ActiveUniversesAdd(nUniverse);
+
+	const auto nPacketLength = SetDmx(m_pArtDmx, nUniverse, pDmxData, nLength, nPortIndex);
+
 	uint32_t nCount = 0;
 	auto IpAddresses = const_cast<struct TArtNetPollTableUniverses*>(GetIpAddress(nUniverse));
 
@@ -161,9 +197,9 @@ void ArtNetController::HandleDmxOut(uint16_t nUniverse, const uint8_t *pDmxData,
 
 	// If the number of universe subscribers exceeds 40 for a given universe, the transmitting device may broadcast.
 
-	if (m_bUnicast && (nCount <= 40)) {
+	if (m_bUnicast && (nCount <= artnetcontroller::MAX_UNICAST_SUBSCRIBERS)) {
 		for (uint32_t nIndex = 0; nIndex < nCount; nIndex++) {
-			Network::Get()->SendTo(m_nHandle, m_pArtDmx, sizeof(struct TArtDmx), IpAddresses->pIpAddresses[nIndex], ArtNet::UDP_PORT);
+			Network::Get()->SendTo(m_nHandle, m_pArtDmx, nPacketLength, IpAddresses->pIpAddresses[nIndex], ArtNet::UDP_PORT);
 		}
 
 		m_bDmxHandled = true;
@@ -172,8 +208,8 @@ void ArtNetController::HandleDmxOut(uint16_t nUniverse, const uint8_t *pDmxData,
 		return;
 	}
 
-	if (!m_bUnicast || (nCount > 40)) {
-		Network::Get()->SendTo(m_nHandle, m_pArtDmx, sizeof(struct TArtDmx), m_tArtNetController.nIPAddressBroadcast, ArtNet::UDP_PORT);
+	if (!m_bUnicast || (nCount > artnetcontroller::MAX_UNICAST_SUBSCRIBERS)) {
+		Network::Get()->SendTo(m_nHandle, m_pArtDmx, nPacketLength, m_tArtNetController.nIPAddressBroadcast, ArtNet::UDP_PORT);
 
 		m_bDmxHandled = true;
 	}
@@ -181,6 +217,181 @@ void ArtNetController::HandleDmxOut(uint16_t nUniverse, const uint8_t *pDmxData,
 	DEBUG_EXIT
 }
 
+/**
+ * The frame buffers are only needed when the frame level output is used.
+ */
+void ArtNetController::AllocateFrame() {
+	DEBUG_ENTRY
+
+	m_pFrameArtDmx = new struct TArtDmx[artnetcontroller::MAX_FRAME_UNIVERSES];
+	assert(m_pFrameArtDmx != nullptr);
+
+	for (uint32_t i = 0; i < artnetcontroller::MAX_FRAME_UNIVERSES; i++) {
+		memcpy(&m_pFrameArtDmx[i], m_pArtDmx, sizeof(struct TArtDmx));
+	}
+
+	m_pFrameDestinations = new FrameDestination[artnetcontroller::MAX_FRAME_DESTINATIONS];
+	assert(m_pFrameDestinations != nullptr);
+
+	m_pFramePackets = new FramePacket[artnetcontroller::MAX_FRAME_PACKETS];
+	assert(m_pFramePackets != nullptr);
+
+	m_pFrameDestinationHash = new uint16_t[artnetcontroller::FRAME_DESTINATION_HASH];
+	assert(m_pFrameDestinationHash != nullptr);
+
+	for (uint32_t nSlot = 0; nSlot < artnetcontroller::FRAME_DESTINATION_HASH; nSlot++) {
+		m_pFrameDestinationHash[nSlot] = FRAME_PACKET_END;
+	}
+
+	DEBUG_EXIT
+}
+
+void ArtNetController::AddUniverse(uint16_t nUniverse, const uint8_t *pDmxData, uint16_t nLength, uint8_t nPortIndex) {
+	ActiveUniversesAdd(nUniverse);
+
+	if (__builtin_expect((m_pFrameArtDmx == nullptr), 0)) {
+		AllocateFrame();
+	}
+
+	WaitFrameSent();
+
+	uint32_t nIndex;
+
+	for (nIndex = 0; nIndex < m_nFrameUniverses; nIndex++) {
+		if (m_pFrameArtDmx[nIndex].PortAddress == nUniverse) {
+			break;
+		}
+	}
+
+	if (nIndex == artnetcontroller::MAX_FRAME_UNIVERSES) {
+		SendFrame();
+		nIndex = 0;
+	}
+
+	if (nIndex == m_nFrameUniverses) {
+		m_nFrameUniverses++;
+	}
+
+	m_nFrameLength[nIndex] = SetDmx(&m_pFrameArtDmx[nIndex], nUniverse, pDmxData, nLength, nPortIndex);
+}
+
+/**
+ * The packet is appended to the list of its destination, a new destination is added at the end.
+ */
+void ArtNetController::AddFramePacket(uint32_t nIp, uint32_t nUniverseIndex) {
+	assert(m_nFramePackets < artnetcontroller::MAX_FRAME_PACKETS);
+
+	auto nSlot = (nIp * 2654435769U) >> (32 - 9);
+
+	while (m_pFrameDestinationHash[nSlot] != FRAME_PACKET_END) {
+		if (m_pFrameDestinations[m_pFrameDestinationHash[nSlot]].nIp == nIp) {
+			break;
+		}
+		nSlot = (nSlot + 1) & (artnetcontroller::FRAME_DESTINATION_HASH - 1);
+	}
+
+	const auto nPacket = static_cast<uint16_t>(m_nFramePackets++);
+
+	m_pFramePackets[nPacket].nUniverseIndex = static_cast<uint16_t>(nUniverseIndex);
+	m_pFramePackets[nPacket].nNext = FRAME_PACKET_END;
+
+	if (m_pFrameDestinationHash[nSlot] == FRAME_PACKET_END) {
+		assert(m_nFrameDestinations < artnetcontroller::MAX_FRAME_DESTINATIONS);
+
+		auto& Destination = m_pFrameDestinations[m_nFrameDestinations];
+
+		Destination.nIp = nIp;
+		Destination.nFirst = nPacket;
+		Destination.nLast = nPacket;
+		Destination.nSlot = static_cast<uint16_t>(nSlot);
+
+		m_pFrameDestinationHash[nSlot] = static_cast<uint16_t>(m_nFrameDestinations++);
+		return;
+	}
+
+	auto& Destination = m_pFrameDestinations[m_pFrameDestinationHash[nSlot]];
+
+	m_pFramePackets[Destination.nLast].nNext = nPacket;
+	Destination.nLast = nPacket;
+}
+
+/**
+ * The subscribers are resolved once per frame. All the packets for one destination are sent together,
+ * in the order the universes were added. The destinations are in the order they were first seen.
+ */
+void ArtNetController::SendFrame() {
+	m_nFrameDestinations = 0;
+	m_nFramePackets = 0;
+
+	for (uint32_t nIndex = 0; nIndex < m_nFrameUniverses; nIndex++) {
+		if (m_bUnicast) {
+			const auto *IpAddresses = GetIpAddress(m_pFrameArtDmx[nIndex].PortAddress);
+
+			if (IpAddresses == nullptr) {
+				continue;
+			}
+
+			if (IpAddresses->nCount <= artnetcontroller::MAX_UNICAST_SUBSCRIBERS) {
+				for (uint32_t i = 0; i < IpAddresses->nCount; i++) {
+					AddFramePacket(IpAddresses->pIpAddresses[i], nIndex);
+				}
+				continue;
+			}
+		}
+
+		AddFramePacket(m_tArtNetController.nIPAddressBroadcast, nIndex);
+	}
+
+	for (uint32_t nDestination = 0; nDestination < m_nFrameDestinations; nDestination++) {
+		const auto& Destination = m_pFrameDestinations[nDestination];
+
+		for (auto nPacket = Destination.nFirst; nPacket != FRAME_PACKET_END; nPacket = m_pFramePackets[nPacket].nNext) {
+			const auto nIndex = m_pFramePackets[nPacket].nUniverseIndex;
+			uint32_t nSequence;
+
+			if (Network::Get()->SendToZeroCopy(m_nHandle, &m_pFrameArtDmx[nIndex], m_nFrameLength[nIndex], Destination.nIp, ArtNet::UDP_PORT, nSequence)) {
+				m_nFrameSequence = nSequence;
+				m_bFrameInFlight = true;
+			} else {
+				Network::Get()->SendTo(m_nHandle, &m_pFrameArtDmx[nIndex], m_nFrameLength[nIndex], Destination.nIp, ArtNet::UDP_PORT);
+			}
+		}
+
+		m_pFrameDestinationHash[Destination.nSlot] = FRAME_PACKET_END;
+	}
+
+	if (m_nFrameDestinations != 0) {
+		m_bDmxHandled = true;
+	}
+
+	m_nFrameUniverses = 0;
+}
+
+/**
+ * The frame packets are sent without a copy, they are not changed before the transmitter is done with them.
+ */
+void ArtNetController::WaitFrameSent() {
+	if (!m_bFrameInFlight) {
+		return;
+	}
+
+	const auto nMillis = Hardware::Get()->Millis();
+
+	while (!Network::Get()->IsSendDone(m_nFrameSequence)) {
+		if ((Hardware::Get()->Millis() - nMillis) > artnetcontroller::FRAME_SENT_TIMEOUT_MILLIS) {
+			DEBUG_PUTS("Frame send timeout");
+			break;
+		}
+	}
+
+	m_bFrameInFlight = false;
+}
+
+void ArtNetController::CommitFrame() {
+	SendFrame();
+	HandleSync();
+}
+
 void ArtNetController::HandleSync() {
 	if (m_bSynchronization && m_bDmxHandled) {
 		m_bDmxHandled = false;
@@ -208,7 +419,7 @@ void ArtNetController::HandleBlackout() {
 			}
 		}
 
-		if (m_bUnicast && (nCount <= 40)) {
+		if (m_bUnicast && (nCount <= artnetcontroller::MAX_UNICAST_SUBSCRIBERS)) {
 			// The sequence number is used to ensure that ArtDmx packets are used in the correct order.
 			// This field is incremented in the range 0x01 to 0xff to allow the receiving node to resequence packets.
 			m_pArtDmx->Sequence++;
@@ -224,7 +435,7 @@ void ArtNetController::HandleBlackout() {
 			continue;
 		}
 
-		if (!m_bUnicast || (nCount > 40)) {
+		if (!m_bUnicast || (nCount > artnetcontroller::MAX_UNICAST_SUBSCRIBERS)) {
 			// The sequence number is used to ensure that ArtDmx packets are used in the correct order.
 			// This field is incremented in the range 0x01 to 0xff to allow the receiving node to resequence packets.
 			m_pArtDmx->Sequence++;
@@ -61,11 +61,11 @@ void ArtNetNode::SetIpProgHandler(ArtNetIpProg *pArtNetIpProg) {
 }
 
 void ArtNetNode::HandleIpProg() {
-	struct TArtIpProg *packet = &(m_ArtNetPacket.ArtPacket.ArtIpProg);
+	struct TArtIpProg *packet = &(m_pArtPacket->ArtIpProg);
 
 	m_pArtNetIpProg->Handler(reinterpret_cast<const TArtNetIpProg*>(&packet->Command), reinterpret_cast<TArtNetIpProgReply*>(&m_pIpProgReply->ProgIpHi));
 
-	Network::Get()->SendTo(m_nHandle, m_pIpProgReply, sizeof(struct TArtIpProgReply), m_ArtNetPacket.IPAddressFrom, ArtNet::UDP_PORT);
+	Network::Get()->SendTo(m_nHandle, m_pIpProgReply, sizeof(struct TArtIpProgReply), m_nIPAddressFrom, ArtNet::UDP_PORT);
 
 	memcpy(ip.u8, &m_pIpProgReply->ProgIpHi, ArtNet::IP_SIZE);
 
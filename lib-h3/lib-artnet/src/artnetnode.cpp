@@ -52,6 +52,10 @@
 
 #include "artnetnode_internal.h"
 
+#if defined (ENABLE_LATENCY_TRACE)
+# include "h3_latency.h"
+#endif
+
 #include "debug.h"
 
 union uip {
@@ -149,6 +153,8 @@ void ArtNetNode::Start() {
 	m_nHandle = Network::Get()->Begin(ArtNet::UDP_PORT);
 	assert(m_nHandle != -1);
 
+	Network::Get()->SetQueueDepth(m_nHandle, artnet::UDP_QUEUE_DEPTH);
+
 	m_State.status = ARTNET_ON;
 
 	if (m_pArtNetDmx != nullptr) {
@@ -223,6 +229,8 @@ int ArtNetNode::SetUniverseSwitch(uint8_t nPortIndex, TArtNetPortDir dir, uint8_
 			}
 		}
 
+		UpdatePortLookup();
+
 		return ARTNET_EOK;
 	}
 
@@ -264,6 +272,8 @@ int ArtNetNode::SetUniverseSwitch(uint8_t nPortIndex, TArtNetPortDir dir, uint8_
 		}
 	}
 
+	UpdatePortLookup();
+
 	if ((m_pArtNet4Handler != nullptr) && (m_State.status != ARTNET_ON)) {
 		m_pArtNet4Handler->SetPort(nPortIndex, dir);
 	}
@@ -311,6 +321,8 @@ void ArtNetNode::SetSubnetSwitch(uint8_t nAddress, uint8_t nPage) {
 		m_OutputPorts[i].port.nPortAddress = MakePortAddress(m_OutputPorts[i].port.nPortAddress, (i / ArtNet::MAX_PORTS));
 	}
 
+	UpdatePortLookup();
+
 	if ((m_pArtNetStore != nullptr) && (m_State.status == ARTNET_ON)) {
 		if (nPage == 0) {
 			m_pArtNetStore->SaveSubnetSwitch(nAddress);
@@ -335,6 +347,8 @@ void ArtNetNode::SetNetSwitch(uint8_t nAddress, uint8_t nPage) {
 		m_OutputPorts[i].port.nPortAddress = MakePortAddress(m_OutputPorts[i].port.nPortAddress, (i / ArtNet::MAX_PORTS));
 	}
 
+	UpdatePortLookup();
+
 	if ((m_pArtNetStore != nullptr) && (m_State.status == ARTNET_ON)) {
 		if (nPage == 0) {
 			m_pArtNetStore->SaveNetSwitch(nAddress);
@@ -366,6 +380,16 @@ bool ArtNetNode::GetPortAddress(uint8_t nPortIndex, uint16_t &nAddress, TArtNetP
 	return m_OutputPorts[nPortIndex].bIsEnabled;
 }
 
+void ArtNetNode::UpdatePortLookup() {
+	m_OutputPortLookup.Clear();
+
+	for (uint32_t i = 0; i < (ArtNet::MAX_PORTS * m_nPages); i++) {
+		if (m_OutputPorts[i].bIsEnabled) {
+			m_OutputPortLookup.Add(m_OutputPorts[i].port.nPortAddress, i);
+		}
+	}
+}
+
 uint16_t ArtNetNode::MakePortAddress(uint16_t nCurrentAddress, uint8_t nPage) {
 	// PortAddress Bit 15 = 0
 	uint16_t newAddress = (m_Node.NetSwitch[nPage] & 0x7F) << 8;	// Net : Bits 14-8
@@ -541,16 +565,8 @@ void ArtNetNode::SendPollRelply(bool bResponse) {
 			if (m_OutputPorts[nPortIndex].tPortProtocol == PORT_ARTNET_ARTNET) {
 				nStatus &= (~GO_DATA_IS_BEING_TRANSMITTED);
 
-				if (m_OutputPorts[nPortIndex].ipA != 0) {
-					if ((m_nCurrentPacketMillis - m_OutputPorts[nPortIndex].nMillisA) < 1000) {
-						nStatus |= GO_DATA_IS_BEING_TRANSMITTED;
-					}
-				}
-
-				if (m_OutputPorts[nPortIndex].ipB != 0) {
-					if ((m_nCurrentPacketMillis - m_OutputPorts[nPortIndex].nMillisB) < 1000) {
-						nStatus |= GO_DATA_IS_BEING_TRANSMITTED;
-					}
+				if (m_MergeEngine.IsActive(nPortIndex, m_nCurrentPacketMillis, 1000)) {
+					nStatus |= GO_DATA_IS_BEING_TRANSMITTED;
 				}
 			} else {
 				if (m_pArtNet4Handler != nullptr) {
@@ -598,82 +614,23 @@ void ArtNetNode::SendPollRelply(bool bResponse) {
 	m_State.IsChanged = false;
 }
 
-bool ArtNetNode::IsDmxDataChanged(uint8_t nPortId, const uint8_t *pData, uint16_t nLength) {
-	bool isChanged = false;
-
-	const uint8_t *pSrc = pData;
-	uint8_t *pDst = m_OutputPorts[nPortId].data;
-
-	if (nLength != m_OutputPorts[nPortId].nLength) {
-		m_OutputPorts[nPortId].nLength = nLength;
-
-		for (uint32_t i = 0; i < nLength; i++) {
-			*pDst++ = *pSrc++;
-		}
-
-		return true;
-	}
-
-	for (uint32_t i = 0; i < nLength; i++) {
-		if (*pDst != *pSrc) {
-			isChanged = true;
-		}
-		*pDst++ = *pSrc++;
-	}
-
-	return isChanged;
-}
-
-bool ArtNetNode::IsMergedDmxDataChanged(uint8_t nPortId, const uint8_t *pData, uint16_t nLength) {
-	bool isChanged = false;
-
-	if (!m_State.IsMergeMode) {
-		m_State.IsMergeMode = true;
-		m_State.IsChanged = true;
-	}
-
-	m_OutputPorts[nPortId].port.nStatus |= GO_OUTPUT_IS_MERGING;
-
-
-	if (m_OutputPorts[nPortId].mergeMode == ArtNetMerge::HTP) {
+void ArtNetNode::UpdateMergeState(uint32_t nPortIndex) {
+	if (m_MergeEngine.IsMerging(nPortIndex)) {
+		m_OutputPorts[nPortIndex].port.nStatus |= GO_OUTPUT_IS_MERGING;
 
-		if (nLength != m_OutputPorts[nPortId].nLength) {
-			m_OutputPorts[nPortId].nLength = nLength;
-			for (uint32_t i = 0; i < nLength; i++) {
-				uint8_t data = std::max(m_OutputPorts[nPortId].dataA[i], m_OutputPorts[nPortId].dataB[i]);
-				m_OutputPorts[nPortId].data[i] = data;
-			}
-			return true;
-		}
-
-		for (uint32_t i = 0; i < nLength; i++) {
-			uint8_t data = std::max(m_OutputPorts[nPortId].dataA[i], m_OutputPorts[nPortId].dataB[i]);
-			if (data != m_OutputPorts[nPortId].data[i]) {
-				m_OutputPorts[nPortId].data[i] = data;
-				isChanged = true;
-			}
+		if (!m_State.IsMergeMode) {
+			m_State.IsMergeMode = true;
+			m_State.IsChanged = true;
 		}
 
-		return isChanged;
-	} else {
-		return IsDmxDataChanged(nPortId, pData, nLength);
+		return;
 	}
-}
 
-void ArtNetNode::CheckMergeTimeouts(uint8_t nPortId) {
-	const uint32_t nTimeOutAMillis = m_nCurrentPacketMillis - m_OutputPorts[nPortId].nMillisA;
-
-	if (nTimeOutAMillis > (artnet::MERGE_TIMEOUT_SECONDS * 1000)) {
-		m_OutputPorts[nPortId].ipA = 0;
-		m_OutputPorts[nPortId].port.nStatus &= (~GO_OUTPUT_IS_MERGING);
+	if ((m_OutputPorts[nPortIndex].port.nStatus & GO_OUTPUT_IS_MERGING) == 0) {
+		return;
 	}
 
-	const uint32_t nTimeOutBMillis = m_nCurrentPacketMillis - m_OutputPorts[nPortId].nMillisB;
-
-	if (nTimeOutBMillis > (artnet::MERGE_TIMEOUT_SECONDS * 1000)) {
-		m_OutputPorts[nPortId].ipB = 0;
-		m_OutputPorts[nPortId].port.nStatus &= (~GO_OUTPUT_IS_MERGING);
-	}
+	m_OutputPorts[nPortIndex].port.nStatus &= (~GO_OUTPUT_IS_MERGING);
 
 	bool bIsMerging = false;
 
@@ -681,7 +638,7 @@ void ArtNetNode::CheckMergeTimeouts(uint8_t nPortId) {
 		bIsMerging |= ((m_OutputPorts[i].port.nStatus & GO_OUTPUT_IS_MERGING) != 0);
 	}
 
-	if (!bIsMerging) {
+	if (!bIsMerging && m_State.IsMergeMode) {
 		m_State.IsChanged = true;
 		m_State.IsMergeMode = false;
 #if defined ( ENABLE_SENDDIAG )
@@ -691,7 +648,7 @@ void ArtNetNode::CheckMergeTimeouts(uint8_t nPortId) {
 }
 
 void ArtNetNode::HandlePoll() {
-	const auto *pArtPoll = &(m_ArtNetPacket.ArtPacket.ArtPoll);
+	const auto *pArtPoll = &(m_pArtPacket->ArtPoll);
 
 	if (pArtPoll->TalkToMe & ArtNetTalkToMe::SEND_ARTP_ON_CHANGE) {
 		m_State.SendArtPollReplyOnChange = true;
@@ -704,8 +661,8 @@ void ArtNetNode::HandlePoll() {
 		m_State.SendArtDiagData = true;
 
 		if (m_State.IPAddressArtPoll == 0) {
-			m_State.IPAddressArtPoll = m_ArtNetPacket.IPAddressFrom;
-		} else if (!m_State.IsMultipleControllersReqDiag && (m_State.IPAddressArtPoll != m_ArtNetPacket.IPAddressFrom)) {
+			m_State.IPAddressArtPoll = m_nIPAddressFrom;
+		} else if (!m_State.IsMultipleControllersReqDiag && (m_State.IPAddressArtPoll != m_nIPAddressFrom)) {
 			// If there are multiple controllers requesting diagnostics, diagnostics shall be broadcast.
 			m_State.IPAddressDiagSend = m_Node.IPAddressBroadcast;
 			m_State.IsMultipleControllersReqDiag = true;
@@ -720,7 +677,7 @@ void ArtNetNode::HandlePoll() {
 
 		// If there are multiple controllers requesting diagnostics, diagnostics shall be broadcast. (Ignore ArtPoll->TalkToMe->3).
 		if (!m_State.IsMultipleControllersReqDiag && (pArtPoll->TalkToMe & ArtNetTalkToMe::SEND_DIAG_UNICAST)) {
-			m_State.IPAddressDiagSend = m_ArtNetPacket.IPAddressFrom;
+			m_State.IPAddressDiagSend = m_nIPAddressFrom;
 		} else {
 			m_State.IPAddressDiagSend = m_Node.IPAddressBroadcast;
 		}
@@ -733,103 +690,58 @@ void ArtNetNode::HandlePoll() {
 }
 
 void ArtNetNode::HandleDmx() {
-	const auto *pArtDmx = &(m_ArtNetPacket.ArtPacket.ArtDmx);
+#if defined (ENABLE_LATENCY_TRACE)
+	h3_latency_record(H3_LATENCY_DMX);
+#endif
+
+	const auto *pArtDmx = &(m_pArtPacket->ArtDmx);
 
 	uint32_t data_length = (static_cast<uint32_t>(pArtDmx->LengthHi << 8) & 0xff00) | pArtDmx->Length;
 	data_length = std::min(data_length, ArtNet::DMX_LENGTH);
 
-	for (uint32_t i = 0; i < (ArtNet::MAX_PORTS * m_nPages); i++) {
-
-		if (m_OutputPorts[i].bIsEnabled && (m_OutputPorts[i].tPortProtocol == PORT_ARTNET_ARTNET) && (pArtDmx->PortAddress == m_OutputPorts[i].port.nPortAddress)) {
+	auto nPortMask = m_OutputPortLookup.Get(pArtDmx->PortAddress);
 
-			uint32_t ipA = m_OutputPorts[i].ipA;
-			uint32_t ipB = m_OutputPorts[i].ipB;
+	while (nPortMask != 0) {
+		const auto i = static_cast<uint32_t>(__builtin_ctz(nPortMask));
+		nPortMask &= (nPortMask - 1);
 
-			bool sendNewData = false;
+		if (m_OutputPorts[i].tPortProtocol == PORT_ARTNET_ARTNET) {
 
 			m_OutputPorts[i].port.nStatus = m_OutputPorts[i].port.nStatus | GO_DATA_IS_BEING_TRANSMITTED;
 
-			if (m_State.IsMergeMode) {
-				if (__builtin_expect((!m_State.bDisableMergeTimeout), 1)) {
-					CheckMergeTimeouts(i);
-				}
+			if (__builtin_expect((!m_State.bDisableMergeTimeout), 1)) {
+				m_MergeEngine.CheckTimeouts(i, m_nCurrentPacketMillis, artnet::MERGE_TIMEOUT_SECONDS * 1000);
 			}
 
-			if (ipA == 0 && ipB == 0) {
-#if defined ( ENABLE_SENDDIAG )
-				SendDiag("1. first packet recv on this port", ARTNET_DP_LOW);
-#endif
-				m_OutputPorts[i].ipA = m_ArtNetPacket.IPAddressFrom;
-				m_OutputPorts[i].nMillisA = m_nCurrentPacketMillis;
-				memcpy(&m_OutputPorts[i].dataA, pArtDmx->Data, data_length);
-				sendNewData = IsDmxDataChanged(i, pArtDmx->Data, data_length);
-			} else if (ipA == m_ArtNetPacket.IPAddressFrom && ipB == 0) {
-#if defined ( ENABLE_SENDDIAG )
-				SendDiag("2. continued transmission from the same ip (source A)", ARTNET_DP_LOW);
-#endif
-				m_OutputPorts[i].nMillisA = m_nCurrentPacketMillis;
-				memcpy(&m_OutputPorts[i].dataA, pArtDmx->Data, data_length);
-				sendNewData = IsDmxDataChanged(i, pArtDmx->Data, data_length);
-			} else if (ipA == 0 && ipB == m_ArtNetPacket.IPAddressFrom) {
-#if defined ( ENABLE_SENDDIAG )
-				SendDiag("3. continued transmission from the same ip (source B)", ARTNET_DP_LOW);
-#endif
-				m_OutputPorts[i].nMillisB = m_nCurrentPacketMillis;
-				memcpy(&m_OutputPorts[i].dataB, pArtDmx->Data, data_length);
-				sendNewData = IsDmxDataChanged(i, pArtDmx->Data, data_length);
-			} else if (ipA != m_ArtNetPacket.IPAddressFrom && ipB == 0) {
-#if defined ( ENABLE_SENDDIAG )
-				SendDiag("4. new source, start the merge", ARTNET_DP_LOW);
-#endif
-				m_OutputPorts[i].ipB = m_ArtNetPacket.IPAddressFrom;
-				m_OutputPorts[i].nMillisB = m_nCurrentPacketMillis;
-				memcpy(&m_OutputPorts[i].dataB, pArtDmx->Data, data_length);
-				sendNewData = IsMergedDmxDataChanged(i, m_OutputPorts[i].dataB, data_length);
-			} else if (ipA == 0 && ipB != m_ArtNetPacket.IPAddressFrom) {
-#if defined ( ENABLE_SENDDIAG )
-				SendDiag("5. new source, start the merge", ARTNET_DP_LOW);
-#endif
-				m_OutputPorts[i].ipA = m_ArtNetPacket.IPAddressFrom;
-				m_OutputPorts[i].nMillisA = m_nCurrentPacketMillis;
-				memcpy(&m_OutputPorts[i].dataA, pArtDmx->Data, data_length);
-				sendNewData = IsMergedDmxDataChanged(i, m_OutputPorts[i].dataA, data_length);
-			} else if (ipA == m_ArtNetPacket.IPAddressFrom && ipB != m_ArtNetPacket.IPAddressFrom) {
-#if defined ( ENABLE_SENDDIAG )
-				SendDiag("6. continue merge", ARTNET_DP_LOW);
-#endif
-				m_OutputPorts[i].nMillisA = m_nCurrentPacketMillis;
-				memcpy(&m_OutputPorts[i].dataA, pArtDmx->Data, data_length);
-				sendNewData = IsMergedDmxDataChanged(i, m_OutputPorts[i].dataA, data_length);
-			} else if (ipA != m_ArtNetPacket.IPAddressFrom && ipB == m_ArtNetPacket.IPAddressFrom) {
-#if defined ( ENABLE_SENDDIAG )
-				SendDiag("7. continue merge", ARTNET_DP_LOW);
-#endif
-				m_OutputPorts[i].nMillisB = m_nCurrentPacketMillis;
-				memcpy(&m_OutputPorts[i].dataB, pArtDmx->Data, data_length);
-				sendNewData = IsMergedDmxDataChanged(i, m_OutputPorts[i].dataB, data_length);
-			} else if (ipA == m_ArtNetPacket.IPAddressFrom && ipB == m_ArtNetPacket.IPAddressFrom) {
-#if defined ( ENABLE_SENDDIAG )
-				SendDiag("8. Source matches both buffers, this shouldn't be happening!", ARTNET_DP_LOW);
-#endif
-				return;
-			} else if (ipA != m_ArtNetPacket.IPAddressFrom && ipB != m_ArtNetPacket.IPAddressFrom) {
-#if defined ( ENABLE_SENDDIAG )
-				SendDiag("9. More than two sources, discarding data", ARTNET_DP_LOW);
-#endif
-				return;
-			} else {
+			auto *pSource = m_MergeEngine.Find(i, m_nIPAddressFrom);
+
+			if (pSource == nullptr) {
+				pSource = m_MergeEngine.Add(i, m_nIPAddressFrom);
+
+				if (pSource == nullptr) {
 #if defined ( ENABLE_SENDDIAG )
-				SendDiag("0. No cases matched, this shouldn't happen!", ARTNET_DP_LOW);
+					SendDiag("No free merge source, discarding data", ARTNET_DP_LOW);
 #endif
-				return;
+					continue;
+				}
 			}
 
+			m_MergeEngine.SetData(pSource, pArtDmx->Data, data_length, LightSetMergeEngine::PRIORITY_DEFAULT, m_nCurrentPacketMillis);
+
+			const auto mergeMode = (m_OutputPorts[i].mergeMode == ArtNetMerge::LTP) ? lightset::MergeMode::LTP : lightset::MergeMode::HTP;
+			const auto sendNewData = m_MergeEngine.Merge(i, mergeMode, m_OutputPorts[i].data, m_OutputPorts[i].nLength);
+
+			UpdateMergeState(i);
+
 			if (sendNewData || m_bDirectUpdate) {
 				if (!m_State.IsSynchronousMode) {
 #if defined ( ENABLE_SENDDIAG )
 					SendDiag("Send new data", ARTNET_DP_LOW);
 #endif
 					m_pLightSet->SetData(i, m_OutputPorts[i].data, m_OutputPorts[i].nLength);
+#if defined (ENABLE_LATENCY_TRACE)
+					h3_latency_record(H3_LATENCY_SETDATA);
+#endif
 
 					if(!m_IsLightSetRunning[i]) {
 						m_pLightSet->Start(i);
@@ -863,6 +775,9 @@ void ArtNetNode::HandleSync() {
 			SendDiag("Send pending data", ARTNET_DP_LOW);
 #endif
 			m_pLightSet->SetData(i, m_OutputPorts[i].data, 	m_OutputPorts[i].nLength);
+#if defined (ENABLE_LATENCY_TRACE)
+			h3_latency_record(H3_LATENCY_SETDATA);
+#endif
 
 			if(!m_IsLightSetRunning[i]) {
 				m_pLightSet->Start(i);
@@ -875,7 +790,7 @@ void ArtNetNode::HandleSync() {
 }
 
 void ArtNetNode::HandleAddress() {
-	const auto *pArtAddress = &(m_ArtNetPacket.ArtPacket.ArtAddress);
+	const auto *pArtAddress = &(m_pArtPacket->ArtAddress);
 	uint8_t nPort = 0xFF;
 
 	m_State.reportCode = ARTNET_RCPOWEROK;
@@ -1015,37 +930,35 @@ void ArtNetNode::SetNetworkDataLossCondition() {
 			m_IsLightSetRunning[i] = false;
 		}
 
-		m_OutputPorts[i].port.nStatus &= (~GO_DATA_IS_BEING_TRANSMITTED);
+		m_OutputPorts[i].port.nStatus &= static_cast<uint8_t>(~(GO_DATA_IS_BEING_TRANSMITTED | GO_OUTPUT_IS_MERGING));
 		m_OutputPorts[i].nLength = 0;
-		m_OutputPorts[i].ipA = 0;
-		m_OutputPorts[i].ipB = 0;
+		m_MergeEngine.Clear(i);
 	}
 }
 
-void ArtNetNode::GetType() {
-	auto *data = reinterpret_cast<char*>(&(m_ArtNetPacket.ArtPacket));
+TOpCodes ArtNetNode::GetType(uint16_t nBytesReceived) const {
+	const auto *data = reinterpret_cast<const char*>(m_pArtPacket);
 
-	if (m_ArtNetPacket.length < ARTNET_MIN_HEADER_SIZE) {
-		m_ArtNetPacket.OpCode = OP_NOT_DEFINED;
-		return;
+	if (nBytesReceived < ARTNET_MIN_HEADER_SIZE) {
+		return OP_NOT_DEFINED;
 	}
 
 	if ((data[10] != 0) || (data[11] != ArtNet::PROTOCOL_REVISION)) {
-		m_ArtNetPacket.OpCode = OP_NOT_DEFINED;
-		return;
+		return OP_NOT_DEFINED;
 	}
 
 	if (memcmp(data, "Art-Net\0", 8) == 0) {
-		m_ArtNetPacket.OpCode = static_cast<TOpCodes>(((data[9] << 8)) + data[8]);
-	} else {
-		m_ArtNetPacket.OpCode = OP_NOT_DEFINED;
+		return static_cast<TOpCodes>(((data[9] << 8)) + data[8]);
 	}
+
+	return OP_NOT_DEFINED;
 }
 
 void ArtNetNode::Run() {
 	uint16_t nForeignPort;
+	void *pBuffer;
 
-	const auto nBytesReceived = Network::Get()->RecvFrom(m_nHandle, &(m_ArtNetPacket.ArtPacket), sizeof(m_ArtNetPacket.ArtPacket), &m_ArtNetPacket.IPAddressFrom, &nForeignPort);
+	auto nBytesReceived = Network::Get()->RecvFromZeroCopy(m_nHandle, &pBuffer, &m_nIPAddressFrom, &nForeignPort);
 
 	m_nCurrentPacketMillis = Hardware::Get()->Millis();
 
@@ -1086,10 +999,33 @@ void ArtNetNode::Run() {
 		return;
 	}
 
-	m_ArtNetPacket.length = nBytesReceived;
-	m_nPreviousPacketMillis = m_nCurrentPacketMillis;
+	/*
+	 * A burst is drained in one call, bounded so that the rest of the main loop keeps running.
+	 */
+	auto nPackets = artnet::RUN_MAX_PACKETS;
+
+	do {
+		HandlePacket(pBuffer, nBytesReceived);
+		Network::Get()->RecvRelease(m_nHandle);
+	} while ((--nPackets != 0) && ((nBytesReceived = Network::Get()->RecvFromZeroCopy(m_nHandle, &pBuffer, &m_nIPAddressFrom, &nForeignPort)) != 0));
 
-	GetType();
+	if (m_pArtNetDmx != nullptr) {
+		HandleDmxIn();
+	}
+
+	if (((m_Node.Status1 & STATUS1_INDICATOR_MASK) == STATUS1_INDICATOR_NORMAL_MODE)) {
+		if (m_State.bIsReceivingDmx) {
+			LedBlink::Get()->SetMode(ledblink::Mode::DATA);
+		} else {
+			LedBlink::Get()->SetMode(ledblink::Mode::NORMAL);
+		}
+	}
+
+}
+
+void ArtNetNode::HandlePacket(void *pBuffer, uint16_t nBytesReceived) {
+	m_pArtPacket = reinterpret_cast<union UArtPacket*>(pBuffer);
+	m_nPreviousPacketMillis = m_nCurrentPacketMillis;
 
 	if (m_State.IsSynchronousMode) {
 		if (m_nCurrentPacketMillis - m_State.nArtSyncMillis >= (4 * 1000)) {
@@ -1097,7 +1033,7 @@ void ArtNetNode::Run() {
 		}
 	}
 
-	switch (m_ArtNetPacket.OpCode) {
+	switch (GetType(nBytesReceived)) {
 	case OP_POLL:
 		HandlePoll();
 		break;
@@ -1154,17 +1090,4 @@ void ArtNetNode::Run() {
 		// Just skip ... no error
 		break;
 	}
-
-	if (m_pArtNetDmx != nullptr) {
-		HandleDmxIn();
-	}
-
-	if (((m_Node.Status1 & STATUS1_INDICATOR_MASK) == STATUS1_INDICATOR_NORMAL_MODE)) {
-		if (m_State.bIsReceivingDmx) {
-			LedBlink::Get()->SetMode(ledblink::Mode::DATA);
-		} else {
-			LedBlink::Get()->SetMode(ledblink::Mode::NORMAL);
-		}
-	}
-
 }
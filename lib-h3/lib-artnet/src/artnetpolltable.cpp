@@ -50,6 +50,11 @@ union uip {
 	uint8_t u8[4];
 } static ip;
 
+static_assert(ARTNET_POLL_TABLE_HASH_NODES == (1U << 9), "HashIpAddress() expects 9 bits");
+static_assert(ARTNET_POLL_TABLE_HASH_UNIVERSES == (1U << 10), "HashUniverse() expects 10 bits");
+static_assert(ARTNET_POLL_TABLE_HASH_NODES >= 2 * ARTNET_POLL_TABLE_SIZE_ENRIES, "There must always be a free slot");
+static_assert(ARTNET_POLL_TABLE_HASH_UNIVERSES >= 2 * ARTNET_POLL_TABLE_SIZE_UNIVERSES, "There must always be a free slot");
+
 ArtNetPollTable::ArtNetPollTable() {
 	m_pPollTable = new TArtNetNodeEntry[ARTNET_POLL_TABLE_SIZE_ENRIES];
 	assert(m_pPollTable != nullptr);
@@ -66,15 +71,34 @@ ArtNetPollTable::ArtNetPollTable() {
 		assert(m_pTableUniverses[nIndex].pIpAddresses != nullptr);
 	}
 
+	m_pNodeHash = new uint16_t[ARTNET_POLL_TABLE_HASH_NODES];
+	assert(m_pNodeHash != nullptr);
+
+	m_pUniverseHash = new uint16_t[ARTNET_POLL_TABLE_HASH_UNIVERSES];
+	assert(m_pUniverseHash != nullptr);
+
+	for (uint32_t nSlot = 0; nSlot < ARTNET_POLL_TABLE_HASH_NODES; nSlot++) {
+		m_pNodeHash[nSlot] = HASH_EMPTY;
+	}
+
+	for (uint32_t nSlot = 0; nSlot < ARTNET_POLL_TABLE_HASH_UNIVERSES; nSlot++) {
+		m_pUniverseHash[nSlot] = HASH_EMPTY;
+	}
+
 	DEBUG_PRINTF("TArtNetNodeEntry[%d] = %ld bytes [%ld Kb]", ARTNET_POLL_TABLE_SIZE_ENRIES, (sizeof(TArtNetNodeEntry[ARTNET_POLL_TABLE_SIZE_ENRIES])), (sizeof(TArtNetNodeEntry[ARTNET_POLL_TABLE_SIZE_ENRIES])) / 1024);
 	DEBUG_PRINTF("TArtNetPollTableUniverses[%d] = %ld bytes [%ld Kb]", ARTNET_POLL_TABLE_SIZE_UNIVERSES, (sizeof(TArtNetPollTableUniverses[ARTNET_POLL_TABLE_SIZE_UNIVERSES])), (sizeof(TArtNetPollTableUniverses[ARTNET_POLL_TABLE_SIZE_UNIVERSES])) / 1024);
 
 	m_tTableClean.nTableIndex = 0;
 	m_tTableClean.nUniverseIndex = 0;
-	m_tTableClean.bOffLine = true;
 }
 
 ArtNetPollTable::~ArtNetPollTable() {
+	delete[] m_pUniverseHash;
+	m_pUniverseHash = nullptr;
+
+	delete[] m_pNodeHash;
+	m_pNodeHash = nullptr;
+
 	for (uint32_t nIndex = 0; nIndex < ARTNET_POLL_TABLE_SIZE_UNIVERSES; nIndex++) {
 		delete[] m_pTableUniverses[nIndex].pIpAddresses;
 		m_pTableUniverses[nIndex].pIpAddresses = nullptr;
@@ -96,206 +120,253 @@ uint16_t ArtNetPollTable::MakePortAddress(uint8_t nNetSwitch, uint8_t nSubSwitch
 	return nPortAddress;
 }
 
-const struct TArtNetPollTableUniverses *ArtNetPollTable::GetIpAddress(uint16_t nUniverse) {
-	if (m_nTableUniversesEntries == 0) {
-		return nullptr;
-	}
-
-	// FIXME Universe lookup
-	for (uint32_t nEntry = 0; nEntry < m_nTableUniversesEntries; nEntry++) {
-		TArtNetPollTableUniverses *pTableUniverses = &m_pTableUniverses[nEntry];
-		assert(pTableUniverses != nullptr);
+/**
+ * @return The hash slot holding the node, or the free slot where it is to be inserted
+ */
+uint32_t ArtNetPollTable::FindNodeSlot(uint32_t nIpAddress) const {
+	auto nSlot = HashIpAddress(nIpAddress);
 
-		if (pTableUniverses->nUniverse == nUniverse) {
-			return &m_pTableUniverses[nEntry];
+	while (m_pNodeHash[nSlot] != HASH_EMPTY) {
+		if (m_pPollTable[m_pNodeHash[nSlot]].IPAddress == nIpAddress) {
+			break;
 		}
+		nSlot = (nSlot + 1) & (ARTNET_POLL_TABLE_HASH_NODES - 1);
 	}
 
-	return nullptr;
+	return nSlot;
 }
 
+/**
+ * @return The hash slot holding the universe, or the free slot where it is to be inserted
+ */
+uint32_t ArtNetPollTable::FindUniverseSlot(uint16_t nUniverse) const {
+	auto nSlot = HashUniverse(nUniverse);
 
-void ArtNetPollTable::RemoveIpAddress(uint32_t nUniverse, uint32_t nIpAddress) {
-	if (m_nTableUniversesEntries == 0) {
-		return;
+	while (m_pUniverseHash[nSlot] != HASH_EMPTY) {
+		if (m_pTableUniverses[m_pUniverseHash[nSlot]].nUniverse == nUniverse) {
+			break;
+		}
+		nSlot = (nSlot + 1) & (ARTNET_POLL_TABLE_HASH_UNIVERSES - 1);
 	}
 
-	uint32_t nEntry = 0;
+	return nSlot;
+}
 
-	// FIXME Universe lookup
-	for (nEntry = 0; nEntry < m_nTableUniversesEntries; nEntry++) {
-		TArtNetPollTableUniverses *pTableUniverses = &m_pTableUniverses[nEntry];
-		assert(pTableUniverses != nullptr);
+/**
+ * Backward shift deletion: the entries following the free slot are moved back
+ * when their home slot is not in between, so lookups never need tombstones.
+ */
+void ArtNetPollTable::NodeHashRemove(uint32_t nSlot) {
+	auto nNext = nSlot;
+
+	for (;;) {
+		nNext = (nNext + 1) & (ARTNET_POLL_TABLE_HASH_NODES - 1);
 
-		if (pTableUniverses->nUniverse == nUniverse) {
+		if (m_pNodeHash[nNext] == HASH_EMPTY) {
 			break;
 		}
-	}
 
-	if (nEntry == m_nTableUniversesEntries) {
-		// Universe not found
-		return;
+		const auto nHome = HashIpAddress(m_pPollTable[m_pNodeHash[nNext]].IPAddress);
+		const auto bInBetween = (nSlot <= nNext) ? ((nSlot < nHome) && (nHome <= nNext)) : ((nSlot < nHome) || (nHome <= nNext));
+
+		if (!bInBetween) {
+			m_pNodeHash[nSlot] = m_pNodeHash[nNext];
+			nSlot = nNext;
+		}
 	}
 
-	TArtNetPollTableUniverses *pTableUniverses = &m_pTableUniverses[nEntry];
-	assert(pTableUniverses->nCount > 0);
+	m_pNodeHash[nSlot] = HASH_EMPTY;
+}
 
-	uint32_t nIpAddressIndex = 0;
+void ArtNetPollTable::UniverseHashRemove(uint32_t nSlot) {
+	auto nNext = nSlot;
 
-	// FIXME IP lookup
-	for (nIpAddressIndex = 0; nIpAddressIndex < pTableUniverses->nCount; nIpAddressIndex++) {
-		if (pTableUniverses->pIpAddresses[nIpAddressIndex] == nIpAddress) {
+	for (;;) {
+		nNext = (nNext + 1) & (ARTNET_POLL_TABLE_HASH_UNIVERSES - 1);
+
+		if (m_pUniverseHash[nNext] == HASH_EMPTY) {
 			break;
 		}
+
+		const auto nHome = HashUniverse(m_pTableUniverses[m_pUniverseHash[nNext]].nUniverse);
+		const auto bInBetween = (nSlot <= nNext) ? ((nSlot < nHome) && (nHome <= nNext)) : ((nSlot < nHome) || (nHome <= nNext));
+
+		if (!bInBetween) {
+			m_pUniverseHash[nSlot] = m_pUniverseHash[nNext];
+			nSlot = nNext;
+		}
 	}
 
-	uint32_t *p32 = pTableUniverses->pIpAddresses;
-	int32_t i;
+	m_pUniverseHash[nSlot] = HASH_EMPTY;
+}
 
-	for (i = static_cast<int32_t>(nIpAddressIndex); i < static_cast<int32_t>(pTableUniverses->nCount) - 1; i++) {
-		p32[i] = p32[i + 1];
+const struct TArtNetPollTableUniverses *ArtNetPollTable::GetIpAddress(uint16_t nUniverse) {
+	if (m_nTableUniversesEntries == 0) {
+		return nullptr;
 	}
 
-	p32[i] = 0;
+	const auto nIndex = m_pUniverseHash[FindUniverseSlot(nUniverse)];
 
-	pTableUniverses->nCount--;
+	if (nIndex == HASH_EMPTY) {
+		return nullptr;
+	}
 
-	if (pTableUniverses->nCount == 0) {
-		DEBUG_PRINTF("Delete Universe -> m_nTableUniversesEntries=%u, nEntry=%u", m_nTableUniversesEntries, nEntry);
+	return &m_pTableUniverses[nIndex];
+}
 
-		TArtNetPollTableUniverses *p = m_pTableUniverses;
+/**
+ * The last universe is moved into the free place, the IP address buffers are swapped.
+ */
+void ArtNetPollTable::RemoveUniverse(uint32_t nIndex) {
+	assert(nIndex < m_nTableUniversesEntries);
 
-		for (i = static_cast<int32_t>(nEntry); i < static_cast<int32_t>(m_nTableUniversesEntries) - 1; i++) {
-			p[i].nUniverse = p[i + 1].nUniverse;
-			p[i].nCount = p[i + 1].nCount;
-			p[i].pIpAddresses = p[i + 1].pIpAddresses;
-		}
+	DEBUG_PRINTF("Delete Universe -> m_nTableUniversesEntries=%u, nIndex=%u", m_nTableUniversesEntries, nIndex);
+
+	UniverseHashRemove(FindUniverseSlot(m_pTableUniverses[nIndex].nUniverse));
+
+	m_nTableUniversesEntries--;
 
-		p[i].nUniverse = 0;
-		p[i].nCount = 0;
+	if (nIndex != m_nTableUniversesEntries) {
+		auto *pDst = &m_pTableUniverses[nIndex];
+		auto *pSrc = &m_pTableUniverses[m_nTableUniversesEntries];
+		auto *pIpAddresses = pDst->pIpAddresses;
 
-		m_nTableUniversesEntries--;
+		pDst->nUniverse = pSrc->nUniverse;
+		pDst->nCount = pSrc->nCount;
+		pDst->pIpAddresses = pSrc->pIpAddresses;
+		pSrc->pIpAddresses = pIpAddresses;
+
+		m_pUniverseHash[FindUniverseSlot(pDst->nUniverse)] = static_cast<uint16_t>(nIndex);
 	}
+
+	m_pTableUniverses[m_nTableUniversesEntries].nUniverse = 0;
+	m_pTableUniverses[m_nTableUniversesEntries].nCount = 0;
 }
 
-void ArtNetPollTable::ProcessUniverse(uint32_t nIpAddress, uint16_t nUniverse) {
-	DEBUG_ENTRY
+void ArtNetPollTable::RemoveIpAddress(uint16_t nUniverse, uint32_t nIpAddress) {
+	if (m_nTableUniversesEntries == 0) {
+		return;
+	}
+
+	const auto nIndex = m_pUniverseHash[FindUniverseSlot(nUniverse)];
 
-	if (ARTNET_POLL_TABLE_SIZE_UNIVERSES == m_nTableUniversesEntries) {
-		DEBUG_PUTS("m_pTableUniverses is full");
-		DEBUG_EXIT
+	if (nIndex == HASH_EMPTY) {
+		// Universe not found
 		return;
 	}
 
-	// FIXME Universe lookup
-	bool bFoundUniverse = false;
-	uint32_t nEntry = 0;
+	auto *pTableUniverses = &m_pTableUniverses[nIndex];
+	assert(pTableUniverses->nCount > 0);
 
-	for (nEntry = 0; nEntry < m_nTableUniversesEntries; nEntry++) {
-		TArtNetPollTableUniverses *pTableUniverses = &m_pTableUniverses[nEntry];
-		assert(pTableUniverses != nullptr);
+	uint32_t nIpAddressIndex;
 
-		if (pTableUniverses->nUniverse == nUniverse) {
-			bFoundUniverse = true;
-			DEBUG_PRINTF("Universe found %u", nUniverse);
+	for (nIpAddressIndex = 0; nIpAddressIndex < pTableUniverses->nCount; nIpAddressIndex++) {
+		if (pTableUniverses->pIpAddresses[nIpAddressIndex] == nIpAddress) {
 			break;
 		}
 	}
 
-	TArtNetPollTableUniverses *pTableUniverses = &m_pTableUniverses[nEntry];
+	if (nIpAddressIndex == pTableUniverses->nCount) {
+		// IP not found
+		return;
+	}
+
+	// The order of the subscribers does not matter
+	pTableUniverses->nCount--;
+	pTableUniverses->pIpAddresses[nIpAddressIndex] = pTableUniverses->pIpAddresses[pTableUniverses->nCount];
+	pTableUniverses->pIpAddresses[pTableUniverses->nCount] = 0;
 
-	bool bFoundIp = false;
-	uint32_t nCount = 0;
+	if (pTableUniverses->nCount == 0) {
+		RemoveUniverse(nIndex);
+	}
+}
 
-	if (bFoundUniverse) {
-		// FIXME IP lookup
-		for (nCount = 0; nCount < pTableUniverses->nCount; nCount++) {
-			if (pTableUniverses->pIpAddresses[nCount] == nIpAddress) {
-				bFoundIp = true;
-				DEBUG_PUTS("IP found");
-				break;
-			}
+/**
+ * Only called for a universe which is new for the node, so the IP address is not in the list yet.
+ */
+void ArtNetPollTable::ProcessUniverse(uint32_t nIpAddress, uint16_t nUniverse) {
+	DEBUG_ENTRY
+
+	const auto nSlot = FindUniverseSlot(nUniverse);
+	auto nIndex = m_pUniverseHash[nSlot];
+
+	if (nIndex == HASH_EMPTY) {
+		if (ARTNET_POLL_TABLE_SIZE_UNIVERSES == m_nTableUniversesEntries) {
+			DEBUG_PUTS("m_pTableUniverses is full");
+			DEBUG_EXIT
+			return;
 		}
-	} else {
+
 		// New universe
-		pTableUniverses->nUniverse = nUniverse;
-		m_nTableUniversesEntries++;
+		nIndex = static_cast<uint16_t>(m_nTableUniversesEntries++);
+		m_pTableUniverses[nIndex].nUniverse = nUniverse;
+		m_pTableUniverses[nIndex].nCount = 0;
+		m_pUniverseHash[nSlot] = nIndex;
+
 		DEBUG_PRINTF("New Universe %d", static_cast<int>(nUniverse));
 	}
 
-	if (!bFoundIp) {
-		if (pTableUniverses->nCount < ARTNET_POLL_TABLE_SIZE_ENRIES) {
-			pTableUniverses->pIpAddresses[pTableUniverses->nCount] = nIpAddress;
-			pTableUniverses->nCount++;
-			DEBUG_PUTS("It is a new IP for the Universe");
-		} else {
-			DEBUG_PUTS("New IP does not fit");
-		}
+	auto *pTableUniverses = &m_pTableUniverses[nIndex];
+
+	if (pTableUniverses->nCount < ARTNET_POLL_TABLE_SIZE_ENRIES) {
+		pTableUniverses->pIpAddresses[pTableUniverses->nCount] = nIpAddress;
+		pTableUniverses->nCount++;
+		DEBUG_PUTS("It is a new IP for the Universe");
+	} else {
+		DEBUG_PUTS("New IP does not fit");
 	}
 
 	DEBUG_EXIT
 }
 
-void ArtNetPollTable::Add(const struct TArtPollReply *ptArtPollReply) {
-	DEBUG_ENTRY
+/**
+ * The last node is moved into the free place.
+ */
+void ArtNetPollTable::RemoveNode(uint32_t nIndex) {
+	assert(nIndex < m_nPollTableEntries);
 
-	bool bFound = false;
+	for (uint32_t nUniverseIndex = 0; nUniverseIndex < m_pPollTable[nIndex].nUniversesCount; nUniverseIndex++) {
+		RemoveIpAddress(m_pPollTable[nIndex].Universe[nUniverseIndex].nUniverse, m_pPollTable[nIndex].IPAddress);
+	}
 
-	memcpy(ip.u8, ptArtPollReply->IPAddress, 4);
+	NodeHashRemove(FindNodeSlot(m_pPollTable[nIndex].IPAddress));
 
-	const auto nIpSwap = __builtin_bswap32(ip.u32);
+	m_nPollTableEntries--;
 
-	int32_t i;
-	int32_t nLow = 0;
-	int32_t nMid;
-	auto nHigh = static_cast<int32_t>(m_nPollTableEntries);
+	if (nIndex != m_nPollTableEntries) {
+		memcpy(&m_pPollTable[nIndex], &m_pPollTable[m_nPollTableEntries], sizeof(struct TArtNetNodeEntry));
+		m_pNodeHash[FindNodeSlot(m_pPollTable[nIndex].IPAddress)] = static_cast<uint16_t>(nIndex);
+	}
 
-	while (nLow <= nHigh) {
-		nMid = nLow + ((nHigh - nLow) / 2);
-		const auto nMidValue = __builtin_bswap32(m_pPollTable[nMid].IPAddress);
+	struct TArtNetNodeEntry *pDst = &m_pPollTable[m_nPollTableEntries];
+	pDst->IPAddress = 0;
+	pDst->nUniversesCount = 0;
+#ifndef NDEBUG
+	memset(pDst->Mac, 0, ArtNet::MAC_SIZE + ArtNet::SHORT_NAME_LENGTH + ArtNet::LONG_NAME_LENGTH);
+#endif
+}
 
-		if (nMidValue < nIpSwap) {
-			nLow = nMid + 1;
-		} else if (nMidValue > nIpSwap) {
-			nHigh = nMid - 1;
-		} else {
-			i = nMid;
-			bFound = true;
-			break;;
-		}
-	}
+void ArtNetPollTable::Add(const struct TArtPollReply *ptArtPollReply) {
+	DEBUG_ENTRY
 
-	if (!bFound) {
+	memcpy(ip.u8, ptArtPollReply->IPAddress, 4);
+
+	const auto nSlot = FindNodeSlot(ip.u32);
+	uint32_t i = m_pNodeHash[nSlot];
+
+	if (i == HASH_EMPTY) {
 		if (m_nPollTableEntries == ARTNET_POLL_TABLE_SIZE_ENRIES) {
 			DEBUG_PUTS("Full");
+			DEBUG_EXIT
 			return;
 		}
 
-		if (m_nPollTableEntries != static_cast<uint32_t>(nHigh)) {
-			DEBUG_PUTS("Move");
-
-			struct TArtNetNodeEntry *pArtNetNodeEntry = m_pPollTable; // TODO
-
-			assert(m_nPollTableEntries >= 1);
-			assert(nLow >= 0);
-
-			for (int32_t i = static_cast<int32_t>(m_nPollTableEntries) - 1;i >= nLow; i--) {
-				const struct TArtNetNodeEntry *pSrc = &pArtNetNodeEntry[i];
-				struct TArtNetNodeEntry *pDst = &pArtNetNodeEntry[i + 1];
-				memcpy(pDst, pSrc, sizeof(struct TArtNetNodeEntry));
-			}
-
-			struct TArtNetNodeEntry *pDst = &pArtNetNodeEntry[nLow];
-			memset(pDst, 0, sizeof(struct TArtNetNodeEntry));
-
-			i = nLow;
-		} else {
-			i = static_cast<int32_t>(m_nPollTableEntries);
-			DEBUG_PRINTF("Add -> i=%d", i);
-		}
+		i = m_nPollTableEntries++;
+		DEBUG_PRINTF("Add -> i=%u", i);
 
+		memset(&m_pPollTable[i], 0, sizeof(struct TArtNetNodeEntry));
 		m_pPollTable[i].IPAddress = ip.u32;
-		m_nPollTableEntries++;
+		m_pNodeHash[nSlot] = static_cast<uint16_t>(i);
 	}
 
 #ifndef NDEBUG
@@ -343,63 +414,45 @@ void ArtNetPollTable::Add(const struct TArtPollReply *ptArtPollReply) {
 	DEBUG_EXIT;
 }
 
+/**
+ * Incremental cleanup, each call checks a single universe of a single node.
+ * An expired universe is removed from the node, a node without universes is removed from the table.
+ */
 void ArtNetPollTable::Clean() {
 	if (m_nPollTableEntries == 0) {
 		return;
 	}
 
-	assert(m_tTableClean.nTableIndex < m_nPollTableEntries);
-	assert(m_tTableClean.nUniverseIndex < ARTNET_POLL_TABLE_SIZE_NODE_UNIVERSES);
-
-	if (m_tTableClean.nUniverseIndex == 0) {
-		m_tTableClean.bOffLine = true;
-	}
-
-	struct TArtNetNodeEntryUniverse *pArtNetNodeEntryBind = &m_pPollTable[m_tTableClean.nTableIndex].Universe[m_tTableClean.nUniverseIndex];
-
-	if (pArtNetNodeEntryBind->nLastUpdateMillis != 0) {
-		if ((Hardware::Get()->Millis() - pArtNetNodeEntryBind->nLastUpdateMillis) > (1.5 * ARTNET_POLL_INTERVAL_MILLIS)) {
-			pArtNetNodeEntryBind->nLastUpdateMillis = 0;
-			RemoveIpAddress(pArtNetNodeEntryBind->nUniverse, m_pPollTable[m_tTableClean.nTableIndex].IPAddress);
-		} else {
-			m_tTableClean.bOffLine = false;
-		}
+	if (m_tTableClean.nTableIndex >= m_nPollTableEntries) {
+		m_tTableClean.nTableIndex = 0;
+		m_tTableClean.nUniverseIndex = 0;
 	}
 
-	m_tTableClean.nUniverseIndex++;
-
-	if (m_tTableClean.nUniverseIndex == ARTNET_POLL_TABLE_SIZE_NODE_UNIVERSES) {
-		if (m_tTableClean.bOffLine) {
-			DEBUG_PUTS("Node is off-line");
+	auto *pArtNetNodeEntry = &m_pPollTable[m_tTableClean.nTableIndex];
 
-			struct TArtNetNodeEntry *pArtNetNodeEntry = m_pPollTable;
-			// Move
-			for (uint32_t i = m_tTableClean.nTableIndex; i < (m_nPollTableEntries - 1); i++) {
-				const struct TArtNetNodeEntry *pSrc = &pArtNetNodeEntry[i + 1];
-				struct TArtNetNodeEntry *pDst = &pArtNetNodeEntry[i];
-
-				memcpy(pDst, pSrc, sizeof(struct TArtNetNodeEntry));
-			}
+	if (m_tTableClean.nUniverseIndex < pArtNetNodeEntry->nUniversesCount) {
+		auto *pArtNetNodeEntryUniverse = &pArtNetNodeEntry->Universe[m_tTableClean.nUniverseIndex];
 
-			m_nPollTableEntries--;
+		if ((Hardware::Get()->Millis() - pArtNetNodeEntryUniverse->nLastUpdateMillis) > ((3 * ARTNET_POLL_INTERVAL_MILLIS) / 2)) {
+			RemoveIpAddress(pArtNetNodeEntryUniverse->nUniverse, pArtNetNodeEntry->IPAddress);
 
-			struct TArtNetNodeEntry *pDst = &pArtNetNodeEntry[m_nPollTableEntries];
-			pDst->IPAddress = 0;
-			pDst->nUniversesCount = 0;
-			memset(pDst->Universe, 0, sizeof(struct TArtNetNodeEntryUniverse[ARTNET_POLL_TABLE_SIZE_NODE_UNIVERSES]));
-#ifndef NDEBUG
-			memset(pDst->Mac, 0, ArtNet::MAC_SIZE + ArtNet::SHORT_NAME_LENGTH + ArtNet::LONG_NAME_LENGTH);
-#endif
+			pArtNetNodeEntry->nUniversesCount--;
+			*pArtNetNodeEntryUniverse = pArtNetNodeEntry->Universe[pArtNetNodeEntry->nUniversesCount];
+		} else {
+			m_tTableClean.nUniverseIndex++;
 		}
 
-		m_tTableClean.nUniverseIndex = 0;
-		m_tTableClean.bOffLine = true;
-		m_tTableClean.nTableIndex++;
+		return;
+	}
 
-		if (m_tTableClean.nTableIndex >= m_nPollTableEntries) {
-			m_tTableClean.nTableIndex = 0;
-		}
+	if (pArtNetNodeEntry->nUniversesCount == 0) {
+		DEBUG_PUTS("Node is off-line");
+		RemoveNode(m_tTableClean.nTableIndex);
+	} else {
+		m_tTableClean.nTableIndex++;
 	}
+
+	m_tTableClean.nUniverseIndex = 0;
 }
 
 void ArtNetPollTable::Dump() {
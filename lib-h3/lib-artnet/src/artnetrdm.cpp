@@ -42,7 +42,7 @@
 void ArtNetNode::HandleTodControl() {
 	DEBUG_ENTRY
 
-	const struct TArtTodControl *pArtTodControl =  &(m_ArtNetPacket.ArtPacket.ArtTodControl);
+	const struct TArtTodControl *pArtTodControl =  &(m_pArtPacket->ArtTodControl);
 	const auto portAddress = static_cast<uint16_t>((pArtTodControl->Net << 8)) | static_cast<uint16_t>((pArtTodControl->Address));
 
 	for (uint32_t i = 0; i < ArtNet::MAX_PORTS; i++) {
@@ -69,7 +69,7 @@ void ArtNetNode::HandleTodControl() {
 void ArtNetNode::HandleTodRequest() {
 	DEBUG_ENTRY
 
-	const struct TArtTodRequest *pArtTodRequest = &(m_ArtNetPacket.ArtPacket.ArtTodRequest);
+	const struct TArtTodRequest *pArtTodRequest = &(m_pArtPacket->ArtTodRequest);
 	const auto portAddress = static_cast<uint16_t>((pArtTodRequest->Net << 8)) | static_cast<uint16_t>((pArtTodRequest->Address[0]));
 
 	for (uint32_t i = 0; i < ArtNet::MAX_PORTS; i++) {
@@ -135,7 +135,7 @@ void ArtNetNode::SetRdmHandler(ArtNetRdm *pArtNetTRdm, bool IsResponder) {
 void ArtNetNode::HandleRdm() {
 	DEBUG_ENTRY
 
-	auto *pArtRdm = &(m_ArtNetPacket.ArtPacket.ArtRdm);
+	auto *pArtRdm = &(m_pArtPacket->ArtRdm);
 	const auto portAddress = static_cast<uint16_t>((pArtRdm->Net << 8)) | static_cast<uint16_t>((pArtRdm->Address));
 
 	for (uint32_t i = 0; i < ArtNet::MAX_PORTS; i++) {
@@ -162,7 +162,7 @@ void ArtNetNode::HandleRdm() {
 
 				const auto nLength = sizeof(struct TArtRdm) - sizeof(pArtRdm->RdmPacket) + nMessageLength;
 
-				Network::Get()->SendTo(m_nHandle, pArtRdm, nLength, m_ArtNetPacket.IPAddressFrom, ArtNet::UDP_PORT);
+				Network::Get()->SendTo(m_nHandle, pArtRdm, nLength, m_nIPAddressFrom, ArtNet::UDP_PORT);
 			} else {
 				printf("No RDM response\n");
 			}
@@ -38,7 +38,7 @@
 #include "debug.h"
 
 void ArtNetNode::HandleTimeCode() {
-	const auto *pArtTimeCode = &(m_ArtNetPacket.ArtPacket.ArtTimeCode);
+	const auto *pArtTimeCode = &(m_pArtPacket->ArtTimeCode);
 
 	m_pArtNetTimeCode->Handler(reinterpret_cast<const struct TArtNetTimeCode*>(&pArtTimeCode->Frames));
 }
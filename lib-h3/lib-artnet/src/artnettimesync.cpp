@@ -38,13 +38,13 @@
 void ArtNetNode::HandleTimeSync() {
 	DEBUG_ENTRY
 
-	struct TArtTimeSync *pArtTimeSync = &(m_ArtNetPacket.ArtPacket.ArtTimeSync);
+	struct TArtTimeSync *pArtTimeSync = &(m_pArtPacket->ArtTimeSync);
 
 	m_pArtNetTimeSync->Handler(reinterpret_cast<const struct TArtNetTimeSync*>(&pArtTimeSync->tm_sec));
 
 	pArtTimeSync->Prog = 0;
 
-	Network::Get()->SendTo(m_nHandle, pArtTimeSync, sizeof(struct TArtTimeSync), m_ArtNetPacket.IPAddressFrom, ArtNet::UDP_PORT);
+	Network::Get()->SendTo(m_nHandle, pArtTimeSync, sizeof(struct TArtTimeSync), m_nIPAddressFrom, ArtNet::UDP_PORT);
 
 	DEBUG_EXIT
 }
@@ -36,7 +36,7 @@
 
 void ArtNetNode::HandleTrigger() {
 	DEBUG_ENTRY
-	const struct TArtTrigger *pArtTrigger = &(m_ArtNetPacket.ArtPacket.ArtTrigger);
+	const struct TArtTrigger *pArtTrigger = &(m_pArtPacket->ArtTrigger);
 
 	if ((pArtTrigger->OemCodeHi == 0xFF && pArtTrigger->OemCodeLo == 0xFF) || (pArtTrigger->OemCodeHi == m_Node.Oem[0] && pArtTrigger->OemCodeLo == m_Node.Oem[1])) {
 		DEBUG_PRINTF("Key=%d, SubKey=%d, Data[0]=%d", pArtTrigger->Key, pArtTrigger->SubKey, pArtTrigger->Data[0]);
@@ -0,0 +1,367 @@
+/**
+ * @file polltable.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Checks ArtNetPollTable against a simple reference model with random
+ * ArtPollReply sequences, node timeouts and a full table, and measures
+ * Add, GetIpAddress and Clean for 500 nodes with 4 universes each.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "artnetpolltable.h"
+#include "artnet.h"
+#include "hardware.h"
+
+namespace bench {
+static constexpr uint32_t IP_POOL = 400;		///< More than ARTNET_POLL_TABLE_SIZE_ENRIES
+static constexpr uint32_t STEPS = 200000;
+static constexpr uint32_t COMPARE_EVERY = 500;
+static constexpr uint32_t NODES = 500;
+static constexpr uint32_t NODE_UNIVERSES = 4;
+static constexpr uint32_t ROUNDS = 20;
+static constexpr uint32_t TIMEOUT_MILLIS = (3 * ARTNET_POLL_INTERVAL_MILLIS) / 2;
+}  // namespace bench
+
+/*
+ * Fake clock
+ */
+
+static uint32_t s_nMillis;
+
+Hardware *Hardware::s_pThis = nullptr;
+
+Hardware::Hardware() {
+	s_pThis = this;
+}
+
+uint32_t Hardware::Millis() {
+	return s_nMillis;
+}
+
+/*
+ * Reference model, same limits, no ordering
+ */
+
+class ReferencePollTable {
+public:
+	void Add(uint32_t nIpAddress, const uint16_t *pUniverses, uint32_t nUniverses) {
+		auto it = m_Nodes.find(nIpAddress);
+
+		if (it == m_Nodes.end()) {
+			if (m_Nodes.size() == ARTNET_POLL_TABLE_SIZE_ENRIES) {
+				return;
+			}
+			it = m_Nodes.insert(std::make_pair(nIpAddress, std::map<uint16_t, uint32_t>())).first;
+		}
+
+		auto& NodeUniverses = it->second;
+
+		for (uint32_t i = 0; i < nUniverses; i++) {
+			const auto nUniverse = pUniverses[i];
+
+			if (NodeUniverses.find(nUniverse) == NodeUniverses.end()) {
+				if (NodeUniverses.size() == ARTNET_POLL_TABLE_SIZE_NODE_UNIVERSES) {
+					continue;
+				}
+
+				if (m_Universes.find(nUniverse) != m_Universes.end()) {
+					m_Universes[nUniverse].insert(nIpAddress);
+				} else if (m_Universes.size() < ARTNET_POLL_TABLE_SIZE_UNIVERSES) {
+					m_Universes[nUniverse].insert(nIpAddress);
+				}
+			}
+
+			NodeUniverses[nUniverse] = s_nMillis;
+		}
+	}
+
+	void Clean() {
+		for (auto it = m_Nodes.begin(); it != m_Nodes.end();) {
+			auto& NodeUniverses = it->second;
+
+			for (auto itUniverse = NodeUniverses.begin(); itUniverse != NodeUniverses.end();) {
+				if ((s_nMillis - itUniverse->second) > bench::TIMEOUT_MILLIS) {
+					auto itTable = m_Universes.find(itUniverse->first);
+
+					if (itTable != m_Universes.end()) {
+						itTable->second.erase(it->first);
+						if (itTable->second.empty()) {
+							m_Universes.erase(itTable);
+						}
+					}
+
+					itUniverse = NodeUniverses.erase(itUniverse);
+				} else {
+					++itUniverse;
+				}
+			}
+
+			if (NodeUniverses.empty()) {
+				it = m_Nodes.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+
+	uint32_t GetEntries() const {
+		return static_cast<uint32_t>(m_Nodes.size());
+	}
+
+	const std::set<uint32_t> *GetIpAddress(uint16_t nUniverse) const {
+		const auto it = m_Universes.find(nUniverse);
+		return (it == m_Universes.end()) ? nullptr : &it->second;
+	}
+
+private:
+	std::map<uint32_t, std::map<uint16_t, uint32_t>> m_Nodes;
+	std::map<uint16_t, std::set<uint32_t>> m_Universes;
+};
+
+static uint64_t now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static uint32_t make_ip(uint32_t nNode) {
+	const uint8_t aIp[4] = { 10, 0, static_cast<uint8_t>(nNode >> 8), static_cast<uint8_t>(nNode) };
+	uint32_t nIp;
+	memcpy(&nIp, aIp, sizeof(nIp));
+	return nIp;
+}
+
+/**
+ * @return The universes with an output port, as ArtNetPollTable computes them
+ */
+static uint32_t make_reply(TArtPollReply *pReply, uint32_t nNode, uint8_t nNet, uint8_t nSub, const uint8_t *pSwOut, uint32_t nOutputMask, uint16_t *pUniverses) {
+	memset(pReply, 0, sizeof(TArtPollReply));
+
+	const auto nIp = make_ip(nNode);
+	memcpy(pReply->IPAddress, &nIp, 4);
+	pReply->NetSwitch = nNet;
+	pReply->SubSwitch = nSub;
+	pReply->BindIndex = 1;
+
+	uint32_t nUniverses = 0;
+
+	for (uint32_t nPort = 0; nPort < ArtNet::MAX_PORTS; nPort++) {
+		pReply->SwOut[nPort] = pSwOut[nPort];
+
+		if ((nOutputMask & (1U << nPort)) != 0) {
+			pReply->PortTypes[nPort] = ARTNET_ENABLE_OUTPUT;
+			pUniverses[nUniverses++] = static_cast<uint16_t>(((nNet & 0x7F) << 8) | ((nSub & 0x0F) << 4) | (pSwOut[nPort] & 0x0F));
+		}
+	}
+
+	return nUniverses;
+}
+
+static void clean_all(ArtNetPollTable& Table) {
+	// Each call handles one universe or one node, this is more than a full pass from any position
+	for (uint32_t i = 0; i < 2 * ARTNET_POLL_TABLE_SIZE_ENRIES * (ARTNET_POLL_TABLE_SIZE_NODE_UNIVERSES + 2); i++) {
+		Table.Clean();
+	}
+}
+
+static bool compare(ArtNetPollTable& Table, const ReferencePollTable& Reference, uint32_t nStep) {
+	if (Table.GetEntries() != Reference.GetEntries()) {
+		printf("FAIL: step %u, %u entries, reference %u\n", nStep, Table.GetEntries(), Reference.GetEntries());
+		return false;
+	}
+
+	for (uint32_t nUniverse = 0; nUniverse < 0x8000; nUniverse++) {
+		const auto *pTable = Table.GetIpAddress(static_cast<uint16_t>(nUniverse));
+		const auto *pReference = Reference.GetIpAddress(static_cast<uint16_t>(nUniverse));
+
+		if ((pTable == nullptr) != (pReference == nullptr)) {
+			printf("FAIL: step %u, universe %u %s\n", nStep, nUniverse, pTable == nullptr ? "missing" : "not expected");
+			return false;
+		}
+
+		if (pTable == nullptr) {
+			continue;
+		}
+
+		const std::set<uint32_t> IpAddresses(pTable->pIpAddresses, pTable->pIpAddresses + pTable->nCount);
+
+		if ((pTable->nUniverse != nUniverse) || (pTable->nCount != IpAddresses.size()) || (IpAddresses != *pReference)) {
+			printf("FAIL: step %u, universe %u has %u subscribers, reference %u\n", nStep, nUniverse, pTable->nCount, static_cast<uint32_t>(pReference->size()));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool test() {
+	ArtNetPollTable Table;
+	ReferencePollTable Reference;
+	TArtPollReply Reply;
+	uint16_t aUniverses[ArtNet::MAX_PORTS];
+	uint32_t nMaxEntries = 0;
+	uint32_t nMaxUniverses = 0;
+
+	s_nMillis = 0;
+
+	for (uint32_t nStep = 1; nStep <= bench::STEPS; nStep++) {
+		// Net 0-3 gives 1024 possible universes, more than ARTNET_POLL_TABLE_SIZE_UNIVERSES
+		const auto nNode = static_cast<uint32_t>(rand()) % bench::IP_POOL;
+		const auto nNet = static_cast<uint8_t>(rand() & 0x03);
+		const auto nSub = static_cast<uint8_t>(rand() & 0x0F);
+		const uint8_t aSwOut[ArtNet::MAX_PORTS] = { static_cast<uint8_t>(rand() & 0x0F), static_cast<uint8_t>(rand() & 0x0F), static_cast<uint8_t>(rand() & 0x0F), static_cast<uint8_t>(rand() & 0x0F) };
+		const auto nOutputMask = static_cast<uint32_t>(rand()) & 0x0F;
+
+		const auto nUniverses = make_reply(&Reply, nNode, nNet, nSub, aSwOut, nOutputMask, aUniverses);
+
+		Table.Add(&Reply);
+		Reference.Add(make_ip(nNode), aUniverses, nUniverses);
+
+		// About 4 s for a full round of the pool, the table fills up
+		s_nMillis += static_cast<uint32_t>(rand()) % 20;
+
+		if ((nStep % bench::COMPARE_EVERY) == 0) {
+			clean_all(Table);
+			Reference.Clean();
+
+			if (Table.GetEntries() > nMaxEntries) {
+				nMaxEntries = Table.GetEntries();
+			}
+
+			uint32_t nTableUniverses = 0;
+
+			for (uint32_t nUniverse = 0; nUniverse < 0x400; nUniverse++) {
+				nTableUniverses += (Table.GetIpAddress(static_cast<uint16_t>(nUniverse)) != nullptr) ? 1 : 0;
+			}
+
+			if (nTableUniverses > nMaxUniverses) {
+				nMaxUniverses = nTableUniverses;
+			}
+
+			if (!compare(Table, Reference, nStep)) {
+				return false;
+			}
+		}
+	}
+
+	// Everything times out
+	s_nMillis += 2 * bench::TIMEOUT_MILLIS;
+	clean_all(Table);
+	Reference.Clean();
+
+	if (!compare(Table, Reference, bench::STEPS) || (Table.GetEntries() != 0)) {
+		return false;
+	}
+
+	printf("%u steps, at most %u nodes and %u universes in the table\n", bench::STEPS, nMaxEntries, nMaxUniverses);
+
+	return true;
+}
+
+/*
+ * Node n outputs the universes 4 * (n % 128) to 4 * (n % 128) + 3, so there are
+ * 512 universes. Only the first ARTNET_POLL_TABLE_SIZE_ENRIES nodes fit in the table.
+ */
+static void benchmark() {
+	static TArtPollReply Replies[bench::NODES];
+	uint16_t aUniverses[ArtNet::MAX_PORTS];
+	uint64_t nAddNew = 0, nAddRefresh = 0, nLookup = 0, nClean = 0;
+	uint32_t nCleanCalls = 0;
+	uint32_t nSubscribers = 0;
+
+	for (uint32_t nNode = 0; nNode < bench::NODES; nNode++) {
+		const auto nFirst = 4 * (nNode % 128);
+		const uint8_t aSwOut[ArtNet::MAX_PORTS] = { static_cast<uint8_t>(nFirst & 0x0F), static_cast<uint8_t>((nFirst + 1) & 0x0F), static_cast<uint8_t>((nFirst + 2) & 0x0F), static_cast<uint8_t>((nFirst + 3) & 0x0F) };
+		make_reply(&Replies[nNode], nNode, static_cast<uint8_t>(nFirst >> 8), static_cast<uint8_t>((nFirst >> 4) & 0x0F), aSwOut, 0x0F, aUniverses);
+	}
+
+	for (uint32_t nRound = 0; nRound < bench::ROUNDS; nRound++) {
+		ArtNetPollTable Table;
+
+		s_nMillis = 0;
+
+		auto nStart = now_ns();
+		for (uint32_t nNode = 0; nNode < bench::NODES; nNode++) {
+			Table.Add(&Replies[nNode]);
+		}
+		nAddNew += now_ns() - nStart;
+
+		s_nMillis = ARTNET_POLL_INTERVAL_MILLIS;
+
+		nStart = now_ns();
+		for (uint32_t nNode = 0; nNode < bench::NODES; nNode++) {
+			Table.Add(&Replies[nNode]);
+		}
+		nAddRefresh += now_ns() - nStart;
+
+		nStart = now_ns();
+		for (uint32_t nUniverse = 0; nUniverse < 4 * 128; nUniverse++) {
+			const auto *pUniverse = Table.GetIpAddress(static_cast<uint16_t>(nUniverse));
+			nSubscribers += (pUniverse != nullptr) ? pUniverse->nCount : 0;
+		}
+		nLookup += now_ns() - nStart;
+
+		s_nMillis += 2 * bench::TIMEOUT_MILLIS;
+
+		nStart = now_ns();
+		while (Table.GetEntries() != 0) {
+			Table.Clean();
+			nCleanCalls++;
+		}
+		nClean += now_ns() - nStart;
+	}
+
+	const auto fNodes = static_cast<double>(bench::NODES * bench::ROUNDS);
+
+	printf("%u nodes x %u universes, %u stored, %u subscribers per round\n", bench::NODES, bench::NODE_UNIVERSES, ARTNET_POLL_TABLE_SIZE_ENRIES, nSubscribers / bench::ROUNDS);
+	printf("Add new        %8.1f ns/reply\n", static_cast<double>(nAddNew) / fNodes);
+	printf("Add refresh    %8.1f ns/reply\n", static_cast<double>(nAddRefresh) / fNodes);
+	printf("GetIpAddress   %8.1f ns/lookup\n", static_cast<double>(nLookup) / (4 * 128 * bench::ROUNDS));
+	printf("Clean          %8.1f ns/call, %u calls to empty the table\n", static_cast<double>(nClean) / nCleanCalls, nCleanCalls / bench::ROUNDS);
+}
+
+int main() {
+	Hardware hardware;
+
+	srand(1);
+
+	if (!test()) {
+		puts("FAIL");
+		return 1;
+	}
+
+	benchmark();
+
+	puts("PASS");
+	return 0;
+}
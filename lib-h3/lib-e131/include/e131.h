@@ -91,6 +91,9 @@ enum TVectorDMP {
  */
 #define E131_DEFAULT_PORT		5568	///<
 
+#define E131_RUN_MAX_PACKETS	16		///< Packets handled in one E131Bridge::Run()
+#define E131_UDP_QUEUE_DEPTH	80		///< Room for a back-to-back burst of 64 universes followed by a synchronization packet
+
 /**
  * 6.4 Priority
  *
@@ -134,6 +137,7 @@ enum TUniverse {
 
 #define E131_MERGE_TIMEOUT_SECONDS					10	///<
 #define E131_PRIORITY_TIMEOUT_SECONDS				10	///<
+#define E131_MERGE_SOURCES_PER_PORT					2	///< Average, the merge sources are pooled over all the output ports
 #define E131_UNIVERSE_DISCOVERY_INTERVAL_SECONDS	10	///<
 #define E131_NETWORK_DATA_LOSS_TIMEOUT_SECONDS		2.5	///<
 
@@ -33,6 +33,8 @@
 #include "e131packets.h"
 
 #include "lightset.h"
+#include "lightsetportlookup.h"
+#include "lightsetmergeengine.h"
 
 // Handlers
 #include "e131dmx.h"
@@ -61,15 +63,6 @@ struct TE131BridgeState {
 	uint16_t nSynchronizationAddressSourceB;
 	uint8_t nActiveInputPorts;
 	uint8_t nActiveOutputPorts;
-	uint8_t nPriority;
-};
-
-struct TSource {
-	uint32_t time;
-	uint32_t ip;
-	uint8_t data[E131_DMX_LENGTH];
-	uint8_t cid[E131_CID_LENGTH];
-	uint8_t sequenceNumberData;
 };
 
 struct TE131OutputPort {
@@ -81,8 +74,6 @@ struct TE131OutputPort {
 	bool bIsEnabled;
 	bool IsTransmitting;
 	bool IsMerging;
-	struct TSource sourceA;
-	struct TSource sourceB;
 };
 
 struct TE131InputPort {
@@ -199,23 +190,23 @@ public:
 
 private:
 	bool IsValidRoot();
+	void HandlePacket(void *pBuffer);
 	bool IsValidDataPacket();
 
-	void SetNetworkDataLossCondition(bool bSourceA = true, bool bSourceB = true);
+	void SetNetworkDataLossCondition();
+	void SetStreamTerminated(uint32_t nPortIndex, LightSetMergeEngine::Source *pSource);
 
-	void SetSynchronizationAddress(bool bSourceA, bool bSourceB, uint16_t nSynchronizationAddress);
+	void SetSynchronizationAddress(uint16_t nSynchronizationAddress);
 
-	void CheckMergeTimeouts(uint8_t nPortIndex);
-	bool IsPriorityTimeOut(uint8_t nPortIndex);
-	bool isIpCidMatch(const struct TSource *);
-	bool IsDmxDataChanged(uint8_t nPortIndex, const uint8_t *pData, uint16_t nLength);
-	bool IsMergedDmxDataChanged(uint8_t nPortIndex, const uint8_t *pData, uint16_t nLength);
+	void UpdateMergeState(uint32_t nPortIndex);
+	void SendData(uint32_t nPortIndex, bool bSendNewData);
 
 	void HandleDmx();
 	void HandleSynchronization();
 
 	uint32_t UniverseToMulticastIp(uint16_t nUniverse) const;
 	void LeaveUniverse(uint8_t nPortIndex, uint16_t nUniverse);
+	void UpdatePortLookup();
 
 	// Input
 	void HandleDmxIn();
@@ -236,8 +227,11 @@ private:
 
 	struct TE131BridgeState m_State;
 	struct TE131OutputPort m_OutputPort[E131_MAX_PORTS];
+	LightSetPortLookup<E131_MAX_PORTS> m_OutputPortLookup;	///< Universe -> output ports
+	LightSetMergeEngine m_MergeEngine { E131_MAX_PORTS, E131_MAX_PORTS * E131_MERGE_SOURCES_PER_PORT };
 	struct TE131InputPort m_InputPort[E131_MAX_UARTS];
-	struct TE131 m_E131;
+	union UE131Packet *m_pE131Packet{nullptr};	///< Points into the network receive buffer, valid until RecvRelease()
+	uint32_t m_nIPAddressFrom{0};
 
 	// Input
 	E131Dmx *m_pE131DmxIn{nullptr};
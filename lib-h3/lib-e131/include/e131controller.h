@@ -35,6 +35,9 @@ enum {
 	DEFAULT_SYNCHRONIZATION_ADDRESS = 5000
 };
 
+#define E131_CONTROLLER_MAX_FRAME_UNIVERSES	128	///< A full frame is sent, the remaining universes follow in the next batch
+#define E131_CONTROLLER_FRAME_SENT_TIMEOUT_MILLIS	100
+
 #ifndef DMX_MAX_VALUE
 #define DMX_MAX_VALUE 255
 #endif
@@ -66,6 +69,16 @@ public:
 	void HandleSync();
 	void HandleBlackout();
 
+	/**
+	 * Frame level output: the universes added are sent by CommitFrame(), in the order added,
+	 * followed by a single synchronization packet. A universe added twice in the same frame is sent once, with the last data.
+	 */
+	void BeginFrame() {
+		m_nFrameUniverses = 0;
+	}
+	void AddUniverse(uint16_t nUniverse, const uint8_t *pDmxData, uint16_t nLength);
+	void CommitFrame();
+
 	void SetSynchronizationAddress(uint16_t nSynchronizationAddress = DEFAULT_SYNCHRONIZATION_ADDRESS) {
 		m_State.SynchronizationPacket.nUniverseNumber = nSynchronizationAddress;
 		m_State.SynchronizationPacket.nIpAddress = UniverseToMulticastIp(nSynchronizationAddress);
@@ -97,10 +110,14 @@ public:
 private:
 	uint32_t UniverseToMulticastIp(uint16_t nUniverse) const;
 	void FillDataPacket();
+	void FillFrameDataPackets();
 	void FillDiscoveryPacket();
 	void FillSynchronizationPacket();
 	void SendDiscoveryPacket();
 	uint8_t GetSequenceNumber(uint16_t nUniverse, uint32_t &nMulticastIpAddress);
+	uint32_t SetData(struct TE131DataPacket *pE131DataPacket, const uint8_t *pDmxData, uint16_t nLength);
+	void SendFrame();
+	void WaitFrameSent();
 
 private:
 	int32_t m_nHandle{-1};
@@ -114,6 +131,13 @@ private:
 	char m_SourceName[E131_SOURCE_NAME_LENGTH];
 	uint32_t m_nMaster{DMX_MAX_VALUE};
 
+	struct TE131DataPacket *m_pFrameDataPackets{nullptr};
+	uint32_t m_nFrameIpAddress[E131_CONTROLLER_MAX_FRAME_UNIVERSES];
+	uint16_t m_nFrameLength[E131_CONTROLLER_MAX_FRAME_UNIVERSES];
+	uint32_t m_nFrameUniverses{0};
+	uint32_t m_nFrameSequence{0};
+	bool m_bFrameInFlight{false};
+
 	static E131Controller *s_pThis;
 };
 
@@ -42,6 +42,10 @@
 #include "network.h"
 #include "ledblink.h"
 
+#if defined (ENABLE_LATENCY_TRACE)
+# include "h3_latency.h"
+#endif
+
 #include "debug.h"
 
 E131Bridge *E131Bridge::s_pThis = nullptr;
@@ -66,7 +70,6 @@ E131Bridge::E131Bridge() {
 	}
 
 	memset(&m_State, 0, sizeof(struct TE131BridgeState));
-	m_State.nPriority = E131_PRIORITY_LOWEST;
 
 	char aSourceName[E131_SOURCE_NAME_LENGTH];
 	uint8_t nLength;
@@ -76,6 +79,8 @@ E131Bridge::E131Bridge() {
 	m_nHandle = Network::Get()->Begin(E131_DEFAULT_PORT); 	// This must be here (and not in Start) for Mac OS and Linux
 	assert(m_nHandle != -1);								// ToDO Rewrite SetUniverse
 
+	Network::Get()->SetQueueDepth(m_nHandle, E131_UDP_QUEUE_DEPTH);
+
 	E131Uuid e131UUID;
 	e131UUID.GetHardwareUuid(m_Cid);
 }
@@ -156,37 +161,29 @@ uint32_t E131Bridge::UniverseToMulticastIp(uint16_t nUniverse) const {
 	return nMulticastIp;
 }
 
-void E131Bridge::SetSynchronizationAddress(bool bSourceA, bool bSourceB, uint16_t nSynchronizationAddress) {
+void E131Bridge::SetSynchronizationAddress(uint16_t nSynchronizationAddress) {
 	DEBUG_ENTRY
-	DEBUG_PRINTF("bSourceA=%d, bSourceB=%d, nSynchronizationAddress=%d", bSourceA, bSourceB, nSynchronizationAddress);
+	DEBUG_PRINTF("nSynchronizationAddress=%d", nSynchronizationAddress);
 
 	assert(nSynchronizationAddress != 0);
 
-	uint16_t *pSynchronizationAddressSource;
-
-	if (bSourceA) {
-		pSynchronizationAddressSource = &m_State.nSynchronizationAddressSourceA;
-	} else if (bSourceB) {
-		pSynchronizationAddressSource = &m_State.nSynchronizationAddressSourceB;
-	} else {
+	if ((nSynchronizationAddress == m_State.nSynchronizationAddressSourceA) || (nSynchronizationAddress == m_State.nSynchronizationAddressSourceB)) {
+		DEBUG_PUTS("Already received SynchronizationAddress");
 		DEBUG_EXIT
-		return; // Just make the compiler happy
+		return;
 	}
 
-	if (*pSynchronizationAddressSource == 0) {
-		*pSynchronizationAddressSource = nSynchronizationAddress;
-		DEBUG_PUTS("SynchronizationAddressSource == 0");
-	} else if (*pSynchronizationAddressSource != nSynchronizationAddress) {
+	// Two synchronization addresses are followed, a third one replaces the second one
+	auto *pSynchronizationAddressSource = (m_State.nSynchronizationAddressSourceA == 0) ? &m_State.nSynchronizationAddressSourceA : &m_State.nSynchronizationAddressSourceB;
+
+	if (*pSynchronizationAddressSource != 0) {
 		// E131_MAX_PORTS forces to check all ports
 		LeaveUniverse(E131_MAX_PORTS, *pSynchronizationAddressSource);
-		*pSynchronizationAddressSource = nSynchronizationAddress;
 		DEBUG_PUTS("SynchronizationAddressSource != nSynchronizationAddress");
-	} else {
-		DEBUG_PUTS("Already received SynchronizationAddress");
-		DEBUG_EXIT
-		return;
 	}
 
+	*pSynchronizationAddressSource = nSynchronizationAddress;
+
 	Network::Get()->JoinGroup(m_nHandle, UniverseToMulticastIp(nSynchronizationAddress));
 
 	DEBUG_EXIT
@@ -241,6 +238,7 @@ void E131Bridge::SetUniverse(uint8_t nPortIndex, TE131PortDir dir, uint16_t nUni
 				m_OutputPort[nPortIndex].bIsEnabled = false;
 				m_State.nActiveOutputPorts = m_State.nActiveOutputPorts - 1;
 				LeaveUniverse(nPortIndex, nUniverse);
+				UpdatePortLookup();
 			}
 		}
 
@@ -271,6 +269,18 @@ void E131Bridge::SetUniverse(uint8_t nPortIndex, TE131PortDir dir, uint16_t nUni
 	Network::Get()->JoinGroup(m_nHandle, UniverseToMulticastIp(nUniverse));
 
 	m_OutputPort[nPortIndex].nUniverse = nUniverse;
+
+	UpdatePortLookup();
+}
+
+void E131Bridge::UpdatePortLookup() {
+	m_OutputPortLookup.Clear();
+
+	for (uint32_t i = 0; i < E131_MAX_PORTS; i++) {
+		if (m_OutputPort[i].bIsEnabled) {
+			m_OutputPortLookup.Add(m_OutputPort[i].nUniverse, i);
+		}
+	}
 }
 
 bool E131Bridge::GetUniverse(uint8_t nPortIndex, uint16_t &nUniverse, TE131PortDir tDir) const {
@@ -303,91 +313,16 @@ E131Merge E131Bridge::GetMergeMode(uint8_t nPortIndex) const {
 	return m_OutputPort[nPortIndex].mergeMode;
 }
 
-bool E131Bridge::IsDmxDataChanged(uint8_t nPortIndex, const uint8_t *pData, uint16_t nLength) {
-	assert(nPortIndex < E131_MAX_PORTS);
-	assert(pData != nullptr);
-
-	bool isChanged = false;
-
-	const uint8_t *pSrc = pData;
-	uint8_t *pDst = m_OutputPort[nPortIndex].data;
-
-	if (nLength != m_OutputPort[nPortIndex].length) {
-		m_OutputPort[nPortIndex].length = nLength;
-		for (unsigned i = 0 ; i < E131_DMX_LENGTH; i++) {
-			*pDst++ = *pSrc++;
-		}
-		return true;
-	}
-
-	for (unsigned i = 0; i < E131_DMX_LENGTH; i++) {
-		if (*pDst != *pSrc) {
-			*pDst = *pSrc;
-			isChanged = true;
-		}
-		pDst++;
-		pSrc++;
-	}
-
-	return isChanged;
-}
-
-bool E131Bridge::IsMergedDmxDataChanged(uint8_t nPortIndex, const uint8_t *pData, uint16_t nLength) {
-	assert(nPortIndex < E131_MAX_PORTS);
-	assert(pData != nullptr);
-
-	bool isChanged = false;
-
-	if (!m_State.IsMergeMode) {
-		m_State.IsMergeMode = true;
-		m_State.IsChanged = true;
-	}
-
-	m_OutputPort[nPortIndex].IsMerging = true;
-
-	if (m_OutputPort[nPortIndex].mergeMode == E131Merge::HTP) {
-
-		if (nLength != m_OutputPort[nPortIndex].length) {
-			m_OutputPort[nPortIndex].length = nLength;
-			for (unsigned i = 0; i < nLength; i++) {
-				uint8_t data = std::max(m_OutputPort[nPortIndex].sourceA.data[i], m_OutputPort[nPortIndex].sourceB.data[i]);
-				m_OutputPort[nPortIndex].data[i] = data;
-			}
-			return true;
-		}
-
-		for (unsigned i = 0; i < nLength; i++) {
-			uint8_t data = std::max(m_OutputPort[nPortIndex].sourceA.data[i], m_OutputPort[nPortIndex].sourceB.data[i]);
-			if (data != m_OutputPort[nPortIndex].data[i]) {
-				m_OutputPort[nPortIndex].data[i] = data;
-				isChanged = true;
-			}
-		}
-
-		return isChanged;
-	} else {
-		return IsDmxDataChanged(nPortIndex, pData, nLength);
-	}
-}
-
-void E131Bridge::CheckMergeTimeouts(uint8_t nPortIndex) {
+void E131Bridge::UpdateMergeState(uint32_t nPortIndex) {
 	assert(nPortIndex < E131_MAX_PORTS);
 
-	const uint32_t timeOutA = m_nCurrentPacketMillis - m_OutputPort[nPortIndex].sourceA.time;
+	const auto isMerging = m_MergeEngine.IsMerging(nPortIndex);
 
-	if (timeOutA > (E131_MERGE_TIMEOUT_SECONDS * 1000)) {
-		m_OutputPort[nPortIndex].sourceA.ip = 0;
-		memset(m_OutputPort[nPortIndex].sourceA.cid, 0, E131_CID_LENGTH);
-		m_OutputPort[nPortIndex].IsMerging = false;
+	if (isMerging == m_OutputPort[nPortIndex].IsMerging) {
+		return;
 	}
 
-	const uint32_t timeOutB = m_nCurrentPacketMillis - m_OutputPort[nPortIndex].sourceB.time;
-
-	if (timeOutB > (E131_MERGE_TIMEOUT_SECONDS * 1000)) {
-		m_OutputPort[nPortIndex].sourceB.ip = 0;
-		memset(m_OutputPort[nPortIndex].sourceB.cid, 0, E131_CID_LENGTH);
-		m_OutputPort[nPortIndex].IsMerging = false;
-	}
+	m_OutputPort[nPortIndex].IsMerging = isMerging;
 
 	bool bIsMerging = false;
 
@@ -395,91 +330,69 @@ void E131Bridge::CheckMergeTimeouts(uint8_t nPortIndex) {
 		bIsMerging |= m_OutputPort[i].IsMerging;
 	}
 
-	if (!bIsMerging) {
+	if (bIsMerging != m_State.IsMergeMode) {
+		m_State.IsMergeMode = bIsMerging;
 		m_State.IsChanged = true;
-		m_State.IsMergeMode = false;
 	}
-
 }
 
-bool E131Bridge::IsPriorityTimeOut(uint8_t nPortIndex) {
+void E131Bridge::SendData(uint32_t nPortIndex, bool bSendNewData) {
 	assert(nPortIndex < E131_MAX_PORTS);
 
-	const uint32_t timeOutA = m_nCurrentPacketMillis - m_OutputPort[nPortIndex].sourceA.time;
-	const uint32_t timeOutB = m_nCurrentPacketMillis - m_OutputPort[nPortIndex].sourceB.time;
+	if (bSendNewData || m_bDirectUpdate) {
+		if ((!m_State.IsSynchronized) || (m_State.bDisableSynchronize)) {
+
+			m_pLightSet->SetData(nPortIndex, m_OutputPort[nPortIndex].data, m_OutputPort[nPortIndex].length);
+#if defined (ENABLE_LATENCY_TRACE)
+			h3_latency_record(H3_LATENCY_SETDATA);
+#endif
 
-	if ( (m_OutputPort[nPortIndex].sourceA.ip != 0) && (m_OutputPort[nPortIndex].sourceB.ip != 0) ) {
-		if ( (timeOutA < (E131_PRIORITY_TIMEOUT_SECONDS * 1000)) || (timeOutB < (E131_PRIORITY_TIMEOUT_SECONDS * 1000)) ) {
-			return false;
+			if (!m_OutputPort[nPortIndex].IsTransmitting) {
+				m_pLightSet->Start(nPortIndex);
+				m_State.IsChanged |= (!m_OutputPort[nPortIndex].IsTransmitting);
+				m_OutputPort[nPortIndex].IsTransmitting = true;
+			}
 		} else {
-			return true;
-		}
-	} else if ( (m_OutputPort[nPortIndex].sourceA.ip != 0) && (m_OutputPort[nPortIndex].sourceB.ip == 0) ) {
-		if (timeOutA > (E131_PRIORITY_TIMEOUT_SECONDS * 1000)) {
-			return true;
-		}
-	} else if ( (m_OutputPort[nPortIndex].sourceA.ip == 0) && (m_OutputPort[nPortIndex].sourceB.ip != 0) ) {
-		if (timeOutB > (E131_PRIORITY_TIMEOUT_SECONDS * 1000)) {
-			return true;
+			m_OutputPort[nPortIndex].IsDataPending = bSendNewData;
 		}
 	}
-
-	return false;
-}
-
-bool E131Bridge::isIpCidMatch(const struct TSource *source) {
-	if (source->ip != m_E131.IPAddressFrom) {
-		return false;
-	}
-
-	if (memcmp(source->cid, m_E131.E131Packet.Raw.RootLayer.Cid, E131_CID_LENGTH) != 0) {
-		return false;
-	}
-
-	return true;
 }
 
 void E131Bridge::HandleDmx() {
-	const uint8_t *p = &m_E131.E131Packet.Data.DMPLayer.PropertyValues[1];
-	const uint16_t slots = __builtin_bswap16(m_E131.E131Packet.Data.DMPLayer.PropertyValueCount) - 1;
-
-	for (uint32_t i = 0; i < E131_MAX_PORTS; i++) {
-		if (!m_OutputPort[i].bIsEnabled) {
-			continue;
-		}
+#if defined (ENABLE_LATENCY_TRACE)
+	h3_latency_record(H3_LATENCY_DMX);
+#endif
 
-		// Frame layer
-		// 8.2 Association of Multicast Addresses and Universe
-		// Note: The identity of the universe shall be determined by the universe number in the
-		// packet and not assumed from the multicast address.
-		if (m_E131.E131Packet.Data.FrameLayer.Universe != __builtin_bswap16(m_OutputPort[i].nUniverse)) {
-			continue;
-		}
+	const uint8_t *p = &m_pE131Packet->Data.DMPLayer.PropertyValues[1];
+	const uint16_t slots = __builtin_bswap16(m_pE131Packet->Data.DMPLayer.PropertyValueCount) - 1;
+	const auto *pCid = m_pE131Packet->Data.RootLayer.Cid;
+	const auto nSequenceNumber = m_pE131Packet->Data.FrameLayer.SequenceNumber;
+	const auto nPriority = m_pE131Packet->Data.FrameLayer.Priority;
 
-		struct TSource *pSourceA = &m_OutputPort[i].sourceA;
-		struct TSource *pSourceB = &m_OutputPort[i].sourceB;
+	// Frame layer
+	// 8.2 Association of Multicast Addresses and Universe
+	// Note: The identity of the universe shall be determined by the universe number in the
+	// packet and not assumed from the multicast address.
+	auto nPortMask = m_OutputPortLookup.Get(__builtin_bswap16(m_pE131Packet->Data.FrameLayer.Universe));
 
-		const uint32_t ipA = pSourceA->ip;
-		const uint32_t ipB = pSourceB->ip;
+	while (nPortMask != 0) {
+		const auto i = static_cast<uint32_t>(__builtin_ctz(nPortMask));
+		nPortMask &= (nPortMask - 1);
 
-		const bool isSourceA = isIpCidMatch(pSourceA);
-		const bool isSourceB = isIpCidMatch(pSourceB);
+		if (__builtin_expect((!m_State.bDisableMergeTimeout), 1)) {
+			m_MergeEngine.CheckTimeouts(i, m_nCurrentPacketMillis, E131_MERGE_TIMEOUT_SECONDS * 1000);
+		}
 
-		bool sendNewData = false;
+		// A source is identified by its CID, the IP address is checked as well
+		auto *pSource = m_MergeEngine.Find(i, m_nIPAddressFrom, pCid);
 
 		// 6.9.2 Sequence Numbering
 		// Having first received a packet with sequence number A, a second packet with sequence number B
 		// arrives. If, using signed 8-bit binary arithmetic, B – A is less than or equal to 0, but greater than -20 then
 		// the packet containing sequence number B shall be deemed out of sequence and discarded
-		if (isSourceA) {
-			const auto diff = static_cast<int8_t>(m_E131.E131Packet.Data.FrameLayer.SequenceNumber - pSourceA->sequenceNumberData);
-			pSourceA->sequenceNumberData = m_E131.E131Packet.Data.FrameLayer.SequenceNumber;
-			if ((diff <= 0) && (diff > -20)) {
-				continue;
-			}
-		} else if (isSourceB) {
-			const auto diff = static_cast<int8_t>(m_E131.E131Packet.Data.FrameLayer.SequenceNumber - pSourceB->sequenceNumberData);
-			pSourceB->sequenceNumberData = m_E131.E131Packet.Data.FrameLayer.SequenceNumber;
+		if (pSource != nullptr) {
+			const auto diff = static_cast<int8_t>(nSequenceNumber - pSource->nSequenceNumber);
+			pSource->nSequenceNumber = nSequenceNumber;
 			if ((diff <= 0) && (diff > -20)) {
 				continue;
 			}
@@ -487,126 +400,57 @@ void E131Bridge::HandleDmx() {
 
 		// This bit, when set to 1, indicates that the data in this packet is intended for use in visualization or media
 		// server preview applications and shall not be used to generate live output.
-		if ((m_E131.E131Packet.Data.FrameLayer.Options & E131_OPTIONS_MASK_PREVIEW_DATA) != 0) {
+		if ((m_pE131Packet->Data.FrameLayer.Options & E131_OPTIONS_MASK_PREVIEW_DATA) != 0) {
 			continue;
 		}
 
 		// Upon receipt of a packet containing this bit set to a value of 1, receiver shall enter network data loss condition.
 		// Any property values in these packets shall be ignored.
-		if ((m_E131.E131Packet.Data.FrameLayer.Options & E131_OPTIONS_MASK_STREAM_TERMINATED) != 0) {
-			if (isSourceA || isSourceB) {
-				SetNetworkDataLossCondition(isSourceA, isSourceB);
+		if ((m_pE131Packet->Data.FrameLayer.Options & E131_OPTIONS_MASK_STREAM_TERMINATED) != 0) {
+			if (pSource != nullptr) {
+				SetStreamTerminated(i, pSource);
 			}
 			continue;
 		}
 
-		if (m_State.IsMergeMode) {
-			if (__builtin_expect((!m_State.bDisableMergeTimeout), 1)) {
-				CheckMergeTimeouts(i);
-			}
-		}
+		if (pSource == nullptr) {
+			pSource = m_MergeEngine.Add(i, m_nIPAddressFrom, pCid);
 
-		if (m_E131.E131Packet.Data.FrameLayer.Priority < m_State.nPriority ){
-			if (!IsPriorityTimeOut(i)) {
+			if (pSource == nullptr) {
+				DEBUG_PUTS("No free merge source, discarding data");
 				continue;
 			}
-			m_State.nPriority = m_E131.E131Packet.Data.FrameLayer.Priority;
-		} else if (m_E131.E131Packet.Data.FrameLayer.Priority > m_State.nPriority) {
-			m_OutputPort[i].sourceA.ip = 0;
-			m_OutputPort[i].sourceB.ip = 0;
-			m_State.IsMergeMode = false;
-			m_State.nPriority = m_E131.E131Packet.Data.FrameLayer.Priority;
+
+			pSource->nSequenceNumber = nSequenceNumber;
 		}
 
-		if ((ipA == 0) && (ipB == 0)) {
-			//printf("1. First package from Source\n");
-			pSourceA->ip = m_E131.IPAddressFrom;
-			pSourceA->sequenceNumberData = m_E131.E131Packet.Data.FrameLayer.SequenceNumber;
-			memcpy(pSourceA->cid, m_E131.E131Packet.Data.RootLayer.Cid, 16);
-			pSourceA->time = m_nCurrentPacketMillis;
-			memcpy(pSourceA->data, p, slots);
-			sendNewData = IsDmxDataChanged(i, p, slots);
-
-		} else if (isSourceA && (ipB == 0)) {
-			//printf("2. Continue package from SourceA\n");
-			pSourceA->sequenceNumberData = m_E131.E131Packet.Data.FrameLayer.SequenceNumber;
-			pSourceA->time = m_nCurrentPacketMillis;
-			memcpy(pSourceA->data, p, slots);
-			sendNewData = IsDmxDataChanged(i, p, slots);
-
-		} else if ((ipA == 0) && isSourceB) {
-			//printf("3. Continue package from SourceB\n");
-			pSourceB->sequenceNumberData = m_E131.E131Packet.Data.FrameLayer.SequenceNumber;
-			pSourceB->time = m_nCurrentPacketMillis;
-			memcpy(pSourceB->data, p, slots);
-			sendNewData = IsDmxDataChanged(i, p, slots);
-
-		} else if (!isSourceA && (ipB == 0)) {
-			//printf("4. New ip, start merging\n");
-			pSourceB->ip = m_E131.IPAddressFrom;
-			pSourceB->sequenceNumberData = m_E131.E131Packet.Data.FrameLayer.SequenceNumber;
-			memcpy(pSourceB->cid, m_E131.E131Packet.Data.RootLayer.Cid, 16);
-			pSourceB->time = m_nCurrentPacketMillis;
-			memcpy(pSourceB->data, p, slots);
-			sendNewData = IsMergedDmxDataChanged(i, pSourceB->data, slots);
-
-		} else if ((ipA == 0) && !isSourceB) {
-			//printf("5. New ip, start merging\n");
-			pSourceA->ip = m_E131.IPAddressFrom;
-			pSourceA->sequenceNumberData = m_E131.E131Packet.Data.FrameLayer.SequenceNumber;
-			memcpy(pSourceA->cid, m_E131.E131Packet.Data.RootLayer.Cid, 16);
-			pSourceA->time = m_nCurrentPacketMillis;
-			memcpy(pSourceA->data, p, slots);
-			sendNewData = IsMergedDmxDataChanged(i, pSourceA->data, slots);
-
-		} else if (isSourceA && !isSourceB) {
-			//printf("6. Continue merging\n");
-			pSourceA->sequenceNumberData = m_E131.E131Packet.Data.FrameLayer.SequenceNumber;
-			pSourceA->time = m_nCurrentPacketMillis;
-			memcpy(pSourceA->data, p, slots);
-			sendNewData = IsMergedDmxDataChanged(i, pSourceA->data, slots);
-
-		} else if (!isSourceA && isSourceB) {
-			//printf("7. Continue merging\n");
-			pSourceB->sequenceNumberData = m_E131.E131Packet.Data.FrameLayer.SequenceNumber;
-			pSourceB->time = m_nCurrentPacketMillis;
-			memcpy(pSourceB->data, p, slots);
-			sendNewData = IsMergedDmxDataChanged(i, pSourceB->data, slots);
-
-		} else if (isSourceA && isSourceB) {
-			printf("8. Source matches both buffers, this shouldn't be happening!\n");
-			assert(0);
-			return;
+		// 6.2.3 Priority: the data of a source with a lower priority than the other sources is kept,
+		// so it takes over immediately when the sources with the higher priority time out.
+		m_MergeEngine.SetData(pSource, p, slots, nPriority, m_nCurrentPacketMillis);
 
-		} else if (!isSourceA && !isSourceB) {
-			printf("9. More than two sources, discarding data\n");
-			assert(0);
-			return;
-
-		} else {
-			printf("0. No cases matched, this shouldn't happen!\n");
-			assert(0);
-			return;
+		if (nPriority < m_MergeEngine.GetPriority(i)) {
+			continue;
 		}
 
+		const auto mergeMode = (m_OutputPort[i].mergeMode == E131Merge::LTP) ? lightset::MergeMode::LTP : lightset::MergeMode::HTP;
+		const auto sendNewData = m_MergeEngine.Merge(i, mergeMode, m_OutputPort[i].data, m_OutputPort[i].length);
+
+		UpdateMergeState(i);
+
 		// This bit indicates whether to lock or revert to an unsynchronized state when synchronization is lost
 		// (See Section 11 on Universe Synchronization and 11.1 for discussion on synchronization states).
 		// When set to 0, components that had been operating in a synchronized state shall not update with any
 		// new packets until synchronization resumes. When set to 1, once synchronization has been lost,
 		// components that had been operating in a synchronized state need not wait for a new
 		// E1.31 Synchronization Packet in order to update to the next E1.31 Data Packet.
-		if ((m_E131.E131Packet.Data.FrameLayer.Options & E131_OPTIONS_MASK_FORCE_SYNCHRONIZATION) == 0) {
+		if ((m_pE131Packet->Data.FrameLayer.Options & E131_OPTIONS_MASK_FORCE_SYNCHRONIZATION) == 0) {
 			// 6.3.3.1 Synchronization Address Usage in an E1.31 Synchronization Packet
 			// An E1.31 Synchronization Packet is sent to synchronize the E1.31 data on a specific universe number.
 			// A Synchronization Address of 0 is thus meaningless, and shall not be transmitted.
 			// Receivers shall ignore E1.31 Synchronization Packets containing a Synchronization Address of 0.
-			if (m_E131.E131Packet.Data.FrameLayer.SynchronizationAddress != 0) {
+			if (m_pE131Packet->Data.FrameLayer.SynchronizationAddress != 0) {
 				if (!m_State.IsForcedSynchronized) {
-					if (!(isSourceA || isSourceB)) {
-						SetSynchronizationAddress((pSourceA->ip != 0), (pSourceB->ip != 0), __builtin_bswap16(m_E131.E131Packet.Data.FrameLayer.SynchronizationAddress));
-					} else {
-						SetSynchronizationAddress(isSourceA, isSourceB, __builtin_bswap16(m_E131.E131Packet.Data.FrameLayer.SynchronizationAddress));
-					}
+					SetSynchronizationAddress(__builtin_bswap16(m_pE131Packet->Data.FrameLayer.SynchronizationAddress));
 					m_State.IsForcedSynchronized = true;
 					m_State.IsSynchronized = true;
 				}
@@ -615,21 +459,7 @@ void E131Bridge::HandleDmx() {
 			m_State.IsForcedSynchronized = false;
 		}
 
-		if (sendNewData || m_bDirectUpdate) {
-			if ((!m_State.IsSynchronized) || (m_State.bDisableSynchronize)) {
-
-				m_pLightSet->SetData(i, m_OutputPort[i].data, m_OutputPort[i].length);
-
-				if (!m_OutputPort[i].IsTransmitting) {
-					m_pLightSet->Start(i);
-					m_State.IsChanged |= (!m_OutputPort[i].IsTransmitting);
-					m_OutputPort[i].IsTransmitting = true;
-				}
-			} else {
-				m_OutputPort[i].IsDataPending = sendNewData;
-			}
-
-		}
+		SendData(i, sendNewData);
 
 		m_State.bIsReceivingDmx = true;
 	}
@@ -643,7 +473,7 @@ void E131Bridge::HandleSynchronization() {
 	// NOTE: There is no multicast addresses (To Ip) available
 	// We just check if SynchronizationAddress is published by a Source
 
-	const uint16_t nSynchronizationAddress = __builtin_bswap16(m_E131.E131Packet.Synchronization.FrameLayer.UniverseNumber);
+	const uint16_t nSynchronizationAddress = __builtin_bswap16(m_pE131Packet->Synchronization.FrameLayer.UniverseNumber);
 
 	if ((nSynchronizationAddress != m_State.nSynchronizationAddressSourceA) && (nSynchronizationAddress != m_State.nSynchronizationAddressSourceB)) {
 		LedBlink::Get()->SetMode(ledblink::Mode::NORMAL);
@@ -657,6 +487,9 @@ void E131Bridge::HandleSynchronization() {
 		if ((m_OutputPort[i].IsDataPending) || (m_OutputPort[i].bIsEnabled && m_bDirectUpdate)){
 
 			m_pLightSet->SetData(i, m_OutputPort[i].data, m_OutputPort[i].length);
+#if defined (ENABLE_LATENCY_TRACE)
+			h3_latency_record(H3_LATENCY_SETDATA);
+#endif
 
 			if (!m_OutputPort[i].IsTransmitting) {
 				m_pLightSet->Start(i);
@@ -672,61 +505,57 @@ void E131Bridge::HandleSynchronization() {
 	}
 }
 
-void E131Bridge::SetNetworkDataLossCondition(bool bSourceA, bool bSourceB) {
+void E131Bridge::SetNetworkDataLossCondition() {
 	DEBUG_ENTRY
-	DEBUG_PRINTF("%d %d", bSourceA, bSourceB);
 
 	m_State.IsChanged = true;
+	m_State.IsNetworkDataLoss = true;
+	m_State.IsMergeMode = false;
+	m_State.IsSynchronized = false;
+	m_State.IsForcedSynchronized = false;
 
-	if (bSourceA && bSourceB) {
-		m_State.IsNetworkDataLoss = true;
-		m_State.IsMergeMode = false;
-		m_State.IsSynchronized = false;
-		m_State.IsForcedSynchronized = false;
-		m_State.nPriority = E131_PRIORITY_LOWEST;
-
-		for (uint32_t i = 0; i < E131_MAX_PORTS; i++) {
-			if (m_OutputPort[i].IsTransmitting) {
-				m_pLightSet->Stop(i);
-				m_OutputPort[i].sourceA.ip = 0;
-				memset(m_OutputPort[i].sourceA.cid, 0, E131_CID_LENGTH);
-				m_OutputPort[i].sourceB.ip = 0;
-				memset(m_OutputPort[i].sourceB.cid, 0, E131_CID_LENGTH);
-				m_OutputPort[i].length = 0;
-				m_OutputPort[i].IsDataPending = false;
-				m_OutputPort[i].IsTransmitting = false;
-				m_OutputPort[i].IsMerging = false;
-			}
+	for (uint32_t i = 0; i < E131_MAX_PORTS; i++) {
+		if (m_OutputPort[i].IsTransmitting) {
+			m_pLightSet->Stop(i);
+			m_OutputPort[i].length = 0;
+			m_OutputPort[i].IsDataPending = false;
+			m_OutputPort[i].IsTransmitting = false;
 		}
 
-	} else {
-		for (uint32_t i = 0; i < E131_MAX_PORTS; i++) {
-			if (m_OutputPort[i].IsTransmitting) {
+		m_MergeEngine.Clear(i);
+		m_OutputPort[i].IsMerging = false;
+	}
 
-				if ((bSourceA) && (m_OutputPort[i].sourceA.ip != 0)) {
-					m_OutputPort[i].sourceA.ip = 0;
-					memset(m_OutputPort[i].sourceA.cid, 0, E131_CID_LENGTH);
-					m_OutputPort[i].IsMerging = false;
-				}
+	LedBlink::Get()->SetMode(ledblink::Mode::NORMAL);
+	m_State.bIsReceivingDmx = false;
 
-				if ((bSourceB) && (m_OutputPort[i].sourceB.ip != 0)) {
-					m_OutputPort[i].sourceB.ip = 0;
-					memset(m_OutputPort[i].sourceB.cid, 0, E131_CID_LENGTH);
-					m_OutputPort[i].IsMerging = false;
-				}
+	DEBUG_EXIT
+}
 
-				if (!m_State.IsMergeMode) {
-					m_pLightSet->Stop(i);
-					m_OutputPort[i].length = 0;
-					m_OutputPort[i].IsDataPending = false;
-					m_OutputPort[i].IsTransmitting = false;
-				}
-			}
-		}
+void E131Bridge::SetStreamTerminated(uint32_t nPortIndex, LightSetMergeEngine::Source *pSource) {
+	DEBUG_ENTRY
+	DEBUG_PRINTF("nPortIndex=%u", nPortIndex);
+
+	m_MergeEngine.Remove(nPortIndex, pSource);
+
+	UpdateMergeState(nPortIndex);
+
+	if (m_MergeEngine.GetSourceCount(nPortIndex) != 0) {
+		// The remaining sources take over
+		const auto mergeMode = (m_OutputPort[nPortIndex].mergeMode == E131Merge::LTP) ? lightset::MergeMode::LTP : lightset::MergeMode::HTP;
+		SendData(nPortIndex, m_MergeEngine.Merge(nPortIndex, mergeMode, m_OutputPort[nPortIndex].data, m_OutputPort[nPortIndex].length));
+		DEBUG_EXIT
+		return;
 	}
 
-	LedBlink::Get()->SetMode(ledblink::Mode::NORMAL);
-	m_State.bIsReceivingDmx = false;
+	m_State.IsChanged = true;
+
+	if (m_OutputPort[nPortIndex].IsTransmitting) {
+		m_pLightSet->Stop(nPortIndex);
+		m_OutputPort[nPortIndex].length = 0;
+		m_OutputPort[nPortIndex].IsDataPending = false;
+		m_OutputPort[nPortIndex].IsTransmitting = false;
+	}
 
 	DEBUG_EXIT
 }
@@ -774,12 +603,12 @@ void E131Bridge::Clear(uint8_t nPortIndex) {
 bool E131Bridge::IsValidRoot() {
 	// 5 E1.31 use of the ACN Root Layer Protocol
 	// Receivers shall discard the packet if the ACN Packet Identifier is not valid.
-	if (memcmp(m_E131.E131Packet.Raw.RootLayer.ACNPacketIdentifier, E117Const::ACN_PACKET_IDENTIFIER, E117_PACKET_IDENTIFIER_LENGTH) != 0) {
+	if (memcmp(m_pE131Packet->Raw.RootLayer.ACNPacketIdentifier, E117Const::ACN_PACKET_IDENTIFIER, E117_PACKET_IDENTIFIER_LENGTH) != 0) {
 		return false;
 	}
 	
-	if (m_E131.E131Packet.Raw.RootLayer.Vector != __builtin_bswap32(E131_VECTOR_ROOT_DATA)
-			 && (m_E131.E131Packet.Raw.RootLayer.Vector != __builtin_bswap32(E131_VECTOR_ROOT_EXTENDED)) ) {
+	if (m_pE131Packet->Raw.RootLayer.Vector != __builtin_bswap32(E131_VECTOR_ROOT_DATA)
+			 && (m_pE131Packet->Raw.RootLayer.Vector != __builtin_bswap32(E131_VECTOR_ROOT_EXTENDED)) ) {
 		return false;
 	}
 
@@ -791,25 +620,25 @@ bool E131Bridge::IsValidDataPacket() {
 
 	// The DMP Layer's Vector shall be set to 0x02, which indicates a DMP Set Property message by
 	// transmitters. Receivers shall discard the packet if the received value is not 0x02.
-	if (m_E131.E131Packet.Data.DMPLayer.Vector != E131_VECTOR_DMP_SET_PROPERTY) {
+	if (m_pE131Packet->Data.DMPLayer.Vector != E131_VECTOR_DMP_SET_PROPERTY) {
 		return false;
 	}
 
 	// Transmitters shall set the DMP Layer's Address Type and Data Type to 0xa1. Receivers shall discard the
 	// packet if the received value is not 0xa1.
-	if (m_E131.E131Packet.Data.DMPLayer.Type != 0xa1) {
+	if (m_pE131Packet->Data.DMPLayer.Type != 0xa1) {
 		return false;
 	}
 
 	// Transmitters shall set the DMP Layer's First Property Address to 0x0000. Receivers shall discard the
 	// packet if the received value is not 0x0000.
-	if (m_E131.E131Packet.Data.DMPLayer.FirstAddressProperty != __builtin_bswap16(0x0000)) {
+	if (m_pE131Packet->Data.DMPLayer.FirstAddressProperty != __builtin_bswap16(0x0000)) {
 		return false;
 	}
 
 	// Transmitters shall set the DMP Layer's Address Increment to 0x0001. Receivers shall discard the packet if
 	// the received value is not 0x0001.
-	if (m_E131.E131Packet.Data.DMPLayer.AddressIncrement != __builtin_bswap16(0x0001)) {
+	if (m_pE131Packet->Data.DMPLayer.AddressIncrement != __builtin_bswap16(0x0001)) {
 		return false;
 	}
 
@@ -818,8 +647,9 @@ bool E131Bridge::IsValidDataPacket() {
 
 void E131Bridge::Run() {
 	uint16_t nForeignPort;
+	void *pBuffer;
 
-	const auto nBytesReceived = Network::Get()->RecvFrom(m_nHandle, &m_E131.E131Packet, sizeof(m_E131.E131Packet), &m_E131.IPAddressFrom, &nForeignPort) ;
+	const auto nBytesReceived = Network::Get()->RecvFromZeroCopy(m_nHandle, &pBuffer, &m_nIPAddressFrom, &nForeignPort) ;
 
 	m_nCurrentPacketMillis = Hardware::Get()->Millis();
 
@@ -858,6 +688,34 @@ void E131Bridge::Run() {
 		return;
 	}
 
+	/*
+	 * A burst is drained in one call, bounded so that the rest of the main loop keeps running.
+	 */
+	auto nPackets = E131_RUN_MAX_PACKETS;
+
+	do {
+		HandlePacket(pBuffer);
+		Network::Get()->RecvRelease(m_nHandle);
+	} while ((--nPackets != 0) && (Network::Get()->RecvFromZeroCopy(m_nHandle, &pBuffer, &m_nIPAddressFrom, &nForeignPort) != 0));
+
+	if (m_pE131DmxIn != nullptr) {
+		HandleDmxIn();
+		SendDiscoveryPacket();
+	}
+
+	// The ledblink::Mode::FAST is for RDM Identify (Art-Net 4)
+	if (m_bEnableDataIndicator && (LedBlink::Get()->GetMode() != ledblink::Mode::FAST)) {
+		if (m_State.bIsReceivingDmx) {
+			LedBlink::Get()->SetMode(ledblink::Mode::DATA);
+		} else {
+			LedBlink::Get()->SetMode(ledblink::Mode::NORMAL);
+		}
+	}
+}
+
+void E131Bridge::HandlePacket(void *pBuffer) {
+	m_pE131Packet = reinterpret_cast<union UE131Packet*>(pBuffer);
+
 	if (__builtin_expect((!IsValidRoot()), 0)) {
 		return;
 	}
@@ -872,14 +730,14 @@ void E131Bridge::Run() {
 	}
 
 	if (m_pLightSet != nullptr) {
-		const uint32_t nRootVector = __builtin_bswap32(m_E131.E131Packet.Raw.RootLayer.Vector);
+		const uint32_t nRootVector = __builtin_bswap32(m_pE131Packet->Raw.RootLayer.Vector);
 
 		if (nRootVector == E131_VECTOR_ROOT_DATA) {
 			if (IsValidDataPacket()) {
 				HandleDmx();
 			}
 		} else if (nRootVector == E131_VECTOR_ROOT_EXTENDED) {
-			const uint32_t nFramingVector = __builtin_bswap32(m_E131.E131Packet.Raw.FrameLayer.Vector);
+			const uint32_t nFramingVector = __builtin_bswap32(m_pE131Packet->Raw.FrameLayer.Vector);
 				if (nFramingVector == E131_VECTOR_EXTENDED_SYNCHRONIZATION) {
 				HandleSynchronization();
 			}
@@ -887,18 +745,4 @@ void E131Bridge::Run() {
 			DEBUG_PRINTF("Not supported Root Vector : 0x%x", nRootVector);
 		}
 	}
-
-	if (m_pE131DmxIn != nullptr) {
-		HandleDmxIn();
-		SendDiscoveryPacket();
-	}
-
-	// The ledblink::Mode::FAST is for RDM Identify (Art-Net 4)
-	if (m_bEnableDataIndicator && (LedBlink::Get()->GetMode() != ledblink::Mode::FAST)) {
-		if (m_State.bIsReceivingDmx) {
-			LedBlink::Get()->SetMode(ledblink::Mode::DATA);
-		} else {
-			LedBlink::Get()->SetMode(ledblink::Mode::NORMAL);
-		}
-	}
 }
@@ -113,6 +113,10 @@ E131Controller::~E131Controller() {
 		delete m_pE131DiscoveryPacket;
 	}
 
+	if (m_pFrameDataPackets != nullptr) {
+		delete[] m_pFrameDataPackets;
+	}
+
 	if (m_pE131DataPacket != nullptr) {
 		delete m_pE131DataPacket;
 	}
@@ -164,6 +168,16 @@ void E131Controller::FillDataPacket() {
 	m_pE131DataPacket->DMPLayer.FirstAddressProperty = __builtin_bswap16(0x0000);
 	m_pE131DataPacket->DMPLayer.AddressIncrement = __builtin_bswap16(0x0001);
 	m_pE131DataPacket->DMPLayer.PropertyValues[0] = 0;
+
+	if (m_pFrameDataPackets != nullptr) {
+		FillFrameDataPackets();
+	}
+}
+
+void E131Controller::FillFrameDataPackets() {
+	for (uint32_t nIndex = 0; nIndex < E131_CONTROLLER_MAX_FRAME_UNIVERSES; nIndex++) {
+		memcpy(&m_pFrameDataPackets[nIndex], m_pE131DataPacket, sizeof(struct TE131DataPacket));
+	}
 }
 
 void E131Controller::FillDiscoveryPacket() {
@@ -199,33 +213,123 @@ void E131Controller::FillSynchronizationPacket() {
 	m_pE131SynchronizationPacket->FrameLayer.UniverseNumber = __builtin_bswap16(m_State.SynchronizationPacket.nUniverseNumber);
 }
 
-void E131Controller::HandleDmxOut(uint16_t nUniverse, const uint8_t *pDmxData, uint16_t nLength) {
-	uint32_t nIp;
+/**
+ * @return The data packet size
+ */
+uint32_t E131Controller::SetData(struct TE131DataPacket *pE131DataPacket, const uint8_t *pDmxData, uint16_t nLength) {
+	if (nLength > E131_DMX_LENGTH) {
+		nLength = E131_DMX_LENGTH;
+	}
 
 	// Root Layer (See Section 5)
-	m_pE131DataPacket->RootLayer.FlagsLength = __builtin_bswap16((0x07 << 12) | (DATA_ROOT_LAYER_LENGTH(1U + nLength)));
+	pE131DataPacket->RootLayer.FlagsLength = __builtin_bswap16((0x07 << 12) | (DATA_ROOT_LAYER_LENGTH(1U + nLength)));
 
 	// E1.31 Framing Layer (See Section 6)
-	m_pE131DataPacket->FrameLayer.FLagsLength = __builtin_bswap16((0x07 << 12) | (DATA_FRAME_LAYER_LENGTH(1U + nLength)));
-	m_pE131DataPacket->FrameLayer.SequenceNumber = GetSequenceNumber(nUniverse, nIp);
-	m_pE131DataPacket->FrameLayer.Universe = __builtin_bswap16(nUniverse);
+	pE131DataPacket->FrameLayer.FLagsLength = __builtin_bswap16((0x07 << 12) | (DATA_FRAME_LAYER_LENGTH(1U + nLength)));
 
 	// Data Layer
-	m_pE131DataPacket->DMPLayer.FlagsLength = __builtin_bswap16((0x07 << 12) | (DATA_LAYER_LENGTH(1U + nLength)));
+	pE131DataPacket->DMPLayer.FlagsLength = __builtin_bswap16((0x07 << 12) | (DATA_LAYER_LENGTH(1U + nLength)));
 
 	if (__builtin_expect((m_nMaster == DMX_MAX_VALUE), 1)) {
-		memcpy(&m_pE131DataPacket->DMPLayer.PropertyValues[1], pDmxData, nLength);
+		memcpy(&pE131DataPacket->DMPLayer.PropertyValues[1], pDmxData, nLength);
 	} else if (m_nMaster == 0) {
-		memset(&m_pE131DataPacket->DMPLayer.PropertyValues[1], 0, nLength);
+		memset(&pE131DataPacket->DMPLayer.PropertyValues[1], 0, nLength);
 	} else {
 		for (uint32_t i = 0; i < nLength; i++) {
-			m_pE131DataPacket->DMPLayer.PropertyValues[1 + i] = (m_nMaster * static_cast<uint32_t>(pDmxData[i])) / DMX_MAX_VALUE;
+			pE131DataPacket->DMPLayer.PropertyValues[1 + i] = (m_nMaster * static_cast<uint32_t>(pDmxData[i])) / DMX_MAX_VALUE;
+		}
+	}
+
+	pE131DataPacket->DMPLayer.PropertyValueCount = __builtin_bswap16(1 + nLength);
+
+	return DATA_PACKET_SIZE(1U + nLength);
+}
+
+void E131Controller::HandleDmxOut(uint16_t nUniverse, const uint8_t *pDmxData, uint16_t nLength) {
+	uint32_t nIp;
+
+	m_pE131DataPacket->FrameLayer.SequenceNumber = GetSequenceNumber(nUniverse, nIp);
+	m_pE131DataPacket->FrameLayer.Universe = __builtin_bswap16(nUniverse);
+
+	const auto nPacketSize = SetData(m_pE131DataPacket, pDmxData, nLength);
+
+	Network::Get()->SendTo(m_nHandle, m_pE131DataPacket, nPacketSize, nIp, E131_DEFAULT_PORT);
+}
+
+void E131Controller::AddUniverse(uint16_t nUniverse, const uint8_t *pDmxData, uint16_t nLength) {
+	const auto nUniverseNetwork = __builtin_bswap16(nUniverse);
+	uint32_t nIndex;
+
+	// The frame buffers are only needed when the frame level output is used
+	if (__builtin_expect((m_pFrameDataPackets == nullptr), 0)) {
+		m_pFrameDataPackets = new struct TE131DataPacket[E131_CONTROLLER_MAX_FRAME_UNIVERSES];
+		assert(m_pFrameDataPackets != nullptr);
+		FillFrameDataPackets();
+	}
+
+	WaitFrameSent();
+
+	for (nIndex = 0; nIndex < m_nFrameUniverses; nIndex++) {
+		if (m_pFrameDataPackets[nIndex].FrameLayer.Universe == nUniverseNetwork) {
+			break;
+		}
+	}
+
+	if (nIndex == E131_CONTROLLER_MAX_FRAME_UNIVERSES) {
+		SendFrame();
+		nIndex = 0;
+	}
+
+	auto *pE131DataPacket = &m_pFrameDataPackets[nIndex];
+
+	// The sequence number is taken once per frame, an overwritten universe keeps it
+	if (nIndex == m_nFrameUniverses) {
+		pE131DataPacket->FrameLayer.SequenceNumber = GetSequenceNumber(nUniverse, m_nFrameIpAddress[nIndex]);
+		pE131DataPacket->FrameLayer.Universe = nUniverseNetwork;
+		m_nFrameUniverses++;
+	}
+
+	m_nFrameLength[nIndex] = static_cast<uint16_t>(SetData(pE131DataPacket, pDmxData, nLength));
+}
+
+void E131Controller::SendFrame() {
+	for (uint32_t nIndex = 0; nIndex < m_nFrameUniverses; nIndex++) {
+		uint32_t nSequence;
+
+		if (Network::Get()->SendToZeroCopy(m_nHandle, &m_pFrameDataPackets[nIndex], m_nFrameLength[nIndex], m_nFrameIpAddress[nIndex], E131_DEFAULT_PORT, nSequence)) {
+			m_nFrameSequence = nSequence;
+			m_bFrameInFlight = true;
+		} else {
+			Network::Get()->SendTo(m_nHandle, &m_pFrameDataPackets[nIndex], m_nFrameLength[nIndex], m_nFrameIpAddress[nIndex], E131_DEFAULT_PORT);
+		}
+	}
+
+	m_nFrameUniverses = 0;
+}
+
+/**
+ * The frame packets are sent without a copy, they are not changed before the transmitter is done with them.
+ */
+void E131Controller::WaitFrameSent() {
+	if (!m_bFrameInFlight) {
+		return;
+	}
+
+	const auto nMillis = Hardware::Get()->Millis();
+
+	while (!Network::Get()->IsSendDone(m_nFrameSequence)) {
+		if ((Hardware::Get()->Millis() - nMillis) > E131_CONTROLLER_FRAME_SENT_TIMEOUT_MILLIS) {
+			DEBUG_PUTS("Frame send timeout");
+			break;
 		}
 	}
 
-	m_pE131DataPacket->DMPLayer.PropertyValueCount = __builtin_bswap16(1 + nLength);
+	m_bFrameInFlight = false;
+}
 
-	Network::Get()->SendTo(m_nHandle, m_pE131DataPacket, DATA_PACKET_SIZE(1U + nLength), nIp, E131_DEFAULT_PORT);
+void E131Controller::CommitFrame() {
+	SendFrame();
+	HandleSync();
 }
 
 void E131Controller::HandleSync() {
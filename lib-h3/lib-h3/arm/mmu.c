@@ -114,12 +114,20 @@ static volatile __attribute__ ((aligned (0x4000))) uint32_t page_table[4096];
 #define XN_BIT	(1 << 4)
 #define DOMAIN	(0 << 5)
 #define AP		(AP_SYSTEM_ACCESS << 10)
+#define TEX_1	(1 << 12)
 #define S_BIT	(1 << 16)
 
 #define MACRO_SRAM	(        AP | DOMAIN          | C_BIT | B_BIT | SECTION)
 #define MACRO_PERI	(        AP | DOMAIN | XN_BIT |                 SECTION)
 #define MACRO_DRAM	(        AP | DOMAIN          | C_BIT | B_BIT | SECTION)
 #define MACRO_COHE	(S_BIT | AP | DOMAIN | XN_BIT |                 SECTION)
+/*
+ * The coherent region is Normal memory, non-cacheable (TEX=001, C=0, B=0).
+ * Strongly-ordered would fault on the unaligned accesses of in-place packet parsing.
+ * Its users are emac.c, h3_codec.c and h3_spi.c. Each of them issues a dmb()
+ * between writing a DMA descriptor or buffer and starting the DMA.
+ */
+#define MACRO_DMA	(S_BIT | AP | DOMAIN | XN_BIT | TEX_1         | SECTION)
 #define MACRO_BROM	(        AP | DOMAIN          | C_BIT | B_BIT | SECTION)
 
 uint32_t *mmu_get_page_table(void) {
@@ -157,7 +165,7 @@ void __attribute__((cold)) mmu_enable(void) {
 
 	// Finally set the Coherent region. This is part of the DRAM section
 	entry = H3_MEM_COHERENT_REGION / MEGABYTE;
-	page_table[entry] = entry << 20 | MACRO_COHE;
+	page_table[entry] = entry << 20 | MACRO_DMA;
 
 	clean_data_cache();
 	dmb();
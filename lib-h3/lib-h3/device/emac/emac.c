@@ -35,6 +35,15 @@
 
 #include "h3.h"
 #include "h3_sid.h"
+#include "irq_timer.h"
+
+#if defined (ENABLE_LATENCY_TRACE)
+# include "h3_latency.h"
+#endif
+
+#include "arm/arm.h"
+#include "arm/synchronize.h"
+#include "arm/gic.h"
 
 #include "phy.h"
 #include "mii.h"
@@ -56,6 +65,7 @@
 #define RX_CTL0_RX_EN				(1U << 31)
 #define RX_CTL1_RX_DMA_EN			(1 << 30)
 
+#define RX_FRM_FLT_HASH_MULTICAST	(1 << 9)
 #define RX_FRM_FLT_RX_ALL_MULTICAST	(1 << 16)
 
 #define	ARM_DMA_ALIGN	64
@@ -70,8 +80,46 @@
  */
 #define CONFIG_ETH_RXSIZE	2044 /* Note must fit in ETH_BUFSIZE */
 
+/*
+ * A completed RX descriptor gets a spare buffer and is given back to the DMA right away.
+ * The received buffer waits in the ready queue until the upper layers are done with it.
+ */
+#define CONFIG_RX_SPARE_NUM	96
+#define CONFIG_RX_BUFFER_NUM	(CONFIG_RX_DESCR_NUM + CONFIG_RX_SPARE_NUM)
+
+/*
+ * Maximum number of RX buffers which can be on loan to the upper layers.
+ * The remaining spare buffers keep the ring running for ARP, DHCP, etc.
+ */
+#define CONFIG_RX_LOAN_MAX	(CONFIG_RX_SPARE_NUM - 16)
+
+#define RX_QUEUE_SIZE		256 // Must always be a power of 2, and larger than CONFIG_RX_BUFFER_NUM
+#define RX_QUEUE_MASK		(RX_QUEUE_SIZE - 1)
+
+#if (RX_QUEUE_SIZE <= CONFIG_RX_BUFFER_NUM)
+# error RX_QUEUE_SIZE is too small
+#endif
+
+#define DESC_OWN_DMA		(1U << 31)
+
+#define TX_DESC_CTL_LEN_MASK	0x7FF
+#define TX_DESC_CTL_UNDOC		(1U << 24) /* Mandatory undocumented bit */
+#define TX_DESC_CTL_FIRST		(1U << 29)
+#define TX_DESC_CTL_LAST		(1U << 30)
+#define TX_DESC_CTL_INT			(1U << 31)
+
+#define INT_STA_RX_INT		(1U << 8)
+#define INT_EN_RX_INT		(1U << 8)
+
 #define TX_TOTAL_BUFSIZE	(CONFIG_ETH_BUFSIZE * CONFIG_TX_DESCR_NUM)
-#define RX_TOTAL_BUFSIZE	(CONFIG_ETH_BUFSIZE * CONFIG_RX_DESCR_NUM)
+#define RX_TOTAL_BUFSIZE	(CONFIG_ETH_BUFSIZE * CONFIG_RX_BUFFER_NUM)
+
+/*
+ * The EMAC owns the first half megabyte of the coherent region, h3_codec.c starts after it.
+ */
+#if (TX_TOTAL_BUFSIZE + RX_TOTAL_BUFSIZE) > (448 * 1024)
+# error The EMAC buffers do not fit in the coherent region
+#endif
 
 #define __aligned(x)            __attribute__((aligned(x)))
 
@@ -93,6 +141,48 @@ struct coherent_region {
 
 static struct coherent_region *p_coherent_region = 0;
 
+/*
+ * Single producer, single consumer queues. There are no locks.
+ * ready: produced by _rx_harvest (IRQ), consumed by emac_free_pkt (main loop).
+ * free: produced by emac_free_pkt/emac_eth_return (main loop), consumed by _rx_harvest (IRQ).
+ */
+struct rx_ready_entry {
+	uint16_t buffer;
+	uint16_t length;
+};
+
+static struct rx_ready_queue {
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	struct rx_ready_entry entries[RX_QUEUE_SIZE];
+} s_rx_ready;
+
+static struct rx_free_queue {
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	uint16_t entries[RX_QUEUE_SIZE];
+} s_rx_free;
+
+static uint16_t s_rx_desc_buffer[CONFIG_RX_DESCR_NUM];	// Buffer attached to the descriptor
+static bool s_rx_loaned[CONFIG_RX_BUFFER_NUM];
+static uint32_t s_rx_loaned_count;
+static volatile bool s_rx_stalled;
+static bool s_rx_irq_enabled;
+static struct emac_rx_stats s_rx_stats;
+
+static bool s_tx_desc_last[CONFIG_TX_DESCR_NUM];	// Last descriptor of a frame
+static uint32_t s_tx_dirtydescnum;	// Oldest descriptor not reclaimed yet
+static uint32_t s_tx_inflight;		// Descriptors handed to the DMA, not reclaimed yet
+static uint32_t s_tx_sequence;		// Sequence number of the next frame
+static uint32_t s_tx_completed;		// Number of frames reclaimed
+static struct emac_tx_stats s_tx_stats;
+
+/*
+ * All multicast frames are received until emac_multicast_set_filter is called.
+ */
+static uint32_t s_rx_frm_flt = RX_FRM_FLT_RX_ALL_MULTICAST;
+static uint32_t s_rx_hash[2];
+
 #define H3_EPHY_DEFAULT_VALUE	0x00058000
 #define H3_EPHY_DEFAULT_MASK	0xFFFF8000
 #define H3_EPHY_ADDR_SHIFT		20
@@ -105,6 +195,9 @@ static struct coherent_region *p_coherent_region = 0;
 void emac_shutdown(void) {
 	uint32_t value;
 
+	H3_EMAC->INT_EN &= ~INT_EN_RX_INT;
+	s_rx_irq_enabled = false;
+
 	value = H3_EMAC->RX_CTL0;
 	value &= ~RX_CTL0_RX_EN;
 	H3_EMAC->RX_CTL0 = value;
@@ -204,100 +297,382 @@ void emac_init(void) {
 	DEBUG_PRINTF("H3_EMAC->ADDR[0].LOW=%08x, H3_EMAC->ADDR[0].HIGH=%08x", H3_EMAC->ADDR[0].LOW, H3_EMAC->ADDR[0].HIGH);
 }
 
+static char *_tx_buffer(uint32_t desc_num) {
+	return &p_coherent_region->txbuffer[desc_num * CONFIG_ETH_BUFSIZE];
+}
+
+static char *_rx_buffer(uint32_t buffer) {
+	return &p_coherent_region->rxbuffer[buffer * CONFIG_ETH_BUFSIZE];
+}
+
 static void _rx_descs_init(void) {
 	struct emac_dma_desc *desc_table_p = &p_coherent_region->rx_chain[0];
-	char *rxbuffs = &p_coherent_region->rxbuffer[0];
 	struct emac_dma_desc *desc_p;
 	uint32_t idx;
 
 	for (idx = 0; idx < CONFIG_RX_DESCR_NUM; idx++) {
 		desc_p = &desc_table_p[idx];
-		desc_p->buf_addr = (uintptr_t) &rxbuffs[idx * CONFIG_ETH_BUFSIZE];
+		desc_p->buf_addr = (uintptr_t) _rx_buffer(idx);
 		desc_p->next = (uintptr_t) &desc_table_p[idx + 1];
 		desc_p->st = CONFIG_ETH_RXSIZE;
-		desc_p->status = (1U << 31);
+		desc_p->status = DESC_OWN_DMA;
+		s_rx_desc_buffer[idx] = (uint16_t) idx;
 	}
 
 	/* Correcting the last pointer of the chain */
 	desc_p->next = (uintptr_t) &desc_table_p[0];
 
+	for (idx = 0; idx < CONFIG_RX_BUFFER_NUM; idx++) {
+		s_rx_loaned[idx] = false;
+	}
+
+	for (idx = 0; idx < CONFIG_RX_SPARE_NUM; idx++) {
+		s_rx_free.entries[idx] = (uint16_t) (CONFIG_RX_DESCR_NUM + idx);
+	}
+
+	s_rx_free.head = CONFIG_RX_SPARE_NUM;
+	s_rx_free.tail = 0;
+	s_rx_ready.head = 0;
+	s_rx_ready.tail = 0;
+	s_rx_loaned_count = 0;
+	s_rx_stalled = false;
+	memset(&s_rx_stats, 0, sizeof(struct emac_rx_stats));
+
 	H3_EMAC->RX_DMA_DESC = (uintptr_t)&desc_table_p[0];
 	p_coherent_region->rx_currdescnum = 0;
 }
 
 static void _tx_descs_init(void) {
 	struct emac_dma_desc *desc_table_p = &p_coherent_region->tx_chain[0];
-	char *txbuffs = &p_coherent_region->txbuffer[0];
 	struct emac_dma_desc *desc_p;
 	uint32_t idx;
 
 	for (idx = 0; idx < CONFIG_TX_DESCR_NUM; idx++) {
 		desc_p = &desc_table_p[idx];
-		desc_p->buf_addr = (uintptr_t) &txbuffs[idx * CONFIG_ETH_BUFSIZE];
+		desc_p->buf_addr = (uintptr_t) _tx_buffer(idx);
 		desc_p->next = (uintptr_t) &desc_table_p[idx + 1];
-		desc_p->status = (1U << 31);
+		desc_p->status = 0;	// Owned by the CPU until there is something to send
 		desc_p->st = 0;
+		s_tx_desc_last[idx] = false;
 	}
 
 	/* Correcting the last pointer of the chain */
 	desc_p->next = (uintptr_t) &desc_table_p[0];
 
+	s_tx_dirtydescnum = 0;
+	s_tx_inflight = 0;
+	s_tx_sequence = 0;
+	s_tx_completed = 0;
+	memset(&s_tx_stats, 0, sizeof(struct emac_tx_stats));
+
 	H3_EMAC->TX_DMA_DESC = (uintptr_t)&desc_table_p[0];
 	p_coherent_region->tx_currdescnum = 0;
 }
 
-int emac_eth_recv(uint8_t **packetp) {
-	uint32_t status, desc_num = p_coherent_region->rx_currdescnum;
-	struct emac_dma_desc *desc_p = &p_coherent_region->rx_chain[desc_num];
-	int length;
+/*
+ * Move all completed descriptors into the ready queue and give them back to the DMA with a spare buffer.
+ * Runs in the EMAC interrupt handler, or from emac_eth_recv when the interrupt is not enabled.
+ */
+static void _rx_harvest(void) {
+	uint32_t desc_num = p_coherent_region->rx_currdescnum;
+	uint32_t harvested = 0;
 
-	status = desc_p->status;
+	for (;;) {
+		struct emac_dma_desc *desc_p = &p_coherent_region->rx_chain[desc_num];
+		const uint32_t status = desc_p->status;
+
+		/* Check for DMA own bit */
+		if (status & DESC_OWN_DMA) {
+			s_rx_stalled = false;
+			break;
+		}
 
-	/* Check for DMA own bit */
-	if (!(status & (1U << 31))) {
-		length = (desc_p->status >> 16) & 0x3FFF;
+		const uint32_t length = (status >> 16) & 0x3FFF;
 
-		if (length < 0x40) {
-			DEBUG_PUTS("Bad Packet (length < 0x40)");
-			return -1;
+		if (__builtin_expect(((length < 0x40) || (length > CONFIG_ETH_RXSIZE)), 0)) {
+			DEBUG_PRINTF("Bad Packet (length=%d)", length);
+			s_rx_stats.bad_frames++;
 		} else {
-			if (length > CONFIG_ETH_RXSIZE) {
-				DEBUG_PRINTF("Received packet is too big (length=%d)\n", length);
-				return -1;
+			const uint32_t ready_head = s_rx_ready.head;
+
+			if (__builtin_expect(((s_rx_free.head == s_rx_free.tail) || (((ready_head + 1) & RX_QUEUE_MASK) == s_rx_ready.tail)), 0)) {
+				/* Leave the descriptor with the CPU, the DMA will suspend when the ring is full */
+				s_rx_stats.stalls++;
+				s_rx_stalled = true;
+				break;
 			}
 
-			*packetp = (uint8_t*) (uint32_t) desc_p->buf_addr;
-#ifdef DEBUG_DUMP
-			debug_dump((void*) *packetp, (uint16_t) length);
-#endif
-			return length;
+			const uint32_t free_tail = s_rx_free.tail;
+			const uint16_t spare = s_rx_free.entries[free_tail];
+			s_rx_free.tail = (free_tail + 1) & RX_QUEUE_MASK;
+
+			s_rx_ready.entries[ready_head].buffer = s_rx_desc_buffer[desc_num];
+			s_rx_ready.entries[ready_head].length = (uint16_t) length;
+			dmb();
+			s_rx_ready.head = (ready_head + 1) & RX_QUEUE_MASK;
+
+			s_rx_desc_buffer[desc_num] = spare;
+			desc_p->buf_addr = (uintptr_t) _rx_buffer(spare);
+			s_rx_stats.frames++;
+		}
+
+		dmb();
+		desc_p->status = DESC_OWN_DMA;
+
+		harvested++;
+
+		/* Move to next desc and wrap-around condition. */
+		if (++desc_num >= CONFIG_RX_DESCR_NUM) {
+			desc_num = 0;
 		}
 	}
 
-	return -1;
+	p_coherent_region->rx_currdescnum = desc_num;
+
+	if (harvested != 0) {
+		if (harvested > s_rx_stats.ring_high_water) {
+			s_rx_stats.ring_high_water = harvested;
+		}
+
+		const uint32_t depth = (s_rx_ready.head - s_rx_ready.tail) & RX_QUEUE_MASK;
+
+		if (depth > s_rx_stats.queue_high_water) {
+			s_rx_stats.queue_high_water = depth;
+		}
+
+		/* The DMA might have been suspended on a full ring */
+		dmb();
+		H3_EMAC->RX_CTL1 |= (1U << 31);
+	}
 }
 
-void emac_eth_send(void *packet, int len) {
-	uint32_t value;
-	uint32_t desc_num = p_coherent_region->tx_currdescnum;
-	struct emac_dma_desc *desc_p = &p_coherent_region->tx_chain[desc_num];
-	uintptr_t data_start = (uintptr_t) desc_p->buf_addr;
+/*
+ * Called from the IRQ handler, after it has read H3_EMAC_IRQn from the GIC.
+ */
+void emac_irq_handler(void) {
+	H3_EMAC->INT_STA = INT_STA_RX_INT;
+	_rx_harvest();
+	H3_GIC_CPUIF->AEOI = H3_EMAC_IRQn;
+	H3_GIC_DIST->ICPEND[H3_EMAC_IRQn / 32] = 1 << (H3_EMAC_IRQn % 32);
+}
+
+/*
+ * The IRQ handler of irq_timer.c dispatches the EMAC interrupt, so the timers keep working.
+ */
+void __attribute__((cold)) emac_rx_irq_enable(void) {
+	irq_timer_init();
+
+	gic_irq_config(H3_EMAC_IRQn, GIC_CORE0);
 
-	desc_p->st = (uint32_t)len;
-	/* Mandatory undocumented bit */
-	desc_p->st |= (1U << 24);
+	H3_EMAC->INT_STA = INT_STA_RX_INT;
+	H3_EMAC->INT_EN |= INT_EN_RX_INT;
 
-	h3_memcpy((void *) data_start, packet, (size_t)len);
+	s_rx_irq_enabled = true;
+
+	isb();
+	__enable_irq();
+}
+
+static void _rx_free_push(uint32_t buffer) {
+	const uint32_t free_head = s_rx_free.head;
+
+	s_rx_free.entries[free_head] = (uint16_t) buffer;
+	dmb();
+	s_rx_free.head = (free_head + 1) & RX_QUEUE_MASK;
+
+	if (__builtin_expect(s_rx_stalled, 0)) {
+		if (s_rx_irq_enabled) {
+			__disable_irq();
+			_rx_harvest();
+			__enable_irq();
+		} else {
+			_rx_harvest();
+		}
+	}
+}
+
+int emac_eth_recv(uint8_t **packetp) {
+	if (!s_rx_irq_enabled) {
+		_rx_harvest();
+	}
+
+	const uint32_t ready_tail = s_rx_ready.tail;
+
+	if (ready_tail == s_rx_ready.head) {
+		return -1;
+	}
+
+	dmb();
+
+	const struct rx_ready_entry *entry = &s_rx_ready.entries[ready_tail];
+
+	*packetp = (uint8_t *) _rx_buffer(entry->buffer);
+#if defined (ENABLE_LATENCY_TRACE)
+	h3_latency_rx_us = h3_latency_now();
+#endif
 #ifdef DEBUG_DUMP
-	debug_dump( data_start, (uint16_t) len);
+	debug_dump((void*) *packetp, entry->length);
 #endif
-	/* frame end */
-	desc_p->st |= (1 << 30);
-	desc_p->st |= (1U << 31);
+	return (int) entry->length;
+}
+
+/*
+ * Keep the current buffer after emac_free_pkt.
+ * Returns a token for emac_eth_return, or -1 when no more buffers can be loaned.
+ */
+int32_t emac_eth_loan(void) {
+	const uint32_t buffer = s_rx_ready.entries[s_rx_ready.tail].buffer;
+
+	assert(s_rx_ready.tail != s_rx_ready.head);
+	assert(!s_rx_loaned[buffer]);
+
+	if (__builtin_expect((s_rx_loaned_count >= CONFIG_RX_LOAN_MAX), 0)) {
+		return -1;
+	}
+
+	s_rx_loaned[buffer] = true;
+	s_rx_loaned_count++;
+
+	return (int32_t) buffer;
+}
+
+void emac_eth_return(int32_t token) {
+	assert((token >= 0) && (token < CONFIG_RX_BUFFER_NUM));
+
+	const uint32_t buffer = (uint32_t) token;
 
-	/*frame begin */
-	desc_p->st |= (1 << 29);
-	desc_p->status = (1U << 31);
+	assert(s_rx_loaned[buffer]);
+
+	s_rx_loaned[buffer] = false;
+	s_rx_loaned_count--;
+
+	_rx_free_push(buffer);
+}
+
+void emac_get_rx_stats(struct emac_rx_stats *p_stats) {
+	memcpy(p_stats, &s_rx_stats, sizeof(struct emac_rx_stats));
+}
+
+/*
+ * Take back the descriptors of the frames which have been sent.
+ */
+static void _tx_reclaim(void) {
+	while (s_tx_inflight != 0) {
+		const uint32_t desc_num = s_tx_dirtydescnum;
+		const struct emac_dma_desc *desc_p = &p_coherent_region->tx_chain[desc_num];
+
+		if (desc_p->status & DESC_OWN_DMA) {
+			break;
+		}
+
+		if (s_tx_desc_last[desc_num]) {
+			s_tx_completed++;
+		}
+
+		s_tx_inflight--;
+
+		if (++s_tx_dirtydescnum >= CONFIG_TX_DESCR_NUM) {
+			s_tx_dirtydescnum = 0;
+		}
+	}
+}
+
+static uint32_t _tx_descs_needed(const struct emac_tx_segment *segments, uint32_t count) {
+	uint32_t needed = 0;
+	uint32_t copy_length = CONFIG_ETH_BUFSIZE;	// Forces a new descriptor for the first copied segment
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		if (segments[i].flags & EMAC_TX_SEGMENT_ZERO_COPY) {
+			needed++;
+			copy_length = CONFIG_ETH_BUFSIZE;
+		} else if ((copy_length + segments[i].length) > TX_DESC_CTL_LEN_MASK) {
+			needed++;
+			copy_length = segments[i].length;
+		} else {
+			copy_length += segments[i].length;
+		}
+	}
+
+	return needed;
+}
+
+/*
+ * Consecutive copied segments are merged into the coherent buffer of one descriptor.
+ * A zero-copy segment gets its own descriptor pointing to the segment data, which must stay
+ * unchanged until emac_eth_tx_done(*sequence) returns true.
+ * Returns -1 when there are not enough free descriptors, nothing is sent then.
+ */
+int emac_eth_send_segments(const struct emac_tx_segment *segments, uint32_t count, uint32_t *sequence) {
+	assert(segments != 0);
+	assert(count != 0);
+
+	_tx_reclaim();
+
+	const uint32_t needed = _tx_descs_needed(segments, count);
+
+	assert(needed <= CONFIG_TX_DESCR_NUM);
+
+	if (__builtin_expect(((s_tx_inflight + needed) > CONFIG_TX_DESCR_NUM), 0)) {
+		s_tx_stats.busy++;
+		return -1;
+	}
+
+	const uint32_t first_desc_num = p_coherent_region->tx_currdescnum;
+	uint32_t desc_num = first_desc_num;
+	struct emac_dma_desc *desc_p = 0;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		const struct emac_tx_segment *segment = &segments[i];
+
+		assert(segment->length <= TX_DESC_CTL_LEN_MASK);
+
+		if ((desc_p != 0) && !(segment->flags & EMAC_TX_SEGMENT_ZERO_COPY) && (desc_p->buf_addr == (uintptr_t) _tx_buffer(desc_num))) {
+			const uint32_t length = desc_p->st & TX_DESC_CTL_LEN_MASK;
+
+			if ((length + segment->length) <= TX_DESC_CTL_LEN_MASK) {
+				h3_memcpy(_tx_buffer(desc_num) + length, segment->data, segment->length);
+				desc_p->st += segment->length;
+				continue;
+			}
+		}
+
+		if (desc_p != 0) {
+			if (++desc_num >= CONFIG_TX_DESCR_NUM) {
+				desc_num = 0;
+			}
+		}
+
+		desc_p = &p_coherent_region->tx_chain[desc_num];
+
+		if (segment->flags & EMAC_TX_SEGMENT_ZERO_COPY) {
+			CleanAndInvalidateDataCacheRange((void *) segment->data, segment->length);
+			desc_p->buf_addr = (uintptr_t) segment->data;
+			s_tx_stats.zero_copy_bytes += segment->length;
+		} else {
+			desc_p->buf_addr = (uintptr_t) _tx_buffer(desc_num);
+			h3_memcpy(_tx_buffer(desc_num), segment->data, segment->length);
+		}
+
+		desc_p->st = TX_DESC_CTL_UNDOC | segment->length;
+		s_tx_desc_last[desc_num] = false;
+
+		/* The first descriptor is given to the DMA last, when the whole chain is ready */
+		if (desc_num != first_desc_num) {
+			desc_p->status = DESC_OWN_DMA;
+		}
+	}
+
+	desc_p->st |= (TX_DESC_CTL_LAST | TX_DESC_CTL_INT);
+	s_tx_desc_last[desc_num] = true;
+
+	p_coherent_region->tx_chain[first_desc_num].st |= TX_DESC_CTL_FIRST;
+
+	dmb();
+	p_coherent_region->tx_chain[first_desc_num].status = DESC_OWN_DMA;
+
+	s_tx_inflight += needed;
 
 	/* Move to next Descriptor and wrap around */
 	if (++desc_num >= CONFIG_TX_DESCR_NUM) {
@@ -306,26 +681,113 @@ void emac_eth_send(void *packet, int len) {
 
 	p_coherent_region->tx_currdescnum = desc_num;
 
-	/* Start the DMA */
-	value = H3_EMAC->TX_CTL1;
+	if (sequence != 0) {
+		*sequence = s_tx_sequence;
+	}
+
+	s_tx_sequence++;
+	s_tx_stats.frames++;
+
+	/* Start the DMA, the descriptors must be written before */
+	dmb();
+	uint32_t value = H3_EMAC->TX_CTL1;
 	value |= (1U << 31);/* mandatory */
 	value |= (1 << 30);/* mandatory */
 	H3_EMAC->TX_CTL1 = value;
+
+	return 0;
 }
 
-void emac_free_pkt(void) {
-	uint32_t desc_num = p_coherent_region->rx_currdescnum;
-	struct emac_dma_desc *desc_p = &p_coherent_region->rx_chain[desc_num];
+bool emac_eth_tx_done(uint32_t sequence) {
+	_tx_reclaim();
 
-	/* Make the current descriptor valid again */
-	desc_p->status |= (1U << 31);
+	return (int32_t) (s_tx_completed - sequence) > 0;
+}
 
-	/* Move to next desc and wrap-around condition. */
-	if (++desc_num >= CONFIG_RX_DESCR_NUM) {
-		desc_num = 0;
+/*
+ * Bit index in the 64-bit multicast hash table: the upper 6 bits of the bit reversed Ethernet CRC.
+ */
+uint32_t emac_multicast_hash(const uint8_t *mac_address) {
+	uint32_t crc = 0xFFFFFFFF;
+	uint32_t i, j;
+
+	for (i = 0; i < 6; i++) {
+		crc ^= mac_address[i];
+
+		for (j = 0; j < 8; j++) {
+			crc = (crc >> 1) ^ (0xEDB88320 & (uint32_t) -(int32_t) (crc & 1));
+		}
 	}
 
-	p_coherent_region->rx_currdescnum = desc_num;
+	crc = ~crc;
+
+	uint32_t hash = 0;
+
+	for (i = 0; i < 6; i++) {
+		hash = (hash << 1) | ((crc >> i) & 1);
+	}
+
+	return hash;
+}
+
+/*
+ * Only multicast frames with a destination in the hash table are received.
+ * Bit n of the table is bit (n & 31) of hash[n >> 5].
+ */
+void emac_multicast_set_filter(const uint32_t *hash) {
+	s_rx_hash[0] = hash[0];
+	s_rx_hash[1] = hash[1];
+	s_rx_frm_flt = RX_FRM_FLT_HASH_MULTICAST;
+
+	H3_EMAC->RX_HASH0 = s_rx_hash[0];
+	H3_EMAC->RX_HASH1 = s_rx_hash[1];
+	H3_EMAC->RX_FRM_FLT = s_rx_frm_flt;
+}
+
+/*
+ * For a payload that was copied instead of sent, emac_eth_tx_done is true right away.
+ */
+uint32_t emac_eth_tx_sequence_done(void) {
+	return s_tx_completed - 1;
+}
+
+void emac_get_tx_stats(struct emac_tx_stats *p_stats) {
+	memcpy(p_stats, &s_tx_stats, sizeof(struct emac_tx_stats));
+}
+
+void emac_eth_send(void *packet, int len) {
+	const struct emac_tx_segment segment = { packet, (uint16_t) len, EMAC_TX_SEGMENT_COPY };
+
+	if (__builtin_expect((emac_eth_send_segments(&segment, 1, 0) == 0), 1)) {
+		return;
+	}
+
+	const uint32_t micros_timeout = H3_TIMER->AVS_CNT1 + CONFIG_TX_TIMEOUT_US;
+
+	while (emac_eth_send_segments(&segment, 1, 0) != 0) {
+		if ((int32_t) (H3_TIMER->AVS_CNT1 - micros_timeout) > 0) {
+			DEBUG_PUTS("TX timeout");
+			s_tx_stats.dropped++;
+			return;
+		}
+	}
+}
+
+void emac_free_pkt(void) {
+	const uint32_t ready_tail = s_rx_ready.tail;
+
+	if (__builtin_expect((ready_tail == s_rx_ready.head), 0)) {
+		return;
+	}
+
+	const uint32_t buffer = s_rx_ready.entries[ready_tail].buffer;
+
+	s_rx_ready.tail = (ready_tail + 1) & RX_QUEUE_MASK;
+
+	/* The buffer can be used again, unless it is on loan */
+	if (!s_rx_loaned[buffer]) {
+		_rx_free_push(buffer);
+	}
 }
 
 void _autonegotiation(void) {
@@ -400,7 +862,9 @@ void __attribute__((cold)) emac_start(__attribute__((unused)) bool reset_emac) {
 	_rx_descs_init();
 	_tx_descs_init();
 
-	H3_EMAC->RX_FRM_FLT = RX_FRM_FLT_RX_ALL_MULTICAST;
+	H3_EMAC->RX_HASH0 = s_rx_hash[0];
+	H3_EMAC->RX_HASH1 = s_rx_hash[1];
+	H3_EMAC->RX_FRM_FLT = s_rx_frm_flt;
 
 	value = H3_EMAC->RX_CTL1;
 	value |= RX_CTL1_RX_DMA_EN;
@@ -29,6 +29,38 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+struct emac_rx_stats {
+	uint32_t frames;
+	uint32_t bad_frames;
+	uint32_t stalls;			///< No spare buffer or the ready queue was full
+	uint32_t ring_high_water;	///< Most completed descriptors found in one harvest
+	uint32_t queue_high_water;	///< Most frames waiting in the ready queue
+};
+
+struct emac_tx_stats {
+	uint32_t frames;
+	uint32_t busy;				///< emac_eth_send_segments found not enough free descriptors
+	uint32_t dropped;			///< emac_eth_send timed out
+	uint32_t zero_copy_bytes;
+};
+
+/*
+ * Waiting time of emac_eth_send for a free descriptor.
+ * At 10Mbit a full ring takes about 60ms to drain.
+ */
+#if !defined (CONFIG_TX_TIMEOUT_US)
+# define CONFIG_TX_TIMEOUT_US	(100 * 1000)
+#endif
+
+#define EMAC_TX_SEGMENT_COPY		0
+#define EMAC_TX_SEGMENT_ZERO_COPY	(1U << 0)	///< The data must stay unchanged until emac_eth_tx_done
+
+struct emac_tx_segment {
+	const void *data;
+	uint16_t length;
+	uint16_t flags;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -36,6 +68,19 @@ extern "C" {
 extern void emac_init(void);
 extern void emac_start(bool reset_emac);
 extern void emac_shutdown(void);
+extern void emac_rx_irq_enable(void);
+extern void emac_irq_handler(void);
+extern void emac_get_rx_stats(struct emac_rx_stats *);
+extern uint32_t emac_multicast_hash(const uint8_t *);
+extern void emac_multicast_set_filter(const uint32_t *);
+//
+extern void emac_eth_send(void *, int);
+extern int emac_eth_send_segments(const struct emac_tx_segment *, uint32_t, uint32_t *);
+extern int32_t emac_eth_loan(void);
+extern void emac_eth_return(int32_t);
+extern bool emac_eth_tx_done(uint32_t);
+extern uint32_t emac_eth_tx_sequence_done(void);
+extern void emac_get_tx_stats(struct emac_tx_stats *);
 
 #ifdef __cplusplus
 }
@@ -151,7 +151,10 @@ typedef enum T_H3_IRQn {
 	H3_TIMER0_IRQn = 50,
 	H3_TIMER1_IRQn = 51,
 	H3_AUDIO_CODEC_IRQn = 61,
-	H3_DMA_IRQn = 82
+	H3_DMA_IRQn = 82,
+	H3_SPI0_IRQn = 97,
+	H3_SPI1_IRQn = 98,
+	H3_EMAC_IRQn = 114
 } H3_IRQn_TypeDef;
 
 #ifdef __ASSEMBLY__
@@ -575,7 +578,9 @@ typedef struct T_H3_EMAC {
 	__I uint32_t RES2[2];			///< 0x2C, 0x30
 	__IO uint32_t RX_DMA_DESC;		///< 0x34
 	__IO uint32_t RX_FRM_FLT;		///< 0x38
-	__I uint32_t RES3[3];			///< 0x3C, 0x40, 0x44
+	__I uint32_t RES3;				///< 0x3C
+	__IO uint32_t RX_HASH0;			///< 0x40
+	__IO uint32_t RX_HASH1;			///< 0x44
 	__IO uint32_t MII_CMD;			///< 0x48
 	__IO uint32_t MII_DATA;			///< 0x4C
 	struct {
@@ -78,6 +78,7 @@
 
 #define EXT_SPI_NUMBER		((EXT_SPI_BASE - H3_SPI_BASE) / 0x1000)
 #define EXT_SPI				((H3_SPI_TypeDef *) EXT_SPI_BASE)
+#define EXT_SPI_IRQn		(EXT_SPI_NUMBER == 0 ? H3_SPI0_IRQn : H3_SPI1_IRQn)
 #define EXT_SPI_CS			GPIO_EXT_24
 #define EXT_SPI_CLK			GPIO_EXT_23
 #define EXT_SPI_MOSI		GPIO_EXT_19
@@ -0,0 +1,99 @@
+/**
+ * @file h3_latency.h
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef H3_LATENCY_H_
+#define H3_LATENCY_H_
+
+#include <stdint.h>
+
+#include "h3.h"
+
+/*
+ * Packet to photon latency. The EMAC receive time travels with the packet through the UDP queue,
+ * each stage adds the time since then to its histogram. A histogram has a single writer.
+ * The call sites are compiled in with ENABLE_LATENCY_TRACE only.
+ */
+
+enum h3_latency_stage {
+	H3_LATENCY_RECV,	///< Read from the UDP queue by the application
+	H3_LATENCY_DMX,		///< Art-Net or sACN data packet handled
+	H3_LATENCY_SETDATA,	///< LightSet::SetData() returned
+	H3_LATENCY_OUTPUT,	///< Output started, e.g. the SPI DMA of the pixel data
+	H3_LATENCY_LAST
+};
+
+#define H3_LATENCY_BUCKETS	16	///< Bucket n holds [2^(n-1), 2^n) us, the last bucket holds all above
+
+struct h3_latency_histogram {
+	uint32_t count;
+	uint32_t max_us;
+	uint64_t total_us;	///< In 32 bits the sum would wrap after 4295 s of latency
+	uint32_t bucket[H3_LATENCY_BUCKETS];
+} __attribute__ ((aligned (64)));
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern struct h3_latency_histogram h3_latency_histograms[H3_LATENCY_LAST];
+extern uint32_t h3_latency_rx_us;		///< The receive time of the last packet taken from the EMAC
+extern uint32_t h3_latency_packet_us;	///< The receive time of the packet being handled
+
+inline static uint32_t h3_latency_now(void) {
+	return H3_TIMER->AVS_CNT1;
+}
+
+inline static void h3_latency_record_since(enum h3_latency_stage stage, uint32_t since_us) {
+	struct h3_latency_histogram *histogram = &h3_latency_histograms[stage];
+	const uint32_t us = h3_latency_now() - since_us;
+	uint32_t bucket = (us == 0) ? 0 : (32 - (uint32_t) __builtin_clz(us));
+
+	if (bucket >= H3_LATENCY_BUCKETS) {
+		bucket = H3_LATENCY_BUCKETS - 1;
+	}
+
+	histogram->bucket[bucket]++;
+	histogram->count++;
+	histogram->total_us += us;
+
+	if (us > histogram->max_us) {
+		histogram->max_us = us;
+	}
+}
+
+inline static void h3_latency_record(enum h3_latency_stage stage) {
+	h3_latency_record_since(stage, h3_latency_packet_us);
+}
+
+extern const char *h3_latency_get_name(enum h3_latency_stage stage);
+extern void h3_latency_get(enum h3_latency_stage stage, struct h3_latency_histogram *histogram);
+extern void h3_latency_reset(void);
+extern void h3_latency_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H3_LATENCY_H_ */
@@ -0,0 +1,69 @@
+/**
+ * @file h3_pipeline.h
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef H3_PIPELINE_H_
+#define H3_PIPELINE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Work pipeline over the cores. Core 0 submits jobs to a stage running on core 1..3,
+ * each stage returns the core of the next stage, 0 returns the job to core 0.
+ * There is a single producer, single consumer ring for every pair of cores.
+ */
+
+struct h3_pipeline_job {
+	uint32_t timestamp_us;	///< Set by the pipeline when the job is passed on
+	uint32_t id;			///< Free for the user
+	void *arg;				///< Free for the user
+};
+
+typedef uint32_t (*h3_pipeline_stage_t)(struct h3_pipeline_job *);	///< Returns the core of the next stage
+typedef void (*h3_pipeline_poll_t)(void);							///< Called on every pass of the worker loop
+
+struct h3_pipeline_stats {
+	uint32_t jobs;
+	uint32_t queue_us_max;		///< From passed on until the stage starts
+	uint64_t queue_us_total;	///< In 32 bits the sum would wrap after 71 minutes
+	uint32_t service_us_max;	///< Time spent in the stage
+	uint64_t service_us_total;
+	uint32_t ring_full;			///< The next stage was not ready
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void h3_pipeline_start(uint32_t core, h3_pipeline_stage_t stage, h3_pipeline_poll_t poll);
+extern bool h3_pipeline_submit(uint32_t core, struct h3_pipeline_job *job);
+extern struct h3_pipeline_job *h3_pipeline_completed(void);
+extern void h3_pipeline_get_stats(uint32_t core, struct h3_pipeline_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H3_PIPELINE_H_ */
@@ -80,10 +80,20 @@ extern bool h3_spi_get_ws28xx_mode(void);
  * DMA support
  */
 
+typedef void (*h3_spi_dma_tx_callback_t)(void);
+
 extern const uint8_t *h3_spi_dma_tx_prepare(uint32_t *data_length);
 extern void h3_spi_dma_tx_start(const uint8_t *tx_buffer, uint32_t length);
 extern bool h3_spi_dma_tx_is_active(void);
 
+/*
+ * The callback runs in the IRQ handler on core 0 when a DMA transfer has completed,
+ * it can start the next transfer. NULL disables the interrupt.
+ * The polled transfers must not be used while a callback is set.
+ */
+extern void h3_spi_dma_tx_set_callback(h3_spi_dma_tx_callback_t callback);
+extern void h3_spi_irq_handler(void);
+
 #ifdef __cplusplus
 }
 #endif
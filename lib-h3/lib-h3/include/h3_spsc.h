@@ -0,0 +1,82 @@
+/**
+ * @file h3_spsc.h
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef H3_SPSC_H_
+#define H3_SPSC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arm/synchronize.h"
+
+/*
+ * Lock-free single producer, single consumer ring of pointers, for passing work between two cores.
+ * The head is only written by the producer and the tail only by the consumer, each in its own cache line.
+ */
+
+#define H3_SPSC_SIZE	16	///< Must be a power of 2
+
+struct h3_spsc {
+	volatile uint32_t head __attribute__ ((aligned (64)));
+	volatile uint32_t tail __attribute__ ((aligned (64)));
+	void *slot[H3_SPSC_SIZE] __attribute__ ((aligned (64)));
+};
+
+inline static void h3_spsc_init(struct h3_spsc *q) {
+	q->head = 0;
+	q->tail = 0;
+}
+
+inline static bool h3_spsc_push(struct h3_spsc *q, void *p) {
+	const uint32_t head = q->head;
+
+	if ((head - q->tail) == H3_SPSC_SIZE) {
+		return false;
+	}
+
+	q->slot[head & (H3_SPSC_SIZE - 1)] = p;
+	dmb();	// The slot (and the data it points to) is visible before the head
+	q->head = head + 1;
+
+	return true;
+}
+
+inline static void *h3_spsc_pop(struct h3_spsc *q) {
+	const uint32_t tail = q->tail;
+
+	if (tail == q->head) {
+		return NULL;
+	}
+
+	dmb();	// The slot is read after the head
+	void *p = q->slot[tail & (H3_SPSC_SIZE - 1)];
+	dmb();	// The slot is read before it is released
+	q->tail = tail + 1;
+
+	return p;
+}
+
+#endif /* H3_SPSC_H_ */
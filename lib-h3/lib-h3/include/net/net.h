@@ -41,6 +41,21 @@ struct ip_info {
     struct ip_addr gw;
 };
 
+struct udp_stats {
+	uint32_t received;
+	uint32_t dropped_queue_full;
+	uint32_t dropped_no_buffer;
+};
+
+/*
+ * Multicast frames passing the EMAC hash filter. The frames dropped by the hash filter are not counted.
+ */
+struct igmp_stats {
+	uint32_t groups;				///< Joined groups
+	uint32_t multicast_accepted;	///< For a joined group
+	uint32_t multicast_filtered;	///< Same hash as a joined group, dropped in software
+};
+
 #define IP_BROADCAST	((uint32_t) 0xFFFFFFFF)
 #define HOST_NAME_MAX 	64	/* including a terminating null byte. */
 
@@ -62,10 +77,17 @@ extern void net_dhcp_release(void);
 extern int udp_bind(uint16_t);
 extern int udp_unbind(uint16_t);
 extern uint16_t udp_recv(uint8_t, uint8_t *, uint16_t, uint32_t *, uint16_t *);
+extern uint16_t udp_recv_zc(uint8_t, uint8_t **, uint32_t *, uint16_t *);
+extern void udp_recv_release(uint8_t);
+extern int udp_set_queue_depth(uint8_t, uint16_t);
+extern void udp_get_stats(uint8_t, struct udp_stats *);
 extern int udp_send(uint8_t, const uint8_t *, uint16_t, uint32_t, uint16_t);
+extern int udp_send_zc(uint8_t, const uint8_t *, uint16_t, uint32_t, uint16_t, uint32_t *);
+extern bool udp_send_done(uint32_t);
 //
 extern int igmp_join(uint32_t);
 extern int igmp_leave(uint32_t);
+extern void igmp_get_stats(struct igmp_stats *);
 
 #ifdef __cplusplus
 }
@@ -2,7 +2,7 @@
  * @file arp_cache.c
  *
  */
-/* Copyright (C) 2018-2019 by Arjan van Vught mailto:info@orangepi-dmx.nl
+/* Copyright (C) 2018-2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -24,24 +24,69 @@
  */
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 #include <assert.h>
 
 #include "net_packets.h"
 #include "net_debug.h"
 
+#include "h3.h"
+
 #ifndef ALIGNED
 # define ALIGNED __attribute__ ((aligned (4)))
 #endif
 
 extern void arp_send_request(uint32_t ip);
 extern void net_handle(void);
+extern void emac_eth_send(void *, int);
+
+/*
+ * The cache is set associative, an IP address hashes to a set of ARP_CACHE_WAYS entries.
+ * When the set is full, the least recently used entry is replaced.
+ */
+#define ARP_CACHE_SETS_BITS	4
+#define ARP_CACHE_SETS		(1U << ARP_CACHE_SETS_BITS)
+#define ARP_CACHE_WAYS		4
 
-#define MAX_RECORDS	32
+/*
+ * The timer runs every 100 msec.
+ * A resolved entry becomes stale after ARP_MAX_AGE ticks, it is still used while being refreshed.
+ */
+#define ARP_MAX_AGE			(5 * 60 * 10)	///< 5 minutes
+#define ARP_MAX_RETRIES		3
+
+/*
+ * Frames to an unresolved destination wait in the pending pool, they are sent when the reply arrives.
+ * The oldest frame for a destination is dropped when it has ARP_PENDING_PER_IP frames waiting.
+ */
+#if !defined (ARP_PENDING_FRAMES)
+# define ARP_PENDING_FRAMES	8
+#endif
+#define ARP_PENDING_PER_IP	2
+#define ARP_PENDING_FRAME_SIZE	(UDP_PACKET_HEADERS_SIZE + FRAME_BUFFER_SIZE)
+
+typedef enum arp_state {
+	ARP_STATE_FREE = 0,
+	ARP_STATE_PENDING,
+	ARP_STATE_VALID,
+	ARP_STATE_STALE
+} _arp_state;
 
 struct t_arp_record {
 	uint32_t ip;
+	uint32_t ticks_updated;
+	uint32_t ticks_used;
 	uint8_t mac_address[ETH_ADDR_LEN];
+	uint8_t state;
+	uint8_t retries;
+} ALIGNED;
+
+struct t_arp_pending {
+	uint32_t ip;
+	uint32_t order;
+	uint16_t length;
+	uint8_t frame[ARP_PENDING_FRAME_SIZE] ALIGNED;
 } ALIGNED;
 
 typedef union pcast32 {
@@ -49,8 +94,10 @@ typedef union pcast32 {
 	uint8_t u8[4];
 } _pcast32;
 
-static struct t_arp_record s_arp_records[MAX_RECORDS] ALIGNED;
-static uint16_t s_entry_current;
+static struct t_arp_record s_arp_records[ARP_CACHE_SETS][ARP_CACHE_WAYS] ALIGNED;
+static struct t_arp_pending s_arp_pending[ARP_PENDING_FRAMES] ALIGNED;
+static uint32_t s_pending_order;
+static volatile uint32_t s_ticks;
 static uint8_t s_multicast_mac[ETH_ADDR_LEN] = {0x01, 0x00, 0x5E}; // Fixed part
 
 #ifndef NDEBUG
@@ -58,14 +105,96 @@ static uint8_t s_multicast_mac[ETH_ADDR_LEN] = {0x01, 0x00, 0x5E}; // Fixed part
  static volatile uint32_t s_ticker ;
 #endif
 
+static inline struct t_arp_record *_set(uint32_t ip) {
+	return s_arp_records[(ip * 2654435761U) >> (32 - ARP_CACHE_SETS_BITS)];
+}
+
+static struct t_arp_record *_find(uint32_t ip) {
+	struct t_arp_record *p_record = _set(ip);
+	uint32_t i;
+
+	for (i = 0; i < ARP_CACHE_WAYS; i++, p_record++) {
+		if ((p_record->state != ARP_STATE_FREE) && (p_record->ip == ip)) {
+			return p_record;
+		}
+	}
+
+	return 0;
+}
+
+static void _pending_drop(uint32_t ip) {
+	uint32_t i;
+
+	for (i = 0; i < ARP_PENDING_FRAMES; i++) {
+		if (s_arp_pending[i].ip == ip) {
+			s_arp_pending[i].ip = 0;
+		}
+	}
+}
+
+static struct t_arp_record *_allocate(uint32_t ip) {
+	struct t_arp_record *p_set = _set(ip);
+	struct t_arp_record *p_victim = 0;
+	uint32_t i;
+
+	for (i = 0; i < ARP_CACHE_WAYS; i++) {
+		struct t_arp_record *p_record = &p_set[i];
+
+		if (p_record->state == ARP_STATE_FREE) {
+			p_victim = p_record;
+			break;
+		}
+
+		if ((p_victim == 0) || ((s_ticks - p_record->ticks_used) > (s_ticks - p_victim->ticks_used))) {
+			p_victim = p_record;
+		}
+	}
+
+	if (p_victim->state != ARP_STATE_FREE) {
+		DEBUG_PRINTF("Replace " IPSTR " -> " IPSTR, IP2STR(p_victim->ip), IP2STR(ip));
+		_pending_drop(p_victim->ip);
+	}
+
+	p_victim->ip = ip;
+	p_victim->ticks_updated = s_ticks;
+	p_victim->ticks_used = s_ticks;
+	p_victim->state = ARP_STATE_FREE;
+	p_victim->retries = 0;
+
+	return p_victim;
+}
+
+static void _pending_flush(const struct t_arp_record *p_record) {
+	for (;;) {
+		struct t_arp_pending *p_oldest = 0;
+		uint32_t i;
+
+		for (i = 0; i < ARP_PENDING_FRAMES; i++) {
+			struct t_arp_pending *p_pending = &s_arp_pending[i];
+
+			if ((p_pending->ip == p_record->ip) && ((p_oldest == 0) || ((int32_t) (p_pending->order - p_oldest->order) < 0))) {
+				p_oldest = p_pending;
+			}
+		}
+
+		if (p_oldest == 0) {
+			return;
+		}
+
+		memcpy(((struct ether_packet *) p_oldest->frame)->dst, p_record->mac_address, ETH_ADDR_LEN);
+		emac_eth_send(p_oldest->frame, p_oldest->length);
+
+		p_oldest->ip = 0;
+	}
+}
+
 void __attribute__((cold)) arp_cache_init(void) {
-	uint16_t i;
+	memset(s_arp_records, 0, sizeof(s_arp_records));
 
-	s_entry_current = 0;
+	uint32_t i;
 
-	for (i = 0; i < MAX_RECORDS; i++) {
-		s_arp_records[i].ip = 0;
-		memset(s_arp_records[i].mac_address, 0, ETH_ADDR_LEN);
+	for (i = 0; i < ARP_PENDING_FRAMES; i++) {
+		s_arp_pending[i].ip = 0;
 	}
 
 #ifndef NDEBUG
@@ -75,27 +204,27 @@ void __attribute__((cold)) arp_cache_init(void) {
 
 void arp_cache_update(uint8_t *mac_address, uint32_t ip) {
 	DEBUG2_ENTRY
-	uint16_t i;
 
-	if (s_entry_current == MAX_RECORDS) {
-		assert(0);
-		return;
-	}
+	struct t_arp_record *p_record = _find(ip);
 
-	for (i = 0; i < s_entry_current; i++) {
-		if (s_arp_records[i].ip == ip) {
-			return;
-		}
+	if (p_record == 0) {
+		p_record = _allocate(ip);
 	}
 
-	memcpy(s_arp_records[s_entry_current].mac_address, mac_address, ETH_ADDR_LEN);
-	s_arp_records[s_entry_current].ip = ip;
+	memcpy(p_record->mac_address, mac_address, ETH_ADDR_LEN);
+	p_record->ticks_updated = s_ticks;
+	p_record->state = ARP_STATE_VALID;
+	p_record->retries = 0;
 
-	s_entry_current++;
+	_pending_flush(p_record);
 
 	DEBUG2_EXIT
 }
 
+/*
+ * Never blocks. On a miss an ARP request is sent and 0 is returned,
+ * the caller can then hand the frame to arp_cache_queue.
+ */
 uint32_t arp_cache_lookup(uint32_t ip, uint8_t *mac_address) {
 	DEBUG2_ENTRY
 
@@ -112,67 +241,151 @@ uint32_t arp_cache_lookup(uint32_t ip, uint8_t *mac_address) {
 		return ip;
 	}
 
-	DEBUG_PRINTF(IPSTR " " MACSTR, IP2STR(ip), MAC2STR(mac_address));
+	struct t_arp_record *p_record = _find(ip);
 
-	uint16_t i;
-
-	for (i = 0; i < MAX_RECORDS; i++) {
-		if (s_arp_records[i].ip == ip) {
-			memcpy(mac_address, s_arp_records[i].mac_address, ETH_ADDR_LEN);
+	if (__builtin_expect((p_record != 0), 1)) {
+		if (p_record->state != ARP_STATE_PENDING) {
+			p_record->ticks_used = s_ticks;
+			memcpy(mac_address, p_record->mac_address, ETH_ADDR_LEN);
+			DEBUG2_EXIT
 			return ip;
 		}
 
-		if (s_arp_records[i].ip == 0) {
-			break;
-		}
+		DEBUG2_EXIT
+		return 0;
 	}
 
-	uint16_t current_entry = s_entry_current;
-	int32_t timeout;
-	int8_t retries = 3;
+	DEBUG_PRINTF(IPSTR " miss", IP2STR(ip));
 
-	while (retries--) {
-		arp_send_request(ip);
+	p_record = _allocate(ip);
+	p_record->state = ARP_STATE_PENDING;
 
-		timeout = 0xFFFF;
+	arp_send_request(ip);
+
+	DEBUG2_EXIT
+	return 0;
+}
 
-		while ((timeout-- > 0) && (current_entry == s_entry_current)) {
-			net_handle();
+/*
+ * Keep a copy of the frame until the destination is resolved.
+ * The Ethernet destination address is filled in when the frame is sent.
+ */
+bool arp_cache_queue(uint32_t ip, const void *header, uint32_t header_length, const void *payload, uint32_t payload_length) {
+	assert(header_length + payload_length <= ARP_PENDING_FRAME_SIZE);
+
+	struct t_arp_pending *p_slot = 0;
+	struct t_arp_pending *p_oldest_same = 0;
+	uint32_t same = 0;
+	uint32_t i;
+
+	for (i = 0; i < ARP_PENDING_FRAMES; i++) {
+		struct t_arp_pending *p_pending = &s_arp_pending[i];
+
+		if (p_pending->ip == 0) {
+			if (p_slot == 0) {
+				p_slot = p_pending;
+			}
+		} else if (p_pending->ip == ip) {
+			same++;
+			if ((p_oldest_same == 0) || ((int32_t) (p_pending->order - p_oldest_same->order) < 0)) {
+				p_oldest_same = p_pending;
+			}
 		}
+	}
 
-		if (current_entry != s_entry_current) {
-			memcpy(mac_address, s_arp_records[current_entry].mac_address, ETH_ADDR_LEN);
-			DEBUG_PRINTF("timeout=%x", timeout);
-			return ip;
+	if ((same >= ARP_PENDING_PER_IP) || (p_slot == 0)) {
+		if (p_oldest_same == 0) {
+			DEBUG_PUTS("Pending pool is full");
+			return false;
 		}
+		p_slot = p_oldest_same;
+	}
+
+	memcpy(p_slot->frame, header, header_length);
+	memcpy(&p_slot->frame[header_length], payload, payload_length);
+	p_slot->length = (uint16_t) (header_length + payload_length);
+	p_slot->order = s_pending_order++;
+	p_slot->ip = ip;
+
+	return true;
+}
+
+/*
+ * Blocking resolve, only for use during the network setup (address probing).
+ */
+uint32_t arp_cache_resolve(uint32_t ip, uint8_t *mac_address, uint32_t timeout_us) {
+	const uint32_t micros_stamp = H3_TIMER->AVS_CNT1;
 
-		DEBUG_PRINTF("i=%d, timeout=%d, current_entry=%d, s_entry_current=%d", i, timeout, current_entry, s_entry_current);
+	while (arp_cache_lookup(ip, mac_address) != ip) {
+		if ((H3_TIMER->AVS_CNT1 - micros_stamp) > timeout_us) {
+			return 0;
+		}
+
+		net_handle();
 	}
 
-	DEBUG2_EXIT
-	return 0;
+	return ip;
 }
 
 void arp_cache_dump(void) {
 #ifndef NDEBUG
-	uint16_t i;
+	uint32_t set, way;
+
+	printf("ARP Cache\n");
 
-	printf("ARP Cache size=%d\n", s_entry_current);
+	for (set = 0; set < ARP_CACHE_SETS; set++) {
+		for (way = 0; way < ARP_CACHE_WAYS; way++) {
+			const struct t_arp_record *p_record = &s_arp_records[set][way];
 
-	for (i = 0; i < s_entry_current; i++) {
-		printf("%02d " IPSTR " " MACSTR "\n", i, IP2STR(s_arp_records[i].ip),MAC2STR(s_arp_records[i].mac_address));
+			if (p_record->state != ARP_STATE_FREE) {
+				printf("%02d:%d " IPSTR " " MACSTR " %d %d\n", (int) set, (int) way, IP2STR(p_record->ip), MAC2STR(p_record->mac_address), p_record->state, (int) (s_ticks - p_record->ticks_updated));
+			}
+		}
 	}
 #endif
 }
 
-#ifndef NDEBUG
+/*
+ * Called every 100 msec from net_timers_run
+ */
 void arp_cache_timer(void) {
+	s_ticks++;
+
+	uint32_t set, way;
+
+	for (set = 0; set < ARP_CACHE_SETS; set++) {
+		for (way = 0; way < ARP_CACHE_WAYS; way++) {
+			struct t_arp_record *p_record = &s_arp_records[set][way];
+
+			switch (p_record->state) {
+			case ARP_STATE_VALID:
+				if ((s_ticks - p_record->ticks_updated) >= ARP_MAX_AGE) {
+					p_record->state = ARP_STATE_STALE;
+					p_record->retries = 0;
+				}
+				break;
+			case ARP_STATE_PENDING:
+			case ARP_STATE_STALE:
+				if (p_record->retries++ < ARP_MAX_RETRIES) {
+					arp_send_request(p_record->ip);
+				} else {
+					DEBUG_PRINTF(IPSTR " timeout", IP2STR(p_record->ip));
+					_pending_drop(p_record->ip);
+					p_record->state = ARP_STATE_FREE;
+				}
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+#ifndef NDEBUG
 	s_ticker--;
 
 	if (s_ticker == 0) {
 		s_ticker = TICKER_COUNT;
 		arp_cache_dump();
 	}
-}
 #endif
-
+}
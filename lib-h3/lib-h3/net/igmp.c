@@ -25,7 +25,9 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
+#include <assert.h>
 
 #include "net/net.h"
 
@@ -38,8 +40,14 @@
 
 extern uint16_t net_chksum(void *, uint32_t);
 extern void emac_eth_send(void *, int);
+extern uint32_t emac_multicast_hash(const uint8_t *);
+extern void emac_multicast_set_filter(const uint32_t *);
 
-#define MAX_JOINS_ALLOWED	(4 + (8 * 4)) /* 8 outputs x 4 Universes */
+/*
+ * The join table grows when needed, it starts with room for GROUPS_INITIAL groups.
+ */
+#define GROUPS_INITIAL		8
+#define ALL_HOSTS_GROUP		0x010000E0	// 224.0.0.1
 
 typedef enum s_state {
 	NON_MEMBER = 0,
@@ -61,9 +69,47 @@ typedef union pcast32 {
 static struct t_igmp s_report ALIGNED;
 static struct t_igmp s_leave ALIGNED;
 static uint8_t s_multicast_mac[ETH_ADDR_LEN] ALIGNED;
-static struct t_group_info s_groups[MAX_JOINS_ALLOWED] ALIGNED;
-static uint32_t s_joins_allowed_index;
+static struct t_group_info *s_groups;
+static uint32_t s_groups_count;
+static uint32_t s_groups_size;
 static uint16_t s_id ALIGNED;
+static struct igmp_stats s_stats;
+
+static void _multicast_mac(uint32_t group_address, uint8_t *mac_address) {
+	_pcast32 multicast_ip;
+
+	multicast_ip.u32 = group_address;
+
+	mac_address[0] = 0x01;
+	mac_address[1] = 0x00;
+	mac_address[2] = 0x5E;
+	mac_address[3] = multicast_ip.u8[1] & 0x7F;
+	mac_address[4] = multicast_ip.u8[2];
+	mac_address[5] = multicast_ip.u8[3];
+}
+
+/*
+ * The hash table is built again from the join table, a bit can be shared by several groups.
+ */
+static void _update_filter(void) {
+	uint8_t mac_address[ETH_ADDR_LEN];
+	uint32_t hash[2] = { 0, 0 };
+	uint32_t i;
+
+	_multicast_mac(ALL_HOSTS_GROUP, mac_address);
+	uint32_t bit = emac_multicast_hash(mac_address);
+	hash[bit >> 5] |= (1U << (bit & 31));
+
+	for (i = 0; i < s_groups_count; i++) {
+		_multicast_mac(s_groups[i].group_address, mac_address);
+		bit = emac_multicast_hash(mac_address);
+		hash[bit >> 5] |= (1U << (bit & 31));
+	}
+
+	DEBUG_PRINTF("hash=%08x:%08x", hash[1], hash[0]);
+
+	emac_multicast_set_filter(hash);
+}
 
 void igmp_set_ip(const struct ip_info  *p_ip_info) {
 	_pcast32 src;
@@ -75,21 +121,18 @@ void igmp_set_ip(const struct ip_info  *p_ip_info) {
 }
 
 void __attribute__((cold)) igmp_init(uint8_t *mac_address, const struct ip_info  *p_ip_info) {
-	uint32_t i;
-
-	for (i = 0; i < MAX_JOINS_ALLOWED ; i++) {
-		memset(&s_groups[i], 0, sizeof(struct t_group_info));
+	if (s_groups == 0) {
+		s_groups = malloc(GROUPS_INITIAL * sizeof(struct t_group_info));
+		assert(s_groups != 0);
+		s_groups_size = GROUPS_INITIAL;
 	}
 
-	s_joins_allowed_index = 0;
+	s_groups_count = 0;
 	s_id = 0;
+	memset(&s_stats, 0, sizeof(struct igmp_stats));
 
 	igmp_set_ip(p_ip_info);
 
-	s_multicast_mac[0] = 0x01;
-	s_multicast_mac[1] = 0x00;
-	s_multicast_mac[2] = 0x5E;
-
 	// Ethernet
 	memcpy(s_report.ether.src, mac_address, ETH_ADDR_LEN);
 	s_report.ether.type = __builtin_bswap16(ETHER_TYPE_IPv4);
@@ -131,22 +174,16 @@ void __attribute__((cold)) igmp_init(uint8_t *mac_address, const struct ip_info
 	// IGMP
 	s_leave.igmp.report.igmp.type = IGMP_TYPE_LEAVE;
 	s_leave.igmp.report.igmp.max_resp_time = 0;
+
+	_update_filter();
 }
 
 void __attribute__((cold)) igmp_shutdown(void) {
 	DEBUG1_ENTRY
 
-	uint32_t i;
-
-	for (i = 0; i < MAX_JOINS_ALLOWED; i++) {
-		if (s_groups[i].group_address != 0) {
-			DEBUG_PRINTF(IPSTR, IP2STR(s_groups[i].group_address));
-
-			igmp_leave(s_groups[i].group_address);
-			s_groups[i].group_address = 0;
-			s_groups[i].state = NON_MEMBER;
-			s_groups[i].timer = 0;
-		}
+	while (s_groups_count != 0) {
+		DEBUG_PRINTF(IPSTR, IP2STR(s_groups[s_groups_count - 1].group_address));
+		igmp_leave(s_groups[s_groups_count - 1].group_address);
 	}
 
 	DEBUG1_EXIT
@@ -158,9 +195,7 @@ static void _send_report(uint32_t group_address) {
 
 	multicast_ip.u32 = group_address;
 
-	s_multicast_mac[3] = multicast_ip.u8[1] & 0x7F;
-	s_multicast_mac[4] = multicast_ip.u8[2];
-	s_multicast_mac[5] = multicast_ip.u8[3];
+	_multicast_mac(group_address, s_multicast_mac);
 
 	DEBUG_PRINTF(IPSTR " " MACSTR, IP2STR(group_address),MAC2STR(s_multicast_mac));
 
@@ -230,14 +265,14 @@ void igmp_handle(struct t_igmp *p_igmp) {
 			is_general_request = true;
 		}
 
-		for (i = 0; i < s_joins_allowed_index; i++) {
+		for (i = 0; i < s_groups_count; i++) {
 			group_address.u32 = s_groups[i].group_address;
 			if (is_general_request || ( memcmp(p_igmp->ip4.dst, group_address.u8, IPv4_ADDR_LEN) == 0)) {
 				if (s_groups[i].state == DELAYING_MEMBER) {
 					if (p_igmp->igmp.igmp.max_resp_time  < s_groups[i].timer) {
 						s_groups[i].timer = 1 + p_igmp->igmp.igmp.max_resp_time / 2;
 					}
-				} else { // s_groups[s_joins_allowed_index].state == IDLE_MEMBER
+				} else { // s_groups[i].state == IDLE_MEMBER
 					s_groups[i].state = DELAYING_MEMBER;
 					s_groups[i].timer = 1 + p_igmp->igmp.igmp.max_resp_time / 2;
 				}
@@ -251,8 +286,7 @@ void igmp_handle(struct t_igmp *p_igmp) {
 void igmp_timer(void) {
 	uint32_t i;
 
-	for (i = 0; i < MAX_JOINS_ALLOWED ; i++) {
-
+	for (i = 0; i < s_groups_count; i++) {
 		if ((s_groups[i].state == DELAYING_MEMBER) && (s_groups[i].timer > 0)) {
 			s_groups[i].timer--;
 
@@ -267,55 +301,85 @@ void igmp_timer(void) {
 // --> Public
 
 int igmp_join(uint32_t group_address) {
-	int i;
+	uint32_t i;
 
 	if ((group_address& 0xE0) != 0xE0) {
 		return -1;
 	}
 
-	if (s_joins_allowed_index == MAX_JOINS_ALLOWED) {
-		return -2;
-	}
-
-	for (i = 0; i < (int) s_joins_allowed_index; i++) {
+	for (i = 0; i < s_groups_count; i++) {
 		if (s_groups[i].group_address == group_address) {
-			return i;
+			return (int) i;
 		}
 	}
 
-	const int current_index = (int) s_joins_allowed_index;
+	if (s_groups_count == s_groups_size) {
+		struct t_group_info *p_groups = realloc(s_groups, 2 * s_groups_size * sizeof(struct t_group_info));
 
-	s_groups[s_joins_allowed_index].group_address = group_address;
-	s_groups[s_joins_allowed_index].state = DELAYING_MEMBER;
-	s_groups[s_joins_allowed_index].timer = 2; // TODO
+		if (p_groups == 0) {
+			return -2;
+		}
+
+		s_groups = p_groups;
+		s_groups_size *= 2;
+	}
 
-	s_joins_allowed_index++;
+	const uint32_t current_index = s_groups_count++;
 
+	s_groups[current_index].group_address = group_address;
+	s_groups[current_index].state = DELAYING_MEMBER;
+	s_groups[current_index].timer = 2; // TODO
+
+	_update_filter();
 	_send_report(group_address);
 
-	return current_index;
+	return (int) current_index;
 }
 
 int igmp_leave(uint32_t group_address) {
 	uint32_t i;
 
-	for (i = 0; i < MAX_JOINS_ALLOWED; i++) {
+	for (i = 0; i < s_groups_count; i++) {
 		if (s_groups[i].group_address == group_address) {
 			break;
 		}
 	}
 
-	if (i == MAX_JOINS_ALLOWED) {
+	if (i == s_groups_count) {
 		return -1;
 	}
 
-	_send_leave(s_groups[i].group_address);
+	_send_leave(group_address);
+
+	s_groups_count--;
+	s_groups[i] = s_groups[s_groups_count];
 
-	s_groups[i].group_address = 0;
-	s_groups[i].state = NON_MEMBER;
-	s_groups[i].timer = 0;
+	_update_filter();
 
 	return 0;
 }
 
+/*
+ * Called by ip_handle for each UDP frame with a multicast destination.
+ * Groups sharing a hash bit with a joined group pass the EMAC filter, these are dropped here.
+ */
+bool igmp_is_joined(uint32_t group_address) {
+	uint32_t i;
+
+	for (i = 0; i < s_groups_count; i++) {
+		if (s_groups[i].group_address == group_address) {
+			s_stats.multicast_accepted++;
+			return true;
+		}
+	}
+
+	s_stats.multicast_filtered++;
+	return false;
+}
+
+void igmp_get_stats(struct igmp_stats *p_stats) {
+	memcpy(p_stats, &s_stats, sizeof(struct igmp_stats));
+	p_stats->groups = s_groups_count;
+}
+
 // <---
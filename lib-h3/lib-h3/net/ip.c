@@ -24,6 +24,8 @@
  */
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
 
 #include "net/net.h"
 
@@ -43,6 +45,7 @@ extern void igmp_init(const uint8_t *, const struct ip_info  *);
 extern void igmp_set_ip(const struct ip_info  *);
 extern void igmp_handle(struct t_igmp *);
 extern void igmp_shutdown(void);
+extern bool igmp_is_joined(uint32_t);
 
 extern void icmp_init(const uint8_t *, const struct ip_info  *);
 extern void icmp_set_ip(const struct ip_info  *);
@@ -90,6 +93,14 @@ void ip_handle(struct t_ip4 *p_ip4) {
 
 	switch (p_ip4->ip4.proto) {
 	case IPv4_PROTO_UDP:
+		if ((p_ip4->ip4.dst[0] & 0xF0) == 0xE0) {
+			uint32_t group_address;
+			memcpy(&group_address, p_ip4->ip4.dst, IPv4_ADDR_LEN);
+
+			if (!igmp_is_joined(group_address)) {
+				return;
+			}
+		}
 		udp_handle((struct t_udp *) p_ip4);
 		break;
 	case IPv4_PROTO_IGMP:
@@ -52,6 +52,14 @@ extern void dhcp_client_release(void);
 extern void rfc3927_init(const uint8_t *mac_address);
 extern bool rfc3927(struct ip_info *p_ip_info);
 
+/*
+ * Maximum number of frames handled per net_handle call.
+ * The UDP queues take the frames, so the protocol code can drain them in its own loop.
+ */
+#if !defined (NET_HANDLE_BUDGET)
+# define NET_HANDLE_BUDGET	16
+#endif
+
 static struct ip_info s_ip_info  __attribute__ ((aligned (4)));
 static uint8_t s_mac_address[ETH_ADDR_LEN] __attribute__ ((aligned (4)));
 static char s_hostname[HOST_NAME_MAX] __attribute__ ((aligned (4))); /* including a terminating null byte. */
@@ -168,9 +176,15 @@ bool net_set_zeroconf(struct ip_info *p_ip_info) {
 }
 
 void net_handle(void) {
-	const int length = emac_eth_recv(&s_p);
+	uint32_t budget = NET_HANDLE_BUDGET;
+
+	while (budget-- != 0) {
+		const int length = emac_eth_recv(&s_p);
+
+		if (__builtin_expect((length <= 0), 1)) {
+			break;
+		}
 
-	if (__builtin_expect((length > 0), 0)) {
 		const struct ether_packet *eth = (struct ether_packet*) s_p;
 
 		if (eth->type == __builtin_bswap16(ETHER_TYPE_IPv4)) {
@@ -39,6 +39,12 @@
 
 #include "h3.h"
 
+#include "device/emac.h"
+
+#if defined (ENABLE_LATENCY_TRACE)
+# include "h3_latency.h"
+#endif
+
 extern int console_error(const char *);
 
 #ifndef ALIGNED
@@ -49,24 +55,55 @@ extern int console_error(const char *);
 # define MIN(a, b) ((a) < (b) ? (a) : (b))
 #endif
 
-extern void emac_eth_send(void *, int);
 extern uint32_t arp_cache_lookup(uint32_t, uint8_t *);
+extern bool arp_cache_queue(uint32_t, const void *, uint32_t, const void *, uint32_t);
 extern uint16_t net_chksum(void *, uint32_t);
 
 #define MAX_PORTS_ALLOWED	16
-#define MAX_ENTRIES			(1 << 2) // Must always be a power of 2
-#define MAX_ENTRIES_MASK	(MAX_ENTRIES - 1)
 
+/*
+ * UDP_QUEUE_ENTRIES is the maximum queue depth per bound port, it can be set in the Makefile DEFINES.
+ * The depth of a port can be changed at runtime with udp_set_queue_depth.
+ * A queue with depth n holds n packets, there is no unused slot.
+ */
+#if !defined (UDP_QUEUE_ENTRIES)
+# define UDP_QUEUE_ENTRIES	(1 << 7)
+#endif
+
+#if (UDP_QUEUE_ENTRIES & (UDP_QUEUE_ENTRIES - 1)) != 0
+# error UDP_QUEUE_ENTRIES must be a power of 2
+#endif
+
+#define MAX_ENTRIES			UDP_QUEUE_ENTRIES
+#define ENTRIES_MASK		(MAX_ENTRIES - 1)
+#define DEFAULT_ENTRIES		(MAX_ENTRIES < (1 << 3) ? MAX_ENTRIES : (1 << 3))
+
+#define NO_LOAN				(-1)
+
+/*
+ * The payload is not copied, the entry points into the EMAC RX descriptor buffer.
+ * The descriptor stays on loan until the entry is consumed.
+ */
 struct queue_entry {
-	uint8_t data[FRAME_BUFFER_SIZE];
+	uint8_t *data;
 	uint32_t from_ip;
 	uint16_t from_port;
 	uint16_t size;
+	int32_t loan;
+#if defined (ENABLE_LATENCY_TRACE)
+	uint32_t rx_us;
+#endif
 }ALIGNED;
 
+/*
+ * queue_head and queue_tail are free running, the entry index is the lower bits.
+ */
 struct queue {
 	uint32_t queue_head;
 	uint32_t queue_tail;
+	uint32_t queue_depth;
+	int32_t loan_held;	// Handed out by udp_recv_zc, waiting for udp_recv_release
+	struct udp_stats stats;
 	struct queue_entry entries[MAX_ENTRIES] ALIGNED;
 }ALIGNED;
 
@@ -96,6 +133,9 @@ void __attribute__((cold)) udp_init(const uint8_t *mac_address, const struct ip_
 		s_ports_allowed[i] = 0;
 		s_recv_queue[i].queue_head = 0;
 		s_recv_queue[i].queue_tail = 0;
+		s_recv_queue[i].queue_depth = DEFAULT_ENTRIES;
+		s_recv_queue[i].loan_held = NO_LOAN;
+		memset(&s_recv_queue[i].stats, 0, sizeof(struct udp_stats));
 	}
 
 	s_id = 0;
@@ -146,8 +186,23 @@ void udp_handle(struct t_udp *p_udp) {
 		return;
 	}
 
-	const uint32_t entry = s_recv_queue[port_index].queue_tail;
-	struct queue_entry *p_queue_entry = &s_recv_queue[port_index].entries[entry];
+	struct queue *p_queue = &s_recv_queue[port_index];
+
+	if (__builtin_expect(((p_queue->queue_head - p_queue->queue_tail) >= p_queue->queue_depth), 0)) {
+		DEBUG_PRINTF("Queue full %d", dest_port);
+		p_queue->stats.dropped_queue_full++;
+		return;
+	}
+
+	const int32_t loan = emac_eth_loan();
+
+	if (__builtin_expect((loan == NO_LOAN), 0)) {
+		DEBUG_PUTS("No RX descriptor available");
+		p_queue->stats.dropped_no_buffer++;
+		return;
+	}
+
+	struct queue_entry *p_queue_entry = &p_queue->entries[p_queue->queue_head & ENTRIES_MASK];
 
 	const uint32_t data_length = __builtin_bswap16(p_udp->udp.len) - UDP_HEADER_SIZE;
 
@@ -155,14 +210,34 @@ void udp_handle(struct t_udp *p_udp) {
 
 	i = MIN(FRAME_BUFFER_SIZE, data_length);
 
-	h3_memcpy(p_queue_entry->data, p_udp->udp.data, i);
+	p_queue_entry->data = p_udp->udp.data;
+	p_queue_entry->loan = loan;
 
 	memcpy(src.u8, p_udp->ip4.src, IPv4_ADDR_LEN);
 	p_queue_entry->from_ip = src.u32;
 	p_queue_entry->from_port = __builtin_bswap16(p_udp->udp.source_port);
 	p_queue_entry->size = i;
+#if defined (ENABLE_LATENCY_TRACE)
+	p_queue_entry->rx_us = h3_latency_rx_us;
+#endif
+
+	p_queue->queue_head++;
+	p_queue->stats.received++;
+}
+
+static void _queue_flush(struct queue *p_queue) {
+	while (p_queue->queue_head != p_queue->queue_tail) {
+		emac_eth_return(p_queue->entries[p_queue->queue_tail & ENTRIES_MASK].loan);
+		p_queue->queue_tail++;
+	}
 
-	s_recv_queue[port_index].queue_head = (s_recv_queue[port_index].queue_head + 1) & MAX_ENTRIES_MASK;
+	if (p_queue->loan_held != NO_LOAN) {
+		emac_eth_return(p_queue->loan_held);
+		p_queue->loan_held = NO_LOAN;
+	}
+
+	p_queue->queue_head = 0;
+	p_queue->queue_tail = 0;
 }
 
 // -->
@@ -188,6 +263,8 @@ int udp_bind(uint16_t local_port) {
 	}
 
 	s_ports_allowed[i] = local_port;
+	s_recv_queue[i].queue_depth = DEFAULT_ENTRIES;
+	memset(&s_recv_queue[i].stats, 0, sizeof(struct udp_stats));
 
 	DEBUG_PRINTF("i=%d, local_port=%d", i, local_port);
 
@@ -200,8 +277,7 @@ int udp_unbind(uint16_t local_port) {
 	for (uint32_t i = 0; i < MAX_PORTS_ALLOWED; i++) {
 		if (s_ports_allowed[i] == local_port) {
 			s_ports_allowed[i] = 0;
-			s_recv_queue[i].queue_head = 0;
-			s_recv_queue[i].queue_tail = 0;
+			_queue_flush(&s_recv_queue[i]);
 			return 0;
 		}
 	}
@@ -213,12 +289,13 @@ int udp_unbind(uint16_t local_port) {
 uint16_t udp_recv(uint8_t idx, uint8_t *packet, uint16_t size, uint32_t *from_ip, uint16_t *from_port) {
 	assert(idx < MAX_PORTS_ALLOWED);
 
-	if (s_recv_queue[idx].queue_head == s_recv_queue[idx].queue_tail) {
+	struct queue *p_queue = &s_recv_queue[idx];
+
+	if (p_queue->queue_head == p_queue->queue_tail) {
 		return 0;
 	}
 
-	const uint8_t entry = s_recv_queue[idx].queue_tail;
-	struct queue_entry *p_queue_entry = &s_recv_queue[idx].entries[entry];
+	const struct queue_entry *p_queue_entry = &p_queue->entries[p_queue->queue_tail & ENTRIES_MASK];
 
 	const uint16_t i = MIN(size, p_queue_entry->size);
 
@@ -227,17 +304,88 @@ uint16_t udp_recv(uint8_t idx, uint8_t *packet, uint16_t size, uint32_t *from_ip
 	*from_ip = p_queue_entry->from_ip;
 	*from_port = p_queue_entry->from_port;
 
-	s_recv_queue[idx].queue_tail = (s_recv_queue[idx].queue_tail + 1) & MAX_ENTRIES_MASK;
+#if defined (ENABLE_LATENCY_TRACE)
+	h3_latency_packet_us = p_queue_entry->rx_us;
+	h3_latency_record(H3_LATENCY_RECV);
+#endif
+
+	emac_eth_return(p_queue_entry->loan);
+
+	p_queue->queue_tail++;
 
 	DEBUG_PRINTF("[%d] %d[%d]: %d " IPSTR, H3_TIMER->AVS_CNT0, idx, s_ports_allowed[idx], i, IP2STR(*from_ip));
 
 	return i;
 }
 
-int udp_send(uint8_t idx, const uint8_t *packet, uint16_t size, uint32_t to_ip, uint16_t remote_port) {
+uint16_t udp_recv_zc(uint8_t idx, uint8_t **packet, uint32_t *from_ip, uint16_t *from_port) {
+	assert(idx < MAX_PORTS_ALLOWED);
+
+	struct queue *p_queue = &s_recv_queue[idx];
+
+	udp_recv_release(idx);
+
+	if (p_queue->queue_head == p_queue->queue_tail) {
+		return 0;
+	}
+
+	const struct queue_entry *p_queue_entry = &p_queue->entries[p_queue->queue_tail & ENTRIES_MASK];
+
+	*packet = p_queue_entry->data;
+	*from_ip = p_queue_entry->from_ip;
+	*from_port = p_queue_entry->from_port;
+
+#if defined (ENABLE_LATENCY_TRACE)
+	h3_latency_packet_us = p_queue_entry->rx_us;
+	h3_latency_record(H3_LATENCY_RECV);
+#endif
+
+	p_queue->loan_held = p_queue_entry->loan;
+	p_queue->queue_tail++;
+
+	return p_queue_entry->size;
+}
+
+void udp_recv_release(uint8_t idx) {
+	assert(idx < MAX_PORTS_ALLOWED);
+
+	struct queue *p_queue = &s_recv_queue[idx];
+
+	if (p_queue->loan_held != NO_LOAN) {
+		emac_eth_return(p_queue->loan_held);
+		p_queue->loan_held = NO_LOAN;
+	}
+}
+
+/*
+ * The depth must not be more than UDP_QUEUE_ENTRIES.
+ * Packets still in the queue are dropped.
+ */
+int udp_set_queue_depth(uint8_t idx, uint16_t depth) {
+	assert(idx < MAX_PORTS_ALLOWED);
+
+	if ((depth == 0) || (depth > MAX_ENTRIES)) {
+		DEBUG_PRINTF("Invalid depth %u", depth);
+		return -1;
+	}
+
+	_queue_flush(&s_recv_queue[idx]);
+	s_recv_queue[idx].queue_depth = depth;
+
+	return 0;
+}
+
+void udp_get_stats(uint8_t idx, struct udp_stats *p_stats) {
+	assert(idx < MAX_PORTS_ALLOWED);
+
+	memcpy(p_stats, &s_recv_queue[idx].stats, sizeof(struct udp_stats));
+}
+
+static int _udp_send(uint8_t idx, const uint8_t *packet, uint16_t size, uint32_t to_ip, uint16_t remote_port, uint16_t flags, uint32_t *sequence) {
 	assert(idx < MAX_PORTS_ALLOWED);
 
 	_pcast32 dst;
+	bool is_resolved = true;
 
 	if (__builtin_expect ((s_ports_allowed[idx] == 0), 0)) {
 		DEBUG_PUTS("ports_allowed[idx] == 0");
@@ -254,15 +402,13 @@ int udp_send(uint8_t idx, const uint8_t *packet, uint16_t size, uint32_t to_ip,
 		dst.u32 = to_ip;
 		memcpy(s_send_packet.ip4.dst, dst.u8, IPv4_ADDR_LEN);
 	} else {
-		if (to_ip == arp_cache_lookup(to_ip, s_send_packet.ether.dst)) {
-			dst.u32 = to_ip;
-			memcpy(s_send_packet.ip4.dst, dst.u8, IPv4_ADDR_LEN);
-		} else {
-			DEBUG_PUTS("ARP lookup failed");
-			return -2;
-		}
+		is_resolved = (to_ip == arp_cache_lookup(to_ip, s_send_packet.ether.dst));
+		dst.u32 = to_ip;
+		memcpy(s_send_packet.ip4.dst, dst.u8, IPv4_ADDR_LEN);
 	}
 
+	size = MIN(FRAME_BUFFER_SIZE, size);
+
 	//IPv4
 	s_send_packet.ip4.id = s_id;
 	s_send_packet.ip4.len = __builtin_bswap16(size + IPv4_UDP_HEADERS_SIZE);
@@ -274,15 +420,67 @@ int udp_send(uint8_t idx, const uint8_t *packet, uint16_t size, uint32_t to_ip,
 	s_send_packet.udp.destination_port = __builtin_bswap16(remote_port);
 	s_send_packet.udp.len = __builtin_bswap16(size + UDP_HEADER_SIZE);
 
-	h3_memcpy(s_send_packet.udp.data, packet, MIN(FRAME_BUFFER_SIZE, size));
-
-	// debug_dump( &s_send_packet, size + UDP_PACKET_HEADERS_SIZE);
+	/*
+	 * The headers are always copied into the TX buffer.
+	 * When both segments are copied, they end up in a single descriptor.
+	 */
+	const struct emac_tx_segment segments[2] = {
+			{ &s_send_packet, UDP_PACKET_HEADERS_SIZE, EMAC_TX_SEGMENT_COPY },
+			{ packet, size, flags }
+	};
+
+	/*
+	 * The destination is not resolved yet, the ARP reply sends a copy of the frame.
+	 * This does not wait for the reply.
+	 */
+	if (__builtin_expect(!is_resolved, 0)) {
+		if (!arp_cache_queue(to_ip, &s_send_packet, UDP_PACKET_HEADERS_SIZE, packet, size)) {
+			DEBUG_PUTS("ARP queue full");
+			return -2;
+		}
 
-	emac_eth_send((void *) &s_send_packet, (int) (size + UDP_PACKET_HEADERS_SIZE));
+		if (sequence != 0) {
+			*sequence = emac_eth_tx_sequence_done();
+		}
+	} else if (flags & EMAC_TX_SEGMENT_ZERO_COPY) {
+		if (emac_eth_send_segments(segments, 2, sequence) != 0) {
+			return -3;
+		}
+	} else {
+		if (emac_eth_send_segments(segments, 2, 0) != 0) {
+			// Keep the blocking behavior of emac_eth_send
+			const uint32_t micros_timeout = H3_TIMER->AVS_CNT1 + CONFIG_TX_TIMEOUT_US;
+
+			while (emac_eth_send_segments(segments, 2, 0) != 0) {
+				if ((int32_t) (H3_TIMER->AVS_CNT1 - micros_timeout) > 0) {
+					DEBUG_PUTS("TX timeout");
+					return -3;
+				}
+			}
+		}
+	}
 
 	s_id++;
 
 	return 0;
 }
 
+int udp_send(uint8_t idx, const uint8_t *packet, uint16_t size, uint32_t to_ip, uint16_t remote_port) {
+	return _udp_send(idx, packet, size, to_ip, remote_port, EMAC_TX_SEGMENT_COPY, 0);
+}
+
+/*
+ * The payload is not copied. It must stay unchanged until udp_send_done(*sequence) returns true.
+ * Returns -3 when the transmitter is busy, the caller should try again later.
+ */
+int udp_send_zc(uint8_t idx, const uint8_t *packet, uint16_t size, uint32_t to_ip, uint16_t remote_port, uint32_t *sequence) {
+	assert(sequence != 0);
+
+	return _udp_send(idx, packet, size, to_ip, remote_port, EMAC_TX_SEGMENT_ZERO_COPY, sequence);
+}
+
+bool udp_send_done(uint32_t sequence) {
+	return emac_eth_tx_done(sequence);
+}
+
 // <---
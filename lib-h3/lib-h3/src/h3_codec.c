@@ -520,6 +520,7 @@ void h3_codec_begin(void) {
 
 	H3_DMA->IRQ_EN0 = DMA_IRQ_EN0_DMA0_PKG_IRQ_EN;
 
+	dmb();
 	H3_DMA_CHL0->DESC_ADDR = (uint32_t) &p_coherent_region->lli[0];
 
 	isb();
@@ -603,6 +604,7 @@ void __attribute__((cold)) h3_codec_start(void) {
 	printf("================\n");
 #endif
 
+	dmb();
 	H3_DMA_CHL0->EN = DMA_CHAN_ENABLE_START;
 
 #ifndef NDEBUG
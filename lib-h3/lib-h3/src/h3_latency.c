@@ -0,0 +1,87 @@
+/**
+ * @file h3_latency.c
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "h3_latency.h"
+
+#include "arm/synchronize.h"
+
+struct h3_latency_histogram h3_latency_histograms[H3_LATENCY_LAST];
+uint32_t h3_latency_rx_us;
+uint32_t h3_latency_packet_us;
+
+static const char s_names[H3_LATENCY_LAST][8] = { "Recv", "DMX", "SetData", "Output" };
+
+const char *h3_latency_get_name(enum h3_latency_stage stage) {
+	assert(stage < H3_LATENCY_LAST);
+
+	return s_names[stage];
+}
+
+/**
+ * The histogram is not locked, a snapshot can be slightly inconsistent.
+ */
+void h3_latency_get(enum h3_latency_stage stage, struct h3_latency_histogram *histogram) {
+	assert(stage < H3_LATENCY_LAST);
+
+	dmb();
+	memcpy(histogram, &h3_latency_histograms[stage], sizeof(struct h3_latency_histogram));
+}
+
+void h3_latency_reset(void) {
+	memset(h3_latency_histograms, 0, sizeof(h3_latency_histograms));
+	dmb();
+}
+
+void h3_latency_print(void) {
+	uint32_t stage;
+
+	printf("Latency [us]\n");
+
+	for (stage = 0; stage < H3_LATENCY_LAST; stage++) {
+		struct h3_latency_histogram histogram;
+		uint32_t bucket;
+
+		h3_latency_get((enum h3_latency_stage) stage, &histogram);
+
+		printf(" %-7s %u, avg %u, max %u\n", s_names[stage], (unsigned int) histogram.count, (unsigned int) (histogram.count == 0 ? 0 : (uint32_t) (histogram.total_us / histogram.count)), (unsigned int) histogram.max_us);
+
+		for (bucket = 0; bucket < H3_LATENCY_BUCKETS; bucket++) {
+			if (histogram.bucket[bucket] == 0) {
+				continue;
+			}
+
+			if (bucket == (H3_LATENCY_BUCKETS - 1)) {
+				printf("  >=%6u: %u\n", 1U << (bucket - 1), (unsigned int) histogram.bucket[bucket]);
+			} else {
+				printf("  < %6u: %u\n", 1U << bucket, (unsigned int) histogram.bucket[bucket]);
+			}
+		}
+	}
+}
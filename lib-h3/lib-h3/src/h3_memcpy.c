@@ -1,5 +1,5 @@
 /**
- * @file h3_memcpy.h
+ * @file h3_memcpy.c
  *
  */
 /* Copyright (C) 2019 by Arjan van Vught mailto:info@orangepi-dmx.nl
@@ -25,34 +25,128 @@
 
 #include <stdint.h>
 #include <stddef.h>
-#include <assert.h>
 
-//#include <stdio.h>
+/*
+ * Cortex-A7 memcpy.
+ *
+ * The destination is aligned to a word first. When the source is then also word aligned,
+ * 32-byte blocks are moved with LDM/STM, otherwise each destination word is merged
+ * from two aligned source words with shifts (little endian). The aligned source reads
+ * never cross the word holding the last byte needed, so they cannot fault.
+ * On a non-ARM host the C loops below are used, which is the same algorithm.
+ *
+ * No NEON: h3_memcpy can be called from the IRQ and FIQ handlers, which do not save
+ * the VFP/NEON registers (see the NEON policy in lightsetmerge.cpp).
+ */
 
-void* h3_memcpy(void *__restrict__ dest, void const *__restrict__ src, size_t n) {
-//	assert(((uint32_t )((uint32_t* ) src) & 0x3) == 0);
-//	assert(((uint32_t )((uint32_t* ) dest) & 0x3) == 0);
+#define BLOCK_SIZE	32
+#define PLD_DISTANCE	64
 
-//	if (((uint32_t )((uint32_t* ) src) & 0x3) != 0) {
-//		printf("src=%p\n", (void *)src);
-//	}
-//
-//	if (((uint32_t )((uint32_t* ) dest) & 0x3) != 0) {
-//		printf("dest=%p\n", (void *)dest);
-//	}
+inline static void _copy_blocks(uint32_t **dst, const uint32_t **src, size_t blocks) {
+#if defined (__arm__)
+	uint32_t *d = *dst;
+	const uint32_t *s = *src;
 
-	uint32_t *plDst = (uint32_t*) dest;
-	uint32_t const *plSrc = (uint32_t const*) src;
+	asm volatile(
+		"1:	pld		[%1, %3]\n"
+		"	ldmia	%1!, {r3-r6, r8-r10, r12}\n"
+		"	subs	%2, %2, #1\n"
+		"	stmia	%0!, {r3-r6, r8-r10, r12}\n"
+		"	bne		1b\n"
+		: "+r" (d), "+r" (s), "+r" (blocks)
+		: "I" (PLD_DISTANCE)
+		: "r3", "r4", "r5", "r6", "r8", "r9", "r10", "r12", "cc", "memory");
 
-	if ((((uint32_t) src & 0x3) == 0) && (((uint32_t) dest & 0x3) == 0)) {
-		while (n >= 4) {
-			*plDst++ = *plSrc++;
-			n -= 4;
-		}
+	*dst = d;
+	*src = s;
+#else
+	uint32_t *d = *dst;
+	const uint32_t *s = *src;
+
+	while (blocks--) {
+		__builtin_prefetch(s + PLD_DISTANCE / 4);
+		d[0] = s[0]; d[1] = s[1]; d[2] = s[2]; d[3] = s[3];
+		d[4] = s[4]; d[5] = s[5]; d[6] = s[6]; d[7] = s[7];
+		d += 8;
+		s += 8;
+	}
+
+	*dst = d;
+	*src = s;
+#endif
+}
+
+/*
+ * The source is 1, 2 or 3 bytes past a word boundary, the destination is word aligned.
+ */
+inline static void _copy_shifted(uint32_t **dst, const uint8_t **src, size_t words) {
+	const uint32_t offset = (uint32_t) ((uintptr_t) *src & 0x3);
+	const uint32_t shift_right = offset * 8;
+	const uint32_t shift_left = 32 - shift_right;
+
+	uint32_t *d = *dst;
+	const uint32_t *s = (const uint32_t *) (*src - offset);
+	uint32_t previous = *s++;
+
+	while (words >= 4) {
+		__builtin_prefetch(s + PLD_DISTANCE / 4);
+		const uint32_t w0 = s[0];
+		const uint32_t w1 = s[1];
+		const uint32_t w2 = s[2];
+		const uint32_t w3 = s[3];
+		d[0] = (previous >> shift_right) | (w0 << shift_left);
+		d[1] = (w0 >> shift_right) | (w1 << shift_left);
+		d[2] = (w1 >> shift_right) | (w2 << shift_left);
+		d[3] = (w2 >> shift_right) | (w3 << shift_left);
+		previous = w3;
+		d += 4;
+		s += 4;
+		words -= 4;
+	}
+
+	while (words--) {
+		const uint32_t w = *s++;
+		*d++ = (previous >> shift_right) | (w << shift_left);
+		previous = w;
 	}
 
-	uint8_t *pcDst = (uint8_t*) plDst;
-	uint8_t const *pcSrc = (uint8_t const*) plSrc;
+	*dst = d;
+	*src = (const uint8_t *) s - 4 + offset;
+}
+
+void *h3_memcpy(void *__restrict__ dest, void const *__restrict__ src, size_t n) {
+	uint8_t *pcDst = (uint8_t *) dest;
+	const uint8_t *pcSrc = (const uint8_t *) src;
+
+	if (__builtin_expect((n >= 8), 1)) {
+		while (((uintptr_t) pcDst & 0x3) != 0) {
+			*pcDst++ = *pcSrc++;
+			n--;
+		}
+
+		uint32_t *plDst = (uint32_t *) pcDst;
+
+		if (((uintptr_t) pcSrc & 0x3) == 0) {
+			const uint32_t *plSrc = (const uint32_t *) pcSrc;
+
+			if (n >= BLOCK_SIZE) {
+				_copy_blocks(&plDst, &plSrc, n / BLOCK_SIZE);
+				n &= (BLOCK_SIZE - 1);
+			}
+
+			while (n >= 4) {
+				*plDst++ = *plSrc++;
+				n -= 4;
+			}
+
+			pcSrc = (const uint8_t *) plSrc;
+		} else {
+			_copy_shifted(&plDst, &pcSrc, n / 4);
+			n &= 0x3;
+		}
+
+		pcDst = (uint8_t *) plDst;
+	}
 
 	while (n--) {
 		*pcDst++ = *pcSrc++;
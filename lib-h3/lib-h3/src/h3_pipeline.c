@@ -0,0 +1,169 @@
+/**
+ * @file h3_pipeline.c
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+
+#include "h3_pipeline.h"
+#include "h3_spsc.h"
+
+#include "h3_cpu.h"
+#include "h3_smp.h"
+#include "h3_hs_timer.h"
+
+#include "arm/synchronize.h"
+
+struct stage {
+	h3_pipeline_stage_t stage;
+	h3_pipeline_poll_t poll;
+	struct h3_pipeline_stats stats;
+} __attribute__ ((aligned (64)));
+
+static struct h3_spsc s_rings[H3_CPU_COUNT][H3_CPU_COUNT];	///< [from][to]
+static struct stage s_stages[H3_CPU_COUNT];
+static uint32_t s_completed_next = 1;
+
+static void pass_on(uint32_t from, uint32_t to, struct h3_pipeline_job *job) {
+	struct h3_spsc *ring = &s_rings[from][to & H3_CPUS_MASK];
+
+	job->timestamp_us = h3_hs_timer_lo_us();
+
+	if (__builtin_expect(!h3_spsc_push(ring, job), 0)) {
+		s_stages[from].stats.ring_full++;
+
+		while (!h3_spsc_push(ring, job)) {
+		}
+	}
+}
+
+static void worker(void) {
+	const uint32_t core = smp_get_core_number();
+	struct stage *s = &s_stages[core];
+
+	for (;;) {
+		uint32_t from;
+
+		for (from = 0; from < H3_CPU_COUNT; from++) {
+			if (from == core) {
+				continue;
+			}
+
+			struct h3_pipeline_job *job = h3_spsc_pop(&s_rings[from][core]);
+
+			if (job == NULL) {
+				continue;
+			}
+
+			const uint32_t start_us = h3_hs_timer_lo_us();
+			const uint32_t next = s->stage(job);
+			assert(next != core);
+			const uint32_t end_us = h3_hs_timer_lo_us();
+
+			const uint32_t queue_us = start_us - job->timestamp_us;
+			const uint32_t service_us = end_us - start_us;
+
+			s->stats.jobs++;
+			s->stats.queue_us_total += queue_us;
+			s->stats.service_us_total += service_us;
+
+			if (queue_us > s->stats.queue_us_max) {
+				s->stats.queue_us_max = queue_us;
+			}
+
+			if (service_us > s->stats.service_us_max) {
+				s->stats.service_us_max = service_us;
+			}
+
+			pass_on(core, next, job);
+		}
+
+		if (s->poll != NULL) {
+			s->poll();
+		}
+	}
+}
+
+/**
+ * Must be called from core 0, the core is not stopped anymore.
+ */
+void h3_pipeline_start(uint32_t core, h3_pipeline_stage_t stage, h3_pipeline_poll_t poll) {
+	assert(smp_get_core_number() == 0);
+	assert((core != 0) && (core < H3_CPU_COUNT));
+	assert(stage != NULL);
+
+	uint32_t from;
+
+	for (from = 0; from < H3_CPU_COUNT; from++) {
+		h3_spsc_init(&s_rings[from][core]);
+		h3_spsc_init(&s_rings[core][from]);
+	}
+
+	s_stages[core].stage = stage;
+	s_stages[core].poll = poll;
+	dmb();
+
+	smp_start_core(core, worker);
+}
+
+bool h3_pipeline_submit(uint32_t core, struct h3_pipeline_job *job) {
+	assert((core != 0) && (core < H3_CPU_COUNT));
+
+	job->timestamp_us = h3_hs_timer_lo_us();
+
+	return h3_spsc_push(&s_rings[smp_get_core_number()][core], job);
+}
+
+/**
+ * Core 0, the jobs returned by the last stage. The cores are polled round-robin.
+ */
+struct h3_pipeline_job *h3_pipeline_completed(void) {
+	uint32_t i;
+
+	for (i = 1; i < H3_CPU_COUNT; i++) {
+		const uint32_t core = s_completed_next;
+
+		s_completed_next = (s_completed_next == (H3_CPU_COUNT - 1)) ? 1 : s_completed_next + 1;
+
+		struct h3_pipeline_job *job = h3_spsc_pop(&s_rings[core][0]);
+
+		if (job != NULL) {
+			return job;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * The counters are written by the stage core only, a snapshot can be slightly inconsistent.
+ */
+void h3_pipeline_get_stats(uint32_t core, struct h3_pipeline_stats *stats) {
+	assert(core < H3_CPU_COUNT);
+
+	dmb();
+	*stats = s_stages[core].stats;
+}
@@ -49,6 +49,12 @@ void smp_core_main(void) {
 		;
 }
 
+uint32_t smp_get_core_number(void) {
+	uint32_t core_number;
+	asm volatile ("mrc p15, 0, %0, c0, c0, 5" : "=r" (core_number));
+	return (core_number & H3_CPUS_MASK);
+}
+
 void smp_start_core(uint32_t core_number, start_fn_t start) {
 	if (core_number == 0 || core_number >= H3_CPU_COUNT) {
 		return;
@@ -40,7 +40,10 @@
 
 #include "h3_spi_internal.h"
 
+#include "irq_timer.h"
+
 #include "arm/synchronize.h"
+#include "arm/gic.h"
 
 #define ALT_FUNCTION_CS		(EXT_SPI_NUMBER == 0 ? (H3_PC3_SELECT_SPI0_CS) : (H3_PA13_SELECT_SPI1_CS))
 #define ALT_FUNCTION_CLK	(EXT_SPI_NUMBER == 0 ? (H3_PC2_SELECT_SPI0_CLK) : (H3_PA14_SELECT_SPI1_CLK))
@@ -546,7 +549,8 @@ struct dma_spi {
 };
 
 static volatile struct dma_spi *p_dma_tx = (struct dma_spi *) SPI_DMA_COHERENT_REGION;
-static bool is_running = false;
+static volatile bool is_running = false;
+static volatile h3_spi_dma_tx_callback_t s_dma_tx_callback = NULL;
 
 bool h3_spi_dma_tx_is_active(void) {
 	if (!is_running) {
@@ -587,7 +591,7 @@ const uint8_t *h3_spi_dma_tx_prepare(uint32_t *size) {
 void h3_spi_dma_tx_start(const uint8_t *tx_buffer, uint32_t data_length) {
 	assert(!is_running);
 	assert(tx_buffer != 0);	// TODO Not valid when SRAM is used
-	assert(data_length <= (uint32_t) sizeof(p_dma_tx->tx_buffer) - ((uint32_t) tx_buffer) - (uint32_t) &p_dma_tx->tx_buffer);
+	assert(data_length <= (uint32_t) sizeof(p_dma_tx->tx_buffer) - ((uint32_t) tx_buffer - (uint32_t) &p_dma_tx->tx_buffer));
 	assert(((uint32_t) tx_buffer & H3_MEM_COHERENT_REGION) == H3_MEM_COHERENT_REGION);
 
 	p_dma_tx->lli.src = (uint32_t) tx_buffer;
@@ -620,3 +624,39 @@ void h3_spi_dma_tx_start(const uint8_t *tx_buffer, uint32_t data_length) {
 
 	is_running = true;
 }
+
+/*
+ * Dispatched by the IRQ handler of irq_timer.c
+ */
+void h3_spi_irq_handler(void) {
+	if (is_running && (EXT_SPI->IS & IS_TC)) {
+		EXT_SPI->IS = (uint32_t) ~0;
+		EXT_SPI->IE = 0;
+		is_running = false;
+		dmb();
+
+		if (s_dma_tx_callback != NULL) {
+			s_dma_tx_callback();
+		}
+	}
+
+	H3_GIC_CPUIF->AEOI = EXT_SPI_IRQn;
+	H3_GIC_DIST->ICPEND[EXT_SPI_IRQn / 32] = 1 << (EXT_SPI_IRQn % 32);
+}
+
+void h3_spi_dma_tx_set_callback(h3_spi_dma_tx_callback_t callback) {
+	if (callback == NULL) {
+		H3_GIC_DIST->ICENABLE[EXT_SPI_IRQn / 32] = 1 << (EXT_SPI_IRQn % 32);
+		isb();
+		s_dma_tx_callback = NULL;
+		return;
+	}
+
+	s_dma_tx_callback = callback;
+	dmb();
+
+	irq_timer_init();
+	gic_irq_config(EXT_SPI_IRQn, GIC_CORE0);
+
+	isb();
+}
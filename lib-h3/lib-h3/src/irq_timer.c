@@ -78,6 +78,13 @@ static void arm_virtual_timer_handler(void) {
 	H3_GIC_DIST->ICPEND[ARM_VIRTUAL_TIMER_IRQ / 32] = 1 << (ARM_VIRTUAL_TIMER_IRQ % 32);
 }
 
+/*
+ * The EMAC receive interrupt and the SPI DMA completion interrupt,
+ * when the drivers are linked in.
+ */
+extern void emac_irq_handler(void) __attribute__((weak));
+extern void h3_spi_irq_handler(void) __attribute__((weak));
+
 static void __attribute__((interrupt("IRQ"))) irq_timer_handler(void) {
 	dmb();
 
@@ -98,6 +105,10 @@ static void __attribute__((interrupt("IRQ"))) irq_timer_handler(void) {
 		arm_physical_timer_handler();
 	} else if (irq == ARM_VIRTUAL_TIMER_IRQ) {
 		arm_virtual_timer_handler();
+	} else if ((emac_irq_handler != NULL) && (irq == H3_EMAC_IRQn)) {
+		emac_irq_handler();
+	} else if ((h3_spi_irq_handler != NULL) && ((irq == H3_SPI0_IRQn) || (irq == H3_SPI1_IRQn))) {
+		h3_spi_irq_handler();
 	}
 
 	dmb();
@@ -0,0 +1,297 @@
+/**
+ * @file arp_cold.c
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Runs net/udp.c and net/arp_cache.c on the host against a fake EMAC and
+ * measures udp_send to destinations that are not in the ARP cache yet.
+ * A cold send must not poll the network (net_handle) while it waits for the
+ * ARP reply; the frame is queued and sent when the reply arrives.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "net/net.h"
+#include "net_packets.h"
+#include "device/emac.h"
+
+extern void udp_init(const uint8_t *, const struct ip_info  *);
+extern void arp_cache_init(void);
+extern void arp_cache_update(uint8_t *, uint32_t);
+extern void arp_cache_timer(void);
+
+#define PORT		6454
+#define PAYLOAD		530		// ArtDmx with 512 slots
+#define DESTINATIONS	4		// 2 frames each fill the pending pool
+#define ROUNDS		20000
+
+static uint32_t s_arp_requests;
+static uint32_t s_net_handle_calls;
+static uint32_t s_frames_sent;
+static uint32_t s_frames_flushed;
+
+static struct {
+	uint8_t dst[ETH_ADDR_LEN];
+	uint32_t ip;
+	uint8_t sequence;
+} s_flushed[16];
+
+/*
+ * Fake network
+ */
+
+void arp_send_request(__attribute__((unused)) uint32_t ip) {
+	s_arp_requests++;
+}
+
+void net_handle(void) {
+	s_net_handle_calls++;
+}
+
+void emac_eth_send(void *p, __attribute__((unused)) int length) {
+	const struct t_udp *p_udp = (const struct t_udp *) p;
+
+	if (s_frames_flushed < sizeof(s_flushed) / sizeof(s_flushed[0])) {
+		memcpy(s_flushed[s_frames_flushed].dst, p_udp->ether.dst, ETH_ADDR_LEN);
+		memcpy(&s_flushed[s_frames_flushed].ip, p_udp->ip4.dst, IPv4_ADDR_LEN);
+		s_flushed[s_frames_flushed].sequence = p_udp->udp.data[0];
+	}
+
+	s_frames_flushed++;
+}
+
+int emac_eth_send_segments(__attribute__((unused)) const struct emac_tx_segment *s, __attribute__((unused)) uint32_t c, __attribute__((unused)) uint32_t *seq) {
+	s_frames_sent++;
+	return 0;
+}
+
+int32_t emac_eth_loan(void) { return -1; }
+void emac_eth_return(__attribute__((unused)) int32_t token) { }
+void *h3_memcpy(void *dest, const void *src, size_t n) { return memcpy(dest, src, n); }
+int console_error(const char *s) { return fprintf(stderr, "%s\n", s); }
+uint16_t net_chksum(__attribute__((unused)) void *p, __attribute__((unused)) uint32_t l) { return 0; }
+bool emac_eth_tx_done(__attribute__((unused)) uint32_t seq) { return true; }
+uint32_t emac_eth_tx_sequence_done(void) { return 0; }
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000U + (uint64_t) ts.tv_nsec;
+}
+
+static uint32_t destination(uint32_t i) {
+	return 0x0000000A | ((i + 2) << 24);	// 10.0.0.2 ...
+}
+
+static void mac_of(uint32_t i, uint8_t *mac) {
+	mac[0] = 2; mac[1] = 0; mac[2] = 0; mac[3] = 0; mac[4] = 1; mac[5] = (uint8_t) i;
+}
+
+struct timing {
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint32_t count;
+};
+
+static int timed_send(struct timing *p_timing, const uint8_t *packet, uint32_t to_ip) {
+	const uint64_t start = now_ns();
+	const int result = udp_send(0, packet, PAYLOAD, to_ip, PORT);
+	const uint64_t elapsed = now_ns() - start;
+
+	p_timing->total_ns += elapsed;
+	p_timing->count++;
+	if (elapsed > p_timing->max_ns) {
+		p_timing->max_ns = elapsed;
+	}
+
+	return result;
+}
+
+static void print_timing(const char *name, const struct timing *p_timing) {
+	printf("%-24s %8.1f ns mean %8.1f us max\n", name, (double) p_timing->total_ns / p_timing->count, (double) p_timing->max_ns / 1000);
+}
+
+/*
+ * Two frames for each cold destination, the replies arrive afterwards.
+ */
+static int check_flush(void) {
+	static uint8_t packet[PAYLOAD];
+	uint32_t i, frame;
+
+	arp_cache_init();
+	s_arp_requests = 0;
+	s_frames_flushed = 0;
+	s_frames_sent = 0;
+
+	for (frame = 0; frame < 3; frame++) {
+		for (i = 0; i < DESTINATIONS; i++) {
+			packet[0] = (uint8_t) frame;
+			if (udp_send(0, packet, PAYLOAD, destination(i), PORT) != 0) {
+				printf("FAIL: cold send %u to destination %u\n", frame, i);
+				return 1;
+			}
+		}
+	}
+
+	if (s_arp_requests != DESTINATIONS) {
+		printf("FAIL: %u ARP requests, expected %u\n", s_arp_requests, DESTINATIONS);
+		return 1;
+	}
+
+	// The pool is full, a new destination cannot be queued
+	if (udp_send(0, packet, PAYLOAD, destination(DESTINATIONS), PORT) != -2) {
+		puts("FAIL: pending pool overflow not reported");
+		return 1;
+	}
+
+	if ((s_frames_sent != 0) || (s_frames_flushed != 0)) {
+		puts("FAIL: frame sent before the ARP reply");
+		return 1;
+	}
+
+	for (i = 0; i < DESTINATIONS; i++) {
+		uint8_t mac[ETH_ADDR_LEN];
+		mac_of(i, mac);
+		arp_cache_update(mac, destination(i));
+	}
+
+	if (s_frames_flushed != 2 * DESTINATIONS) {
+		printf("FAIL: %u frames flushed, expected %u\n", s_frames_flushed, 2 * DESTINATIONS);
+		return 1;
+	}
+
+	// Per destination the 2 newest frames, oldest first
+	for (i = 0; i < 2 * DESTINATIONS; i++) {
+		uint8_t mac[ETH_ADDR_LEN];
+		const uint32_t d = i / 2;
+
+		mac_of(d, mac);
+
+		if ((memcmp(s_flushed[i].dst, mac, ETH_ADDR_LEN) != 0) || (s_flushed[i].ip != destination(d)) || (s_flushed[i].sequence != 1 + (i & 1))) {
+			printf("FAIL: flushed frame %u\n", i);
+			return 1;
+		}
+	}
+
+	// Resolved now, sent right away
+	if ((udp_send(0, packet, PAYLOAD, destination(0), PORT) != 0) || (s_frames_sent != 1)) {
+		puts("FAIL: warm send");
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * An unanswered request is retried from the timer, then the frames are dropped.
+ */
+static int check_timeout(void) {
+	static uint8_t packet[PAYLOAD];
+	uint8_t mac[ETH_ADDR_LEN];
+	uint32_t i;
+
+	arp_cache_init();
+	s_arp_requests = 0;
+	s_frames_flushed = 0;
+
+	udp_send(0, packet, PAYLOAD, destination(0), PORT);
+
+	for (i = 0; i < 4; i++) {
+		arp_cache_timer();
+	}
+
+	if (s_arp_requests != 4) {
+		printf("FAIL: %u ARP requests, expected 4\n", s_arp_requests);
+		return 1;
+	}
+
+	mac_of(0, mac);
+	arp_cache_update(mac, destination(0));
+
+	if (s_frames_flushed != 0) {
+		puts("FAIL: frame not dropped after the timeout");
+		return 1;
+	}
+
+	return 0;
+}
+
+static void benchmark(void) {
+	static uint8_t packet[PAYLOAD];
+	struct timing cold = { 0, 0, 0 };
+	struct timing warm = { 0, 0, 0 };
+	uint32_t round, i;
+
+	for (round = 0; round < ROUNDS; round++) {
+		arp_cache_init();
+
+		for (i = 0; i < DESTINATIONS; i++) {
+			timed_send(&cold, packet, destination(i));
+		}
+
+		for (i = 0; i < DESTINATIONS; i++) {
+			uint8_t mac[ETH_ADDR_LEN];
+			mac_of(i, mac);
+			arp_cache_update(mac, destination(i));
+		}
+
+		for (i = 0; i < DESTINATIONS; i++) {
+			timed_send(&warm, packet, destination(i));
+		}
+	}
+
+	print_timing("udp_send cold unicast", &cold);
+	print_timing("udp_send warm unicast", &warm);
+}
+
+int main(void) {
+	const struct ip_info ip_info = { { 0x0100000A }, { 0x00FFFFFF }, { 0 } };
+	const uint8_t mac_address[6] = { 2, 0, 0, 0, 0, 1 };
+
+	udp_init(mac_address, &ip_info);
+	arp_cache_init();
+
+	if (udp_bind(PORT) != 0) {
+		puts("FAIL: udp_bind");
+		return 1;
+	}
+
+	if ((check_flush() != 0) || (check_timeout() != 0)) {
+		return 1;
+	}
+
+	benchmark();
+
+	if (s_net_handle_calls != 0) {
+		printf("FAIL: net_handle called %u times while sending\n", s_net_handle_calls);
+		return 1;
+	}
+
+	puts("PASS");
+	return 0;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file memcpy.c
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Checks h3_memcpy (the C path of src/h3_memcpy.c) against the libc memcpy
+ * for sizes 0-300 and source/destination offsets 0-7, and measures it for
+ * the packet sizes 64-1500 with source offsets 0-3. The baseline is the
+ * byte loop of lib-c/src/memcpy.c, which the firmware uses for memcpy.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern void *h3_memcpy(void *__restrict__ dest, void const *__restrict__ src, size_t n);
+
+#define CHECK_SIZE	300
+#define CHECK_OFFSETS	8
+#define GUARD		16
+#define BENCH_OFFSETS	4
+#define BENCH_BYTES	(64 * 1024 * 1024)
+
+static const size_t s_sizes[] = { 64, 128, 256, 512, 1024, 1500 };
+
+static uint8_t s_src[CHECK_SIZE + CHECK_OFFSETS + 2 * GUARD] __attribute__ ((aligned (64)));
+static uint8_t s_dst[CHECK_SIZE + CHECK_OFFSETS + 2 * GUARD] __attribute__ ((aligned (64)));
+static uint8_t s_ref[CHECK_SIZE + CHECK_OFFSETS + 2 * GUARD] __attribute__ ((aligned (64)));
+
+static uint8_t s_bench_src[2048] __attribute__ ((aligned (64)));
+static uint8_t s_bench_dst[2048] __attribute__ ((aligned (64)));
+
+/*
+ * lib-c/src/memcpy.c, the compiler must not turn it into a call to memcpy
+ */
+__attribute__ ((noinline, optimize ("no-tree-loop-distribute-patterns", "no-tree-vectorize")))
+static void *byte_memcpy(void *dst, const void *src, size_t len) {
+	const char *s = src;
+	char *d = dst;
+
+	while (len--)
+		*d++ = *s++;
+
+	return dst;
+}
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static int check(void) {
+	size_t n;
+	uint32_t src_offset, dst_offset;
+	uint32_t i;
+
+	for (i = 0; i < sizeof(s_src); i++) {
+		s_src[i] = (uint8_t) (i * 7 + 3);
+	}
+
+	for (n = 0; n <= CHECK_SIZE; n++) {
+		for (src_offset = 0; src_offset < CHECK_OFFSETS; src_offset++) {
+			for (dst_offset = 0; dst_offset < CHECK_OFFSETS; dst_offset++) {
+				memset(s_dst, 0xA5, sizeof(s_dst));
+				memset(s_ref, 0xA5, sizeof(s_ref));
+
+				void *result = h3_memcpy(&s_dst[GUARD + dst_offset], &s_src[GUARD + src_offset], n);
+				memcpy(&s_ref[GUARD + dst_offset], &s_src[GUARD + src_offset], n);
+
+				if ((result != &s_dst[GUARD + dst_offset]) || (memcmp(s_dst, s_ref, sizeof(s_dst)) != 0)) {
+					printf("FAIL: size %u, source offset %u, destination offset %u\n", (unsigned int) n, src_offset, dst_offset);
+					return 0;
+				}
+			}
+		}
+	}
+
+	return 1;
+}
+
+typedef void *(*copy_fn)(void *, const void *, size_t);
+
+static double measure(copy_fn copy, size_t n, uint32_t src_offset) {
+	const uint32_t rounds = (uint32_t) (BENCH_BYTES / n);
+	uint32_t i;
+
+	const uint64_t start = now_ns();
+
+	for (i = 0; i < rounds; i++) {
+		copy(s_bench_dst, &s_bench_src[src_offset], n);
+		__asm__ volatile("" ::: "memory");
+	}
+
+	const uint64_t elapsed = now_ns() - start;
+
+	return ((double) rounds * (double) n * 1e9) / ((double) elapsed * 1024.0 * 1024.0);
+}
+
+static void benchmark(void) {
+	uint32_t i, src_offset;
+
+	printf("Throughput [MiB/s], destination aligned\n");
+	printf("%6s", "size");
+
+	for (src_offset = 0; src_offset < BENCH_OFFSETS; src_offset++) {
+		printf("  %8s+%u %8s+%u", "h3", src_offset, "byte", src_offset);
+	}
+
+	printf("\n");
+
+	for (i = 0; i < sizeof(s_sizes) / sizeof(s_sizes[0]); i++) {
+		printf("%6u", (unsigned int) s_sizes[i]);
+
+		for (src_offset = 0; src_offset < BENCH_OFFSETS; src_offset++) {
+			printf("  %10.0f %10.0f", measure(h3_memcpy, s_sizes[i], src_offset), measure(byte_memcpy, s_sizes[i], src_offset));
+		}
+
+		printf("\n");
+	}
+}
+
+int main(void) {
+	if (!check()) {
+		return EXIT_FAILURE;
+	}
+
+	benchmark();
+
+	puts("PASS");
+	return EXIT_SUCCESS;
+}
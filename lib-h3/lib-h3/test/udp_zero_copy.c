@@ -0,0 +1,189 @@
+/**
+ * @file udp_zero_copy.c
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Runs net/udp.c on the host against a fake EMAC and counts the payload bytes
+ * copied per received packet, for udp_recv (Network::RecvFrom) and for
+ * udp_recv_zc (Network::RecvFromZeroCopy).
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#include "net/net.h"
+#include "net_packets.h"
+#include "device/emac.h"
+
+extern void udp_init(const uint8_t *, const struct ip_info  *);
+extern void udp_handle(struct t_udp *);
+
+#define PORT		6454
+#define PAYLOAD		530		// ArtDmx with 512 slots
+#define PACKETS		100000
+#define BUFFERS		64
+
+static uint8_t s_buffers[BUFFERS][2048] __attribute__((aligned(64)));
+static bool s_loaned[BUFFERS];
+static uint32_t s_loans;
+static uint32_t s_current;
+static uint64_t s_bytes_copied;
+
+/*
+ * Fake EMAC: the frame being handled is always s_buffers[s_current]
+ */
+
+int32_t emac_eth_loan(void) {
+	if (s_loaned[s_current]) {
+		return -1;
+	}
+	s_loaned[s_current] = true;
+	s_loans++;
+	return (int32_t) s_current;
+}
+
+void emac_eth_return(int32_t token) {
+	assert(s_loaned[token]);
+	s_loaned[token] = false;
+	s_loans--;
+}
+
+void *h3_memcpy(void *dest, const void *src, size_t n) {
+	s_bytes_copied += n;
+	return memcpy(dest, src, n);
+}
+
+int console_error(const char *s) {
+	return fprintf(stderr, "%s\n", s);
+}
+
+uint32_t arp_cache_lookup(uint32_t ip, __attribute__((unused)) uint8_t *mac) { return ip; }
+bool arp_cache_queue(__attribute__((unused)) uint32_t ip, __attribute__((unused)) const void *h, __attribute__((unused)) uint32_t hl, __attribute__((unused)) const void *p, __attribute__((unused)) uint32_t pl) { return false; }
+uint16_t net_chksum(__attribute__((unused)) void *p, __attribute__((unused)) uint32_t l) { return 0; }
+int emac_eth_send_segments(__attribute__((unused)) const struct emac_tx_segment *s, __attribute__((unused)) uint32_t c, __attribute__((unused)) uint32_t *seq) { return 0; }
+bool emac_eth_tx_done(__attribute__((unused)) uint32_t seq) { return true; }
+uint32_t emac_eth_tx_sequence_done(void) { return 0; }
+
+static void receive_frame(uint32_t buffer, uint32_t sequence) {
+	struct t_udp *p_udp = (struct t_udp *) s_buffers[buffer];
+
+	p_udp->ip4.src[0] = 10;
+	p_udp->ip4.src[1] = 0;
+	p_udp->ip4.src[2] = 0;
+	p_udp->ip4.src[3] = 1;
+	p_udp->udp.source_port = __builtin_bswap16(PORT);
+	p_udp->udp.destination_port = __builtin_bswap16(PORT);
+	p_udp->udp.len = __builtin_bswap16(PAYLOAD + UDP_HEADER_SIZE);
+	memset(p_udp->udp.data, (int) sequence, PAYLOAD);
+
+	s_current = buffer;
+	udp_handle(p_udp);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+static int run(bool zero_copy) {
+	static uint8_t packet[FRAME_BUFFER_SIZE];
+	uint32_t checksum = 0;
+	uint32_t i;
+
+	s_bytes_copied = 0;
+
+	const double start = now();
+
+	for (i = 0; i < PACKETS; i++) {
+		receive_frame(i % BUFFERS, i);
+
+		uint32_t from_ip;
+		uint16_t from_port;
+		uint16_t size;
+		const uint8_t *data;
+
+		if (zero_copy) {
+			uint8_t *p;
+			size = udp_recv_zc(0, &p, &from_ip, &from_port);
+			data = p;
+		} else {
+			size = udp_recv(0, packet, sizeof(packet), &from_ip, &from_port);
+			data = packet;
+		}
+
+		if ((size != PAYLOAD) || (data[PAYLOAD - 1] != (uint8_t) i) || (from_port != PORT)) {
+			printf("FAIL: packet %u size=%u\n", i, size);
+			return 1;
+		}
+
+		checksum += data[0];
+	}
+
+	const double elapsed = now() - start;
+
+	udp_recv_release(0);
+
+	if (s_loans != 0) {
+		printf("FAIL: %u descriptors still on loan\n", s_loans);
+		return 1;
+	}
+
+	printf("%-10s %7.1f bytes copied/packet, %6.1f ns/packet (%u)\n", zero_copy ? "zero-copy" : "copy",
+			(double) s_bytes_copied / PACKETS, elapsed * 1e9 / PACKETS, checksum);
+
+	return 0;
+}
+
+int main(void) {
+	const struct ip_info ip_info = { { 0x0100000A }, { 0x00FFFFFF }, { 0 } };
+	const uint8_t mac_address[6] = { 2, 0, 0, 0, 0, 1 };
+
+	udp_init(mac_address, &ip_info);
+
+	if (udp_bind(PORT) != 0) {
+		puts("FAIL: udp_bind");
+		return 1;
+	}
+
+	if (run(false) != 0) {
+		return 1;
+	}
+
+	if (run(true) != 0) {
+		return 1;
+	}
+
+	if (s_bytes_copied != 0) {
+		puts("FAIL: zero-copy path copied payload bytes");
+		return 1;
+	}
+
+	puts("PASS");
+	return 0;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file lightsetmerge.h
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef LIGHTSETMERGE_H_
+#define LIGHTSETMERGE_H_
+
+#include <stdint.h>
+
+/**
+ * DMX slot kernels shared by the Art-Net and sACN bridges.
+ * All functions write the result into pDst and return true when pDst has changed.
+ * LTP is a plain Copy of the latest source.
+ */
+struct LightSetMerge {
+	static bool Copy(uint8_t *pDst, const uint8_t *pSrc, uint32_t nLength);
+	static bool Htp(uint8_t *pDst, const uint8_t *pSourceA, const uint8_t *pSourceB, uint32_t nLength);
+
+	// Portable implementations, also used for the tail of the vector implementations
+	static bool CopyScalar(uint8_t *pDst, const uint8_t *pSrc, uint32_t nLength);
+	static bool HtpScalar(uint8_t *pDst, const uint8_t *pSourceA, const uint8_t *pSourceB, uint32_t nLength);
+};
+
+#endif /* LIGHTSETMERGE_H_ */
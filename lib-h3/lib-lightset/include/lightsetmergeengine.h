@@ -0,0 +1,135 @@
+/**
+ * @file lightsetmergeengine.h
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef LIGHTSETMERGEENGINE_H_
+#define LIGHTSETMERGEENGINE_H_
+
+#include <stdint.h>
+
+namespace lightset {
+enum class MergeMode {
+	HTP,	///< Highest Takes Precedence (HTP)
+	LTP		///< Latest Takes Precedence (LTP)
+};
+}  // namespace lightset
+
+/**
+ * N-way merge of the sources sending to the same output port, shared by the Art-Net and sACN bridges.
+ * The source slots are pooled over all the ports. The pool (the arena) is allocated once by the constructor,
+ * so the memory used does not depend on the number of sources on the network.
+ * Only the sources with the highest priority take part in the merge (E1.31 6.2.3), Art-Net uses a single priority.
+ */
+class LightSetMergeEngine {
+public:
+	static constexpr uint32_t MAX_SOURCES_PER_PORT = 8;
+	static constexpr uint32_t CID_LENGTH = 16;
+	static constexpr uint8_t PRIORITY_DEFAULT = 100;
+
+	struct Source {
+		uint8_t *pData;				///< Arena slot of DMX_UNIVERSE_SIZE bytes, zero beyond nLength
+		uint32_t nIp;
+		uint32_t nMillis;			///< The latest time of the data received
+		uint32_t nStamp;			///< Order of arrival, used for LTP
+		uint16_t nLength;
+		uint16_t nNext;				///< Next source of the same port
+		uint8_t Cid[CID_LENGTH];	///< sACN only
+		uint8_t nPriority;
+		uint8_t nSequenceNumber;	///< sACN only
+	};
+
+	LightSetMergeEngine(uint32_t nPorts, uint32_t nSources);
+	~LightSetMergeEngine();
+
+	/**
+	 * @param pCid nullptr when the source is identified by the IP address only (Art-Net)
+	 */
+	Source *Find(uint32_t nPortIndex, uint32_t nIp, const uint8_t *pCid = nullptr);
+	/**
+	 * @return nullptr when the port has MAX_SOURCES_PER_PORT sources or the pool is exhausted
+	 */
+	Source *Add(uint32_t nPortIndex, uint32_t nIp, const uint8_t *pCid = nullptr);
+	void Remove(uint32_t nPortIndex, Source *pSource);
+	void Clear(uint32_t nPortIndex);
+
+	void SetData(Source *pSource, const uint8_t *pData, uint32_t nLength, uint8_t nPriority, uint32_t nMillis);
+
+	/**
+	 * Removes the sources which did not send data within nTimeoutMillis.
+	 * @return true when a source has been removed
+	 */
+	bool CheckTimeouts(uint32_t nPortIndex, uint32_t nMillis, uint32_t nTimeoutMillis);
+
+	/**
+	 * Merges the sources with the highest priority into pOutput.
+	 * HTP output length is the longest source, LTP output is the source which sent the latest data.
+	 * @return true when the data or the length of the output has changed
+	 */
+	bool Merge(uint32_t nPortIndex, lightset::MergeMode mergeMode, uint8_t *pOutput, uint16_t& nOutputLength);
+
+	uint32_t GetSourceCount(uint32_t nPortIndex) const {
+		return m_pPorts[nPortIndex].nSources;
+	}
+
+	/**
+	 * @return The highest priority of the sources, 0 when there are no sources
+	 */
+	uint8_t GetPriority(uint32_t nPortIndex) const;
+
+	/**
+	 * @return true when more than one source has the highest priority
+	 */
+	bool IsMerging(uint32_t nPortIndex) const;
+
+	/**
+	 * @return true when a source has sent data within nWindowMillis
+	 */
+	bool IsActive(uint32_t nPortIndex, uint32_t nMillis, uint32_t nWindowMillis) const;
+
+	/**
+	 * @return The number of new sources which could not be added
+	 */
+	uint32_t GetDiscarded() const {
+		return m_nDiscarded;
+	}
+
+private:
+	static constexpr uint16_t END = 0xFFFF;
+
+	struct Port {
+		uint16_t nFirst;
+		uint16_t nSources;
+	};
+
+	uint32_t m_nPorts;
+	uint32_t m_nSources;
+	uint8_t *m_pArena { nullptr };		///< nSources + 1 slots, the last one is the HTP scratch buffer
+	Source *m_pSources { nullptr };
+	Port *m_pPorts { nullptr };
+	uint16_t m_nFree { END };
+	uint32_t m_nStamp { 0 };
+	uint32_t m_nDiscarded { 0 };
+};
+
+#endif /* LIGHTSETMERGEENGINE_H_ */
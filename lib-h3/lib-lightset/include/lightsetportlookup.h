@@ -0,0 +1,103 @@
+/**
+ * @file lightsetportlookup.h
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef LIGHTSETPORTLOOKUP_H_
+#define LIGHTSETPORTLOOKUP_H_
+
+#include <stdint.h>
+#include <cassert>
+
+/**
+ * Maps a universe (Art-Net Port-Address or sACN universe) to the output ports using it.
+ * Several ports can have the same universe, so the value is a bit mask of port indexes.
+ * Open addressing with linear probing, the table is rebuilt when the port mapping changes.
+ * The table is sized from nMaxPorts, the number of output ports of the node.
+ */
+template<uint32_t nMaxPorts>
+class LightSetPortLookup {
+	static_assert((nMaxPorts != 0) && (nMaxPorts <= 32), "The port mask is 32 bits");
+
+public:
+	static constexpr uint32_t MAX_PORTS = nMaxPorts;
+
+	LightSetPortLookup() {
+		Clear();
+	}
+
+	void Clear() {
+		for (uint32_t i = 0; i < SIZE; i++) {
+			m_Entries[i].nPortMask = 0;
+		}
+	}
+
+	void Add(uint16_t nUniverse, uint32_t nPortIndex) {
+		assert(nPortIndex < MAX_PORTS);
+
+		auto nIndex = Hash(nUniverse);
+
+		while ((m_Entries[nIndex].nPortMask != 0) && (m_Entries[nIndex].nUniverse != nUniverse)) {
+			nIndex = (nIndex + 1) & (SIZE - 1);
+		}
+
+		m_Entries[nIndex].nUniverse = nUniverse;
+		m_Entries[nIndex].nPortMask |= (1U << nPortIndex);
+	}
+
+	/**
+	 * @return Bit mask of the port indexes, 0 when the universe is not used
+	 */
+	uint32_t Get(uint16_t nUniverse) const {
+		auto nIndex = Hash(nUniverse);
+
+		while (m_Entries[nIndex].nPortMask != 0) {
+			if (m_Entries[nIndex].nUniverse == nUniverse) {
+				return m_Entries[nIndex].nPortMask;
+			}
+			nIndex = (nIndex + 1) & (SIZE - 1);
+		}
+
+		return 0;
+	}
+
+private:
+	static constexpr uint32_t RoundUp(uint32_t n, uint32_t nPowerOf2 = 1) {
+		return nPowerOf2 >= n ? nPowerOf2 : RoundUp(n, 2 * nPowerOf2);
+	}
+
+	static constexpr uint32_t SIZE = RoundUp(2 * MAX_PORTS); // Must always be a power of 2, there is always a free entry
+
+	static uint32_t Hash(uint16_t nUniverse) {
+		return (static_cast<uint32_t>(nUniverse) * 40503U) >> 10 & (SIZE - 1);
+	}
+
+	struct Entry {
+		uint32_t nPortMask;
+		uint16_t nUniverse;
+	};
+
+	Entry m_Entries[SIZE];
+};
+
+#endif /* LIGHTSETPORTLOOKUP_H_ */
@@ -0,0 +1,132 @@
+/**
+ * @file lightsetmerge.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "lightsetmerge.h"
+
+/*
+ * The GCC vector extensions compile to NEON with -mfpu=neon-vfpv4 (Cortex-A7).
+ * They do not need arm_neon.h, which is not available with -nostdinc.
+ *
+ * NEON policy: the IRQ and FIQ handlers do not save the VFP/NEON registers, so NEON is
+ * only used by code which runs in the main loop. These kernels are called from the
+ * Art-Net and sACN packet handling only. Code which can be called from a handler,
+ * such as h3_memcpy, uses the core registers.
+ */
+#if defined (__ARM_NEON__) || defined (__ARM_NEON) || defined (__SSE2__)
+# define LIGHTSETMERGE_VECTOR
+#endif
+
+#if defined (LIGHTSETMERGE_VECTOR)
+namespace lightsetmerge {
+typedef uint8_t v16u8 __attribute__((vector_size(16)));
+static constexpr uint32_t VECTOR_SIZE = sizeof(v16u8);
+
+static inline v16u8 load(const uint8_t *p) {
+	v16u8 v;
+	memcpy(&v, p, VECTOR_SIZE);
+	return v;
+}
+
+static inline void store(uint8_t *p, v16u8 v) {
+	memcpy(p, &v, VECTOR_SIZE);
+}
+
+static inline bool any(v16u8 v) {
+	uint64_t r[2];
+	memcpy(r, &v, VECTOR_SIZE);
+	return (r[0] | r[1]) != 0;
+}
+}  // namespace lightsetmerge
+#endif
+
+bool LightSetMerge::CopyScalar(uint8_t *pDst, const uint8_t *pSrc, uint32_t nLength) {
+	uint32_t nDiff = 0;
+
+	for (uint32_t i = 0; i < nLength; i++) {
+		nDiff |= static_cast<uint32_t>(pDst[i] ^ pSrc[i]);
+		pDst[i] = pSrc[i];
+	}
+
+	return nDiff != 0;
+}
+
+bool LightSetMerge::HtpScalar(uint8_t *pDst, const uint8_t *pSourceA, const uint8_t *pSourceB, uint32_t nLength) {
+	uint32_t nDiff = 0;
+
+	for (uint32_t i = 0; i < nLength; i++) {
+		const uint8_t nData = pSourceA[i] > pSourceB[i] ? pSourceA[i] : pSourceB[i];
+		nDiff |= static_cast<uint32_t>(pDst[i] ^ nData);
+		pDst[i] = nData;
+	}
+
+	return nDiff != 0;
+}
+
+#if defined (LIGHTSETMERGE_VECTOR)
+using namespace lightsetmerge;
+
+bool LightSetMerge::Copy(uint8_t *pDst, const uint8_t *pSrc, uint32_t nLength) {
+	v16u8 vDiff = {};
+	uint32_t i = 0;
+
+	for (; (i + VECTOR_SIZE) <= nLength; i += VECTOR_SIZE) {
+		const auto vSrc = load(&pSrc[i]);
+		vDiff |= vSrc ^ load(&pDst[i]);
+		store(&pDst[i], vSrc);
+	}
+
+	const auto isChanged = CopyScalar(&pDst[i], &pSrc[i], nLength - i);
+
+	return isChanged || any(vDiff);
+}
+
+bool LightSetMerge::Htp(uint8_t *pDst, const uint8_t *pSourceA, const uint8_t *pSourceB, uint32_t nLength) {
+	v16u8 vDiff = {};
+	uint32_t i = 0;
+
+	for (; (i + VECTOR_SIZE) <= nLength; i += VECTOR_SIZE) {
+		const auto vA = load(&pSourceA[i]);
+		const auto vB = load(&pSourceB[i]);
+		const v16u8 vData = vA > vB ? vA : vB;
+		vDiff |= vData ^ load(&pDst[i]);
+		store(&pDst[i], vData);
+	}
+
+	const auto isChanged = HtpScalar(&pDst[i], &pSourceA[i], &pSourceB[i], nLength - i);
+
+	return isChanged || any(vDiff);
+}
+#else
+bool LightSetMerge::Copy(uint8_t *pDst, const uint8_t *pSrc, uint32_t nLength) {
+	return CopyScalar(pDst, pSrc, nLength);
+}
+
+bool LightSetMerge::Htp(uint8_t *pDst, const uint8_t *pSourceA, const uint8_t *pSourceB, uint32_t nLength) {
+	return HtpScalar(pDst, pSourceA, pSourceB, nLength);
+}
+#endif
@@ -0,0 +1,307 @@
+/**
+ * @file lightsetmergeengine.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <cassert>
+
+#include "lightsetmergeengine.h"
+#include "lightsetmerge.h"
+#include "lightset.h"
+
+#include "debug.h"
+
+LightSetMergeEngine::LightSetMergeEngine(uint32_t nPorts, uint32_t nSources): m_nPorts(nPorts), m_nSources(nSources) {
+	DEBUG_ENTRY
+	DEBUG_PRINTF("nPorts=%u, nSources=%u", nPorts, nSources);
+
+	assert(nSources < END);
+
+	m_pArena = new uint8_t[(nSources + 1) * DMX_UNIVERSE_SIZE];
+	assert(m_pArena != nullptr);
+
+	m_pSources = new Source[nSources];
+	assert(m_pSources != nullptr);
+
+	m_pPorts = new Port[nPorts];
+	assert(m_pPorts != nullptr);
+
+	for (uint32_t i = 0; i < nSources; i++) {
+		m_pSources[i].pData = &m_pArena[i * DMX_UNIVERSE_SIZE];
+		m_pSources[i].nNext = static_cast<uint16_t>(i + 1);
+	}
+
+	if (nSources != 0) {
+		m_pSources[nSources - 1].nNext = END;
+		m_nFree = 0;
+	}
+
+	for (uint32_t i = 0; i < nPorts; i++) {
+		m_pPorts[i].nFirst = END;
+		m_pPorts[i].nSources = 0;
+	}
+
+	DEBUG_EXIT
+}
+
+LightSetMergeEngine::~LightSetMergeEngine() {
+	delete[] m_pPorts;
+	delete[] m_pSources;
+	delete[] m_pArena;
+}
+
+LightSetMergeEngine::Source *LightSetMergeEngine::Find(uint32_t nPortIndex, uint32_t nIp, const uint8_t *pCid) {
+	assert(nPortIndex < m_nPorts);
+
+	for (auto nIndex = m_pPorts[nPortIndex].nFirst; nIndex != END; nIndex = m_pSources[nIndex].nNext) {
+		auto *pSource = &m_pSources[nIndex];
+
+		if ((pSource->nIp == nIp) && ((pCid == nullptr) || (memcmp(pSource->Cid, pCid, CID_LENGTH) == 0))) {
+			return pSource;
+		}
+	}
+
+	return nullptr;
+}
+
+LightSetMergeEngine::Source *LightSetMergeEngine::Add(uint32_t nPortIndex, uint32_t nIp, const uint8_t *pCid) {
+	assert(nPortIndex < m_nPorts);
+
+	auto& port = m_pPorts[nPortIndex];
+
+	if (__builtin_expect(((port.nSources == MAX_SOURCES_PER_PORT) || (m_nFree == END)), 0)) {
+		m_nDiscarded++;
+		return nullptr;
+	}
+
+	const auto nIndex = m_nFree;
+	auto *pSource = &m_pSources[nIndex];
+
+	m_nFree = pSource->nNext;
+
+	pSource->nNext = port.nFirst;
+	port.nFirst = nIndex;
+	port.nSources++;
+
+	pSource->nIp = nIp;
+	pSource->nMillis = 0;
+	pSource->nStamp = 0;
+	pSource->nLength = 0;
+	pSource->nPriority = PRIORITY_DEFAULT;
+	pSource->nSequenceNumber = 0;
+
+	if (pCid != nullptr) {
+		memcpy(pSource->Cid, pCid, CID_LENGTH);
+	} else {
+		memset(pSource->Cid, 0, CID_LENGTH);
+	}
+
+	memset(pSource->pData, 0, DMX_UNIVERSE_SIZE);
+
+	return pSource;
+}
+
+void LightSetMergeEngine::Remove(uint32_t nPortIndex, Source *pSource) {
+	assert(nPortIndex < m_nPorts);
+	assert(pSource != nullptr);
+
+	const auto nIndex = static_cast<uint16_t>(pSource - m_pSources);
+	auto& port = m_pPorts[nPortIndex];
+	auto *pIndex = &port.nFirst;
+
+	while (*pIndex != END) {
+		if (*pIndex == nIndex) {
+			*pIndex = pSource->nNext;
+			pSource->nNext = m_nFree;
+			m_nFree = nIndex;
+			port.nSources--;
+			return;
+		}
+		pIndex = &m_pSources[*pIndex].nNext;
+	}
+
+	assert(0);
+}
+
+void LightSetMergeEngine::Clear(uint32_t nPortIndex) {
+	assert(nPortIndex < m_nPorts);
+
+	auto& port = m_pPorts[nPortIndex];
+
+	while (port.nFirst != END) {
+		const auto nIndex = port.nFirst;
+		port.nFirst = m_pSources[nIndex].nNext;
+		m_pSources[nIndex].nNext = m_nFree;
+		m_nFree = nIndex;
+	}
+
+	port.nSources = 0;
+}
+
+void LightSetMergeEngine::SetData(Source *pSource, const uint8_t *pData, uint32_t nLength, uint8_t nPriority, uint32_t nMillis) {
+	assert(pSource != nullptr);
+	assert(nLength <= DMX_UNIVERSE_SIZE);
+
+	memcpy(pSource->pData, pData, nLength);
+
+	if (nLength < pSource->nLength) {
+		memset(&pSource->pData[nLength], 0, pSource->nLength - nLength);
+	}
+
+	pSource->nLength = static_cast<uint16_t>(nLength);
+	pSource->nPriority = nPriority;
+	pSource->nMillis = nMillis;
+	pSource->nStamp = ++m_nStamp;
+}
+
+bool LightSetMergeEngine::CheckTimeouts(uint32_t nPortIndex, uint32_t nMillis, uint32_t nTimeoutMillis) {
+	assert(nPortIndex < m_nPorts);
+
+	auto& port = m_pPorts[nPortIndex];
+	auto *pIndex = &port.nFirst;
+	auto isRemoved = false;
+
+	while (*pIndex != END) {
+		const auto nIndex = *pIndex;
+		auto *pSource = &m_pSources[nIndex];
+
+		if ((nMillis - pSource->nMillis) > nTimeoutMillis) {
+			*pIndex = pSource->nNext;
+			pSource->nNext = m_nFree;
+			m_nFree = nIndex;
+			port.nSources--;
+			isRemoved = true;
+		} else {
+			pIndex = &pSource->nNext;
+		}
+	}
+
+	return isRemoved;
+}
+
+uint8_t LightSetMergeEngine::GetPriority(uint32_t nPortIndex) const {
+	assert(nPortIndex < m_nPorts);
+
+	uint8_t nPriority = 0;
+
+	for (auto nIndex = m_pPorts[nPortIndex].nFirst; nIndex != END; nIndex = m_pSources[nIndex].nNext) {
+		if (m_pSources[nIndex].nPriority > nPriority) {
+			nPriority = m_pSources[nIndex].nPriority;
+		}
+	}
+
+	return nPriority;
+}
+
+bool LightSetMergeEngine::IsMerging(uint32_t nPortIndex) const {
+	assert(nPortIndex < m_nPorts);
+
+	if (m_pPorts[nPortIndex].nSources < 2) {
+		return false;
+	}
+
+	const auto nPriority = GetPriority(nPortIndex);
+	uint32_t nCount = 0;
+
+	for (auto nIndex = m_pPorts[nPortIndex].nFirst; nIndex != END; nIndex = m_pSources[nIndex].nNext) {
+		if (m_pSources[nIndex].nPriority == nPriority) {
+			nCount++;
+		}
+	}
+
+	return nCount > 1;
+}
+
+bool LightSetMergeEngine::IsActive(uint32_t nPortIndex, uint32_t nMillis, uint32_t nWindowMillis) const {
+	assert(nPortIndex < m_nPorts);
+
+	for (auto nIndex = m_pPorts[nPortIndex].nFirst; nIndex != END; nIndex = m_pSources[nIndex].nNext) {
+		if ((nMillis - m_pSources[nIndex].nMillis) < nWindowMillis) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool LightSetMergeEngine::Merge(uint32_t nPortIndex, lightset::MergeMode mergeMode, uint8_t *pOutput, uint16_t& nOutputLength) {
+	assert(nPortIndex < m_nPorts);
+	assert(pOutput != nullptr);
+
+	const auto nPriority = GetPriority(nPortIndex);
+
+	const Source *pSources[MAX_SOURCES_PER_PORT];
+	uint32_t nCount = 0;
+	const Source *pLatest = nullptr;
+	uint16_t nLength = 0;
+
+	for (auto nIndex = m_pPorts[nPortIndex].nFirst; nIndex != END; nIndex = m_pSources[nIndex].nNext) {
+		const auto *pSource = &m_pSources[nIndex];
+
+		if (pSource->nPriority != nPriority) {
+			continue;
+		}
+
+		pSources[nCount++] = pSource;
+
+		if ((pLatest == nullptr) || (static_cast<int32_t>(pSource->nStamp - pLatest->nStamp) > 0)) {
+			pLatest = pSource;
+		}
+
+		if (pSource->nLength > nLength) {
+			nLength = pSource->nLength;
+		}
+	}
+
+	if (nCount == 0) {
+		return false;
+	}
+
+	bool isChanged;
+
+	if ((mergeMode == lightset::MergeMode::LTP) || (nCount == 1)) {
+		nLength = pLatest->nLength;
+		isChanged = LightSetMerge::Copy(pOutput, pLatest->pData, nLength);
+	} else if (nCount == 2) {
+		isChanged = LightSetMerge::Htp(pOutput, pSources[0]->pData, pSources[1]->pData, nLength);
+	} else {
+		auto *pScratch = &m_pArena[m_nSources * DMX_UNIVERSE_SIZE];
+
+		LightSetMerge::Htp(pScratch, pSources[0]->pData, pSources[1]->pData, nLength);
+
+		for (uint32_t i = 2; i < nCount; i++) {
+			LightSetMerge::Htp(pScratch, pScratch, pSources[i]->pData, nLength);
+		}
+
+		isChanged = LightSetMerge::Copy(pOutput, pScratch, nLength);
+	}
+
+	if (nLength != nOutputLength) {
+		nOutputLength = nLength;
+		return true;
+	}
+
+	return isChanged;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file merge.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Checks the vector kernels of LightSetMerge against the scalar ones, for all
+ * lengths up to a full universe and unaligned buffers, and measures both.
+ * The vector kernels use the GCC vector extensions: NEON on the Cortex-A7,
+ * SSE2 on an x86 host.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "lightsetmerge.h"
+
+namespace bench {
+static constexpr uint32_t DMX_LENGTH = 512;
+static constexpr uint32_t MAX_OFFSET = 16;
+static constexpr uint32_t UNIVERSES = 200000;
+}  // namespace bench
+
+static uint8_t s_SourceA[bench::DMX_LENGTH + bench::MAX_OFFSET];
+static uint8_t s_SourceB[bench::DMX_LENGTH + bench::MAX_OFFSET];
+static uint8_t s_Vector[bench::DMX_LENGTH + bench::MAX_OFFSET];
+static uint8_t s_Scalar[bench::DMX_LENGTH + bench::MAX_OFFSET];
+
+static uint64_t now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static void fill(uint8_t *p, uint32_t nLength) {
+	for (uint32_t i = 0; i < nLength; i++) {
+		p[i] = static_cast<uint8_t>(rand());
+	}
+}
+
+static bool check(const char *pName, uint32_t nLength, uint32_t nOffset, bool isVector, bool isScalar) {
+	if ((isVector != isScalar) || (memcmp(s_Vector, s_Scalar, sizeof(s_Vector)) != 0)) {
+		printf("FAIL: %s length %u, offset %u\n", pName, nLength, nOffset);
+		return false;
+	}
+
+	return true;
+}
+
+static bool test() {
+	bool bPass = true;
+
+	for (uint32_t nOffset = 0; nOffset < bench::MAX_OFFSET; nOffset++) {
+		for (uint32_t nLength = 0; nLength <= bench::DMX_LENGTH; nLength++) {
+			fill(s_SourceA, sizeof(s_SourceA));
+			fill(s_SourceB, sizeof(s_SourceB));
+			fill(s_Vector, sizeof(s_Vector));
+			memcpy(s_Scalar, s_Vector, sizeof(s_Scalar));
+
+			// Changed data
+			auto isVector = LightSetMerge::Copy(&s_Vector[nOffset], &s_SourceA[nOffset], nLength);
+			auto isScalar = LightSetMerge::CopyScalar(&s_Scalar[nOffset], &s_SourceA[nOffset], nLength);
+			bPass &= check("Copy", nLength, nOffset, isVector, isScalar);
+
+			// Unchanged data
+			isVector = LightSetMerge::Copy(&s_Vector[nOffset], &s_SourceA[nOffset], nLength);
+			isScalar = LightSetMerge::CopyScalar(&s_Scalar[nOffset], &s_SourceA[nOffset], nLength);
+			bPass &= check("Copy unchanged", nLength, nOffset, isVector, isScalar) && !isVector;
+
+			// Only the last slot changed, this is in the scalar tail or in the last vector
+			if (nLength != 0) {
+				s_SourceA[nOffset + nLength - 1]++;
+				isVector = LightSetMerge::Copy(&s_Vector[nOffset], &s_SourceA[nOffset], nLength);
+				isScalar = LightSetMerge::CopyScalar(&s_Scalar[nOffset], &s_SourceA[nOffset], nLength);
+				bPass &= check("Copy last slot", nLength, nOffset, isVector, isScalar) && isVector;
+			}
+
+			isVector = LightSetMerge::Htp(&s_Vector[nOffset], &s_SourceA[nOffset], &s_SourceB[nOffset], nLength);
+			isScalar = LightSetMerge::HtpScalar(&s_Scalar[nOffset], &s_SourceA[nOffset], &s_SourceB[nOffset], nLength);
+			bPass &= check("Htp", nLength, nOffset, isVector, isScalar);
+
+			isVector = LightSetMerge::Htp(&s_Vector[nOffset], &s_SourceA[nOffset], &s_SourceB[nOffset], nLength);
+			isScalar = LightSetMerge::HtpScalar(&s_Scalar[nOffset], &s_SourceA[nOffset], &s_SourceB[nOffset], nLength);
+			bPass &= check("Htp unchanged", nLength, nOffset, isVector, isScalar) && !isVector;
+
+			if (!bPass) {
+				return false;
+			}
+		}
+	}
+
+	return bPass;
+}
+
+template<typename F>
+static double measure(F f) {
+	const auto nStart = now_ns();
+
+	for (uint32_t i = 0; i < bench::UNIVERSES; i++) {
+		s_SourceA[i & 0xFF]++;	// Changed data, as with a running show
+		f();
+	}
+
+	return static_cast<double>(now_ns() - nStart) / bench::UNIVERSES;
+}
+
+int main() {
+	srand(1);
+
+	if (!test()) {
+		puts("FAIL");
+		return 1;
+	}
+
+	const auto fCopyVector = measure([] { LightSetMerge::Copy(s_Vector, s_SourceA, bench::DMX_LENGTH); });
+	const auto fCopyScalar = measure([] { LightSetMerge::CopyScalar(s_Scalar, s_SourceA, bench::DMX_LENGTH); });
+	const auto fHtpVector = measure([] { LightSetMerge::Htp(s_Vector, s_SourceA, s_SourceB, bench::DMX_LENGTH); });
+	const auto fHtpScalar = measure([] { LightSetMerge::HtpScalar(s_Scalar, s_SourceA, s_SourceB, bench::DMX_LENGTH); });
+
+	printf("512 slots  vector ns  scalar ns\n");
+	printf("Copy       %9.1f  %9.1f\n", fCopyVector, fCopyScalar);
+	printf("Htp        %9.1f  %9.1f\n", fHtpVector, fHtpScalar);
+
+	puts("PASS");
+	return 0;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file portlookup.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Per-packet cost of finding the output ports of a universe, as the number of
+ * Art-Net pages (4 ports each) grows. LightSetPortLookup is compared with the
+ * linear scan over all the ports it replaced, and checked against it.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "lightsetportlookup.h"
+
+namespace bench {
+static constexpr uint32_t PORTS_PER_PAGE = 4;
+static constexpr uint32_t MAX_PAGES = 8;
+static constexpr uint32_t MAX_PORTS = PORTS_PER_PAGE * MAX_PAGES;
+static constexpr uint32_t PACKETS = 4 * 1000 * 1000;
+static constexpr uint32_t UNIVERSES = 1024;	// Received universes, the ports use some of them
+}  // namespace bench
+
+static uint16_t s_PortUniverse[bench::MAX_PORTS];
+static uint16_t s_Received[bench::UNIVERSES];
+
+static uint64_t now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static uint32_t linear(uint16_t nUniverse, uint32_t nPorts) {
+	uint32_t nPortMask = 0;
+
+	for (uint32_t i = 0; i < nPorts; i++) {
+		if (s_PortUniverse[i] == nUniverse) {
+			nPortMask |= (1U << i);
+		}
+	}
+
+	return nPortMask;
+}
+
+int main() {
+	LightSetPortLookup<bench::MAX_PORTS> lookup;
+
+	srand(1);
+
+	for (uint32_t i = 0; i < bench::MAX_PORTS; i++) {
+		s_PortUniverse[i] = static_cast<uint16_t>(rand() & 0x7FFF);
+	}
+
+	// Two ports on the same universe
+	s_PortUniverse[bench::MAX_PORTS - 1] = s_PortUniverse[0];
+
+	for (uint32_t i = 0; i < bench::UNIVERSES; i++) {
+		s_Received[i] = (i & 1) ? s_PortUniverse[rand() % bench::MAX_PORTS] : static_cast<uint16_t>(rand() & 0x7FFF);
+	}
+
+	double fLookup1 = 0;
+	double fLookupN = 0;
+	bool bPass = true;
+
+	printf("pages  ports  lookup ns/packet  linear ns/packet\n");
+
+	for (uint32_t nPages = 1; nPages <= bench::MAX_PAGES; nPages++) {
+		const auto nPorts = nPages * bench::PORTS_PER_PAGE;
+
+		lookup.Clear();
+
+		for (uint32_t i = 0; i < nPorts; i++) {
+			lookup.Add(s_PortUniverse[i], i);
+		}
+
+		for (uint32_t i = 0; i < bench::UNIVERSES; i++) {
+			if (lookup.Get(s_Received[i]) != linear(s_Received[i], nPorts)) {
+				printf("FAIL: universe %u, pages %u\n", s_Received[i], nPages);
+				bPass = false;
+			}
+		}
+
+		volatile uint32_t nSink = 0;
+
+		auto nStart = now_ns();
+		for (uint32_t i = 0; i < bench::PACKETS; i++) {
+			nSink = nSink + lookup.Get(s_Received[i & (bench::UNIVERSES - 1)]);
+		}
+		const auto fLookup = static_cast<double>(now_ns() - nStart) / bench::PACKETS;
+
+		nStart = now_ns();
+		for (uint32_t i = 0; i < bench::PACKETS; i++) {
+			nSink = nSink + linear(s_Received[i & (bench::UNIVERSES - 1)], nPorts);
+		}
+		const auto fLinear = static_cast<double>(now_ns() - nStart) / bench::PACKETS;
+
+		printf("%5u  %5u  %16.2f  %16.2f\n", nPages, nPorts, fLookup, fLinear);
+
+		if (nPages == 1) {
+			fLookup1 = fLookup;
+		}
+		fLookupN = fLookup;
+	}
+
+	// Loose bound, the timing of a shared host is noisy
+	if (fLookupN > 4 * fLookup1) {
+		printf("FAIL: the lookup cost grows with the number of pages\n");
+		bPass = false;
+	}
+
+	puts(bPass ? "PASS" : "FAIL");
+	return bPass ? 0 : 1;
+}
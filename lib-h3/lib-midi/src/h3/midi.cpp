@@ -463,6 +463,11 @@ void Midi::SendQf(uint8_t nValue) {
 	SendUart2(data, 2);
 }
 
+extern "C" {
+void emac_irq_handler(void) __attribute__((weak));
+void h3_spi_irq_handler(void) __attribute__((weak));
+}
+
 static void __attribute__((interrupt("IRQ"))) irq_midi_in_handler(void) {
 	dmb();
 
@@ -501,6 +506,10 @@ static void __attribute__((interrupt("IRQ"))) irq_midi_in_handler(void) {
 
 		H3_GIC_CPUIF->AEOI = H3_TIMER1_IRQn;
 		gic_unpend(H3_TIMER1_IRQn);
+	} else if ((emac_irq_handler != nullptr) && (irq == H3_EMAC_IRQn)) {
+		emac_irq_handler();
+	} else if ((h3_spi_irq_handler != nullptr) && ((irq == H3_SPI0_IRQn) || (irq == H3_SPI1_IRQn))) {
+		h3_spi_irq_handler();
 	}
 
 	dmb();
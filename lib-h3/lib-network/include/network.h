@@ -56,6 +56,20 @@ enum class DhcpClientStatus {
 	FAILED
 };
 
+struct NetworkQueueStats {
+	uint32_t nReceived;
+	uint32_t nDroppedQueueFull;	///< The receive queue of the port was full
+	uint32_t nDroppedNoBuffer;	///< The driver was out of receive buffers
+};
+
+struct NetworkRxStats {
+	uint32_t nFrames;
+	uint32_t nBadFrames;
+	uint32_t nStalls;			///< The driver had no buffer for a received frame
+	uint32_t nRingHighWater;	///< Most frames received between two harvests of the DMA ring
+	uint32_t nQueueHighWater;	///< Most frames waiting for the upper layers
+};
+
 struct NetworkDisplay {
 	virtual ~NetworkDisplay() {
 	}
@@ -98,7 +112,26 @@ public:
 	virtual void LeaveGroup(int32_t nHandle, uint32_t nIp)=0;
 
 	virtual uint16_t RecvFrom(int32_t nHandle, void *pBuffer, uint16_t nLength, uint32_t *pFromIp, uint16_t *pFromPort)=0;
+	/**
+	 * The buffer is on loan from the network driver.
+	 * It stays valid until RecvRelease() or the next RecvFromZeroCopy() on the same handle.
+	 */
+	virtual uint16_t RecvFromZeroCopy(int32_t nHandle, void **ppBuffer, uint32_t *pFromIp, uint16_t *pFromPort);
+	virtual void RecvRelease(int32_t nHandle);
+	/**
+	 * Number of packets which can be queued for the handle.
+	 * Returns false when the depth is not supported by the driver.
+	 */
+	virtual bool SetQueueDepth(int32_t nHandle, uint32_t nDepth);
+	virtual void GetQueueStats(int32_t nHandle, NetworkQueueStats &Stats);
+	virtual void GetRxStats(NetworkRxStats &Stats);
 	virtual void SendTo(int32_t nHandle, const void *pBuffer, uint16_t nLength, uint32_t nToIp, uint16_t nRemotePort)=0;
+	/**
+	 * The buffer is not copied, it must stay unchanged until IsSendDone(nSequence) returns true.
+	 * Returns false when the packet is not sent, the caller falls back to SendTo().
+	 */
+	virtual bool SendToZeroCopy(int32_t nHandle, const void *pBuffer, uint16_t nLength, uint32_t nToIp, uint16_t nRemotePort, uint32_t &nSequence);
+	virtual bool IsSendDone(uint32_t nSequence);
 
 	virtual void SetIp(uint32_t nIp)=0;
 	virtual void SetNetmask(uint32_t nNetmask)=0;
@@ -54,7 +54,14 @@ public:
 	void LeaveGroup(int32_t nHandle, uint32_t nIp) override;
 
 	uint16_t RecvFrom(int32_t nHandle, void *pBuffer, uint16_t nLength, uint32_t *pFromIp, uint16_t *pFromPort) override;
+	uint16_t RecvFromZeroCopy(int32_t nHandle, void **ppBuffer, uint32_t *pFromIp, uint16_t *pFromPort) override;
+	void RecvRelease(int32_t nHandle) override;
+	bool SetQueueDepth(int32_t nHandle, uint32_t nDepth) override;
+	void GetQueueStats(int32_t nHandle, NetworkQueueStats &Stats) override;
+	void GetRxStats(NetworkRxStats &Stats) override;
 	void SendTo(int32_t nHandle, const void *pBuffer, uint16_t nLength, uint32_t nToIp, uint16_t nRemotePort) override;
+	bool SendToZeroCopy(int32_t nHandle, const void *pBuffer, uint16_t nLength, uint32_t nToIp, uint16_t nRemotePort, uint32_t &nSequence) override;
+	bool IsSendDone(uint32_t nSequence) override;
 
 	void SetIp(uint32_t nIp) override;
 	void SetNetmask(uint32_t nNetmask) override;
@@ -57,6 +57,8 @@ public:
 	void LeaveGroup(int32_t nHandle, uint32_t nIp);
 
 	uint16_t RecvFrom(int32_t nHandle, void *pBuffer, uint16_t nLength, uint32_t *pFromIp, uint16_t *pFromPort);
+	bool SetQueueDepth(int32_t nHandle, uint32_t nDepth);
+	void GetQueueStats(int32_t nHandle, NetworkQueueStats &Stats);
 	void SendTo(int32_t nHandle, const void *pBuffer, uint16_t nLength, uint32_t nToIp, uint16_t nRemotePort);
 
 private:
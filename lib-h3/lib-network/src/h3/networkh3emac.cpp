@@ -36,6 +36,7 @@
 #include "ledblink.h"
 
 #include "./../lib-h3/include/net/net.h"
+#include "./../lib-h3/include/device/emac.h"
 
 #include "debug.h"
 
@@ -45,8 +46,6 @@
 
 extern "C" {
 int32_t hardware_get_mac_address(/*@out@*/uint8_t *mac_address);
-// MAC-PHY
-int emac_start(bool reset_emac);
 }
 
 NetworkH3emac::NetworkH3emac() {
@@ -75,6 +74,7 @@ void NetworkH3emac::Init(NetworkParamsStore *pNetworkParamsStore) {
 	}
 
 	emac_start(true);
+	emac_rx_irq_enable();
 
 	hardware_get_mac_address(m_aNetMacaddr);
 
@@ -233,10 +233,56 @@ uint16_t NetworkH3emac::RecvFrom(int32_t nHandle, void *pBuffer, uint16_t nLengt
 	return udp_recv(nHandle, reinterpret_cast<uint8_t*>(pBuffer), nLength, from_ip, from_port);
 }
 
+uint16_t NetworkH3emac::RecvFromZeroCopy(int32_t nHandle, void **ppBuffer, uint32_t *from_ip, uint16_t *from_port) {
+	return udp_recv_zc(nHandle, reinterpret_cast<uint8_t**>(ppBuffer), from_ip, from_port);
+}
+
+void NetworkH3emac::RecvRelease(int32_t nHandle) {
+	udp_recv_release(nHandle);
+}
+
+bool NetworkH3emac::SetQueueDepth(int32_t nHandle, uint32_t nDepth) {
+	if (nDepth > 0xFFFF) {
+		return false;
+	}
+
+	return udp_set_queue_depth(static_cast<uint8_t>(nHandle), static_cast<uint16_t>(nDepth)) == 0;
+}
+
+void NetworkH3emac::GetQueueStats(int32_t nHandle, NetworkQueueStats &Stats) {
+	struct udp_stats stats;
+
+	udp_get_stats(static_cast<uint8_t>(nHandle), &stats);
+
+	Stats.nReceived = stats.received;
+	Stats.nDroppedQueueFull = stats.dropped_queue_full;
+	Stats.nDroppedNoBuffer = stats.dropped_no_buffer;
+}
+
+void NetworkH3emac::GetRxStats(NetworkRxStats &Stats) {
+	struct emac_rx_stats stats;
+
+	emac_get_rx_stats(&stats);
+
+	Stats.nFrames = stats.frames;
+	Stats.nBadFrames = stats.bad_frames;
+	Stats.nStalls = stats.stalls;
+	Stats.nRingHighWater = stats.ring_high_water;
+	Stats.nQueueHighWater = stats.queue_high_water;
+}
+
 void NetworkH3emac::SendTo(int32_t nHandle, const void *pBuffer, uint16_t nLength, uint32_t to_ip, uint16_t remote_port) {
 	udp_send(nHandle, reinterpret_cast<const uint8_t*>(pBuffer), nLength, to_ip, remote_port);
 }
 
+bool NetworkH3emac::SendToZeroCopy(int32_t nHandle, const void *pBuffer, uint16_t nLength, uint32_t to_ip, uint16_t remote_port, uint32_t &nSequence) {
+	return udp_send_zc(nHandle, reinterpret_cast<const uint8_t*>(pBuffer), nLength, to_ip, remote_port, &nSequence) == 0;
+}
+
+bool NetworkH3emac::IsSendDone(uint32_t nSequence) {
+	return udp_send_done(nSequence);
+}
+
 void NetworkH3emac::SetDefaultIp() {
 	DEBUG_ENTRY
 
@@ -33,6 +33,7 @@
 #include <net/if.h>
 #include <ifaddrs.h>
 #include <errno.h>
+#include <sys/socket.h>
 #include <cassert>
 
 #include "networklinux.h"
@@ -52,6 +53,17 @@ namespace max {
 
 static int s_ports_allowed[max::PORTS_ALLOWED];
 static int snHandles[max::PORTS_ALLOWED];
+static NetworkQueueStats s_QueueStats[max::PORTS_ALLOWED];
+
+static int32_t handle_index(int32_t nHandle) {
+	for (int32_t i = 0; i < max::PORTS_ALLOWED; i++) {
+		if (snHandles[i] == nHandle) {
+			return i;
+		}
+	}
+
+	return -1;
+}
 
 /**
  * END
@@ -122,7 +134,7 @@ int NetworkLinux::Init(const char *s) {
 
 	i = 0;
 
-	while(i < NETWORK_HOSTNAME_SIZE && m_aHostName[i] != '.') {
+	while(i < NETWORK_HOSTNAME_SIZE - 1 && m_aHostName[i] != '.') {
 		i++;
 	}
 
@@ -210,6 +222,13 @@ int32_t NetworkLinux::Begin(uint16_t nPort) {
 		exit(EXIT_FAILURE);
 	}
 
+#if defined (__linux__)
+	// The kernel reports the packets dropped on a full receive buffer with each received packet
+	if (setsockopt(nSocket, SOL_SOCKET, SO_RXQ_OVFL, reinterpret_cast<char*>(&true_flag), sizeof(int)) == -1) {
+		perror("setsockopt(SO_RXQ_OVFL)");
+	}
+#endif
+
 /**
  * BEGIN - needed H3 code compatibility
  */
@@ -223,6 +242,7 @@ int32_t NetworkLinux::Begin(uint16_t nPort) {
  */
 
 	snHandles[i] = nSocket;
+	memset(&s_QueueStats[i], 0, sizeof(s_QueueStats[i]));
 
 	return nSocket;
 }
@@ -348,22 +368,97 @@ uint16_t NetworkLinux::RecvFrom(int32_t nHandle, void *pPacket, uint16_t nSize,
 
 	int recv_len;
 	struct sockaddr_in si_other;
-	socklen_t slen = sizeof(si_other);
-
-
-	if ((recv_len = recvfrom(nHandle, pPacket, nSize, 0, reinterpret_cast<struct sockaddr*>(&si_other), &slen)) == -1) {
+	struct iovec iov;
+	struct msghdr msg;
+	char control[CMSG_SPACE(sizeof(uint32_t))];
+
+	iov.iov_base = pPacket;
+	iov.iov_len = nSize;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = &si_other;
+	msg.msg_namelen = sizeof(si_other);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	if ((recv_len = recvmsg(nHandle, &msg, 0)) == -1) {
 		if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
-			perror("recvfrom");
+			perror("recvmsg");
 		}
 		return 0;
 	}
 
+	const auto nIndex = handle_index(nHandle);
+
+	if (nIndex >= 0) {
+		s_QueueStats[nIndex].nReceived++;
+#if defined (__linux__)
+		for (auto *pCmsg = CMSG_FIRSTHDR(&msg); pCmsg != nullptr; pCmsg = CMSG_NXTHDR(&msg, pCmsg)) {
+			if ((pCmsg->cmsg_level == SOL_SOCKET) && (pCmsg->cmsg_type == SO_RXQ_OVFL)) {
+				// Running total for the socket
+				memcpy(&s_QueueStats[nIndex].nDroppedQueueFull, CMSG_DATA(pCmsg), sizeof(uint32_t));
+			}
+		}
+#endif
+	}
+
 	*pFromIp = si_other.sin_addr.s_addr;
 	*pFromPort = ntohs(si_other.sin_port);
 
 	return recv_len;
 }
 
+/**
+ * The kernel accounts the receive buffer in bytes, including its own overhead per packet.
+ * The buffer is only made larger, never smaller than the system default.
+ */
+bool NetworkLinux::SetQueueDepth(int32_t nHandle, uint32_t nDepth) {
+	static constexpr auto BYTES_PER_PACKET = 2304U;	// 1500 bytes of data in a 2K buffer, plus the sk_buff
+	const int nNeeded = static_cast<int>(nDepth * BYTES_PER_PACKET);
+
+	int nBufferSize;
+	socklen_t nLength = sizeof(nBufferSize);
+
+	if (getsockopt(nHandle, SOL_SOCKET, SO_RCVBUF, &nBufferSize, &nLength) == -1) {
+		perror("getsockopt(SO_RCVBUF)");
+		return false;
+	}
+
+	if (nBufferSize >= nNeeded) {
+		return true;
+	}
+
+	if (setsockopt(nHandle, SOL_SOCKET, SO_RCVBUF, &nNeeded, sizeof(nNeeded)) == -1) {
+		perror("setsockopt(SO_RCVBUF)");
+		return false;
+	}
+
+	// The kernel limits the size to net.core.rmem_max
+	if ((getsockopt(nHandle, SOL_SOCKET, SO_RCVBUF, &nBufferSize, &nLength) == -1) || (nBufferSize < nNeeded)) {
+		fprintf(stderr, "SO_RCVBUF is %d bytes, %d bytes are needed for %u packets\n", nBufferSize, nNeeded, nDepth);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * nDroppedQueueFull is the count of SO_RXQ_OVFL, it is updated with each received packet.
+ * Packets are never dropped for the lack of a buffer, nDroppedNoBuffer stays 0.
+ */
+void NetworkLinux::GetQueueStats(int32_t nHandle, NetworkQueueStats &Stats) {
+	const auto nIndex = handle_index(nHandle);
+
+	if (nIndex < 0) {
+		memset(&Stats, 0, sizeof(Stats));
+		return;
+	}
+
+	Stats = s_QueueStats[nIndex];
+}
+
 void NetworkLinux::SendTo(int32_t nHandle, const void *pPacket, uint16_t nSize, uint32_t nToIp, uint16_t nRemotePort) {
 	struct sockaddr_in si_other;
 	socklen_t slen = sizeof(si_other);
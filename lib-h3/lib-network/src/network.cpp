@@ -33,6 +33,12 @@
 
 Network *Network::s_pThis = nullptr;
 
+namespace network {
+static constexpr auto RECV_BUFFER_SIZE = 1500;
+}  // namespace network
+
+static uint8_t s_RecvBuffer[network::RECV_BUFFER_SIZE] __attribute__ ((aligned (4)));
+
 Network::Network() {
 	assert(s_pThis == nullptr);
 	s_pThis = this;
@@ -49,6 +55,43 @@ void Network::Shutdown() {
 	DEBUG_EXIT
 }
 
+/**
+ * Fallback for platforms without a zero-copy receive path
+ */
+uint16_t Network::RecvFromZeroCopy(int32_t nHandle, void **ppBuffer, uint32_t *pFromIp, uint16_t *pFromPort) {
+	assert(ppBuffer != nullptr);
+
+	*ppBuffer = s_RecvBuffer;
+
+	return RecvFrom(nHandle, s_RecvBuffer, sizeof(s_RecvBuffer), pFromIp, pFromPort);
+}
+
+void Network::RecvRelease(__attribute__((unused)) int32_t nHandle) {
+}
+
+bool Network::SetQueueDepth(__attribute__((unused)) int32_t nHandle, __attribute__((unused)) uint32_t nDepth) {
+	return false;
+}
+
+/**
+ * Fallback for platforms without a zero-copy send path
+ */
+bool Network::SendToZeroCopy(__attribute__((unused)) int32_t nHandle, __attribute__((unused)) const void *pBuffer, __attribute__((unused)) uint16_t nLength, __attribute__((unused)) uint32_t nToIp, __attribute__((unused)) uint16_t nRemotePort, __attribute__((unused)) uint32_t &nSequence) {
+	return false;
+}
+
+bool Network::IsSendDone(__attribute__((unused)) uint32_t nSequence) {
+	return true;
+}
+
+void Network::GetQueueStats(__attribute__((unused)) int32_t nHandle, NetworkQueueStats &Stats) {
+	memset(&Stats, 0, sizeof(NetworkQueueStats));
+}
+
+void Network::GetRxStats(NetworkRxStats &Stats) {
+	memset(&Stats, 0, sizeof(NetworkRxStats));
+}
+
 void Network::SetQueuedStaticIp(uint32_t nLocalIp, uint32_t nNetmask) {
 	DEBUG_ENTRY
 	DEBUG_PRINTF(IPSTR ", nNetmask=" IPSTR, IP2STR(nLocalIp), IP2STR(nNetmask));
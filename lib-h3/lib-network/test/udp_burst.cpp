@@ -0,0 +1,153 @@
+/**
+ * @file udp_burst.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Sends bursts of 64 Art-Net universes followed by an ArtSync back-to-back over
+ * the loopback interface to a NetworkLinux handle with the Art-Net queue depth.
+ * The receiver only starts reading when the burst has been sent, so all packets
+ * must fit in the receive queue. Checks that no packet is lost.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "networklinux.h"
+#include "networkparams.h"
+
+/*
+ * NetworkLinux::Init is not used, it loads the parameters from the configuration store
+ */
+NetworkParams::NetworkParams(__attribute__((unused)) NetworkParamsStore *pNetworkParamsStore) {
+}
+
+bool NetworkParams::Load() {
+	return false;
+}
+
+void NetworkParams::Dump() {
+}
+
+namespace burst {
+static constexpr auto PORT = 6454;
+static constexpr auto UNIVERSES = 64;
+static constexpr auto ARTDMX_SIZE = 18 + 512;
+static constexpr auto ARTSYNC_SIZE = 14;
+static constexpr auto QUEUE_DEPTH = 80;		// artnet::UDP_QUEUE_DEPTH
+static constexpr auto COUNT = 1000;
+}  // namespace burst
+
+static uint64_t now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static int get_rcvbuf(int nHandle) {
+	int nSize = 0;
+	socklen_t nLength = sizeof(nSize);
+	getsockopt(nHandle, SOL_SOCKET, SO_RCVBUF, &nSize, &nLength);
+	return nSize;
+}
+
+int main() {
+	NetworkLinux nw;
+
+	const auto nHandle = nw.Begin(burst::PORT);
+
+	const auto nDefault = get_rcvbuf(nHandle);
+
+	if (!nw.SetQueueDepth(nHandle, 1) || (get_rcvbuf(nHandle) != nDefault)) {
+		printf("FAIL: SetQueueDepth(1) changed SO_RCVBUF from %d to %d\n", nDefault, get_rcvbuf(nHandle));
+		return 1;
+	}
+
+	if (!nw.SetQueueDepth(nHandle, burst::QUEUE_DEPTH)) {
+		printf("FAIL: SetQueueDepth(%d)\n", burst::QUEUE_DEPTH);
+		return 1;
+	}
+
+	printf("SO_RCVBUF %d -> %d bytes\n", nDefault, get_rcvbuf(nHandle));
+
+	const auto nSender = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+	struct sockaddr_in to;
+	memset(&to, 0, sizeof(to));
+	to.sin_family = AF_INET;
+	to.sin_port = htons(burst::PORT);
+	to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	uint8_t packet[1500];
+	memset(packet, 0, sizeof(packet));
+
+	uint32_t nSent = 0;
+	uint32_t nReceived = 0;
+	uint64_t nBurstTime = 0;
+
+	for (auto nCount = 0; nCount < burst::COUNT; nCount++) {
+		const auto nStart = now_ns();
+
+		for (auto nUniverse = 0; nUniverse < burst::UNIVERSES; nUniverse++) {
+			packet[14] = static_cast<uint8_t>(nUniverse);
+			if (sendto(nSender, packet, burst::ARTDMX_SIZE, 0, reinterpret_cast<struct sockaddr*>(&to), sizeof(to)) == burst::ARTDMX_SIZE) {
+				nSent++;
+			}
+		}
+
+		if (sendto(nSender, packet, burst::ARTSYNC_SIZE, 0, reinterpret_cast<struct sockaddr*>(&to), sizeof(to)) == burst::ARTSYNC_SIZE) {
+			nSent++;
+		}
+
+		nBurstTime += now_ns() - nStart;
+
+		uint32_t nFromIp;
+		uint16_t nFromPort;
+
+		while (nw.RecvFrom(nHandle, packet, sizeof(packet), &nFromIp, &nFromPort) != 0) {
+			nReceived++;
+		}
+	}
+
+	NetworkQueueStats stats;
+	nw.GetQueueStats(nHandle, stats);
+
+	close(nSender);
+	nw.End(burst::PORT);
+
+	printf("\n%d bursts of %d universes + ArtSync, %.1f us/burst to send\n", burst::COUNT, burst::UNIVERSES, static_cast<double>(nBurstTime) / burst::COUNT / 1000.0);
+	printf("sent %u, received %u, dropped (SO_RXQ_OVFL) %u\n", nSent, nReceived, stats.nDroppedQueueFull);
+
+	if ((nReceived != nSent) || (stats.nReceived != nReceived) || (stats.nDroppedQueueFull != 0)) {
+		puts("FAIL");
+		return 1;
+	}
+
+	puts("PASS");
+	return 0;
+}
@@ -314,6 +314,13 @@ private:
 	void HandleTftpSet();
 	void HandleTftpGet();
 
+	void HandleNetStatsGet();
+
+#if defined (ENABLE_LATENCY_TRACE)
+	void HandleLatencySet();
+	void HandleLatencyGet();
+#endif
+
 private:
 	remoteconfig::Node m_tNode;
 	remoteconfig::Output m_tOutput;
@@ -165,6 +165,10 @@
 #include "tftpfileserver.h"
 #include "spiflashinstall.h"
 
+#if defined (ENABLE_LATENCY_TRACE)
+# include "h3_latency.h"
+#endif
+
 #include "debug.h"
 
 namespace udp {
@@ -182,6 +186,8 @@ static constexpr char VERSION[] = "?version#";
 static constexpr char STORE[] = "?store#";
 static constexpr char DISPLAY[] = "?display#";
 static constexpr char TFTP[] = "?tftp#";
+static constexpr char LATENCY[] = "?latency#";
+static constexpr char NETSTATS[] = "?netstats#";
 namespace length {
 static constexpr auto REBOOT = sizeof(cmd::get::REBOOT) - 1;
 static constexpr auto LIST = sizeof(cmd::get::LIST) - 1;
@@ -191,6 +197,8 @@ static constexpr auto VERSION = sizeof(cmd::get::VERSION) - 1;
 static constexpr auto STORE = sizeof(cmd::get::STORE) - 1;
 static constexpr auto DISPLAY = sizeof(cmd::get::DISPLAY) - 1;
 static constexpr auto TFTP = sizeof(cmd::get::TFTP) - 1;
+static constexpr auto LATENCY = sizeof(cmd::get::LATENCY) - 1;
+static constexpr auto NETSTATS = sizeof(cmd::get::NETSTATS) - 1;
 }  // namespace length
 }  // namespace get
 
@@ -198,10 +206,12 @@ namespace set {
 static constexpr char STORE[] = "!store#";
 static constexpr char DISPLAY[] = "!display#";
 static constexpr char TFTP[] = "!tftp#";
+static constexpr char LATENCY[] = "!latency#";
 namespace length {
 static constexpr auto STORE = sizeof(cmd::set::STORE) - 1;
 static constexpr auto DISPLAY = sizeof(cmd::set::DISPLAY) - 1;
 static constexpr auto TFTP = sizeof(cmd::set::TFTP) - 1;
+static constexpr auto LATENCY = sizeof(cmd::set::LATENCY) - 1;
 }  // namespace length
 }  // namespace set
 
@@ -357,6 +367,18 @@ void RemoteConfig::Run() {
 			return;
 		}
 
+		if ((m_nBytesReceived >= udp::cmd::get::length::NETSTATS) && (memcmp(m_pUdpBuffer, udp::cmd::get::NETSTATS, udp::cmd::get::length::NETSTATS) == 0)) {
+			HandleNetStatsGet();
+			return;
+		}
+
+#if defined (ENABLE_LATENCY_TRACE)
+		if ((m_nBytesReceived >= udp::cmd::get::length::LATENCY) && (memcmp(m_pUdpBuffer, udp::cmd::get::LATENCY, udp::cmd::get::length::LATENCY) == 0)) {
+			HandleLatencyGet();
+			return;
+		}
+#endif
+
 		Network::Get()->SendTo(m_nHandle, "?#ERROR#\n", 9, m_nIPAddressFrom, udp::PORT);
 
 		return;
@@ -375,6 +397,11 @@ void RemoteConfig::Run() {
 			} else if ((m_nBytesReceived == udp::cmd::set::length::TFTP + 1) && (memcmp(m_pUdpBuffer, udp::cmd::set::TFTP, udp::cmd::set::length::TFTP) == 0)) {
 				DEBUG_PUTS(udp::cmd::set::TFTP);
 				HandleTftpSet();
+#if defined (ENABLE_LATENCY_TRACE)
+			} else if ((m_nBytesReceived >= udp::cmd::set::length::LATENCY) && (memcmp(m_pUdpBuffer, udp::cmd::set::LATENCY, udp::cmd::set::length::LATENCY) == 0)) {
+				DEBUG_PUTS(udp::cmd::set::LATENCY);
+				HandleLatencySet();
+#endif
 			} else if ((m_nBytesReceived > udp::cmd::set::length::STORE) && (memcmp(m_pUdpBuffer, udp::cmd::set::STORE, udp::cmd::set::length::STORE) == 0)) {
 				DEBUG_PUTS(udp::cmd::set::STORE);
 				m_tHandleMode = HandleMode::BIN;
@@ -468,6 +495,80 @@ void RemoteConfig::HandleDisplayGet() {
 	DEBUG_EXIT
 }
 
+/**
+ * The receive counters of the network driver: frames,bad,stalls,ring high water,queue high water
+ */
+void RemoteConfig::HandleNetStatsGet() {
+	DEBUG_ENTRY
+
+	NetworkRxStats stats;
+	Network::Get()->GetRxStats(stats);
+
+	if (m_nBytesReceived == udp::cmd::get::length::NETSTATS) {
+		const auto nLength = snprintf(m_pUdpBuffer, udp::BUFFER_SIZE - 1, "rx: %u,%u,%u,%u,%u\n", static_cast<unsigned int>(stats.nFrames), static_cast<unsigned int>(stats.nBadFrames), static_cast<unsigned int>(stats.nStalls), static_cast<unsigned int>(stats.nRingHighWater), static_cast<unsigned int>(stats.nQueueHighWater));
+		Network::Get()->SendTo(m_nHandle, m_pUdpBuffer, static_cast<uint16_t>(nLength), m_nIPAddressFrom, udp::PORT);
+	} else if (m_nBytesReceived == udp::cmd::get::length::NETSTATS + 3) {
+		if (memcmp(&m_pUdpBuffer[udp::cmd::get::length::NETSTATS], "bin", 3) == 0) {
+			Network::Get()->SendTo(m_nHandle, &stats, sizeof(stats), m_nIPAddressFrom, udp::PORT);
+		}
+	}
+
+	DEBUG_EXIT
+}
+
+#if defined (ENABLE_LATENCY_TRACE)
+/**
+ * One line per stage: name,count,average,maximum followed by the buckets
+ */
+void RemoteConfig::HandleLatencyGet() {
+	DEBUG_ENTRY
+
+	struct h3_latency_histogram histograms[H3_LATENCY_LAST];
+
+	for (uint32_t i = 0; i < H3_LATENCY_LAST; i++) {
+		h3_latency_get(static_cast<h3_latency_stage>(i), &histograms[i]);
+	}
+
+	if (m_nBytesReceived == udp::cmd::get::length::LATENCY) {
+		int nLength = 0;
+
+		for (uint32_t i = 0; i < H3_LATENCY_LAST; i++) {
+			const auto& histogram = histograms[i];
+			const auto nAverage = histogram.count == 0 ? 0 : static_cast<uint32_t>(histogram.total_us / histogram.count);
+
+			nLength += snprintf(&m_pUdpBuffer[nLength], static_cast<size_t>(udp::BUFFER_SIZE - nLength), "%s,%u,%u,%u", h3_latency_get_name(static_cast<h3_latency_stage>(i)), static_cast<unsigned int>(histogram.count), static_cast<unsigned int>(nAverage), static_cast<unsigned int>(histogram.max_us));
+
+			for (uint32_t nBucket = 0; nBucket < H3_LATENCY_BUCKETS; nBucket++) {
+				nLength += snprintf(&m_pUdpBuffer[nLength], static_cast<size_t>(udp::BUFFER_SIZE - nLength), ",%u", static_cast<unsigned int>(histogram.bucket[nBucket]));
+			}
+
+			nLength += snprintf(&m_pUdpBuffer[nLength], static_cast<size_t>(udp::BUFFER_SIZE - nLength), "\n");
+		}
+
+		Network::Get()->SendTo(m_nHandle, m_pUdpBuffer, static_cast<uint16_t>(nLength), m_nIPAddressFrom, udp::PORT);
+	} else if (m_nBytesReceived == udp::cmd::get::length::LATENCY + 3) {
+		if (memcmp(&m_pUdpBuffer[udp::cmd::get::length::LATENCY], "bin", 3) == 0) {
+			Network::Get()->SendTo(m_nHandle, histograms, sizeof(histograms), m_nIPAddressFrom, udp::PORT);
+		}
+	}
+
+	DEBUG_EXIT
+}
+
+/**
+ * !latency#reset clears the histograms
+ */
+void RemoteConfig::HandleLatencySet() {
+	DEBUG_ENTRY
+
+	if ((m_nBytesReceived == udp::cmd::set::length::LATENCY + 5) && (memcmp(&m_pUdpBuffer[udp::cmd::set::length::LATENCY], "reset", 5) == 0)) {
+		h3_latency_reset();
+	}
+
+	DEBUG_EXIT
+}
+#endif
+
 void RemoteConfig::HandleStoreGet() {
 	DEBUG_ENTRY
 
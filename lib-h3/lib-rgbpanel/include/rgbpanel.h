@@ -29,7 +29,8 @@
 #include "rgbpanelconst.h"
 
 namespace rgbpanel {
-static constexpr auto PWM_WIDTH = 94;
+static constexpr uint32_t BCM_BITS = 10;		///< Bitplanes per colour, the 8-bit input is gamma corrected to this depth
+static constexpr uint32_t BCM_LSB_CLOCKS = 1;	///< On time of the least significant bitplane, in column clock periods
 }  // namespace rgbpanel
 
 class RgbPanel {
@@ -43,6 +44,11 @@ public:
 	void Stop();
 
 	void SetPixel(uint32_t nColumn, uint32_t nRow, uint8_t nRed, uint8_t nGreen, uint8_t nBlue);
+	/**
+	 * Bulk update, 3 bytes (R, G, B) per pixel. For SetFrame, nStride is the number of bytes from one row to the next.
+	 */
+	void SetFrame(const uint8_t *pRGB, uint32_t nStride);
+	void SetRow(uint32_t nRow, const uint8_t *pRGB);
 	void Cls();
 	void Show();
 
@@ -29,6 +29,7 @@
 #include <algorithm>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "rgbpanel.h"
 
@@ -74,12 +75,53 @@ static volatile uint32_t s_nUpdatesCounter;
 //
 static uint32_t *s_pFramebuffer1 ;
 static uint32_t *s_pFramebuffer2 ;
-static uint8_t *s_pTablePWM ;
 //
 static bool s_bIsCoreRunning;
 
 using namespace rgbpanel;
 
+/**
+ * Gamma 2.2, 8-bit input to BCM_BITS output
+ */
+static constexpr uint16_t s_Gamma[256] = {
+	   0,    0,    0,    0,    0,    0,    0,    0,    1,    1,    1,    1,    1,    1,    2,    2,
+	   2,    3,    3,    3,    4,    4,    5,    5,    6,    6,    7,    7,    8,    9,    9,   10,
+	  11,   11,   12,   13,   14,   15,   16,   16,   17,   18,   19,   20,   21,   23,   24,   25,
+	  26,   27,   28,   30,   31,   32,   34,   35,   36,   38,   39,   41,   42,   44,   46,   47,
+	  49,   51,   52,   54,   56,   58,   60,   61,   63,   65,   67,   69,   71,   73,   76,   78,
+	  80,   82,   84,   87,   89,   91,   94,   96,   98,  101,  103,  106,  109,  111,  114,  117,
+	 119,  122,  125,  128,  130,  133,  136,  139,  142,  145,  148,  151,  155,  158,  161,  164,
+	 167,  171,  174,  177,  181,  184,  188,  191,  195,  198,  202,  206,  209,  213,  217,  221,
+	 225,  228,  232,  236,  240,  244,  248,  252,  257,  261,  265,  269,  274,  278,  282,  287,
+	 291,  295,  300,  304,  309,  314,  318,  323,  328,  333,  337,  342,  347,  352,  357,  362,
+	 367,  372,  377,  382,  387,  393,  398,  403,  408,  414,  419,  425,  430,  436,  441,  447,
+	 452,  458,  464,  470,  475,  481,  487,  493,  499,  505,  511,  517,  523,  529,  535,  542,
+	 548,  554,  561,  567,  573,  580,  586,  593,  599,  606,  613,  619,  626,  633,  640,  647,
+	 653,  660,  667,  674,  681,  689,  696,  703,  710,  717,  725,  732,  739,  747,  754,  762,
+	 769,  777,  784,  792,  800,  807,  815,  823,  831,  839,  847,  855,  863,  871,  879,  887,
+	 895,  903,  912,  920,  928,  937,  945,  954,  962,  971,  979,  988,  997, 1005, 1014, 1023
+};
+
+static_assert(BCM_BITS == 10, "s_Gamma is for 10 bitplanes");
+
+/*
+ * The GCC vector extensions compile to NEON with -mfpu=neon-vfpv4 (Cortex-A7).
+ */
+#if defined (__ARM_NEON__) || defined (__ARM_NEON) || defined (__SSE2__)
+# define RGBPANEL_VECTOR
+typedef uint32_t v4u32 __attribute__((vector_size(16)));
+static constexpr uint32_t VECTOR_LANES = sizeof(v4u32) / sizeof(uint32_t);
+#endif
+
+static constexpr uint32_t SHIFT_R1 = HUB75B_R1;
+static constexpr uint32_t SHIFT_G1 = HUB75B_G1;
+static constexpr uint32_t SHIFT_B1 = HUB75B_B1;
+static constexpr uint32_t SHIFT_R2 = HUB75B_R2;
+static constexpr uint32_t SHIFT_G2 = HUB75B_G2;
+static constexpr uint32_t SHIFT_B2 = HUB75B_B2;
+static constexpr uint32_t MASK_UPPER = (1U << SHIFT_R1) | (1U << SHIFT_G1) | (1U << SHIFT_B1);
+static constexpr uint32_t MASK_LOWER = (1U << SHIFT_R2) | (1U << SHIFT_G2) | (1U << SHIFT_B2);
+
 void RgbPanel::PlatformInit() {
 	h3_cpu_off(H3_CPU2);
 	h3_cpu_off(H3_CPU3);
@@ -127,7 +169,11 @@ void RgbPanel::PlatformInit() {
 	h3_gpio_clr(HUB75B_G2);
 	h3_gpio_clr(HUB75B_B2);
 
-	s_nBufferSize = m_nColumns * m_nRows * PWM_WIDTH;
+	/*
+	 * Binary Code Modulation: for each row pair there is one bitplane per bit,
+	 * each bitplane holds one GPIO word per column.
+	 */
+	s_nBufferSize = m_nColumns * (m_nRows / 2) * BCM_BITS;
 	DEBUG_PRINTF("nBufferSize=%u", s_nBufferSize);
 
 	s_pFramebuffer1 = new uint32_t[s_nBufferSize];
@@ -142,19 +188,11 @@ void RgbPanel::PlatformInit() {
 		s_pFramebuffer1[i] = 0;
 		s_pFramebuffer2[i] = 0;
 	}
-
-	s_pTablePWM = new uint8_t[256];
-	assert(s_pTablePWM != nullptr);
-
-	for (uint32_t i = 0; i < 256; i++) {
-		s_pTablePWM[i] = (i * PWM_WIDTH) / 255;
-	}
 }
 
 void RgbPanel::PlatformCleanUp() {
 	delete[] s_pFramebuffer1;
 	delete[] s_pFramebuffer2;
-	delete[] s_pTablePWM;
 }
 
 void RgbPanel::Start() {
@@ -230,60 +268,144 @@ uint32_t RgbPanel::GetUpdatesCounter() {
 	return s_nUpdatesCounter;
 }
 
+/**
+ * The gamma correction is applied here, when the bitplanes are built.
+ */
 void RgbPanel::SetPixel(uint32_t nColumn, uint32_t nRow, uint8_t nRed, uint8_t nGreen, uint8_t nBlue) {
 	if (__builtin_expect(((nColumn >= m_nColumns) || (nRow >= m_nRows)), 0)) {
 		return;
 	}
 
+	uint32_t nMask, nShiftRed, nShiftGreen, nShiftBlue;
+
 	if (nRow < (m_nRows / 2)) {
-		const uint32_t nBaseIndex = (nRow * m_nColumns * PWM_WIDTH) + nColumn;
+		nMask = (1U << HUB75B_R1) | (1U << HUB75B_G1) | (1U << HUB75B_B1);
+		nShiftRed = HUB75B_R1;
+		nShiftGreen = HUB75B_G1;
+		nShiftBlue = HUB75B_B1;
+	} else {
+		nRow -= (m_nRows / 2);
+		nMask = (1U << HUB75B_R2) | (1U << HUB75B_G2) | (1U << HUB75B_B2);
+		nShiftRed = HUB75B_R2;
+		nShiftGreen = HUB75B_G2;
+		nShiftBlue = HUB75B_B2;
+	}
 
-		for (uint32_t nPWM = 0; nPWM < PWM_WIDTH; nPWM++) {
+	const uint32_t nGammaRed = s_Gamma[nRed];
+	const uint32_t nGammaGreen = s_Gamma[nGreen];
+	const uint32_t nGammaBlue = s_Gamma[nBlue];
 
-			const uint32_t nIndex = nBaseIndex + (nPWM * m_nColumns);
+	auto *pPlane = &s_pFramebuffer1[(nRow * m_nColumns * BCM_BITS) + nColumn];
 
-			uint32_t nValue = s_pFramebuffer1[nIndex];
+	for (uint32_t nBit = 0; nBit < BCM_BITS; nBit++) {
+		uint32_t nValue = *pPlane & ~nMask;
 
-			nValue &= ~((1U << HUB75B_R1) | (1U << HUB75B_G1) | (1U << HUB75B_B1));
+		nValue |= ((nGammaRed >> nBit) & 0x1) << nShiftRed;
+		nValue |= ((nGammaGreen >> nBit) & 0x1) << nShiftGreen;
+		nValue |= ((nGammaBlue >> nBit) & 0x1) << nShiftBlue;
 
-			if (s_pTablePWM[nRed] > nPWM) {
-				nValue |= (1U << HUB75B_R1);
-			}
+		*pPlane = nValue;
+		pPlane += m_nColumns;
+	}
+}
 
-			if (s_pTablePWM[nGreen] > nPWM) {
-				nValue |= (1U << HUB75B_G1);
+/**
+ * Builds all the bitplanes of a row pair in one pass, the upper and lower half row are written together.
+ * When pUpper or pLower is nullptr, the bits of that half are kept.
+ */
+static void SetRowPair(uint32_t *pPlanes, const uint8_t *pUpper, const uint8_t *pLower) {
+	const auto nColumns = s_nColumns;
+	const uint32_t nKeepMask = (pUpper == nullptr ? MASK_UPPER : 0) | (pLower == nullptr ? MASK_LOWER : 0);
+	uint32_t nColumn = 0;
+
+#if defined (RGBPANEL_VECTOR)
+	for (; (nColumn + VECTOR_LANES) <= nColumns; nColumn += VECTOR_LANES) {
+		v4u32 vR1 = {}, vG1 = {}, vB1 = {}, vR2 = {}, vG2 = {}, vB2 = {};
+
+		for (uint32_t i = 0; i < VECTOR_LANES; i++) {
+			if (pUpper != nullptr) {
+				const auto *p = &pUpper[(nColumn + i) * 3];
+				vR1[i] = s_Gamma[p[0]];
+				vG1[i] = s_Gamma[p[1]];
+				vB1[i] = s_Gamma[p[2]];
+			}
+			if (pLower != nullptr) {
+				const auto *p = &pLower[(nColumn + i) * 3];
+				vR2[i] = s_Gamma[p[0]];
+				vG2[i] = s_Gamma[p[1]];
+				vB2[i] = s_Gamma[p[2]];
 			}
+		}
+
+		auto *pPlane = &pPlanes[nColumn];
 
-			if (s_pTablePWM[nBlue] > nPWM) {
-				nValue |= (1U << HUB75B_B1);
+		for (uint32_t nBit = 0; nBit < BCM_BITS; nBit++) {
+			v4u32 vWord = (((vR1 >> nBit) & 1U) << SHIFT_R1) | (((vG1 >> nBit) & 1U) << SHIFT_G1) | (((vB1 >> nBit) & 1U) << SHIFT_B1)
+						| (((vR2 >> nBit) & 1U) << SHIFT_R2) | (((vG2 >> nBit) & 1U) << SHIFT_G2) | (((vB2 >> nBit) & 1U) << SHIFT_B2);
+
+			if (nKeepMask != 0) {
+				v4u32 vPlane;
+				memcpy(&vPlane, pPlane, sizeof(v4u32));
+				vWord |= vPlane & nKeepMask;
 			}
 
-			s_pFramebuffer1[nIndex] = nValue;
+			memcpy(pPlane, &vWord, sizeof(v4u32));
+			pPlane += nColumns;
 		}
-	} else {
-		const uint32_t nBaseIndex = ((nRow - (m_nRows / 2)) * m_nColumns * PWM_WIDTH) + nColumn;
+	}
+#endif
+
+	for (; nColumn < nColumns; nColumn++) {
+		uint32_t nR1 = 0, nG1 = 0, nB1 = 0, nR2 = 0, nG2 = 0, nB2 = 0;
 
-		for (uint32_t nPWM = 0; nPWM < PWM_WIDTH; nPWM++) {
+		if (pUpper != nullptr) {
+			const auto *p = &pUpper[nColumn * 3];
+			nR1 = s_Gamma[p[0]];
+			nG1 = s_Gamma[p[1]];
+			nB1 = s_Gamma[p[2]];
+		}
+		if (pLower != nullptr) {
+			const auto *p = &pLower[nColumn * 3];
+			nR2 = s_Gamma[p[0]];
+			nG2 = s_Gamma[p[1]];
+			nB2 = s_Gamma[p[2]];
+		}
 
-			const uint32_t nIndex = nBaseIndex + (nPWM * m_nColumns);
+		auto *pPlane = &pPlanes[nColumn];
 
-			uint32_t nValue = s_pFramebuffer1[nIndex];
-			nValue &= ~((1U << HUB75B_R2) | (1U << HUB75B_G2) | (1U << HUB75B_B2));
+		for (uint32_t nBit = 0; nBit < BCM_BITS; nBit++) {
+			*pPlane = (*pPlane & nKeepMask)
+					| (((nR1 >> nBit) & 1U) << SHIFT_R1) | (((nG1 >> nBit) & 1U) << SHIFT_G1) | (((nB1 >> nBit) & 1U) << SHIFT_B1)
+					| (((nR2 >> nBit) & 1U) << SHIFT_R2) | (((nG2 >> nBit) & 1U) << SHIFT_G2) | (((nB2 >> nBit) & 1U) << SHIFT_B2);
+			pPlane += nColumns;
+		}
+	}
+}
 
-			if (s_pTablePWM[nRed] > nPWM) {
-				nValue |= (1U << HUB75B_R2);
-			}
+void RgbPanel::SetFrame(const uint8_t *pRGB, uint32_t nStride) {
+	assert(pRGB != nullptr);
+	assert(nStride >= (m_nColumns * 3));
 
-			if (s_pTablePWM[nGreen] > nPWM) {
-				nValue |= (1U << HUB75B_G2);
-			}
+	const auto nHalf = m_nRows / 2;
 
-			if (s_pTablePWM[nBlue] > nPWM) {
-				nValue |= (1U << HUB75B_B2);
-			}
+	for (uint32_t nRow = 0; nRow < nHalf; nRow++) {
+		SetRowPair(&s_pFramebuffer1[nRow * m_nColumns * BCM_BITS], &pRGB[nRow * nStride], &pRGB[(nRow + nHalf) * nStride]);
+	}
+}
 
-			s_pFramebuffer1[nIndex] = nValue;
-		}
+void RgbPanel::SetRow(uint32_t nRow, const uint8_t *pRGB) {
+	assert(pRGB != nullptr);
+
+	if (__builtin_expect((nRow >= m_nRows), 0)) {
+		return;
+	}
+
+	const auto nHalf = m_nRows / 2;
+
+	if (nRow < nHalf) {
+		SetRowPair(&s_pFramebuffer1[nRow * m_nColumns * BCM_BITS], pRGB, nullptr);
+	} else {
+		SetRowPair(&s_pFramebuffer1[(nRow - nHalf) * m_nColumns * BCM_BITS], nullptr, pRGB);
 	}
 }
 
@@ -296,37 +418,54 @@ void RgbPanel::Show() {
 	s_nShowCounter++;
 }
 
+/**
+ * Each row is shifted in once per bitplane. Bitplane n is displayed for (BCM_LSB_CLOCKS << n) column clock periods,
+ * the display is kept on while the next bitplane is shifted in, and blanked when its on time has elapsed.
+ * The GPIO writes are the time base, no timer is needed.
+ */
 void core1_task() {
-	const uint32_t nMultiplier = s_nColumns * PWM_WIDTH;
+	const uint32_t nRowSize = s_nColumns * BCM_BITS;
 
 	uint32_t nGPIO = H3_PIO_PORTA->DAT & ~((1U << HUB75B_R1) | (1U << HUB75B_G1) | (1U << HUB75B_B1) | (1U << HUB75B_R2) | (1U << HUB75B_G2) | (1U << HUB75B_B2));
+	nGPIO |= (1U << HUB75B_OE);
+
+	uint32_t nOnTime = 0;
 
 	for (;;) {
 		for (uint32_t nRow = 0; nRow < (s_nRows / 2); nRow++) {
 
-			const uint32_t nBaseIndex = nRow * nMultiplier;
-
-			for (uint32_t nPWM = 0; nPWM < PWM_WIDTH; nPWM++) {
+			const uint32_t *pPlane = &s_pFramebuffer2[nRow * nRowSize];
 
-				uint32_t nIndex = nBaseIndex + (nPWM * s_nColumns);
+			for (uint32_t nBit = 0; nBit < BCM_BITS; nBit++) {
 
-				/* Shift in next data */
+				/* Shift in next data, the previous bitplane is displayed */
 				for (uint32_t i = 0; i < s_nColumns; i++) {
-					const uint32_t nValue = s_pFramebuffer2[nIndex++];
+					const uint32_t nValue = *pPlane++;
 					// Clock high with data
 					H3_PIO_PORTA->DAT = nGPIO | (1U << HUB75B_CK) | nValue;
 					// Clock low
 					H3_PIO_PORTA->DAT = nGPIO | nValue;
+
+					if ((nOnTime != 0) && (--nOnTime == 0)) {
+						nGPIO |= (1U << HUB75B_OE);
+					}
 				}
 
-				/* Blank the display */
-				H3_PIO_PORTA->DAT = nGPIO | (1U << HUB75B_OE);
+				/* Remaining on time of the previous bitplane */
+				while (nOnTime != 0) {
+					H3_PIO_PORTA->DAT = nGPIO;
+					H3_PIO_PORTA->DAT = nGPIO;
+					nOnTime--;
+				}
 
-				/* Latch the previous data */
-				H3_PIO_PORTA->DAT = nGPIO | (1U << HUB75B_LA) | (1U << HUB75B_OE);
+				/* Blank the display */
 				nGPIO |= (1U << HUB75B_OE);
 				H3_PIO_PORTA->DAT = nGPIO;
 
+				/* Latch the data */
+				H3_PIO_PORTA->DAT = nGPIO | (1U << HUB75B_LA);
+				H3_PIO_PORTA->DAT = nGPIO;
+
 				/* Update the row select */
 				nGPIO &= ~(0xFU);
 				nGPIO |= nRow;
@@ -335,6 +474,8 @@ void core1_task() {
 				/* Enable the display */
 				nGPIO &= ~(1U << HUB75B_OE);
 				H3_PIO_PORTA->DAT = nGPIO;
+
+				nOnTime = BCM_LSB_CLOCKS << nBit;
 			}
 		}
 
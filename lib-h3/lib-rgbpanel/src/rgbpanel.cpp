@@ -223,4 +223,5 @@ void RgbPanel::Stop() {
 void RgbPanel::Print() {
 	printf("RGB led panel\n");
 	printf(" %ux%ux%u\n", m_nColumns, m_nRows, m_nChain);
+	printf(" BCM %u-bit\n", static_cast<unsigned int>(BCM_BITS));
 }
@@ -0,0 +1,188 @@
+/**
+ * @file setframe.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Builds the H3 RgbPanel (src/h3/rgbpanel.cpp) on the host, with port A in
+ * memory. Checks that SetFrame and SetRow give the same bitplanes as SetPixel
+ * and measures the three for 64x32 panels, 4 in a chain.
+ * The H3 backend shifts out all the columns of a chain per row, so a chain of
+ * 4 panels is 256 columns.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "h3.h"
+#include "arm/synchronize.h"
+
+static H3_PIO_TypeDef s_PioPortA;
+
+#undef H3_PIO_PORTA
+#define H3_PIO_PORTA (&s_PioPortA)
+
+#undef dmb
+#define dmb() __sync_synchronize()
+
+#include "h3/rgbpanel.cpp"
+
+extern "C" {
+void h3_gpio_fsel(__attribute__((unused)) uint32_t gpio, __attribute__((unused)) uint32_t fsel) {}
+void h3_cpu_off(__attribute__((unused)) h3_cpu_t cpu) {}
+void smp_start_core(__attribute__((unused)) uint32_t core, __attribute__((unused)) start_fn_t fn) {}
+void h3_spi_end(void) {}
+void h3_i2c_end(void) {}
+}
+
+namespace bench {
+static constexpr uint32_t PANEL_COLUMNS = 64;
+static constexpr uint32_t PANEL_ROWS = 32;
+static constexpr uint32_t CHAIN = 4;
+static constexpr uint32_t MAX_COLUMNS = PANEL_COLUMNS * CHAIN + 8;
+static constexpr uint32_t PADDING = 5;	///< The stride is not a multiple of 4
+static constexpr uint32_t STRIDE = MAX_COLUMNS * 3 + PADDING;
+static constexpr uint32_t FRAMES = 2000;
+}  // namespace bench
+
+static uint8_t s_RGB[bench::PANEL_ROWS][bench::STRIDE];
+static uint32_t s_Reference[bench::MAX_COLUMNS * (bench::PANEL_ROWS / 2) * BCM_BITS];
+
+static uint64_t now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static void fill() {
+	for (uint32_t nRow = 0; nRow < bench::PANEL_ROWS; nRow++) {
+		for (uint32_t i = 0; i < bench::STRIDE; i++) {
+			s_RGB[nRow][i] = static_cast<uint8_t>(rand());
+		}
+	}
+}
+
+static void set_pixels(RgbPanel& Panel, uint32_t nColumns) {
+	for (uint32_t nRow = 0; nRow < bench::PANEL_ROWS; nRow++) {
+		for (uint32_t nColumn = 0; nColumn < nColumns; nColumn++) {
+			const auto *p = &s_RGB[nRow][nColumn * 3];
+			Panel.SetPixel(nColumn, nRow, p[0], p[1], p[2]);
+		}
+	}
+}
+
+static void set_rows(RgbPanel& Panel) {
+	for (uint32_t nRow = 0; nRow < bench::PANEL_ROWS; nRow++) {
+		Panel.SetRow(nRow, s_RGB[nRow]);
+	}
+}
+
+/*
+ * The widths that are not a multiple of 4 also run the scalar tail.
+ */
+static bool test() {
+	static constexpr uint32_t WIDTHS[] = { 64, 128, 192, 256, 66, 255 };
+
+	for (const auto nColumns : WIDTHS) {
+		RgbPanel Panel(nColumns, bench::PANEL_ROWS);
+		const auto nWords = nColumns * (bench::PANEL_ROWS / 2) * BCM_BITS;
+
+		fill();
+
+		set_pixels(Panel, nColumns);
+		memcpy(s_Reference, s_pFramebuffer1, nWords * sizeof(uint32_t));
+
+		Panel.Cls();
+		Panel.SetFrame(&s_RGB[0][0], bench::STRIDE);
+
+		if (memcmp(s_Reference, s_pFramebuffer1, nWords * sizeof(uint32_t)) != 0) {
+			printf("FAIL: SetFrame %u columns\n", nColumns);
+			return false;
+		}
+
+		// Over a previous frame, the other half of each row pair is kept
+		memset(s_pFramebuffer1, 0xFF, nWords * sizeof(uint32_t));
+
+		for (uint32_t nRow = 0; nRow < bench::PANEL_ROWS / 2; nRow++) {
+			Panel.SetRow(nRow, s_RGB[nRow]);
+		}
+
+		for (uint32_t i = 0; i < nWords; i++) {
+			if (s_pFramebuffer1[i] != ((s_Reference[i] & MASK_UPPER) | MASK_LOWER)) {
+				printf("FAIL: SetRow upper half %u columns\n", nColumns);
+				return false;
+			}
+		}
+
+		for (uint32_t nRow = bench::PANEL_ROWS / 2; nRow < bench::PANEL_ROWS; nRow++) {
+			Panel.SetRow(nRow, s_RGB[nRow]);
+		}
+
+		if (memcmp(s_Reference, s_pFramebuffer1, nWords * sizeof(uint32_t)) != 0) {
+			printf("FAIL: SetRow %u columns\n", nColumns);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template<typename F>
+static double measure(F Function) {
+	const auto nStart = now_ns();
+
+	for (uint32_t i = 0; i < bench::FRAMES; i++) {
+		Function();
+	}
+
+	return static_cast<double>(now_ns() - nStart) / (1000.0 * bench::FRAMES);
+}
+
+int main() {
+	srand(1);
+
+	if (!test()) {
+		puts("FAIL");
+		return 1;
+	}
+
+	const auto nColumns = bench::PANEL_COLUMNS * bench::CHAIN;
+	RgbPanel Panel(nColumns, bench::PANEL_ROWS, bench::CHAIN);
+
+	fill();
+
+	const auto fSetPixel = measure([&] { set_pixels(Panel, nColumns); });
+	const auto fSetFrame = measure([&] { Panel.SetFrame(&s_RGB[0][0], bench::STRIDE); });
+	const auto fSetRow = measure([&] { set_rows(Panel); });
+
+	printf("%ux%u x %u chain  us/frame\n", bench::PANEL_COLUMNS, bench::PANEL_ROWS, bench::CHAIN);
+	printf("SetPixel        %8.1f\n", fSetPixel);
+	printf("SetFrame        %8.1f\n", fSetFrame);
+	printf("SetRow          %8.1f\n", fSetRow);
+
+	puts("PASS");
+	return 0;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file showfileconvert.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include "showfilebinaryconverter.h"
+
+int main(int argc, char **argv) {
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <OLA show file> <binary show file>\n", argv[0]);
+		return 1;
+	}
+
+	auto *pOlaFile = fopen(argv[1], "r");
+
+	if (pOlaFile == nullptr) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	auto *pBinaryFile = fopen(argv[2], "w+b");
+
+	if (pBinaryFile == nullptr) {
+		perror(argv[2]);
+		fclose(pOlaFile);
+		return 1;
+	}
+
+	ShowFileBinaryConverter converter;
+
+	const auto isConverted = converter.FromOla(pOlaFile, pBinaryFile);
+
+	fclose(pBinaryFile);
+	fclose(pOlaFile);
+
+	if (!isConverted) {
+		fprintf(stderr, "Conversion of %s failed\n", argv[1]);
+		remove(argv[2]);
+		return 1;
+	}
+
+	converter.Print();
+
+	return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file binaryshowfile.h
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef BINARYSHOWFILE_H_
+#define BINARYSHOWFILE_H_
+
+#include <stdint.h>
+
+#include "showfile.h"
+#include "showfilebinary.h"
+
+class BinaryShowFile final: public ShowFile {
+public:
+	BinaryShowFile();
+	~BinaryShowFile() override;
+
+	void ShowFileStart() override;
+	void ShowFileStop() override;
+	void ShowFileResume() override;
+	void ShowFileRun() override;
+	void ShowFilePrint() override;
+
+	/**
+	 * Continue the show from the frame at nMillis, O(log n) on the index.
+	 * The next frame outputs all the universes.
+	 */
+	bool Seek(uint32_t nMillis);
+
+	/**
+	 * @return Show time of the next frame
+	 */
+	uint32_t GetMillis() const {
+		return m_nShowMillis;
+	}
+
+private:
+	enum class State {
+		IDLE,
+		PLAYING,
+		TIME_WAITING
+	};
+
+	static constexpr uint32_t BUFFER_SIZE = 131072;	///< Read in large sequential chunks
+	static_assert(BUFFER_SIZE >= showfilebinary::MAX_RECORD_LENGTH, "BUFFER_SIZE");
+
+	bool ReadHeader();
+	bool SetPosition(uint32_t nOffset, uint32_t nMillis);
+	bool Fill(uint32_t nNeeded);
+	const uint8_t *GetNextRecord();
+	bool ApplyRecord(const uint8_t *pRecord);
+	void OutputRecord(const uint8_t *pRecord);
+	void SyncFrame();
+
+private:
+	showfilebinary::Header m_Header;
+	bool m_bHeaderValid{false};
+	State m_tState{State::IDLE};
+	uint8_t *m_pBuffer{nullptr};
+	uint32_t m_nBufferHead{0};
+	uint32_t m_nBufferTail{0};
+	uint32_t m_nFileOffset{0};	///< File position of m_pBuffer[m_nBufferTail]
+	uint8_t *m_pDmxData{nullptr};
+	uint16_t m_nDmxDataLength[showfilebinary::MAX_UNIVERSES];
+	uint32_t m_nShowMillis{0};
+	uint32_t m_nOutputMaskWords{0};
+	bool m_bOutputAll{false};	///< After a seek, the receivers get the complete state
+	bool m_bSyncPending{false};	///< Universes have been output since the last sync
+	uint32_t m_nDelayMillis{0};
+	uint32_t m_nLastMillis{0};
+};
+
+#endif /* BINARYSHOWFILE_H_ */
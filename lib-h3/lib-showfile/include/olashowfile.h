@@ -60,6 +60,7 @@ private:
 	OlaParseCode GetNextLine();
 	OlaParseCode ParseLine(const char *pLine);
 	OlaParseCode ParseDmxData(const char *pLine);
+	void SyncFrame();
 
 private:
 	OlaParseCode m_tParseCode{OlaParseCode::FAILED};
@@ -70,6 +71,7 @@ private:
 	uint32_t m_nUniverse{0};
 	uint8_t m_DmxData[512];
 	uint32_t m_nDmxDataLength{0};
+	bool m_bSyncPending{false};	///< Universes have been output since the last sync
 };
 
 #endif /* OLASHOWFILE_H_ */
@@ -37,7 +37,7 @@ enum class ShowFileStatus : unsigned {
 };
 
 enum class ShowFileFormats : unsigned {
-	OLA, DUMMY, UNDEFINED
+	OLA, DUMMY, BINARY, UNDEFINED
 };
 
 enum class ShowFileProtocols : unsigned {
@@ -0,0 +1,99 @@
+/**
+ * @file showfilebinary.h
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SHOWFILEBINARY_H_
+#define SHOWFILEBINARY_H_
+
+#include <stdint.h>
+
+/**
+ * Binary show file format, all fields are little endian.
+ *
+ * Header | Universe table | Frame records ... | Index
+ *
+ * A frame record holds all the universes output at the same moment, followed by a DmxSync.
+ * A wait longer than 65535 ms is continued with empty frames.
+ * The universe data is either a full copy (key) or the changes against the previous frame (delta).
+ * Every KEYFRAME_INTERVAL frames all universes are written as key, these frames are in the index.
+ * The index is sorted on time, so a seek is a binary search followed by a sequential read.
+ */
+namespace showfilebinary {
+static constexpr char MAGIC[4] = { 'S', 'H', 'O', 'W' };
+static constexpr uint16_t VERSION = 2;
+static constexpr uint32_t MAX_UNIVERSES = 128;	///< The universe index of a block is an uint8_t
+static constexpr uint32_t DMX_MAX_LENGTH = 512;
+static constexpr uint32_t KEYFRAME_INTERVAL = 64;
+
+struct Header {
+	char Magic[4];
+	uint16_t nVersion;
+	uint16_t nUniverses;
+	uint32_t nFrames;
+	uint32_t nDurationMillis;
+	uint32_t nDataOffset;
+	uint32_t nIndexOffset;
+	uint32_t nIndexEntries;
+	uint32_t nReserved;
+	uint16_t Universe[MAX_UNIVERSES];
+}__attribute__((packed));
+
+/**
+ * Followed by the output mask, nOutputMaskWords uint32_t. Bit n is universe table index n.
+ */
+struct FrameHeader {
+	uint32_t nRecordLength;		///< Including this header and the output mask
+	uint16_t nDelayMillis;		///< Wait time after the frame is output
+	uint16_t nOutputMaskWords;	///< GetOutputMaskWords(nUniverses)
+}__attribute__((packed));
+
+inline uint32_t GetOutputMaskWords(uint32_t nUniverses) {
+	return (nUniverses + 31) / 32;
+}
+
+enum class BlockType : uint8_t {
+	KEY, DELTA
+};
+
+/**
+ * KEY: nLength bytes DMX data.
+ * DELTA: nLength bytes of runs {uint8_t nSkip, uint8_t nCount, uint8_t data[nCount]}.
+ * Universes in the output mask without a block are unchanged.
+ */
+struct BlockHeader {
+	uint8_t nUniverseIndex;
+	BlockType tType;
+	uint16_t nLength;
+}__attribute__((packed));
+
+struct IndexEntry {
+	uint32_t nMillis;
+	uint32_t nOffset;
+}__attribute__((packed));
+
+static constexpr uint32_t MAX_OUTPUT_MASK_WORDS = (MAX_UNIVERSES + 31) / 32;
+static constexpr uint32_t MAX_RECORD_LENGTH = sizeof(FrameHeader) + MAX_OUTPUT_MASK_WORDS * sizeof(uint32_t) + MAX_UNIVERSES * (sizeof(BlockHeader) + DMX_MAX_LENGTH);
+}  // namespace showfilebinary
+
+#endif /* SHOWFILEBINARY_H_ */
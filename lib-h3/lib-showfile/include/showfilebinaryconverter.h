@@ -0,0 +1,72 @@
+/**
+ * @file showfilebinaryconverter.h
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SHOWFILEBINARYCONVERTER_H_
+#define SHOWFILEBINARYCONVERTER_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "showfilebinary.h"
+
+/**
+ * Converts an OLA recording (text) into the binary show file format.
+ * Both files must be seekable, the input is read twice.
+ */
+class ShowFileBinaryConverter {
+public:
+	ShowFileBinaryConverter();
+	~ShowFileBinaryConverter();
+
+	bool FromOla(FILE *pOlaFile, FILE *pBinaryFile);
+
+	void Print();
+
+private:
+	bool CollectUniverses(FILE *pOlaFile);
+	bool ParseDmxLine(uint16_t nUniverse, const char *pLine, uint32_t& nIndex, uint16_t& nLength);
+	int32_t GetUniverseIndex(uint16_t nUniverse) const;
+	bool WriteFrame(FILE *pBinaryFile, uint16_t nDelayMillis);
+	bool WriteDelay(FILE *pBinaryFile, uint32_t nDelayMillis);
+	bool HasOutput() const;
+	uint32_t EncodeDelta(uint32_t nIndex, uint8_t *pOut) const;
+	bool AddIndexEntry(uint32_t nMillis, uint32_t nOffset);
+
+private:
+	showfilebinary::Header m_Header;
+	char m_aLine[2048];
+	uint8_t *m_pRecord{nullptr};
+	uint8_t *m_pData{nullptr};		///< Data of the frame being built
+	uint8_t *m_pPrevious{nullptr};	///< Data as known by the player
+	uint16_t m_nLength[showfilebinary::MAX_UNIVERSES];
+	uint16_t m_nPreviousLength[showfilebinary::MAX_UNIVERSES];
+	uint32_t m_nOutputMask[showfilebinary::MAX_OUTPUT_MASK_WORDS];
+	uint32_t m_nOffset{0};
+	showfilebinary::IndexEntry *m_pIndex{nullptr};
+	uint32_t m_nIndexSize{0};
+	uint32_t m_nBytesIn{0};
+};
+
+#endif /* SHOWFILEBINARYCONVERTER_H_ */
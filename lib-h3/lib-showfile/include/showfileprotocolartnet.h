@@ -56,14 +56,15 @@ public:
 	}
 
 	void DmxOut(uint16_t nUniverse, const uint8_t *pDmxData, uint16_t nLength) override {
-		m_ArtNetController.HandleDmxOut(nUniverse, pDmxData, nLength);
+		m_ArtNetController.AddUniverse(nUniverse, pDmxData, nLength);
 	}
 
 	void DmxSync() override {
-		m_ArtNetController.HandleSync();
+		m_ArtNetController.CommitFrame();
 	}
 
 	void DmxBlackout() override {
+		m_ArtNetController.BeginFrame();
 		m_ArtNetController.HandleBlackout();
 	}
 
@@ -54,14 +54,15 @@ public:
 	}
 
 	void DmxOut(uint16_t nUniverse, const uint8_t *pDmxData, uint16_t nLength) {
-		m_E131Controller.HandleDmxOut(nUniverse, pDmxData, nLength);
+		m_E131Controller.AddUniverse(nUniverse, pDmxData, nLength);
 	}
 
 	void DmxSync() {
-		m_E131Controller.HandleSync();
+		m_E131Controller.CommitFrame();
 	}
 
 	void DmxBlackout() {
+		m_E131Controller.BeginFrame();
 		m_E131Controller.HandleBlackout();
 	}
 
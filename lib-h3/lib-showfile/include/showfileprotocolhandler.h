@@ -33,6 +33,9 @@ public:
 	virtual ~ShowFileProtocolHandler() {
 	}
 
+	/**
+	 * The universes output with DmxOut can be held back until DmxSync, which ends the frame.
+	 */
 	virtual void DmxOut(uint16_t nUniverse, const uint8_t *pDmxData, uint16_t nLength)=0;
 	virtual void DmxSync()=0;
 	virtual void DmxBlackout()=0;
@@ -0,0 +1,392 @@
+/**
+ * @file binaryshowfile.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <cassert>
+
+#include "binaryshowfile.h"
+#include "showfile.h"
+#include "showfilebinary.h"
+
+#include "hardware.h"
+
+#include "debug.h"
+
+using namespace showfilebinary;
+
+BinaryShowFile::BinaryShowFile() {
+	DEBUG1_ENTRY
+
+	m_pBuffer = new uint8_t[BUFFER_SIZE];
+	assert(m_pBuffer != nullptr);
+
+	m_pDmxData = new uint8_t[MAX_UNIVERSES * DMX_MAX_LENGTH];
+	assert(m_pDmxData != nullptr);
+
+	memset(&m_Header, 0, sizeof(m_Header));
+	memset(m_nDmxDataLength, 0, sizeof(m_nDmxDataLength));
+
+	DEBUG1_EXIT
+}
+
+BinaryShowFile::~BinaryShowFile() {
+	delete[] m_pDmxData;
+	delete[] m_pBuffer;
+}
+
+void BinaryShowFile::ShowFileStart() {
+	DEBUG1_ENTRY
+
+	m_nDelayMillis = 0;
+	m_nLastMillis = 0;
+	m_tState = State::IDLE;
+
+	m_bHeaderValid = ReadHeader() && SetPosition(m_Header.nDataOffset, 0);
+
+	DEBUG1_EXIT
+}
+
+void BinaryShowFile::ShowFileStop() {
+	DEBUG1_ENTRY
+
+	SyncFrame();
+
+	DEBUG1_EXIT
+}
+
+/**
+ * The show continues with the frame where it was stopped. The receivers could have lost
+ * the state while stopped, so that frame outputs all the universes.
+ */
+void BinaryShowFile::ShowFileResume() {
+	DEBUG1_ENTRY
+
+	if (!Seek(m_nShowMillis)) {
+		m_bHeaderValid = false;
+	}
+
+	m_nDelayMillis = 0;
+	m_nLastMillis = 0;
+
+	DEBUG1_EXIT
+}
+
+void BinaryShowFile::ShowFileRun() {
+	if (__builtin_expect(!m_bHeaderValid, 0)) {
+		SetShowFileStatus(ShowFileStatus::ENDED);
+		return;
+	}
+
+	if (m_tState != State::TIME_WAITING) {
+		const auto *pRecord = GetNextRecord();
+
+		if (pRecord != nullptr) {
+			if (ApplyRecord(pRecord)) {
+				OutputRecord(pRecord);
+			}
+			m_tState = State::TIME_WAITING;
+		} else if (m_bDoLoop) {
+			SyncFrame();
+			SetPosition(m_Header.nDataOffset, 0);
+		} else {
+			SyncFrame();
+			SetShowFileStatus(ShowFileStatus::ENDED);
+			return;
+		}
+	}
+
+	const auto nMillis = Hardware::Get()->Millis();
+
+	if ((nMillis - m_nLastMillis) >= m_nDelayMillis) {
+		m_nLastMillis = nMillis;
+		m_tState = State::PLAYING;
+	}
+}
+
+void BinaryShowFile::ShowFilePrint() {
+	puts("BinaryShowFile");
+
+	if (m_bHeaderValid) {
+		printf(" Universes : %u\n", m_Header.nUniverses);
+		printf(" Frames    : %u\n", static_cast<unsigned>(m_Header.nFrames));
+		printf(" Duration  : %u ms\n", static_cast<unsigned>(m_Header.nDurationMillis));
+	}
+}
+
+bool BinaryShowFile::Seek(uint32_t nMillis) {
+	DEBUG1_ENTRY
+
+	if (!m_bHeaderValid || (m_Header.nIndexEntries == 0)) {
+		DEBUG1_EXIT
+		return false;
+	}
+
+	// Find the last key frame at or before nMillis
+	uint32_t nLow = 0;
+	uint32_t nHigh = m_Header.nIndexEntries;
+	IndexEntry entry;
+	IndexEntry found = { 0, m_Header.nDataOffset };
+
+	while (nLow < nHigh) {
+		const auto nMiddle = nLow + (nHigh - nLow) / 2;
+
+		if ((fseek(m_pShowFile, static_cast<long>(m_Header.nIndexOffset + nMiddle * sizeof(IndexEntry)), SEEK_SET) != 0)
+				|| (fread(&entry, 1, sizeof(IndexEntry), m_pShowFile) != sizeof(IndexEntry))) {
+			DEBUG1_EXIT
+			return false;
+		}
+
+		if (entry.nMillis <= nMillis) {
+			found = entry;
+			nLow = nMiddle + 1;
+		} else {
+			nHigh = nMiddle;
+		}
+	}
+
+	if (!SetPosition(found.nOffset, found.nMillis)) {
+		DEBUG1_EXIT
+		return false;
+	}
+
+	// Bring the universe data up to date without output
+	for (;;) {
+		if (m_nBufferTail - m_nBufferHead < sizeof(FrameHeader)) {
+			if (!Fill(sizeof(FrameHeader))) {
+				break;
+			}
+		}
+
+		const auto *pFrameHeader = reinterpret_cast<const FrameHeader *>(&m_pBuffer[m_nBufferHead]);
+
+		if (m_nShowMillis + pFrameHeader->nDelayMillis > nMillis) {
+			break;
+		}
+
+		const auto *pRecord = GetNextRecord();
+
+		if ((pRecord == nullptr) || !ApplyRecord(pRecord)) {
+			break;
+		}
+	}
+
+	m_nDelayMillis = 0;
+	m_bOutputAll = true;
+	m_tState = State::PLAYING;
+
+	DEBUG1_EXIT
+	return true;
+}
+
+bool BinaryShowFile::ReadHeader() {
+	if (m_pShowFile == nullptr) {
+		return false;
+	}
+
+	if ((fseek(m_pShowFile, 0L, SEEK_SET) != 0) || (fread(&m_Header, 1, sizeof(Header), m_pShowFile) != sizeof(Header))) {
+		return false;
+	}
+
+	if ((memcmp(m_Header.Magic, MAGIC, sizeof(MAGIC)) != 0) || (m_Header.nVersion != VERSION)) {
+		DEBUG_PUTS("Not a binary show file");
+		return false;
+	}
+
+	if ((m_Header.nUniverses > MAX_UNIVERSES) || (m_Header.nDataOffset < sizeof(Header)) || (m_Header.nIndexOffset < m_Header.nDataOffset)) {
+		DEBUG_PUTS("Invalid header");
+		return false;
+	}
+
+	m_nOutputMaskWords = GetOutputMaskWords(m_Header.nUniverses);
+
+	return true;
+}
+
+/**
+ * Restart reading at nOffset, which must be a key frame
+ */
+bool BinaryShowFile::SetPosition(uint32_t nOffset, uint32_t nMillis) {
+	m_nBufferHead = 0;
+	m_nBufferTail = 0;
+	m_nFileOffset = nOffset;
+	m_nShowMillis = nMillis;
+
+	memset(m_nDmxDataLength, 0, sizeof(m_nDmxDataLength));
+
+	return fseek(m_pShowFile, static_cast<long>(nOffset), SEEK_SET) == 0;
+}
+
+/**
+ * The frame records are read in large sequential chunks, up to the index
+ */
+bool BinaryShowFile::Fill(uint32_t nNeeded) {
+	auto nAvailable = m_nBufferTail - m_nBufferHead;
+
+	if (m_nBufferHead != 0) {
+		memmove(m_pBuffer, &m_pBuffer[m_nBufferHead], nAvailable);
+		m_nBufferHead = 0;
+		m_nBufferTail = nAvailable;
+	}
+
+	auto nRead = BUFFER_SIZE - m_nBufferTail;
+
+	if (nRead > m_Header.nIndexOffset - m_nFileOffset) {
+		nRead = m_Header.nIndexOffset - m_nFileOffset;
+	}
+
+	if (nRead != 0) {
+		const auto nBytes = static_cast<uint32_t>(fread(&m_pBuffer[m_nBufferTail], 1, nRead, m_pShowFile));
+		m_nBufferTail += nBytes;
+		m_nFileOffset += nBytes;
+	}
+
+	return (m_nBufferTail - m_nBufferHead) >= nNeeded;
+}
+
+const uint8_t *BinaryShowFile::GetNextRecord() {
+	if (m_nBufferTail - m_nBufferHead < sizeof(FrameHeader)) {
+		if (!Fill(sizeof(FrameHeader))) {
+			return nullptr;
+		}
+	}
+
+	const auto *pFrameHeader = reinterpret_cast<const FrameHeader *>(&m_pBuffer[m_nBufferHead]);
+	const auto nRecordLength = pFrameHeader->nRecordLength;
+
+	if (__builtin_expect(((pFrameHeader->nOutputMaskWords != m_nOutputMaskWords)
+			|| (nRecordLength < sizeof(FrameHeader) + m_nOutputMaskWords * sizeof(uint32_t))
+			|| (nRecordLength > MAX_RECORD_LENGTH)), 0)) {
+		DEBUG_PUTS("Invalid record");
+		return nullptr;
+	}
+
+	if (m_nBufferTail - m_nBufferHead < nRecordLength) {
+		if (!Fill(nRecordLength)) {
+			return nullptr;
+		}
+	}
+
+	const auto *pRecord = &m_pBuffer[m_nBufferHead];
+	m_nBufferHead += nRecordLength;
+
+	return pRecord;
+}
+
+bool BinaryShowFile::ApplyRecord(const uint8_t *pRecord) {
+	const auto *pFrameHeader = reinterpret_cast<const FrameHeader *>(pRecord);
+	const auto *pEnd = pRecord + pFrameHeader->nRecordLength;
+	auto *p = pRecord + sizeof(FrameHeader) + m_nOutputMaskWords * sizeof(uint32_t);
+
+	while (p + sizeof(BlockHeader) <= pEnd) {
+		const auto *pBlockHeader = reinterpret_cast<const BlockHeader *>(p);
+		const auto *pData = p + sizeof(BlockHeader);
+		const auto nLength = pBlockHeader->nLength;
+		const auto nIndex = pBlockHeader->nUniverseIndex;
+
+		if (__builtin_expect(((nIndex >= m_Header.nUniverses) || (pData + nLength > pEnd)), 0)) {
+			DEBUG_PUTS("Invalid block");
+			return false;
+		}
+
+		auto *pDmxData = &m_pDmxData[nIndex * DMX_MAX_LENGTH];
+
+		if (pBlockHeader->tType == BlockType::KEY) {
+			if (nLength > DMX_MAX_LENGTH) {
+				return false;
+			}
+			memcpy(pDmxData, pData, nLength);
+			m_nDmxDataLength[nIndex] = nLength;
+		} else {
+			const auto *pRun = pData;
+			const auto *pRunEnd = pData + nLength;
+			uint32_t nSlot = 0;
+
+			while (pRun + 2 <= pRunEnd) {
+				nSlot += pRun[0];
+				const uint32_t nCount = pRun[1];
+				pRun += 2;
+
+				if ((nSlot + nCount > m_nDmxDataLength[nIndex]) || (pRun + nCount > pRunEnd)) {
+					DEBUG_PUTS("Invalid delta");
+					return false;
+				}
+
+				memcpy(&pDmxData[nSlot], pRun, nCount);
+				nSlot += nCount;
+				pRun += nCount;
+			}
+		}
+
+		p = pData + nLength;
+	}
+
+	m_nShowMillis += pFrameHeader->nDelayMillis;
+
+	return true;
+}
+
+void BinaryShowFile::OutputRecord(const uint8_t *pRecord) {
+	const auto *pFrameHeader = reinterpret_cast<const FrameHeader *>(pRecord);
+	const auto *pOutputMask = pRecord + sizeof(FrameHeader);	// The records are not aligned
+
+	for (uint32_t nWord = 0; nWord < m_nOutputMaskWords; nWord++) {
+		uint32_t nOutputMask = 0xFFFFFFFF;
+
+		if (!m_bOutputAll) {
+			memcpy(&nOutputMask, &pOutputMask[nWord * sizeof(uint32_t)], sizeof(uint32_t));
+		}
+
+		while (nOutputMask != 0) {
+			const auto nIndex = nWord * 32 + static_cast<uint32_t>(__builtin_ctz(nOutputMask));
+			nOutputMask &= nOutputMask - 1;
+
+			if ((nIndex < m_Header.nUniverses) && (m_nDmxDataLength[nIndex] != 0)) {
+				m_pShowFileProtocolHandler->DmxOut(m_Header.Universe[nIndex], &m_pDmxData[nIndex * DMX_MAX_LENGTH], m_nDmxDataLength[nIndex]);
+				m_bSyncPending = true;
+			}
+		}
+	}
+
+	m_bOutputAll = false;
+
+	m_nDelayMillis = pFrameHeader->nDelayMillis;
+
+	// A record without a delay continues the frame
+	if (m_nDelayMillis != 0) {
+		SyncFrame();
+	}
+}
+
+/**
+ * Ends the frame, the universes output since the last sync are sent.
+ */
+void BinaryShowFile::SyncFrame() {
+	if (m_bSyncPending) {
+		m_bSyncPending = false;
+		m_pShowFileProtocolHandler->DmxSync();
+	}
+}
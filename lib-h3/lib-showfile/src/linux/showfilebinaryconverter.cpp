@@ -0,0 +1,402 @@
+/**
+ * @file showfilebinaryconverter.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <cassert>
+
+#include "showfilebinaryconverter.h"
+#include "showfilebinary.h"
+
+#include "debug.h"
+
+using namespace showfilebinary;
+
+ShowFileBinaryConverter::ShowFileBinaryConverter() {
+	DEBUG_ENTRY
+
+	m_pRecord = new uint8_t[MAX_RECORD_LENGTH];
+	assert(m_pRecord != nullptr);
+
+	m_pData = new uint8_t[MAX_UNIVERSES * DMX_MAX_LENGTH];
+	assert(m_pData != nullptr);
+
+	m_pPrevious = new uint8_t[MAX_UNIVERSES * DMX_MAX_LENGTH];
+	assert(m_pPrevious != nullptr);
+
+	DEBUG_EXIT
+}
+
+ShowFileBinaryConverter::~ShowFileBinaryConverter() {
+	delete[] m_pIndex;
+	delete[] m_pPrevious;
+	delete[] m_pData;
+	delete[] m_pRecord;
+}
+
+bool ShowFileBinaryConverter::FromOla(FILE *pOlaFile, FILE *pBinaryFile) {
+	DEBUG_ENTRY
+	assert(pOlaFile != nullptr);
+	assert(pBinaryFile != nullptr);
+
+	memset(&m_Header, 0, sizeof(m_Header));
+	memcpy(m_Header.Magic, MAGIC, sizeof(MAGIC));
+	m_Header.nVersion = VERSION;
+	m_Header.nDataOffset = sizeof(Header);
+
+	memset(m_nLength, 0, sizeof(m_nLength));
+	memset(m_nPreviousLength, 0, sizeof(m_nPreviousLength));
+	memset(m_nOutputMask, 0, sizeof(m_nOutputMask));
+	m_Header.nIndexEntries = 0;
+	m_nBytesIn = 0;
+
+	if (!CollectUniverses(pOlaFile)) {
+		DEBUG_EXIT
+		return false;
+	}
+
+	if ((fseek(pOlaFile, 0L, SEEK_SET) != 0) || (fseek(pBinaryFile, 0L, SEEK_SET) != 0)) {
+		DEBUG_EXIT
+		return false;
+	}
+
+	// Placeholder, the header is written again when the index is known
+	if (fwrite(&m_Header, 1, sizeof(Header), pBinaryFile) != sizeof(Header)) {
+		DEBUG_EXIT
+		return false;
+	}
+
+	m_nOffset = sizeof(Header);
+
+	while (fgets(m_aLine, sizeof(m_aLine) - 1, pOlaFile) == m_aLine) {
+		m_nBytesIn += static_cast<uint32_t>(strlen(m_aLine));
+
+		if (!isdigit(m_aLine[0])) {
+			continue;
+		}
+
+		char *pEnd;
+		const auto nValue = strtoul(m_aLine, &pEnd, 10);
+
+		if (*pEnd == ' ') {
+			uint32_t nIndex;
+			uint16_t nLength;
+
+			if ((nValue > UINT16_MAX) || !ParseDmxLine(static_cast<uint16_t>(nValue), pEnd + 1, nIndex, nLength)) {
+				DEBUG_PUTS("Invalid universe");
+				DEBUG_EXIT
+				return false;
+			}
+
+			m_nLength[nIndex] = nLength;
+			m_nOutputMask[nIndex / 32] |= (1U << (nIndex % 32));
+		} else if ((nValue > UINT32_MAX) || !WriteDelay(pBinaryFile, static_cast<uint32_t>(nValue))) {
+			DEBUG_PUTS("Invalid delay");
+			DEBUG_EXIT
+			return false;
+		}
+	}
+
+	if (HasOutput() && !WriteFrame(pBinaryFile, 0)) {
+		DEBUG_EXIT
+		return false;
+	}
+
+	m_Header.nIndexOffset = m_nOffset;
+
+	const auto nIndexBytes = m_Header.nIndexEntries * sizeof(IndexEntry);
+
+	if ((fwrite(m_pIndex, 1, nIndexBytes, pBinaryFile) != nIndexBytes)
+			|| (fseek(pBinaryFile, 0L, SEEK_SET) != 0)
+			|| (fwrite(&m_Header, 1, sizeof(Header), pBinaryFile) != sizeof(Header))) {
+		DEBUG_EXIT
+		return false;
+	}
+
+	m_nOffset += static_cast<uint32_t>(nIndexBytes);
+
+	DEBUG_EXIT
+	return true;
+}
+
+void ShowFileBinaryConverter::Print() {
+	printf("Binary show file\n");
+	printf(" Universes : %u\n", m_Header.nUniverses);
+	printf(" Frames    : %u\n", m_Header.nFrames);
+	printf(" Duration  : %u ms\n", m_Header.nDurationMillis);
+	printf(" Index     : %u entries\n", m_Header.nIndexEntries);
+	printf(" Size      : %u -> %u bytes\n", m_nBytesIn, m_nOffset);
+}
+
+bool ShowFileBinaryConverter::CollectUniverses(FILE *pOlaFile) {
+	if (fseek(pOlaFile, 0L, SEEK_SET) != 0) {
+		return false;
+	}
+
+	while (fgets(m_aLine, sizeof(m_aLine) - 1, pOlaFile) == m_aLine) {
+		if (!isdigit(m_aLine[0])) {
+			continue;
+		}
+
+		char *pEnd;
+		const auto nUniverse = strtoul(m_aLine, &pEnd, 10);
+
+		if ((*pEnd != ' ') || (nUniverse > UINT16_MAX)) {
+			continue;
+		}
+
+		if (GetUniverseIndex(static_cast<uint16_t>(nUniverse)) < 0) {
+			if (m_Header.nUniverses == MAX_UNIVERSES) {
+				printf("Too many universes, maximum is %u\n", MAX_UNIVERSES);
+				return false;
+			}
+
+			m_Header.Universe[m_Header.nUniverses++] = static_cast<uint16_t>(nUniverse);
+		}
+	}
+
+	return true;
+}
+
+int32_t ShowFileBinaryConverter::GetUniverseIndex(uint16_t nUniverse) const {
+	for (uint32_t i = 0; i < m_Header.nUniverses; i++) {
+		if (m_Header.Universe[i] == nUniverse) {
+			return static_cast<int32_t>(i);
+		}
+	}
+
+	return -1;
+}
+
+bool ShowFileBinaryConverter::ParseDmxLine(uint16_t nUniverse, const char *pLine, uint32_t& nIndex, uint16_t& nLength) {
+	const auto nUniverseIndex = GetUniverseIndex(nUniverse);
+
+	if (nUniverseIndex < 0) {
+		return false;
+	}
+
+	nIndex = static_cast<uint32_t>(nUniverseIndex);
+
+	auto *pData = &m_pData[nIndex * DMX_MAX_LENGTH];
+	const char *p = pLine;
+	nLength = 0;
+
+	while (isdigit(*p)) {
+		char *pEnd;
+		const auto nValue = strtoul(p, &pEnd, 10);
+
+		if ((nValue > 255) || (nLength == DMX_MAX_LENGTH)) {
+			DEBUG_PUTS("Invalid DMX data");
+			return false;
+		}
+
+		pData[nLength++] = static_cast<uint8_t>(nValue);
+
+		p = pEnd;
+
+		if (*p == ',') {
+			p++;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Runs of changed slots, unchanged gaps of up to 2 slots are cheaper inside a run
+ */
+uint32_t ShowFileBinaryConverter::EncodeDelta(uint32_t nIndex, uint8_t *pOut) const {
+	const auto *pData = &m_pData[nIndex * DMX_MAX_LENGTH];
+	const auto *pPrevious = &m_pPrevious[nIndex * DMX_MAX_LENGTH];
+	const uint32_t nLength = m_nLength[nIndex];
+	uint32_t nOut = 0;
+	uint32_t nSlot = 0;
+	uint32_t nRunEnd = 0;
+
+	while (nSlot < nLength) {
+		if (pData[nSlot] == pPrevious[nSlot]) {
+			nSlot++;
+			continue;
+		}
+
+		auto nSkip = nSlot - nRunEnd;
+
+		while (nSkip > 255) {
+			pOut[nOut++] = 255;
+			pOut[nOut++] = 0;
+			nSkip -= 255;
+		}
+
+		uint32_t nCount = 0;
+		uint32_t nLastChanged = nSlot;
+
+		while ((nSlot + nCount < nLength) && (nCount < 255) && ((nSlot + nCount) - nLastChanged <= 2)) {
+			if (pData[nSlot + nCount] != pPrevious[nSlot + nCount]) {
+				nLastChanged = nSlot + nCount;
+			}
+			nCount++;
+		}
+
+		nCount = nLastChanged - nSlot + 1;
+
+		if (nOut + 2 + nCount >= nLength) {
+			return nLength;	// Delta is not smaller than the key
+		}
+
+		pOut[nOut++] = static_cast<uint8_t>(nSkip);
+		pOut[nOut++] = static_cast<uint8_t>(nCount);
+		memcpy(&pOut[nOut], &pData[nSlot], nCount);
+		nOut += nCount;
+
+		nSlot += nCount;
+		nRunEnd = nSlot;
+	}
+
+	return nOut;
+}
+
+bool ShowFileBinaryConverter::HasOutput() const {
+	for (uint32_t nWord = 0; nWord < MAX_OUTPUT_MASK_WORDS; nWord++) {
+		if (m_nOutputMask[nWord] != 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * A frame waits up to 65535 ms, a longer wait is continued with empty frames
+ */
+bool ShowFileBinaryConverter::WriteDelay(FILE *pBinaryFile, uint32_t nDelayMillis) {
+	while (nDelayMillis > UINT16_MAX) {
+		if (!WriteFrame(pBinaryFile, UINT16_MAX)) {
+			return false;
+		}
+
+		nDelayMillis -= UINT16_MAX;
+	}
+
+	return WriteFrame(pBinaryFile, static_cast<uint16_t>(nDelayMillis));
+}
+
+bool ShowFileBinaryConverter::WriteFrame(FILE *pBinaryFile, uint16_t nDelayMillis) {
+	const auto bKeyFrame = ((m_Header.nFrames % KEYFRAME_INTERVAL) == 0);
+	const auto nOutputMaskWords = GetOutputMaskWords(m_Header.nUniverses);
+	auto *pFrameHeader = reinterpret_cast<FrameHeader *>(m_pRecord);
+	uint32_t nRecordLength = sizeof(FrameHeader);
+
+	memcpy(&m_pRecord[nRecordLength], m_nOutputMask, nOutputMaskWords * sizeof(uint32_t));
+	nRecordLength += nOutputMaskWords * static_cast<uint32_t>(sizeof(uint32_t));
+
+	for (uint32_t nIndex = 0; nIndex < m_Header.nUniverses; nIndex++) {
+		const auto bOutput = ((m_nOutputMask[nIndex / 32] & (1U << (nIndex % 32))) != 0);
+
+		// A key frame restores everything the player has seen so far
+		if (!bOutput && !(bKeyFrame && (m_nPreviousLength[nIndex] != 0))) {
+			continue;
+		}
+
+		auto *pBlockHeader = reinterpret_cast<BlockHeader *>(&m_pRecord[nRecordLength]);
+		auto *pBlockData = &m_pRecord[nRecordLength + sizeof(BlockHeader)];
+		const auto nLength = m_nLength[nIndex];
+		auto nBlockLength = static_cast<uint32_t>(nLength);
+
+		pBlockHeader->nUniverseIndex = static_cast<uint8_t>(nIndex);
+		pBlockHeader->tType = BlockType::KEY;
+
+		if (!bKeyFrame && (nLength == m_nPreviousLength[nIndex])) {
+			const auto nDeltaLength = EncodeDelta(nIndex, pBlockData);
+
+			if (nDeltaLength == 0) {
+				continue;	// Unchanged
+			}
+
+			if (nDeltaLength < nLength) {
+				pBlockHeader->tType = BlockType::DELTA;
+				nBlockLength = nDeltaLength;
+			}
+		}
+
+		if (pBlockHeader->tType == BlockType::KEY) {
+			memcpy(pBlockData, &m_pData[nIndex * DMX_MAX_LENGTH], nLength);
+		}
+
+		pBlockHeader->nLength = static_cast<uint16_t>(nBlockLength);
+		nRecordLength += static_cast<uint32_t>(sizeof(BlockHeader)) + nBlockLength;
+
+		memcpy(&m_pPrevious[nIndex * DMX_MAX_LENGTH], &m_pData[nIndex * DMX_MAX_LENGTH], nLength);
+		m_nPreviousLength[nIndex] = nLength;
+	}
+
+	assert(nRecordLength <= MAX_RECORD_LENGTH);
+
+	pFrameHeader->nRecordLength = nRecordLength;
+	pFrameHeader->nDelayMillis = nDelayMillis;
+	pFrameHeader->nOutputMaskWords = static_cast<uint16_t>(nOutputMaskWords);
+
+	if (bKeyFrame && !AddIndexEntry(m_Header.nDurationMillis, m_nOffset)) {
+		return false;
+	}
+
+	if (fwrite(m_pRecord, 1, nRecordLength, pBinaryFile) != nRecordLength) {
+		return false;
+	}
+
+	m_nOffset += nRecordLength;
+	m_Header.nFrames++;
+	m_Header.nDurationMillis += nDelayMillis;
+	memset(m_nOutputMask, 0, sizeof(m_nOutputMask));
+
+	return true;
+}
+
+bool ShowFileBinaryConverter::AddIndexEntry(uint32_t nMillis, uint32_t nOffset) {
+	if (m_Header.nIndexEntries == m_nIndexSize) {
+		const auto nIndexSize = (m_nIndexSize == 0) ? 256 : 2 * m_nIndexSize;
+		auto *pIndex = new IndexEntry[nIndexSize];
+
+		if (pIndex == nullptr) {
+			return false;
+		}
+
+		if (m_pIndex != nullptr) {
+			memcpy(pIndex, m_pIndex, m_nIndexSize * sizeof(IndexEntry));
+			delete[] m_pIndex;
+		}
+
+		m_pIndex = pIndex;
+		m_nIndexSize = nIndexSize;
+	}
+
+	m_pIndex[m_Header.nIndexEntries].nMillis = nMillis;
+	m_pIndex[m_Header.nIndexEntries].nOffset = nOffset;
+	m_Header.nIndexEntries++;
+
+	return true;
+}
@@ -57,6 +57,8 @@ void OlaShowFile::ShowFileStart() {
 void OlaShowFile::ShowFileStop() {
 	DEBUG1_ENTRY
 
+	SyncFrame();
+
 	DEBUG1_EXIT
 }
 
@@ -76,15 +78,16 @@ void OlaShowFile::ShowFileRun() {
 		if (m_tParseCode == OlaParseCode::DMX) {
 			if (m_nDmxDataLength != 0) {
 				m_pShowFileProtocolHandler->DmxOut(m_nUniverse, m_DmxData, m_nDmxDataLength);
+				m_bSyncPending = true;
 			}
 		} else if (m_tParseCode == OlaParseCode::TIME) {
 			if (m_nDelayMillis != 0) {
-				if (m_nDmxDataLength != 0) {
-					m_pShowFileProtocolHandler->DmxSync();
-				}
+				SyncFrame();
 			}
 			m_tState = OlaState::TIME_WAITING;
 		} else if (m_tParseCode == OlaParseCode::EOFILE) {
+			SyncFrame();
+
 			if (m_bDoLoop) {
 				fseek(m_pShowFile, 0L, SEEK_SET);
 			} else {
@@ -101,6 +104,16 @@ void OlaShowFile::ShowFileRun() {
 	}
 }
 
+/**
+ * Ends the frame, the universes output since the last sync are sent.
+ */
+void OlaShowFile::SyncFrame() {
+	if (m_bSyncPending) {
+		m_bSyncPending = false;
+		m_pShowFileProtocolHandler->DmxSync();
+	}
+}
+
 OlaParseCode OlaShowFile::ParseDmxData(const char *pLine) {
 	char *p = const_cast<char *>(pLine);
 	int64_t k = 0;
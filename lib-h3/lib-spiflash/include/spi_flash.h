@@ -44,6 +44,12 @@ extern int spi_flash_cmd_write_multi(uint32_t offset, size_t len, const void *bu
 extern int spi_flash_cmd_erase(uint32_t offset, size_t len);
 extern int spi_flash_cmd_write_status(uint8_t sr);
 
+/*
+ * The last page program or sector erase is not waited for,
+ * a caller which must not block polls until the flash is ready.
+ */
+extern int spi_flash_is_busy(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -162,12 +162,31 @@ int spi_flash_cmd_write_multi(uint32_t offset, size_t len, const void *buf) {
 		return -1;
 	}
 
-	if (fwrite(buf, 1, len, file) != len) {
+	// NOR flash: programming can only clear bits, an erase sets them
+	uint8_t *data = malloc(len);
+	assert(data != NULL);
+
+	if (fread(data, 1, len, file) != len) {
+		perror("fread");
+		free(data);
+		DEBUG_EXIT
+		return -1;
+	}
+
+	size_t i;
+	for (i = 0; i < len; i++) {
+		data[i] &= ((const uint8_t *) buf)[i];
+	}
+
+	if ((fseek(file, offset, SEEK_SET) != 0) || (fwrite(data, 1, len, file) != len)) {
 		perror("fwrite");
+		free(data);
 		DEBUG_EXIT
 		return -1;
 	}
 
+	free(data);
+
 	if (fflush(file) != 0) {
 		perror("fflush");
 	}
@@ -178,6 +197,10 @@ int spi_flash_cmd_write_multi(uint32_t offset, size_t len, const void *buf) {
 	return 0;
 }
 
+int spi_flash_is_busy(void) {
+	return 0;
+}
+
 int spi_flash_cmd_read_fast(uint32_t offset, size_t len, void *data) {
 	DEBUG_ENTRY
 
@@ -178,6 +178,22 @@ static int spi_flash_cmd_wait_ready(unsigned long timeout) {
 	return -1;
 }
 
+int spi_flash_is_busy(void) {
+	uint8_t status;
+	uint8_t check_status = 0x0;
+	uint8_t poll_bit = STATUS_WIP;
+	uint8_t cmd = s_flash.poll_cmd;
+
+	if (cmd == CMD_FLAG_STATUS) {
+		poll_bit = STATUS_PEC;
+		check_status = poll_bit;
+	}
+
+	spi_flash_cmd_read(&cmd, 1, &status, 1);
+
+	return (status & poll_bit) != check_status;
+}
+
 static int spi_flash_write_common(const uint8_t *cmd, size_t cmd_len, const void *buf, size_t buf_len, bool wait_ready) {
 	unsigned long timeout = SPI_FLASH_PROG_TIMEOUT;
 	int ret;
@@ -65,6 +65,13 @@ enum class Store {
 };
 }  // namespace spiflashstore
 
+/**
+ * The stores are kept in RAM, the flash holds an append-only log of records.
+ * A record is a byte range of one store with a CRC. When the log is full, the
+ * stores are compacted into the other bank, which alternates the wear.
+ * Flash() does one page program or one sector erase per call, it never waits
+ * for the flash chip.
+ */
 class SpiFlashStore {
 public:
 	SpiFlashStore();
@@ -83,6 +90,10 @@ public:
 
 	void ResetSetList(spiflashstore::Store tStore);
 
+	/**
+	 * It must be called from the main loop.
+	 * @return true when there is still work to do
+	 */
 	bool Flash();
 
 	void Dump();
@@ -93,21 +104,47 @@ public:
 
 private:
 	bool Init();
+	bool Replay(uint32_t nBank);
+	bool Migrate();
+	void SetDefaults();
+	void Compact();
 	uint32_t GetStoreOffset(spiflashstore::Store tStore);
+	void SetDirty(spiflashstore::Store tStore, uint32_t nBegin, uint32_t nEnd);
+	uint32_t BuildRecord(uint32_t nStore, uint32_t nBegin, uint32_t nEnd);
+	bool NextRecord();
+	bool NextCompactRecord();
+	bool Program();
 
 private:
 	bool m_bHaveFlashChip { false };
 	bool m_bIsNew { false };
 	enum class State {
-		IDLE, CHANGED, ERASED
+		IDLE, CHANGED, PROGRAM, ERASE, COMPACT, HEADER
 	};
 	State m_tState { State::IDLE };
-	uint32_t m_nStartAddress { 0 };
+	State m_tStateProgrammed { State::IDLE };	///< The state after the record is programmed
 	struct FlashStore {
 		static constexpr auto SIZE = 4096;
 	};
+	struct Log {
+		static constexpr uint32_t BANK_SECTORS = 2;
+		static constexpr uint32_t BANK_SIZE = BANK_SECTORS * FlashStore::SIZE;
+		static constexpr uint32_t RECORD_MAX = 12 + 1024;
+	};
+	uint32_t m_nBankAddress[2] { 0, 0 };
+	uint32_t m_nActiveBank { 0 };
+	uint32_t m_nSequence { 0 };
+	uint32_t m_nLogOffset { Log::BANK_SIZE };	///< The next free byte in the active bank
+	uint32_t m_nCompactStep { 0 };
+	uint32_t m_nCompactOffset { 0 };
+	uint32_t m_nRecordAddress { 0 };
+	uint32_t m_nRecordLength { 0 };
+	uint32_t m_nRecordProgrammed { 0 };
+	uint16_t m_aDirtyBegin[static_cast<uint32_t>(spiflashstore::Store::LAST)] {};
+	uint16_t m_aDirtyEnd[static_cast<uint32_t>(spiflashstore::Store::LAST)] {};	///< 0 is clean
 	uint32_t m_nSpiFlashStoreSize { FlashStore::SIZE };
 	uint8_t m_aSpiFlashData[FlashStore::SIZE];
+	uint8_t m_aRecord[Log::RECORD_MAX];
 
 #if !defined( NO_EMAC )
 	StoreNetwork m_StoreNetwork;
@@ -2,7 +2,7 @@
  * @file spiflashstore.cpp
  *
  */
-/* Copyright (C) 2018-2020 by Arjan van Vught mailto:info@orangepi-dmx.nl
+/* Copyright (C) 2018-2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -25,6 +25,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <cassert>
 
 #include "spiflashstore.h"
@@ -40,12 +41,62 @@
 using namespace spiflashstore;
 
 static constexpr uint8_t s_aSignature[] = {'A', 'v', 'V', 0x10};
+static constexpr uint8_t s_aLogSignature[] = {'A', 'v', 'V', 0x20};
 static constexpr auto OFFSET_STORES	= ((((sizeof(s_aSignature) + 15) / 16) * 16) + 16); // +16 is reserved for UUID
 static constexpr uint32_t s_aStorSize[static_cast<uint32_t>(Store::LAST)]  = {96,        144,       32,    64,       96,      64,     32,     32,         480,           64,        32,        96,           48,        32,      944,          48,        64,            32,        96,         32,      1024,     32,     32,       64,            96,               32,    32};
 #ifndef NDEBUG
 static constexpr char s_aStoreName[static_cast<uint32_t>(Store::LAST)][16] = {"Network", "Art-Net3", "DMX", "WS28xx", "E1.31", "LTC", "MIDI", "Art-Net4", "OSC Server", "TLC59711", "USB Pro", "RDM Device", "RConfig", "TCNet", "OSC Client", "Display", "LTC Display", "Monitor", "SparkFun", "Slush", "Motors", "Show", "Serial", "RDM Sensors", "RDM SubDevices", "GPS", "RGB Panel"};
 #endif
 
+/*
+ * Bank:   header {signature, sequence, CRC, 0xFFFFFFFF} followed by the records
+ * Record: {store, 0x00, offset, length, 0x0000, CRC} followed by the data, 4 bytes aligned
+ * The CRC of a record covers the first 8 bytes and the data.
+ */
+static constexpr uint32_t LOG_HEADER_SIZE = 16;
+static constexpr uint32_t RECORD_HEADER_SIZE = 12;
+static constexpr uint32_t PAGE_SIZE = 256;
+
+static constexpr uint32_t record_size(uint32_t nLength) {
+	return (RECORD_HEADER_SIZE + nLength + 3) & ~3U;
+}
+
+static constexpr uint32_t compacted_size(uint32_t nStore = 0) {
+	return nStore == static_cast<uint32_t>(Store::LAST) ? LOG_HEADER_SIZE : record_size(s_aStorSize[nStore]) + compacted_size(nStore + 1);
+}
+
+static uint32_t crc32(const uint8_t *pData, uint32_t nLength, uint32_t nCrc = 0xFFFFFFFF) {
+	static constexpr uint32_t s_aTable[16] = {
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+	};
+
+	for (uint32_t i = 0; i < nLength; i++) {
+		nCrc = s_aTable[(nCrc ^ pData[i]) & 0xF] ^ (nCrc >> 4);
+		nCrc = s_aTable[(nCrc ^ (static_cast<uint32_t>(pData[i]) >> 4)) & 0xF] ^ (nCrc >> 4);
+	}
+
+	return nCrc;
+}
+
+static uint32_t get_uint32(const uint8_t *p) {
+	return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static void put_uint32(uint8_t *p, uint32_t n) {
+	p[0] = static_cast<uint8_t>(n);
+	p[1] = static_cast<uint8_t>(n >> 8);
+	p[2] = static_cast<uint8_t>(n >> 16);
+	p[3] = static_cast<uint8_t>(n >> 24);
+}
+
+/**
+ * The value of a store byte which has never been written, the set list is 0
+ */
+static uint8_t default_value(uint32_t nOffset) {
+	return nOffset < 4 ? 0x00 : 0xFF;
+}
+
 SpiFlashStore *SpiFlashStore::s_pThis = nullptr;
 
 SpiFlashStore::SpiFlashStore() {
@@ -89,6 +140,9 @@ SpiFlashStore::~SpiFlashStore() {
 }
 
 bool SpiFlashStore::Init() {
+	static_assert(compacted_size() <= Log::BANK_SIZE, "All the stores must fit in a bank");
+	static_assert(record_size(1024) <= Log::RECORD_MAX, "The largest store must fit in a record");
+
 	const uint32_t nEraseSize = spi_flash_get_sector_size();
 	assert(FlashStore::SIZE == nEraseSize);
 
@@ -96,47 +150,138 @@ bool SpiFlashStore::Init() {
 		return false;
 	}
 
-	m_nStartAddress = spi_flash_get_size() - nEraseSize;
-	assert(!(m_nStartAddress % nEraseSize));
+	// The last sector is within bank 1, it holds the stores written before the log
+	m_nBankAddress[1] = spi_flash_get_size() - Log::BANK_SIZE;
+	m_nBankAddress[0] = m_nBankAddress[1] - Log::BANK_SIZE;
 
-	if (m_nStartAddress % nEraseSize) {
-		return false;
-	}
+	SetDefaults();
+
+	bool isValid[2];
+	uint32_t nSequence[2];
+
+	for (uint32_t nBank = 0; nBank < 2; nBank++) {
+		uint8_t aHeader[LOG_HEADER_SIZE];
 
-	spi_flash_cmd_read_fast(m_nStartAddress, FlashStore::SIZE, &m_aSpiFlashData);
+		spi_flash_cmd_read_fast(m_nBankAddress[nBank], LOG_HEADER_SIZE, aHeader);
+
+		isValid[nBank] = (memcmp(aHeader, s_aLogSignature, sizeof(s_aLogSignature)) == 0) && (get_uint32(&aHeader[8]) == ~crc32(aHeader, 8));
+		nSequence[nBank] = get_uint32(&aHeader[4]);
+	}
 
-	bool bSignatureOK = true;
+	if (isValid[0] || isValid[1]) {
+		m_nActiveBank = (isValid[0] && (!isValid[1] || (nSequence[0] > nSequence[1]))) ? 0 : 1;
+		m_nSequence = nSequence[m_nActiveBank];
 
-	for (uint32_t i = 0; i < sizeof(s_aSignature); i++) {
-		if (s_aSignature[i] != m_aSpiFlashData[i]) {
-			m_aSpiFlashData[i] = s_aSignature[i];
-			bSignatureOK = false;
+		if (!Replay(m_nActiveBank)) {
+			// Nothing can be appended after a broken record
+			Compact();
 		}
+
+		return true;
 	}
 
-	if (__builtin_expect(!bSignatureOK, 0)) {
-		DEBUG_PUTS("No signature");
+	// There is no log yet, the stores are compacted into bank 0
+	m_nActiveBank = 1;
+	m_nSequence = 0;
 
+	if (!Migrate()) {
+		DEBUG_PUTS("No signature");
 		m_bIsNew = true;
+	}
 
-		// Clear nSetList
-		for (uint32_t j = 0; j < static_cast<uint32_t>(Store::LAST); j++) {
-			const uint32_t nOffset = GetStoreOffset(static_cast<Store>(j));
-			uint32_t k = nOffset;
-			m_aSpiFlashData[k++] = 0x00;
-			m_aSpiFlashData[k++] = 0x00;
-			m_aSpiFlashData[k++] = 0x00;
-			m_aSpiFlashData[k++] = 0x00;
-
-			// Clear rest of data
-			for (; k < nOffset + s_aStorSize[j]; k++) {
-				m_aSpiFlashData[k] = 0xFF;
+	Compact();
+
+	return true;
+}
+
+void SpiFlashStore::SetDefaults() {
+	memset(m_aSpiFlashData, 0xFF, sizeof(m_aSpiFlashData));
+	memcpy(m_aSpiFlashData, s_aSignature, sizeof(s_aSignature));
+
+	for (uint32_t j = 0; j < static_cast<uint32_t>(Store::LAST); j++) {
+		memset(&m_aSpiFlashData[GetStoreOffset(static_cast<Store>(j))], 0x00, 4);
+	}
+}
+
+/**
+ * Applies the records of the bank to the stores.
+ * @return false when a record is broken
+ */
+bool SpiFlashStore::Replay(uint32_t nBank) {
+	DEBUG_ENTRY
+
+	uint32_t nOffset = LOG_HEADER_SIZE;
+
+	while (nOffset + RECORD_HEADER_SIZE <= Log::BANK_SIZE) {
+		spi_flash_cmd_read_fast(m_nBankAddress[nBank] + nOffset, RECORD_HEADER_SIZE, m_aRecord);
+
+		uint32_t i;
+
+		for (i = 0; (i < RECORD_HEADER_SIZE) && (m_aRecord[i] == 0xFF); i++) {
+		}
+
+		if (i == RECORD_HEADER_SIZE) {
+			// Erased, the end of the log. A record interrupted by a reset can have its data programmed only.
+			auto nLength = Log::BANK_SIZE - nOffset;
+
+			if (nLength > Log::RECORD_MAX) {
+				nLength = Log::RECORD_MAX;
 			}
+
+			spi_flash_cmd_read_fast(m_nBankAddress[nBank] + nOffset, nLength, m_aRecord);
+
+			for (i = 0; (i < nLength) && (m_aRecord[i] == 0xFF); i++) {
+			}
+
+			if (i != nLength) {
+				DEBUG_PRINTF("Not erased at %u", nOffset + i);
+				DEBUG_EXIT
+				return false;
+			}
+
+			break;
 		}
 
-		m_tState = State::CHANGED;
+		const uint32_t nStore = m_aRecord[0];
+		const uint32_t nStoreOffset = static_cast<uint32_t>(m_aRecord[2] | (m_aRecord[3] << 8));
+		const uint32_t nLength = static_cast<uint32_t>(m_aRecord[4] | (m_aRecord[5] << 8));
 
-		return true;
+		if ((nStore >= static_cast<uint32_t>(Store::LAST)) || (m_aRecord[1] != 0x00) || (nLength == 0)
+				|| ((nStoreOffset + nLength) > s_aStorSize[nStore]) || ((nOffset + record_size(nLength)) > Log::BANK_SIZE)) {
+			DEBUG_PRINTF("Invalid record at %u", nOffset);
+			DEBUG_EXIT
+			return false;
+		}
+
+		spi_flash_cmd_read_fast(m_nBankAddress[nBank] + nOffset + RECORD_HEADER_SIZE, nLength, &m_aRecord[RECORD_HEADER_SIZE]);
+
+		if (get_uint32(&m_aRecord[8]) != ~crc32(&m_aRecord[RECORD_HEADER_SIZE], nLength, crc32(m_aRecord, 8))) {
+			DEBUG_PRINTF("CRC error at %u", nOffset);
+			DEBUG_EXIT
+			return false;
+		}
+
+		memcpy(&m_aSpiFlashData[GetStoreOffset(static_cast<Store>(nStore)) + nStoreOffset], &m_aRecord[RECORD_HEADER_SIZE], nLength);
+
+		nOffset += record_size(nLength);
+	}
+
+	m_nLogOffset = nOffset;
+
+	DEBUG_PRINTF("m_nActiveBank=%u, m_nSequence=%u, m_nLogOffset=%u", m_nActiveBank, m_nSequence, m_nLogOffset);
+	DEBUG_EXIT
+	return true;
+}
+
+/**
+ * The stores written before the log, in the last sector of the flash
+ */
+bool SpiFlashStore::Migrate() {
+	spi_flash_cmd_read_fast(spi_flash_get_size() - FlashStore::SIZE, FlashStore::SIZE, &m_aSpiFlashData);
+
+	if (memcmp(m_aSpiFlashData, s_aSignature, sizeof(s_aSignature)) != 0) {
+		SetDefaults();
+		return false;
 	}
 
 	for (uint32_t j = 0; j < static_cast<uint32_t>(Store::LAST); j++) {
@@ -144,12 +289,7 @@ bool SpiFlashStore::Init() {
 		if ((pbSetList[0] == 0xFF) && (pbSetList[1] == 0xFF) && (pbSetList[2] == 0xFF) && (pbSetList[3] == 0xFF)) {
 			DEBUG_PRINTF("[%s]: nSetList \'FF...FF\'", s_aStoreName[j]);
 			// Clear bSetList
-			*pbSetList++ = 0x00;
-			*pbSetList++ = 0x00;
-			*pbSetList++ = 0x00;
-			*pbSetList = 0x00;
-
-			m_tState = State::CHANGED;
+			memset(pbSetList, 0x00, 4);
 		}
 	}
 
@@ -165,11 +305,32 @@ uint32_t SpiFlashStore::GetStoreOffset(Store tStore) {
 		nOffset += s_aStorSize[i];
 	}
 
-	DEBUG_PRINTF("nOffset=%d", nOffset);
-
 	return nOffset;
 }
 
+void SpiFlashStore::SetDirty(Store tStore, uint32_t nBegin, uint32_t nEnd) {
+	const auto nStore = static_cast<uint32_t>(tStore);
+
+	assert(nBegin < nEnd);
+	assert(nEnd <= s_aStorSize[nStore]);
+
+	if (m_aDirtyEnd[nStore] == 0) {
+		m_aDirtyBegin[nStore] = static_cast<uint16_t>(nBegin);
+		m_aDirtyEnd[nStore] = static_cast<uint16_t>(nEnd);
+	} else {
+		if (nBegin < m_aDirtyBegin[nStore]) {
+			m_aDirtyBegin[nStore] = static_cast<uint16_t>(nBegin);
+		}
+		if (nEnd > m_aDirtyEnd[nStore]) {
+			m_aDirtyEnd[nStore] = static_cast<uint16_t>(nEnd);
+		}
+	}
+
+	if (m_tState == State::IDLE) {
+		m_tState = State::CHANGED;
+	}
+}
+
 void SpiFlashStore::ResetSetList(Store tStore) {
 	assert(tStore < Store::LAST);
 
@@ -181,7 +342,7 @@ void SpiFlashStore::ResetSetList(Store tStore) {
 	*pbSetList++ = 0x00;
 	*pbSetList = 0x00;
 
-	m_tState = State::CHANGED;
+	SetDirty(tStore, 0, 4);
 }
 
 void SpiFlashStore::Update(Store tStore, uint32_t nOffset, const void *pData, uint32_t nDataLength, uint32_t nSetList, uint32_t nOffsetSetList) {
@@ -215,14 +376,16 @@ void SpiFlashStore::Update(Store tStore, uint32_t nOffset, const void *pData, ui
 		pSrc++;
 	}
 
-	if (bIsChanged && (m_tState != State::ERASED)) {
-		m_tState = State::CHANGED;
+	if (bIsChanged) {
+		SetDirty(tStore, nOffset, nOffset + nDataLength);
 	}
 
 	if ((0 != nOffset) && (bIsChanged) && (nSetList != 0)) {
 		auto *pSet = reinterpret_cast<uint32_t*>((&m_aSpiFlashData[GetStoreOffset(tStore)] + nOffsetSetList));
 
 		*pSet |= nSetList;
+
+		SetDirty(tStore, nOffsetSetList, nOffsetSetList + 4);
 	}
 
 	DEBUG_PRINTF("m_tState=%u", static_cast<uint32_t>(m_tState));
@@ -282,29 +445,182 @@ void SpiFlashStore::CopyTo(Store tStore, void* pData, uint32_t& nDataLength) {
 	DEBUG1_EXIT
 }
 
+/**
+ * The bytes nBegin up to nEnd of the store are copied into a record.
+ * @return The size of the record in the log
+ */
+uint32_t SpiFlashStore::BuildRecord(uint32_t nStore, uint32_t nBegin, uint32_t nEnd) {
+	const auto nLength = nEnd - nBegin;
+
+	assert(nStore < static_cast<uint32_t>(Store::LAST));
+	assert((nBegin < nEnd) && (nEnd <= s_aStorSize[nStore]));
+
+	m_aRecord[0] = static_cast<uint8_t>(nStore);
+	m_aRecord[1] = 0x00;
+	m_aRecord[2] = static_cast<uint8_t>(nBegin);
+	m_aRecord[3] = static_cast<uint8_t>(nBegin >> 8);
+	m_aRecord[4] = static_cast<uint8_t>(nLength);
+	m_aRecord[5] = static_cast<uint8_t>(nLength >> 8);
+	m_aRecord[6] = 0x00;
+	m_aRecord[7] = 0x00;
+
+	memcpy(&m_aRecord[RECORD_HEADER_SIZE], &m_aSpiFlashData[GetStoreOffset(static_cast<Store>(nStore)) + nBegin], nLength);
+
+	put_uint32(&m_aRecord[8], ~crc32(&m_aRecord[RECORD_HEADER_SIZE], nLength, crc32(m_aRecord, 8)));
+
+	m_nRecordLength = RECORD_HEADER_SIZE + nLength;
+	m_nRecordProgrammed = 0;
+
+	return record_size(nLength);
+}
+
+/**
+ * Appends a record of the first changed store to the log.
+ * @return false when there are no changes
+ */
+bool SpiFlashStore::NextRecord() {
+	for (uint32_t nStore = 0; nStore < static_cast<uint32_t>(Store::LAST); nStore++) {
+		if (m_aDirtyEnd[nStore] == 0) {
+			continue;
+		}
+
+		if ((m_nLogOffset + record_size(m_aDirtyEnd[nStore] - m_aDirtyBegin[nStore])) > Log::BANK_SIZE) {
+			Compact();
+			return true;
+		}
+
+		m_nRecordAddress = m_nBankAddress[m_nActiveBank] + m_nLogOffset;
+		m_nLogOffset += BuildRecord(nStore, m_aDirtyBegin[nStore], m_aDirtyEnd[nStore]);
+		m_aDirtyEnd[nStore] = 0;
+
+		m_tState = State::PROGRAM;
+		m_tStateProgrammed = State::CHANGED;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Starts writing all the stores into the other bank. The RAM copy is complete,
+ * so the pending changes are included.
+ */
+void SpiFlashStore::Compact() {
+	DEBUG_PRINTF("m_nActiveBank=%u, m_nLogOffset=%u", m_nActiveBank, m_nLogOffset);
+
+	for (uint32_t nStore = 0; nStore < static_cast<uint32_t>(Store::LAST); nStore++) {
+		m_aDirtyEnd[nStore] = 0;
+	}
+
+	m_nCompactStep = 0;
+	m_tState = State::ERASE;
+}
+
+/**
+ * The stores which differ from the defaults are written, up to the last changed byte.
+ * @return false when all the stores are written
+ */
+bool SpiFlashStore::NextCompactRecord() {
+	for (; m_nCompactStep < static_cast<uint32_t>(Store::LAST); m_nCompactStep++) {
+		const auto *pStore = &m_aSpiFlashData[GetStoreOffset(static_cast<Store>(m_nCompactStep))];
+		auto nEnd = s_aStorSize[m_nCompactStep];
+
+		while ((nEnd != 0) && (pStore[nEnd - 1] == default_value(nEnd - 1))) {
+			nEnd--;
+		}
+
+		if (nEnd == 0) {
+			continue;
+		}
+
+		m_nRecordAddress = m_nBankAddress[m_nActiveBank ^ 0x1] + m_nCompactOffset;
+		m_nCompactOffset += BuildRecord(m_nCompactStep, 0, nEnd);
+		m_nCompactStep++;
+
+		m_tState = State::PROGRAM;
+		m_tStateProgrammed = State::COMPACT;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * A page program of the record, it is not waited for.
+ * @return true when the record is completely programmed
+ */
+bool SpiFlashStore::Program() {
+	const auto nAddress = m_nRecordAddress + m_nRecordProgrammed;
+	auto nLength = PAGE_SIZE - (nAddress & (PAGE_SIZE - 1));
+
+	if (nLength > (m_nRecordLength - m_nRecordProgrammed)) {
+		nLength = m_nRecordLength - m_nRecordProgrammed;
+	}
+
+	spi_flash_cmd_write_multi(nAddress, nLength, &m_aRecord[m_nRecordProgrammed]);
+
+	m_nRecordProgrammed += nLength;
+
+	return m_nRecordProgrammed == m_nRecordLength;
+}
+
 bool SpiFlashStore::Flash() {
 	if (__builtin_expect((m_tState == State::IDLE), 1)) {
 		return false;
 	}
 
-	DEBUG_PRINTF("m_tState=%d", static_cast<uint32_t>(m_tState));
+	assert(m_nBankAddress[0] != 0);
 
-	assert(m_nStartAddress != 0);
-
-	if (m_nStartAddress == 0) {
-		printf("!*! m_nStartAddress == 0 !*!\n");
-		return false;
+	if (spi_flash_is_busy()) {
+		return true;
 	}
 
 	switch (m_tState) {
 		case State::CHANGED:
-			spi_flash_cmd_erase(m_nStartAddress, FlashStore::SIZE);
-			m_tState = State::ERASED;
+			if (NextRecord()) {
+				return true;
+			}
+			m_tState = State::IDLE;
+			break;
+		case State::PROGRAM:
+			if (Program()) {
+				m_tState = m_tStateProgrammed;
+			}
 			return true;
 			break;
-		case State::ERASED:
-			spi_flash_cmd_write_multi(m_nStartAddress, m_nSpiFlashStoreSize, &m_aSpiFlashData);
-			m_tState = State::IDLE;
+		case State::ERASE:
+			spi_flash_cmd_erase(m_nBankAddress[m_nActiveBank ^ 0x1] + m_nCompactStep * FlashStore::SIZE, FlashStore::SIZE);
+
+			if (++m_nCompactStep == Log::BANK_SECTORS) {
+				m_nCompactStep = 0;
+				m_nCompactOffset = LOG_HEADER_SIZE;
+				m_tState = State::COMPACT;
+			}
+			return true;
+			break;
+		case State::COMPACT:
+			if (!NextCompactRecord()) {
+				// The header is written last, an incomplete bank is never used
+				memcpy(m_aRecord, s_aLogSignature, sizeof(s_aLogSignature));
+				put_uint32(&m_aRecord[4], m_nSequence + 1);
+				put_uint32(&m_aRecord[8], ~crc32(m_aRecord, 8));
+				put_uint32(&m_aRecord[12], 0xFFFFFFFF);
+
+				m_nRecordAddress = m_nBankAddress[m_nActiveBank ^ 0x1];
+				m_nRecordLength = LOG_HEADER_SIZE;
+				m_nRecordProgrammed = 0;
+
+				m_tState = State::PROGRAM;
+				m_tStateProgrammed = State::HEADER;
+			}
+			return true;
+			break;
+		case State::HEADER:
+			m_nActiveBank ^= 0x1;
+			m_nSequence++;
+			m_nLogOffset = m_nCompactOffset;
+			m_tState = State::CHANGED;
+			return true;
 			break;
 		default:
 			break;
@@ -346,5 +662,6 @@ void SpiFlashStore::Dump() {
 	}
 
 	printf("m_tState=%d\n", static_cast<uint32_t>(m_tState));
+	printf("Bank %u at 0x%x, sequence %u, log %u/%u bytes\n", m_nActiveBank, m_nBankAddress[m_nActiveBank], m_nSequence, m_nLogOffset, Log::BANK_SIZE);
 #endif
 }
@@ -0,0 +1,230 @@
+/**
+ * @file logstore.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Runs SpiFlashStore on the Linux NOR flash emulation (spiflash.bin). Random
+ * updates are written with a random number of Flash() steps, after which the
+ * store is abandoned as on a power loss and constructed again. The replayed
+ * stores must be either the previous or the new contents, through many
+ * (interrupted) compactions of the log.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "spiflashstore.h"
+#include "spi_flash.h"
+
+using spiflashstore::Store;
+
+namespace sim {
+static constexpr uint32_t ROUNDS = 800;	///< Each power on opens the flash emulation once more
+static constexpr uint32_t UPDATES_MAX = 8;
+static constexpr uint32_t DATA_MAX = 48;
+static constexpr uint32_t STEPS_MAX = 40;
+static constexpr uint32_t DRAIN_EVERY = 4;
+static constexpr uint32_t STORES = static_cast<uint32_t>(Store::LAST);
+static constexpr uint32_t STORE_MAX = 1024;
+static constexpr uint32_t BANK_SIZE = 2 * 4096;
+}  // namespace sim
+
+static constexpr uint32_t s_aStoreSize[sim::STORES] = {96, 144, 32, 64, 96, 64, 32, 32, 480, 64, 32, 96, 48, 32, 944, 48, 64, 32, 96, 32, 1024, 32, 32, 64, 96, 32, 32};
+
+static uint8_t s_aOld[sim::STORES][sim::STORE_MAX];	///< The contents which are on the flash
+static uint8_t s_aNew[sim::STORES][sim::STORE_MAX];	///< The contents after the updates
+
+/*
+ * The store is constructed in place, the previous one is not destroyed.
+ * Its destructor would finish the pending flash writes.
+ */
+alignas(SpiFlashStore) static uint8_t s_aStoreMemory[sizeof(SpiFlashStore)];
+
+static uint64_t now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static SpiFlashStore *power_on() {
+	// The constructor prints the detected flash
+	fflush(stdout);
+	const auto nStdout = dup(STDOUT_FILENO);
+	const auto nNull = open("/dev/null", O_WRONLY);
+	dup2(nNull, STDOUT_FILENO);
+	close(nNull);
+
+	auto *pStore = new (s_aStoreMemory) SpiFlashStore;
+
+	fflush(stdout);
+	dup2(nStdout, STDOUT_FILENO);
+	close(nStdout);
+
+	return pStore;
+}
+
+static bool erase_flash() {
+	auto *pFile = fopen("spiflash.bin", "w");
+
+	if (pFile == nullptr) {
+		perror("spiflash.bin");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < 512 * 4096; i++) {
+		fputc(0xFF, pFile);
+	}
+
+	fclose(pFile);
+	return true;
+}
+
+static uint32_t sequence() {
+	uint32_t nSequence = 0;
+
+	for (uint32_t nBank = 1; nBank <= 2; nBank++) {
+		uint8_t aHeader[8];
+		spi_flash_cmd_read_fast(spi_flash_get_size() - nBank * sim::BANK_SIZE, sizeof(aHeader), aHeader);
+
+		if ((aHeader[0] == 'A') && (aHeader[3] == 0x20)) {
+			const auto n = static_cast<uint32_t>(aHeader[4] | (aHeader[5] << 8) | (aHeader[6] << 16) | (aHeader[7] << 24));
+			if (n > nSequence) {
+				nSequence = n;
+			}
+		}
+	}
+
+	return nSequence;
+}
+
+int main() {
+	srand(1);
+
+	if (!erase_flash()) {
+		return EXIT_FAILURE;
+	}
+
+	for (uint32_t nStore = 0; nStore < sim::STORES; nStore++) {
+		memset(s_aOld[nStore], 0xFF, s_aStoreSize[nStore]);
+		memset(s_aOld[nStore], 0x00, 4);
+		memcpy(s_aNew[nStore], s_aOld[nStore], s_aStoreSize[nStore]);
+	}
+
+	uint32_t nKeptOld = 0;
+	uint32_t nKeptNew = 0;
+	uint32_t nFlashCalls = 0;
+	uint32_t nDrained = 0;
+	uint64_t nFlashTime = 0;
+
+	for (uint32_t nRound = 0; nRound < sim::ROUNDS; nRound++) {
+		auto *pStore = power_on();
+
+		if (!pStore->HaveFlashChip()) {
+			puts("FAIL: no flash");
+			return EXIT_FAILURE;
+		}
+
+		for (uint32_t nStore = 0; nStore < sim::STORES; nStore++) {
+			uint8_t aData[sim::STORE_MAX];
+			uint32_t nLength;
+
+			pStore->CopyTo(static_cast<Store>(nStore), aData, nLength);
+
+			if (nLength != s_aStoreSize[nStore]) {
+				printf("FAIL: round %u, store %u has %u bytes\n", nRound, nStore, nLength);
+				return EXIT_FAILURE;
+			}
+
+			if (memcmp(aData, s_aNew[nStore], nLength) == 0) {
+				nKeptNew++;
+			} else if (memcmp(aData, s_aOld[nStore], nLength) == 0) {
+				nKeptOld++;
+			} else {
+				printf("FAIL: round %u, store %u is neither the previous nor the new contents\n", nRound, nStore);
+				return EXIT_FAILURE;
+			}
+
+			memcpy(s_aOld[nStore], aData, nLength);
+			memcpy(s_aNew[nStore], aData, nLength);
+		}
+
+		const auto nUpdates = 1 + static_cast<uint32_t>(rand()) % sim::UPDATES_MAX;
+
+		for (uint32_t i = 0; i < nUpdates; i++) {
+			const auto nStore = static_cast<uint32_t>(rand()) % sim::STORES;
+			const auto nSize = s_aStoreSize[nStore];
+			const auto nLength = 1 + static_cast<uint32_t>(rand()) % (nSize < sim::DATA_MAX ? nSize : sim::DATA_MAX);
+			const auto nOffset = static_cast<uint32_t>(rand()) % (nSize - nLength + 1);
+
+			uint8_t aData[sim::DATA_MAX];
+
+			for (uint32_t j = 0; j < nLength; j++) {
+				aData[j] = static_cast<uint8_t>(rand());
+			}
+
+			pStore->Update(static_cast<Store>(nStore), nOffset, aData, nLength);
+			memcpy(&s_aNew[nStore][nOffset], aData, nLength);
+		}
+
+		const auto bDrain = (nRound % sim::DRAIN_EVERY) == 0;
+		const auto nSteps = bDrain ? UINT32_MAX : static_cast<uint32_t>(rand()) % sim::STEPS_MAX;
+
+		for (uint32_t i = 0; i < nSteps; i++) {
+			const auto nStart = now_ns();
+			const auto bBusy = pStore->Flash();
+			nFlashTime += now_ns() - nStart;
+			nFlashCalls++;
+
+			if (!bBusy) {
+				break;
+			}
+		}
+
+		if (bDrain) {
+			// Everything is written, the previous contents are not acceptable
+			memcpy(s_aOld, s_aNew, sizeof(s_aOld));
+			nDrained++;
+		}
+	}
+
+	const auto nCompactions = sequence();
+
+	printf("%u rounds (%u drained), %u compactions\n", sim::ROUNDS, nDrained, nCompactions);
+	printf("Stores replayed: %u new, %u previous\n", nKeptNew, nKeptOld);
+	printf("Flash(): %u calls, %.1f us/call on the emulation\n", nFlashCalls, static_cast<double>(nFlashTime) / nFlashCalls / 1000.0);
+
+	if ((nCompactions < 10) || (nKeptOld == 0)) {
+		puts("FAIL: the log is not exercised");
+		return EXIT_FAILURE;
+	}
+
+	puts("PASS");
+	return EXIT_SUCCESS;
+}
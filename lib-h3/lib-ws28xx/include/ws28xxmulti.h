@@ -30,10 +30,6 @@
 
 #include "ws28xx.h"
 
-#if defined (H3)
-# include "h3_spi.h"
-#endif
-
 #include "rgbmapping.h"
 
 namespace ws28xxmulti {
@@ -43,9 +39,14 @@ enum class Board {
 namespace defaults {
 static constexpr auto BOARD = Board::X4;
 }  // namespace defaults
+struct FrameStats {
+	uint32_t nPresented;	///< Frames sent to the LEDs
+	uint32_t nDropped;		///< Frames replaced by a newer frame before they could be sent
+};
 }  // namespace ws28xxmulti
 
 struct JamSTAPLDisplay;
+struct h3_pipeline_job;
 
 class WS28xxMulti {
 public:
@@ -93,23 +94,68 @@ public:
 		}
 	}
 
-#if defined (H3)
-	bool IsUpdating() {
+	/**
+	 * Sets nLedCount consecutive LEDs of one port, pData is in DMX order (RGB, or RGBW for SK6812W).
+	 * The RGB mapping is applied.
+	 */
+	void SetPixels(uint8_t nPort, uint16_t nLedIndex, const uint8_t *pData, uint32_t nLedCount) {
 		if (m_tBoard == ws28xxmulti::Board::X8) {
-			return h3_spi_dma_tx_is_active();  // returns TRUE while DMA operation is active
+			SetPixels8x(nPort, nLedIndex, pData, nLedCount);
 		} else {
-			return false;
+			SetPixels4x(nPort, nLedIndex, pData, nLedCount);
 		}
 	}
-#else
-	bool IsUpdating(void) {
+
+	/**
+	 * 8x only: transposes LEDs nLedBegin up to nLedEnd of all the 8 ports into pBuffer, a nullptr port is set to black.
+	 * The ports are in DMX order, the RGB mapping is applied. The pipeline cores run it on the whole frame.
+	 */
+	void Transpose8x(const uint8_t * const pPorts[8], uint8_t *pBuffer, uint32_t nLedBegin, uint32_t nLedEnd) const;
+
+	/**
+	 * 8x only: the frame being composed, without the pipeline
+	 */
+	const uint8_t *GetBuffer8x() const {
+		return m_pBuffer8x;
+	}
+
+	/**
+	 * 8x only, H3: the bit transposition runs on core 1 and 2, each doing half of the LEDs,
+	 * core 3 owns the SPI DMA. Core 0 only copies the pixel data.
+	 * It must be called from core 0 after Initialize(). The cores cannot be stopped.
+	 * @return false when not supported
+	 */
+	bool StartPipeline();
+
+	bool IsPipeline() const {
+		return m_bPipeline;
+	}
+
+	/**
+	 * 8x: Update() copies the frame into a DMA buffer, so the pixel buffer can always be written.
+	 */
+	bool IsUpdating() {
+		Run();
 		return false;
 	}
-#endif
 
+	/**
+	 * 8x: the pending frame is started when the DMA transfer of the current frame has completed,
+	 * by the SPI interrupt or, with the pipeline, by core 3. It must be called from the main loop
+	 * when the pipeline is used.
+	 */
+	void Run();
+
+	/**
+	 * 8x: the latest frame wins, a frame still waiting for the DMA is replaced.
+	 */
 	void Update();
 	void Blackout();
 
+	const ws28xxmulti::FrameStats& GetFrameStats() const {
+		return m_FrameStats;
+	}
+
 // 8x
 	void SetJamSTAPLDisplay(JamSTAPLDisplay *pJamSTAPLDisplay) {
 		m_pJamSTAPLDisplay = pJamSTAPLDisplay;
@@ -131,14 +177,29 @@ private:
 	void SetColour4x(uint8_t nPort, uint16_t nLedIndex, uint8_t nColour1, uint8_t nColour2, uint8_t nColour3);
 	void SetLED4x(uint8_t nPort, uint16_t nLedIndex, uint8_t nRed, uint8_t nGreen, uint8_t nBlue);
 	void SetLED4x(uint8_t nPort, uint16_t nLedIndex, uint8_t nRed, uint8_t nGreen, uint8_t nBlue, uint8_t nWhite);
+	void SetPixels4x(uint8_t nPort, uint16_t nLedIndex, const uint8_t *pData, uint32_t nLedCount);
 // 8x
 	void SetupHC595(uint8_t nT0H, uint8_t nT1H);
 	void SetupSPI();
 	void SetupCPLD();
 	void SetupBuffers8x();
+	void Submit8x(const uint8_t *pBuffer);
+	static void DmaTxDone8x();
 	void SetColour8x(uint8_t nPort, uint16_t nLedIndex, uint8_t nColour1, uint8_t nColour2, uint8_t nColour3);
 	void SetLED8x(uint8_t nPort, uint16_t nLedIndex, uint8_t nRed, uint8_t nGreen, uint8_t nBlue);
 	void SetLED8x(uint8_t nPort, uint16_t nLedIndex, uint8_t nRed, uint8_t nGreen, uint8_t nBlue, uint8_t nWhite);
+	void SetPixels8x(uint8_t nPort, uint16_t nLedIndex, const uint8_t *pData, uint32_t nLedCount);
+	uint32_t GetColourOffsets(uint32_t nOffsets[4]) const;
+// 8x pipeline
+	uint8_t *GetPipelinePort(uint32_t nPort) const {
+		return &m_pPipelinePixels8x[m_nPipelineWrite][nPort * m_nPipelinePortSize];
+	}
+	void RunPipeline();
+	void SubmitPipeline();
+	void BlackoutPipeline();
+	static uint32_t PipelineTranspose(struct h3_pipeline_job *pJob);
+	static uint32_t PipelineOutput(struct h3_pipeline_job *pJob);
+	static void PipelinePoll();
 
 private:
 	ws28xxmulti::Board m_tBoard { ws28xxmulti::defaults::BOARD };
@@ -150,9 +211,25 @@ private:
 	uint32_t m_nBufSize { 0 };
 	uint32_t *m_pBuffer4x { nullptr };
 	uint32_t *m_pBlackoutBuffer4x { nullptr };
-	uint8_t *m_pBuffer8x { nullptr };
+	uint8_t *m_pBuffer8x { nullptr };			///< The frame being composed, normal memory
 	uint8_t *m_pBlackoutBuffer8x { nullptr };
+	uint8_t *m_pDmaBuffer8x[2] { nullptr, nullptr };
+	const uint8_t * volatile m_pFront8x { nullptr };	///< The frame being sent
+	const uint8_t * volatile m_pPending8x { nullptr };	///< The frame waiting for the DMA, started from the SPI interrupt
+	ws28xxmulti::FrameStats m_FrameStats { 0, 0 };
 	JamSTAPLDisplay *m_pJamSTAPLDisplay { nullptr };
+	// 8x pipeline, there are 2 frames: one is written by core 0, the other one is being processed
+	bool m_bPipeline { false };
+	bool m_bPipelineUpdate { false };
+	uint32_t m_nPipelineWrite { 0 };
+	uint32_t m_nPipelinePortSize { 0 };
+	uint32_t m_nPipelineInFlight[2] { 0, 0 };
+	uint8_t *m_pPipelinePixels8x[2] { nullptr, nullptr };	///< DMX ordered pixel data per port
+	uint8_t *m_pPipelineBuffer8x[2] { nullptr, nullptr };	///< The transposed frames
+#if defined (ENABLE_LATENCY_TRACE)
+	uint32_t m_nTimestamp8x { 0 };						///< The receive time of the packet of the last submitted frame
+	uint32_t m_nPipelineTimestamp8x[2] { 0, 0 };
+#endif
 
 	static WS28xxMulti *s_pThis;
 };
@@ -24,12 +24,19 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include <cassert>
 
 #include "ws28xxmulti.h"
 
 #include "h3_spi.h"
 
+#include "arm/arm.h"
+
+#if defined (ENABLE_LATENCY_TRACE)
+# include "h3_latency.h"
+#endif
+
 #include "debug.h"
 
 using namespace ws28xxmulti;
@@ -41,26 +48,57 @@ uint8_t WS28xxMulti::ReverseBits(uint8_t nBits) {
 	return static_cast<uint8_t>((output >> 24));
 }
 
+void WS28xxMulti::Run() {
+	// Without the pipeline, the SPI interrupt starts the pending frame
+	if (m_bPipeline) {
+		RunPipeline();
+	}
+}
+
 void WS28xxMulti::Update() {
-	if (m_tBoard == Board::X8) {
+	if (m_bPipeline) {
+		m_bPipelineUpdate = true;
+		RunPipeline();
+	} else if (m_tBoard == Board::X8) {
 		assert(m_pBuffer8x != nullptr);
-		assert(!h3_spi_dma_tx_is_active());
 
-		h3_spi_dma_tx_start(m_pBuffer8x, m_nBufSize);
+		// The DMA buffer which is not being sent. A pending frame is replaced, it is taken back
+		// first so that the SPI interrupt cannot start it while it is being written.
+		__disable_irq();
+		auto *pBuffer = (m_pFront8x == m_pDmaBuffer8x[0]) ? m_pDmaBuffer8x[1] : m_pDmaBuffer8x[0];
+
+		if (m_pPending8x != nullptr) {
+			m_pPending8x = nullptr;
+			m_FrameStats.nDropped++;
+		}
+		__enable_irq();
+
+		memcpy(pBuffer, m_pBuffer8x, m_nBufSize);
+
+#if defined (ENABLE_LATENCY_TRACE)
+		m_nTimestamp8x = h3_latency_packet_us;
+#endif
+		__disable_irq();
+		Submit8x(pBuffer);
+		__enable_irq();
 	} else {
 		assert(m_pBuffer4x != nullptr);
 		Generate800kHz(m_pBuffer4x);
+		m_FrameStats.nPresented++;
 	}
 }
 
 void WS28xxMulti::Blackout() {
 	DEBUG_ENTRY
 
-	if (m_tBoard == Board::X8) {
+	if (m_bPipeline) {
+		BlackoutPipeline();
+	} else if (m_tBoard == Board::X8) {
 		assert(m_pBlackoutBuffer8x != nullptr);
-		assert(!h3_spi_dma_tx_is_active());
 
-		h3_spi_dma_tx_start(m_pBlackoutBuffer8x, m_nBufSize);
+		__disable_irq();
+		Submit8x(m_pBlackoutBuffer8x);
+		__enable_irq();
 	} else {
 		Generate800kHz(m_pBlackoutBuffer4x);
 	}
@@ -32,6 +32,10 @@
 #include "h3/ws28xxdma.h"
 #include "h3_spi.h"
 
+#if defined (ENABLE_LATENCY_TRACE)
+# include "h3_latency.h"
+#endif
+
 #include "debug.h"
 
 void WS28xxMulti::SetupBuffers8x() {
@@ -39,22 +43,65 @@ void WS28xxMulti::SetupBuffers8x() {
 
 	uint32_t nSize;
 
-	m_pBuffer8x = const_cast<uint8_t*>(h3_spi_dma_tx_prepare(&nSize));
-	assert(m_pBuffer8x != nullptr);
+	auto *pDmaRegion = const_cast<uint8_t*>(h3_spi_dma_tx_prepare(&nSize));
+	assert(pDmaRegion != nullptr);
 
-	const uint32_t nSizeHalf = nSize / 2;
-	assert(m_nBufSize <= nSizeHalf);
+	// Two DMA buffers (ping-pong) and the blackout buffer
+	const uint32_t nSizeThird = (nSize / 3) & static_cast<uint32_t>(~3);
+	assert(m_nBufSize <= nSizeThird);
 
-	if (m_nBufSize > nSizeHalf) {
+	if (m_nBufSize > nSizeThird) {
 		// FIXME Handle internal error
 		return;
 	}
 
-	m_pBlackoutBuffer8x = m_pBuffer8x + (nSizeHalf & static_cast<uint32_t>(~3));
+	m_pDmaBuffer8x[0] = pDmaRegion;
+	m_pDmaBuffer8x[1] = pDmaRegion + nSizeThird;
+	m_pBlackoutBuffer8x = pDmaRegion + 2 * nSizeThird;
 
-	memset(m_pBuffer8x, 0, m_nBufSize);
+	memset(m_pDmaBuffer8x[0], 0, m_nBufSize);
+	memset(m_pDmaBuffer8x[1], 0, m_nBufSize);
 	memset(m_pBlackoutBuffer8x, 0, m_nBufSize);
 
-	DEBUG_PRINTF("nSize=%x, m_pBuffer=%p, m_pBlackoutBuffer=%p", nSize, m_pBuffer8x, m_pBlackoutBuffer8x);
+	// The frame is composed in cached memory, the bit operations are read-modify-write
+	m_pBuffer8x = new uint8_t[m_nBufSize];
+	assert(m_pBuffer8x != nullptr);
+
+	memset(m_pBuffer8x, 0, m_nBufSize);
+
+	h3_spi_dma_tx_set_callback(DmaTxDone8x);
+
+	DEBUG_PRINTF("nSize=%x, m_pDmaBuffer8x={%p,%p}, m_pBlackoutBuffer=%p", nSize, m_pDmaBuffer8x[0], m_pDmaBuffer8x[1], m_pBlackoutBuffer8x);
 	DEBUG_EXIT
 }
+
+void WS28xxMulti::Submit8x(const uint8_t *pBuffer) {
+	if (h3_spi_dma_tx_is_active()) {
+		if (m_pPending8x != nullptr) {
+			m_FrameStats.nDropped++;
+		}
+		m_pPending8x = pBuffer;
+		return;
+	}
+
+	h3_spi_dma_tx_start(pBuffer, m_nBufSize);
+
+#if defined (ENABLE_LATENCY_TRACE)
+	h3_latency_record_since(H3_LATENCY_OUTPUT, m_nTimestamp8x);
+#endif
+
+	m_pFront8x = pBuffer;
+	m_pPending8x = nullptr;
+	m_FrameStats.nPresented++;
+}
+
+/**
+ * Core 0, IRQ
+ */
+void WS28xxMulti::DmaTxDone8x() {
+	auto *pThis = s_pThis;
+
+	if (pThis->m_pPending8x != nullptr) {
+		pThis->Submit8x(pThis->m_pPending8x);
+	}
+}
@@ -0,0 +1,238 @@
+/**
+ * @file ws28xxmultipipeline.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <cassert>
+
+#include "ws28xxmulti.h"
+
+#include "h3_pipeline.h"
+#include "h3_spi.h"
+
+#if defined (ENABLE_LATENCY_TRACE)
+# include "h3_latency.h"
+#endif
+
+#include "debug.h"
+
+using namespace ws28xxmulti;
+
+/*
+ * Core 1 and 2 each transpose half of the LEDs into the compose buffer of the set.
+ * Every byte of the SPI stream holds a bit of all the 8 ports, so the work is split by LED range.
+ * Core 3 copies the completed frame into the DMA buffer and owns the SPI DMA.
+ */
+
+namespace pipeline {
+static constexpr uint32_t CORE_TRANSPOSE_FIRST = 1;
+static constexpr uint32_t CORE_TRANSPOSE_SECOND = 2;
+static constexpr uint32_t CORE_OUTPUT = 3;
+static constexpr uint32_t JOB_BLACKOUT = 0x100;
+}  // namespace pipeline
+
+static struct h3_pipeline_job s_Jobs[2][2];		///< [set][half], id = set | (half << 1)
+static struct h3_pipeline_job s_BlackoutJob;
+static bool s_bBlackoutInFlight;				///< Core 0 only
+static uint32_t s_nHalvesDone[2];				///< Core 3 only
+
+bool WS28xxMulti::StartPipeline() {
+	DEBUG_ENTRY
+
+	if ((m_tBoard != Board::X8) || (m_pBuffer8x == nullptr)) {
+		DEBUG_EXIT
+		return false;
+	}
+
+	assert(!m_bPipeline);
+
+	m_nPipelinePortSize = m_nLedCount * (m_tWS28xxType == ws28xx::Type::SK6812W ? 4U : 3U);
+
+	for (uint32_t nSet = 0; nSet < 2; nSet++) {
+		m_pPipelinePixels8x[nSet] = new uint8_t[8 * m_nPipelinePortSize];
+		assert(m_pPipelinePixels8x[nSet] != nullptr);
+
+		memset(m_pPipelinePixels8x[nSet], 0, 8 * m_nPipelinePortSize);
+
+		m_pPipelineBuffer8x[nSet] = new uint8_t[m_nBufSize];
+		assert(m_pPipelineBuffer8x[nSet] != nullptr);
+
+		memset(m_pPipelineBuffer8x[nSet], 0, m_nBufSize);
+
+		for (uint32_t nHalf = 0; nHalf < 2; nHalf++) {
+			s_Jobs[nSet][nHalf].id = nSet | (nHalf << 1);
+			s_Jobs[nSet][nHalf].arg = nullptr;
+		}
+	}
+
+	s_BlackoutJob.id = pipeline::JOB_BLACKOUT;
+	s_BlackoutJob.arg = nullptr;
+
+	// Core 3 owns the SPI DMA, the interrupt is routed to core 0
+	h3_spi_dma_tx_set_callback(nullptr);
+
+	m_nPipelineWrite = 0;
+	m_nPipelineInFlight[0] = 0;
+	m_nPipelineInFlight[1] = 0;
+	m_bPipelineUpdate = false;
+	m_bPipeline = true;
+
+	// All the stages are running before the first job is submitted
+	h3_pipeline_start(pipeline::CORE_OUTPUT, PipelineOutput, PipelinePoll);
+	h3_pipeline_start(pipeline::CORE_TRANSPOSE_FIRST, PipelineTranspose, nullptr);
+	h3_pipeline_start(pipeline::CORE_TRANSPOSE_SECOND, PipelineTranspose, nullptr);
+
+	DEBUG_PRINTF("m_nPipelinePortSize=%u", static_cast<unsigned int>(m_nPipelinePortSize));
+	DEBUG_EXIT
+	return true;
+}
+
+/**
+ * Core 0
+ */
+void WS28xxMulti::RunPipeline() {
+	struct h3_pipeline_job *pJob;
+
+	while ((pJob = h3_pipeline_completed()) != nullptr) {
+		if (pJob->id == pipeline::JOB_BLACKOUT) {
+			s_bBlackoutInFlight = false;
+		} else {
+			assert(m_nPipelineInFlight[pJob->id & 0x1] != 0);
+			m_nPipelineInFlight[pJob->id & 0x1]--;
+		}
+	}
+
+	// Core 0 continues with the other set, which must not be processed anymore
+	if (m_bPipelineUpdate && (m_nPipelineInFlight[m_nPipelineWrite ^ 0x1] == 0)) {
+		SubmitPipeline();
+	}
+}
+
+/**
+ * Core 0, the written set is passed to the pipeline. The pixel data is copied
+ * into the other set, SetPixels() can update a part of the frame only.
+ */
+void WS28xxMulti::SubmitPipeline() {
+	const auto nSet = m_nPipelineWrite;
+
+	m_nPipelineInFlight[nSet] = 2;
+#if defined (ENABLE_LATENCY_TRACE)
+	m_nPipelineTimestamp8x[nSet] = h3_latency_packet_us;
+#endif
+
+	auto isSubmitted = h3_pipeline_submit(pipeline::CORE_TRANSPOSE_FIRST, &s_Jobs[nSet][0]);
+	assert(isSubmitted);
+
+	isSubmitted = h3_pipeline_submit(pipeline::CORE_TRANSPOSE_SECOND, &s_Jobs[nSet][1]);
+	assert(isSubmitted);
+
+	(void)isSubmitted;
+
+	memcpy(m_pPipelinePixels8x[nSet ^ 0x1], m_pPipelinePixels8x[nSet], 8 * m_nPipelinePortSize);
+
+	m_nPipelineWrite = nSet ^ 0x1;
+	m_bPipelineUpdate = false;
+}
+
+/**
+ * Core 1 and 2
+ */
+uint32_t WS28xxMulti::PipelineTranspose(struct h3_pipeline_job *pJob) {
+	const auto *pThis = s_pThis;
+	const auto nSet = pJob->id & 0x1;
+	const auto nHalf = pJob->id >> 1;
+	const uint32_t nLedMiddle = pThis->m_nLedCount / 2U;
+
+	const uint8_t *pPorts[8];
+
+	for (uint32_t nPort = 0; nPort < 8; nPort++) {
+		pPorts[nPort] = &pThis->m_pPipelinePixels8x[nSet][nPort * pThis->m_nPipelinePortSize];
+	}
+
+	if (nHalf == 0) {
+		pThis->Transpose8x(pPorts, pThis->m_pPipelineBuffer8x[nSet], 0, nLedMiddle);
+	} else {
+		pThis->Transpose8x(pPorts, pThis->m_pPipelineBuffer8x[nSet], nLedMiddle, pThis->m_nLedCount);
+	}
+
+	return pipeline::CORE_OUTPUT;
+}
+
+/**
+ * Core 3
+ */
+uint32_t WS28xxMulti::PipelineOutput(struct h3_pipeline_job *pJob) {
+	auto *pThis = s_pThis;
+
+	if (pJob->id == pipeline::JOB_BLACKOUT) {
+		pThis->Submit8x(pThis->m_pBlackoutBuffer8x);
+		return 0;
+	}
+
+	const auto nSet = pJob->id & 0x1;
+
+	if (++s_nHalvesDone[nSet] == 2) {
+		s_nHalvesDone[nSet] = 0;
+
+		// The DMA buffer which is not being sent, it can hold a pending frame which is then replaced
+		auto *pBuffer = (pThis->m_pFront8x == pThis->m_pDmaBuffer8x[0]) ? pThis->m_pDmaBuffer8x[1] : pThis->m_pDmaBuffer8x[0];
+
+		memcpy(pBuffer, pThis->m_pPipelineBuffer8x[nSet], pThis->m_nBufSize);
+
+#if defined (ENABLE_LATENCY_TRACE)
+		pThis->m_nTimestamp8x = pThis->m_nPipelineTimestamp8x[nSet];
+#endif
+
+		pThis->Submit8x(pBuffer);
+	}
+
+	return 0;
+}
+
+/**
+ * Core 3, starts the pending frame when the DMA transfer of the current frame has completed.
+ */
+void WS28xxMulti::PipelinePoll() {
+	auto *pThis = s_pThis;
+
+	if ((pThis->m_pPending8x != nullptr) && !h3_spi_dma_tx_is_active()) {
+		pThis->Submit8x(pThis->m_pPending8x);
+	}
+}
+
+/**
+ * Core 0, a blackout still in the pipeline is not submitted again.
+ */
+void WS28xxMulti::BlackoutPipeline() {
+	if (s_bBlackoutInFlight) {
+		return;
+	}
+
+	s_bBlackoutInFlight = true;
+
+	const auto isSubmitted = h3_pipeline_submit(pipeline::CORE_OUTPUT, &s_BlackoutJob);
+	assert(isSubmitted);
+	(void)isSubmitted;
+}
@@ -27,6 +27,7 @@
  */
 
 #include <stdint.h>
+#include <stdio.h>
 #include <cassert>
 
 #include "ws28xxmulti.h"
@@ -53,8 +54,17 @@ void WS28xxMulti::SetupBuffers4x(void) {
 	}
 }
 
+void WS28xxMulti::Run() {
+	// Nothing todo
+}
+
+bool WS28xxMulti::StartPipeline() {
+	return false;
+}
+
 void WS28xxMulti::Update(void) {
 	Generate800kHz(m_pBuffer4x);
+	m_FrameStats.nPresented++;
 }
 
 void WS28xxMulti::Blackout(void) {
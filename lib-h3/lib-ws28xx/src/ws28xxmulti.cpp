@@ -58,6 +58,18 @@ WS28xxMulti::~WS28xxMulti() {
 		m_pBuffer4x = nullptr;
 	} else {
 		m_pBlackoutBuffer8x = nullptr;
+		m_pDmaBuffer8x[0] = nullptr;
+		m_pDmaBuffer8x[1] = nullptr;
+
+		for (uint32_t i = 0; i < 2; i++) {
+			delete[] m_pPipelineBuffer8x[i];
+			m_pPipelineBuffer8x[i] = nullptr;
+
+			delete[] m_pPipelinePixels8x[i];
+			m_pPipelinePixels8x[i] = nullptr;
+		}
+
+		delete[] m_pBuffer8x;
 		m_pBuffer8x = nullptr;
 	}
 }
@@ -178,3 +178,21 @@ void WS28xxMulti::SetLED4x(uint8_t nPort, uint16_t nLedIndex, uint8_t nRed, uint
 		j++;
 	}
 }
+
+void WS28xxMulti::SetPixels4x(uint8_t nPort, uint16_t nLedIndex, const uint8_t *pData, uint32_t nLedCount) {
+	assert(pData != nullptr);
+	assert((nLedIndex + nLedCount) <= m_nLedCount);
+
+	if (m_tWS28xxType == Type::SK6812W) {
+		for (uint32_t i = 0; i < nLedCount; i++) {
+			SetLED4x(nPort, static_cast<uint16_t>(nLedIndex + i), pData[0], pData[1], pData[2], pData[3]);
+			pData += 4;
+		}
+		return;
+	}
+
+	for (uint32_t i = 0; i < nLedCount; i++) {
+		SetLED4x(nPort, static_cast<uint16_t>(nLedIndex + i), pData[0], pData[1], pData[2]);
+		pData += 3;
+	}
+}
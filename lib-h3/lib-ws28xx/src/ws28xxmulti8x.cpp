@@ -131,6 +131,12 @@ void WS28xxMulti::SetLED8x(uint8_t nPort, uint16_t nLedIndex, uint8_t nRed, uint
 	assert(nPort < 8);
 	assert(nLedIndex < m_nLedCount);
 
+	if (m_bPipeline) {
+		const uint8_t pData[4] = { nRed, nGreen, nBlue, 0 };
+		SetPixels8x(nPort, nLedIndex, pData, 1);
+		return;
+	}
+
 	switch (m_tRGBMapping) {
 	case rgbmapping::Map::RGB:
 		SetColour8x(nPort, nLedIndex, nRed, nGreen, nBlue);
@@ -161,6 +167,12 @@ void WS28xxMulti::SetLED8x(uint8_t nPort, uint16_t nLedIndex, uint8_t nRed, uint
 	assert(nLedIndex < m_nLedCount);
 	assert(m_tWS28xxType == Type::SK6812W);
 
+	if (m_bPipeline) {
+		const uint8_t pData[4] = { nRed, nGreen, nBlue, nWhite };
+		SetPixels8x(nPort, nLedIndex, pData, 1);
+		return;
+	}
+
 	uint32_t j = 0;
 	const auto k = static_cast<uint32_t>(nLedIndex * ws28xx::single::RGBW);
 
@@ -193,3 +205,126 @@ void WS28xxMulti::SetLED8x(uint8_t nPort, uint16_t nLedIndex, uint8_t nRed, uint
 		j++;
 	}
 }
+
+/*
+ * Bulk updates
+ * Each colour byte is 8 buffer bytes, MSB first. Bit n of a buffer byte is port n.
+ */
+
+/**
+ * Byte j of the result is bit (7 - j) of nColour
+ */
+static inline uint64_t spread_bits(uint8_t nColour) {
+	const auto nBits = (nColour * 0x0101010101010101ULL) & 0x0102040810204080ULL;
+	return ((nBits + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+}
+
+/**
+ * 8x8 bit matrix transpose (Hacker's Delight 7-3), byte p of x is the colour byte of port p.
+ * Byte j of the result is bit (7 - j) of all the ports.
+ */
+static inline uint64_t transpose_bits(uint64_t x) {
+	uint64_t t;
+
+	t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+	x = x ^ t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+	x = x ^ t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+	x = x ^ t ^ (t << 28);
+
+	return __builtin_bswap64(x);
+}
+
+/**
+ * @return The number of colours per LED, nOffsets is the order in which the DMX channels are sent
+ */
+uint32_t WS28xxMulti::GetColourOffsets(uint32_t nOffsets[4]) const {
+	if (m_tWS28xxType == Type::SK6812W) {
+		// GRBW
+		nOffsets[0] = 1;
+		nOffsets[1] = 0;
+		nOffsets[2] = 2;
+		nOffsets[3] = 3;
+		return 4;
+	}
+
+	switch (m_tRGBMapping) {
+	case rgbmapping::Map::RGB:
+		nOffsets[0] = 0; nOffsets[1] = 1; nOffsets[2] = 2;
+		break;
+	case rgbmapping::Map::RBG:
+		nOffsets[0] = 0; nOffsets[1] = 2; nOffsets[2] = 1;
+		break;
+	case rgbmapping::Map::GBR:
+		nOffsets[0] = 1; nOffsets[1] = 2; nOffsets[2] = 0;
+		break;
+	case rgbmapping::Map::BRG:
+		nOffsets[0] = 2; nOffsets[1] = 0; nOffsets[2] = 1;
+		break;
+	case rgbmapping::Map::BGR:
+		nOffsets[0] = 2; nOffsets[1] = 1; nOffsets[2] = 0;
+		break;
+	case rgbmapping::Map::GRB:
+	default:
+		nOffsets[0] = 1; nOffsets[1] = 0; nOffsets[2] = 2;
+		break;
+	}
+
+	return 3;
+}
+
+void WS28xxMulti::SetPixels8x(uint8_t nPort, uint16_t nLedIndex, const uint8_t *pData, uint32_t nLedCount) {
+	assert(nPort < 8);
+	assert(pData != nullptr);
+	assert((nLedIndex + nLedCount) <= m_nLedCount);
+
+	uint32_t nOffsets[4];
+	const auto nColours = GetColourOffsets(nOffsets);
+
+	if (m_bPipeline) {
+		// The RGB mapping and the transposition are done by the pipeline
+		memcpy(&GetPipelinePort(nPort)[nLedIndex * nColours], pData, nLedCount * nColours);
+		return;
+	}
+
+	const auto nMask = ~(0x0101010101010101ULL << nPort);
+	auto *pBuffer = &m_pBuffer8x[nLedIndex * nColours * 8];
+
+	for (uint32_t i = 0; i < nLedCount; i++) {
+		for (uint32_t nColour = 0; nColour < nColours; nColour++) {
+			uint64_t nBits;
+			memcpy(&nBits, pBuffer, sizeof(uint64_t));
+			nBits = (nBits & nMask) | (spread_bits(pData[nOffsets[nColour]]) << nPort);
+			memcpy(pBuffer, &nBits, sizeof(uint64_t));
+			pBuffer += sizeof(uint64_t);
+		}
+
+		pData += nColours;
+	}
+}
+
+void WS28xxMulti::Transpose8x(const uint8_t * const pPorts[8], uint8_t *pBuffer, uint32_t nLedBegin, uint32_t nLedEnd) const {
+	uint32_t nOffsets[4];
+	const auto nColours = GetColourOffsets(nOffsets);
+
+	pBuffer += nLedBegin * nColours * 8;
+
+	for (uint32_t i = nLedBegin; i < nLedEnd; i++) {
+		const auto nPixel = i * nColours;
+
+		for (uint32_t nColour = 0; nColour < nColours; nColour++) {
+			uint64_t nBits = 0;
+
+			for (uint32_t nPort = 0; nPort < 8; nPort++) {
+				if (pPorts[nPort] != nullptr) {
+					nBits |= static_cast<uint64_t>(pPorts[nPort][nPixel + nOffsets[nColour]]) << (nPort * 8);
+				}
+			}
+
+			nBits = transpose_bits(nBits);
+			memcpy(pBuffer, &nBits, sizeof(uint64_t));
+			pBuffer += sizeof(uint64_t);
+		}
+	}
+}
@@ -0,0 +1,67 @@
+/**
+ * @file stubs.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * The board setup of the 8x is not needed for composing frames on the host
+ */
+
+#include <cstdint>
+
+#include "jamstapl.h"
+#include "si5351a.h"
+
+uint32_t PIXEL8X4_PROGRAM;
+
+extern "C" {
+uint32_t getPIXEL8X4_SIZE() {
+	return 0;
+}
+}
+
+void JamSTAPL::PlatformInit(__attribute__((unused)) bool bVerbose) {
+}
+
+JBI_RETURN_TYPE JamSTAPL::PrintInfo() {
+	return JBIC_IO_ERROR;
+}
+
+JBI_RETURN_TYPE JamSTAPL::CheckCRC(__attribute__((unused)) bool bVerbose) {
+	return JBIC_IO_ERROR;
+}
+
+void JamSTAPL::CheckIdCode() {
+}
+
+void JamSTAPL::ReadUsercode() {
+}
+
+void JamSTAPL::Program() {
+}
+
+SI5351A::SI5351A(uint8_t nAddress) : HAL_I2C(nAddress) {
+}
+
+void SI5351A::ClockBuilder() {
+}
@@ -0,0 +1,160 @@
+/**
+ * @file transpose.cpp
+ *
+ */
+/* Copyright (C) 2021 by Arjan van Vught mailto:info@orangepi-dmx.nl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Checks the bulk updates of the 8x against the per LED update, and measures
+ * the 3 ways of composing a frame:
+ * - SetLED, one LED of one port at a time
+ * - SetPixels, a universe of one port at a time, as done by WS28xxDmxMulti
+ * - Transpose8x, all the ports at once, as done by the pipeline cores
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "ws28xxmulti.h"
+
+namespace bench {
+static constexpr uint32_t PORTS = 8;
+static constexpr uint32_t LED_COUNT = ws28xx::max::ledcount::RGB;
+static constexpr uint32_t LEDS_PER_UNIVERSE = 170;
+static constexpr uint32_t BLACK_PORT = 5;	///< Set to black, this is a nullptr port for Transpose8x
+static constexpr uint32_t FRAMES = 2000;
+}  // namespace bench
+
+static uint8_t s_Pixels[bench::PORTS][bench::LED_COUNT * 3];
+static uint8_t s_PerLed[bench::LED_COUNT * ws28xx::single::RGB];
+static uint8_t s_Transposed[bench::LED_COUNT * ws28xx::single::RGB];
+static const uint8_t *s_pPorts[bench::PORTS];
+
+static uint64_t now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static void fill() {
+	for (uint32_t nPort = 0; nPort < bench::PORTS; nPort++) {
+		for (uint32_t i = 0; i < sizeof(s_Pixels[0]); i++) {
+			s_Pixels[nPort][i] = (nPort == bench::BLACK_PORT) ? 0 : static_cast<uint8_t>(rand());
+		}
+
+		s_pPorts[nPort] = (nPort == bench::BLACK_PORT) ? nullptr : s_Pixels[nPort];
+	}
+}
+
+static void setLeds(WS28xxMulti& multi) {
+	for (uint32_t nPort = 0; nPort < bench::PORTS; nPort++) {
+		const auto *p = s_Pixels[nPort];
+
+		for (uint32_t i = 0; i < bench::LED_COUNT; i++) {
+			multi.SetLED(static_cast<uint8_t>(nPort), static_cast<uint16_t>(i), p[0], p[1], p[2]);
+			p += 3;
+		}
+	}
+}
+
+static void setPixels(WS28xxMulti& multi) {
+	for (uint32_t nPort = 0; nPort < bench::PORTS; nPort++) {
+		for (uint32_t i = 0; i < bench::LED_COUNT; i += bench::LEDS_PER_UNIVERSE) {
+			multi.SetPixels(static_cast<uint8_t>(nPort), static_cast<uint16_t>(i), &s_Pixels[nPort][i * 3], bench::LEDS_PER_UNIVERSE);
+		}
+	}
+}
+
+static bool test(WS28xxMulti& multi) {
+	bool bPass = true;
+
+	for (uint32_t nRun = 0; nRun < 4; nRun++) {
+		fill();
+
+		setLeds(multi);
+		memcpy(s_PerLed, multi.GetBuffer8x(), sizeof(s_PerLed));
+
+		memset(const_cast<uint8_t *>(multi.GetBuffer8x()), 0xA5, sizeof(s_PerLed));
+		setPixels(multi);
+
+		if (memcmp(s_PerLed, multi.GetBuffer8x(), sizeof(s_PerLed)) != 0) {
+			puts("FAIL: SetPixels");
+			bPass = false;
+		}
+
+		// In 2 halves, as the pipeline does
+		memset(s_Transposed, 0xA5, sizeof(s_Transposed));
+		multi.Transpose8x(s_pPorts, s_Transposed, 0, bench::LED_COUNT / 2);
+		multi.Transpose8x(s_pPorts, s_Transposed, bench::LED_COUNT / 2, bench::LED_COUNT);
+
+		if (memcmp(s_PerLed, s_Transposed, sizeof(s_PerLed)) != 0) {
+			puts("FAIL: Transpose8x");
+			bPass = false;
+		}
+	}
+
+	return bPass;
+}
+
+template<typename F>
+static double measure(F f) {
+	const auto nStart = now_ns();
+
+	for (uint32_t i = 0; i < bench::FRAMES; i++) {
+		s_Pixels[0][i % sizeof(s_Pixels[0])]++;	// Changed data, as with a running show
+		f();
+	}
+
+	return static_cast<double>(now_ns() - nStart) / (bench::FRAMES * 1000);
+}
+
+int main() {
+	srand(1);
+
+	WS28xxMulti multi;
+	multi.Initialize(ws28xx::Type::WS2812B, bench::LED_COUNT, rgbmapping::Map::GRB, 0, 0);
+
+	if ((multi.GetBoard() != ws28xxmulti::Board::X8) || (multi.GetLEDCount() != bench::LED_COUNT)) {
+		puts("FAIL: no 8x board");
+		return 1;
+	}
+
+	if (!test(multi)) {
+		puts("FAIL");
+		return 1;
+	}
+
+	const auto fSetLed = measure([&multi] { setLeds(multi); });
+	const auto fSetPixels = measure([&multi] { setPixels(multi); });
+	const auto fTranspose = measure([&multi] { multi.Transpose8x(s_pPorts, s_Transposed, 0, bench::LED_COUNT); });
+
+	printf("8 ports x %u LEDs  us/frame\n", bench::LED_COUNT);
+	printf("SetLED            %8.1f\n", fSetLed);
+	printf("SetPixels         %8.1f\n", fSetPixels);
+	printf("Transpose8x       %8.1f\n", fTranspose);
+
+	puts("PASS");
+	return 0;
+}
@@ -102,6 +102,10 @@ public:
 		return ws28xxmulti::Board::UNKNOWN;
 	}
 
+	void Run() {
+		m_pLEDStripe->Run();
+	}
+
 	void SetTestPattern(pixelpatterns::Pattern TestPattern);
 	void RunTestPattern();
 
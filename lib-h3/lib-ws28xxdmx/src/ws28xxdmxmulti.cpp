@@ -107,7 +107,6 @@ void WS28xxDmxMulti::SetData(uint8_t nPortId, const uint8_t* pData, uint16_t nLe
 	assert(nLength <= DMX_UNIVERSE_SIZE);
 	assert(m_pLEDStripe != nullptr);
 
-	uint32_t i = 0;
 	uint32_t beginIndex, endIndex;
 
 #if defined (NODE_ARTNET)
@@ -150,21 +149,8 @@ void WS28xxDmxMulti::SetData(uint8_t nPortId, const uint8_t* pData, uint16_t nLe
 		// wait for completion
 	}
 
-	for (uint32_t j = beginIndex; j < endIndex; j++) {
-		__builtin_prefetch(&pData[i]);
-		if (m_tLedType == Type::SK6812W) {
-			if (i + 3 > nLength) {
-				break;
-			}
-			m_pLEDStripe->SetLED(nOutIndex, j, pData[i], pData[i + 1], pData[i + 2], pData[i + 3]);
-			i = i + 4;
-		} else {
-			if (i + 2 > nLength) {
-				break;
-			}
-			m_pLEDStripe->SetLED(nOutIndex, j, pData[i], pData[i + 1], pData[i + 2]);
-			i = i + 3;
-		}
+	if (endIndex > beginIndex) {
+		m_pLEDStripe->SetPixels(static_cast<uint8_t>(nOutIndex), static_cast<uint16_t>(beginIndex), pData, endIndex - beginIndex);
 	}
 
 	if (nPortId == m_nPortIdLast) {
@@ -119,6 +119,7 @@ void notmain(void) {
 	}
 
 	ws28xxDmxMulti.Initialize();
+	WS28xxMulti::Get()->StartPipeline();
 	ws28xxDmxMulti.SetLightSetHandler(new WS28xxDmxStartSop);
 
 	const auto nActivePorts = ws28xxDmxMulti.GetActivePorts();
@@ -244,6 +245,7 @@ void notmain(void) {
 		hw.WatchdogFeed();
 		nw.Run();
 		node.Run();
+		ws28xxDmxMulti.Run();
 		remoteConfig.Run();
 		llrpOnlyDevice.Run();
 		spiFlashStore.Flash();
@@ -125,6 +125,7 @@ void notmain(void) {
 	}
 
 	ws28xxDmxMulti.Initialize();
+	WS28xxMulti::Get()->StartPipeline();
 	ws28xxDmxMulti.SetLightSetHandler(new WS28xxDmxStartSop);
 
 	bridge.SetDirectUpdate(true);
@@ -231,6 +232,7 @@ void notmain(void) {
 		hw.WatchdogFeed();
 		nw.Run();
 		bridge.Run();
+		ws28xxDmxMulti.Run();
 		remoteConfig.Run();
 		llrpOnlyDevice.Run();
 		spiFlashStore.Flash();
@@ -66,6 +66,7 @@
 
 // Format handlers
 #include "olashowfile.h"
+#include "binaryshowfile.h"
 
 // Protocol handlers
 #include "showfileprotocole131.h"
@@ -105,8 +106,9 @@ void notmain(void) {
 	ShowFile *pShowFile = nullptr;
 
 	switch (showFileParams.GetFormat()) {
-//		case SHOWFILE_FORMAT_:
-//			break;
+		case ShowFileFormats::BINARY:
+			pShowFile = new BinaryShowFile;
+			break;
 		default:
 			pShowFile = new OlaShowFile;
 			break;
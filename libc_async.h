@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 Ulrich Hecht
+
+// Asynchronous libc calls (Jailhouse only)
+
+// Calls are prepared in submission queue entries (SQEs) and handed to the
+// libc server in batches. Their results arrive in completion queue entries
+// (CQEs), in any order, identified by user_data. Many calls can be in flight
+// at the same time, and the application does not have to wait for them.
+
+// The functions below must only be used from one context (one core, not
+// from interrupt handlers). The regular libc functions stay usable from
+// anywhere at the same time.
+
+// libc_submit() flushes the bulk stream (see libc_io_jh.c) of every file an
+// SQE uses, so the call sees the data written before and the file position
+// of the data read before. Synchronous reads and writes of the same file
+// made while the call is in flight are not ordered against it.
+
+// Example: read a file without blocking
+
+//   struct libc_sqe *sqe = libc_get_sqe();
+//   libc_prep_call(sqe, LIBC_OPEN, (uint32_t)path, O_RDONLY, 0, 0);
+//   sqe->flags |= LIBC_SQE_LINK;
+//   sqe = libc_get_sqe();
+//   libc_prep_call(sqe, LIBC_READ, 0, (uint32_t)buf, size, 0);
+//   sqe->flags |= LIBC_SQE_LINK | LIBC_SQE_FD_FROM_LINK;
+//   sqe->user_data = 1;
+//   sqe = libc_get_sqe();
+//   libc_prep_call(sqe, LIBC_CLOSE, 0, 0, 0, 0);
+//   sqe->flags |= LIBC_SQE_FD_FROM_LINK;
+//   libc_submit();
+//
+//   ...each frame:
+//   struct libc_cqe *cqe;
+//   while ((cqe = libc_peek_cqe()) != NULL) {
+//       if (cqe->user_data == 1)
+//           bytes_read = cqe->retval;
+//       libc_cqe_seen();
+//   }
+
+#ifndef _LIBC_ASYNC_H
+#define _LIBC_ASYNC_H
+
+#include "libc_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns the next free SQE, or NULL if the queue is full or too many calls
+// are in flight. The SQE is passed to the server by the next libc_submit().
+struct libc_sqe *libc_get_sqe(void);
+
+static inline void libc_prep_call(struct libc_sqe *sqe, int func, uint32_t arg0,
+                                  uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+    sqe->func = func;
+    sqe->args[0] = arg0;
+    sqe->args[1] = arg1;
+    sqe->args[2] = arg2;
+    sqe->args[3] = arg3;
+}
+
+// Submits all SQEs obtained since the last call. Returns their number.
+int libc_submit(void);
+
+// Returns the oldest unseen CQE without blocking, or NULL if there is none.
+struct libc_cqe *libc_peek_cqe(void);
+// Like libc_peek_cqe(), but waits for a completion. Returns NULL if no calls
+// are in flight.
+struct libc_cqe *libc_wait_cqe(void);
+// Releases the CQE returned by libc_peek_cqe() or libc_wait_cqe().
+void libc_cqe_seen(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
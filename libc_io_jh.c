@@ -9,6 +9,7 @@
 #include "smp.h"
 #include "spinlock.h"
 #include "libc_server.h"
+#include "libc_async.h"
 #include "fixed_addr.h"
 
 //#define DEBUG_LIBC
@@ -57,35 +58,157 @@ static int console_write(const void *buf, size_t n)
 }
 
 struct libc_call_buffer *callbuf = (struct libc_call_buffer *)LIBC_CALL_BUFFER_ADDR;
-static spinlock_t libc_lock;
 
-static uint32_t libc_call(int func, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3, int *_errno)
+static void wait_for_server(void)
 {
 	while (callbuf->magic != LIBC_SERVER_READY_MAGIC) {
 		asm("wfe");
 	}
+}
+
+// Set while a core has a synchronous call in flight, see libc_server.h.
+static int sync_call_busy[LIBC_SYNC_SLOTS];
+
+static uint32_t libc_call(int func, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3, int *_errno)
+{
+	wait_for_server();
 
-	spin_lock(&libc_lock);
+	int core = smp_get_core_id();
 
-	struct libc_call *call = &callbuf->calls[callbuf->write_pos];
+	if (sync_call_busy[core]) {
+		uart_print("libc call nested in another on the same core\r\n");
+		*_errno = EBUSY;
+		return (func == LIBC_OPENDIR || func == LIBC_READDIR || func == LIBC_GETCWD) ? 0 : (uint32_t)-1;
+	}
+
+	sync_call_busy[core] = 1;
+
+	// Every core has its own call slot, so no locking is needed.
+	struct libc_call *call = &callbuf->sync_calls[core];
 	call->func = func;
 	call->args[0] = arg0;
 	call->args[1] = arg1;
 	call->args[2] = arg2;
 	call->args[3] = arg3;
 	call->processed = 0;
+	__atomic_store_n(&call->pending, 1, __ATOMIC_RELEASE);
+
+	comm_ring(&callbuf->doorbell);
+	while (__atomic_load_n(&call->processed, __ATOMIC_ACQUIRE) == 0) {
+		asm("wfe");
+	}
+
+	*_errno = call->_errno;
+	uint32_t retval = call->retval;
+
+	sync_call_busy[core] = 0;
+
+	return retval;
+}
+
+// Asynchronous calls, see libc_async.h. Only used from one context.
+
+static uint32_t sq_tail;	// next SQE to hand out
+static uint32_t in_flight;	// submitted, completion not yet seen
+static uint32_t prepared;	// handed out, not yet submitted
+
+static int bulk_flush(int fd, int *_errno);
+
+// Ends the bulk stream the call of an SQE would see, as the synchronous call
+// does: data written behind goes out first, and the file position does not
+// include read ahead. A file opened in the same chain has no stream.
+static void bulk_flush_sqe(const struct libc_sqe *sqe)
+{
+	int eno;
+
+	switch (sqe->func) {
+	case LIBC_WRITE:
+	case LIBC_READ:
+	case LIBC_LSEEK:
+	case LIBC_FSTAT:
+	case LIBC_CLOSE:
+		if (!(sqe->flags & LIBC_SQE_FD_FROM_LINK))
+			bulk_flush(sqe->args[0], &eno);
+		break;
+	case LIBC_UNLINK:
+	case LIBC_STAT:
+	case LIBC_RENAME:
+		bulk_flush(-1, &eno);
+		break;
+	}
+}
+
+struct libc_sqe *libc_get_sqe(void)
+{
+	wait_for_server();
+
+	uint32_t sq_head = __atomic_load_n(&callbuf->sq_head, __ATOMIC_ACQUIRE);
+
+	if (sq_tail - sq_head >= LIBC_SQ_SIZE)
+		return NULL;
+
+	// Every call gets a completion entry, make sure there is room for it.
+	if (in_flight + prepared >= LIBC_CQ_SIZE)
+		return NULL;
+
+	struct libc_sqe *sqe = &callbuf->sq[sq_tail & (LIBC_SQ_SIZE - 1)];
+	sq_tail++;
+	prepared++;
+
+	sqe->flags = 0;
+	sqe->user_data = 0;
+
+	return sqe;
+}
+
+int libc_submit(void)
+{
+	int submitted = prepared;
+
+	if (submitted == 0)
+		return 0;
+
+	// Not called from interrupt handlers, so the flush cannot be nested.
+	for (uint32_t i = sq_tail - prepared; i != sq_tail; i++)
+		bulk_flush_sqe(&callbuf->sq[i & (LIBC_SQ_SIZE - 1)]);
+
+	__atomic_store_n(&callbuf->sq_tail, sq_tail, __ATOMIC_RELEASE);
+	in_flight += prepared;
+	prepared = 0;
+
+	// One doorbell for the whole batch.
+	comm_ring(&callbuf->doorbell);
+
+	return submitted;
+}
+
+struct libc_cqe *libc_peek_cqe(void)
+{
+	uint32_t cq_head = callbuf->cq_head;
+
+	if (cq_head == __atomic_load_n(&callbuf->cq_tail, __ATOMIC_ACQUIRE))
+		return NULL;
 
-	callbuf->write_pos = (callbuf->write_pos + 1) % LIBC_CALL_BUFFER_SIZE;
+	return &callbuf->cq[cq_head & (LIBC_CQ_SIZE - 1)];
+}
 
-	spin_unlock(&libc_lock);
+struct libc_cqe *libc_wait_cqe(void)
+{
+	struct libc_cqe *cqe;
 
-	asm("sev");
-	while (call->processed == 0) {
+	while ((cqe = libc_peek_cqe()) == NULL) {
+		if (in_flight == 0)
+			return NULL;
 		asm("wfe");
 	}
 
-	*_errno = call->_errno;
-	return call->retval;
+	return cqe;
+}
+
+void libc_cqe_seen(void)
+{
+	__atomic_store_n(&callbuf->cq_head, callbuf->cq_head + 1, __ATOMIC_RELEASE);
+	in_flight--;
 }
 
 #define LIBC_CALL0(func, eno) libc_call(func, 0, 0, 0, 0, &eno)
@@ -93,6 +216,381 @@ static uint32_t libc_call(int func, uint32_t arg0, uint32_t arg1, uint32_t arg2,
 #define LIBC_CALL2(func, eno, arg0, arg1) libc_call(func, (uint32_t)arg0, (uint32_t)arg1, 0, 0, &eno)
 #define LIBC_CALL3(func, eno, arg0, arg1, arg2) libc_call(func, (uint32_t)arg0, (uint32_t)arg1, (uint32_t)arg2, 0, &eno)
 
+// Bulk data channel, see libc_server.h
+
+// Writes of regular files of at least BULK_MIN_SIZE bytes start a stream on
+// that file, which collects the data in the bulk buffers and has the server
+// write them behind the application's back. A read stream is started by the
+// second read of at least BULK_MIN_SIZE bytes in a row from the same file.
+// It reads one buffer ahead at first, and doubles that each time a buffer
+// has been used up, up to all bulk buffers. There is only one stream at a
+// time; it ends with any other operation on the file (or when another file
+// starts a stream), at which point written data is flushed and the file
+// position is corrected for data that was read ahead but not used.
+
+// An error of a write behind is reported by the next write or close of the
+// file.
+
+// bulk_lock is held while waiting for the server. Another core simply waits
+// for it, but an interrupt handler doing file I/O while the code it
+// interrupted holds the lock would wait forever; it fails with EBUSY
+// instead, like a nested synchronous call.
+
+#define BULK_MIN_SIZE 4096
+
+static uint8_t bulk_pool[LIBC_BULK_BUFFERS][LIBC_BULK_BUFFER_SIZE] __attribute__((aligned(64)));
+static spinlock_t bulk_lock;
+static int bulk_busy[LIBC_SYNC_SLOTS];	// the core holds or is taking bulk_lock
+
+static struct {
+	int fd;			// -1 if there is no stream
+	int op;
+	uint32_t head;		// oldest buffer not taken back yet
+	uint32_t tail;		// next buffer to hand to the server
+	uint32_t fill;		// write: bytes in the buffer at tail
+	uint32_t offset;	// read: bytes used of the buffer at head
+	uint32_t window;	// read: buffers to keep reading ahead
+	int eof;		// read: no more read ahead
+} stream = { .fd = -1 };
+
+static int bulk_read_fd = -1;	// last large read, if nothing else happened since
+static int bulk_skip_fd = -1;	// not a regular file
+static int bulk_error_fd = -1;	// failed write behind
+static int bulk_error;
+
+// Returns 0 if this core holds the lock already.
+static int bulk_lock_take(void)
+{
+	int core = smp_get_core_id();
+
+	if (bulk_busy[core]) {
+		uart_print("file I/O nested in a bulk transfer on the same core\r\n");
+		return 0;
+	}
+
+	// Set first, an interrupt right after spin_lock() must see it.
+	bulk_busy[core] = 1;
+	spin_lock(&bulk_lock);
+
+	return 1;
+}
+
+static void bulk_lock_give(void)
+{
+	spin_unlock(&bulk_lock);
+	bulk_busy[smp_get_core_id()] = 0;
+}
+
+static struct libc_bulk *bulk_desc(uint32_t n)
+{
+	return &callbuf->bulk[n & (LIBC_BULK_BUFFERS - 1)];
+}
+
+static uint8_t *bulk_buf(uint32_t n)
+{
+	return bulk_pool[n & (LIBC_BULK_BUFFERS - 1)];
+}
+
+static void bulk_hand_over(uint32_t length)
+{
+	struct libc_bulk *bulk = bulk_desc(stream.tail);
+
+	bulk->op = stream.op;
+	bulk->fd = stream.fd;
+	bulk->length = length;
+	bulk->owner = LIBC_BULK_OWNER_SERVER;
+
+	stream.tail++;
+	__atomic_store_n(&callbuf->bulk_tail, stream.tail, __ATOMIC_RELEASE);
+
+	comm_ring(&callbuf->doorbell);
+}
+
+static int bulk_head_done(void)
+{
+	return __atomic_load_n(&bulk_desc(stream.head)->owner, __ATOMIC_ACQUIRE) == LIBC_BULK_OWNER_CLIENT;
+}
+
+// Waits until the server has handed back the oldest buffer.
+static struct libc_bulk *bulk_wait_head(void)
+{
+	while (!bulk_head_done()) {
+		asm("wfe");
+	}
+
+	return bulk_desc(stream.head);
+}
+
+static void bulk_take_back_write(void)
+{
+	struct libc_bulk *bulk = bulk_wait_head();
+
+	if (bulk->result < 0 && bulk_error_fd < 0) {
+		bulk_error_fd = stream.fd;
+		bulk_error = bulk->_errno;
+	}
+
+	stream.head++;
+}
+
+static void bulk_read_ahead(void)
+{
+	while (!stream.eof && stream.tail - stream.head < stream.window)
+		bulk_hand_over(LIBC_BULK_BUFFER_SIZE);
+}
+
+static void bulk_stream_end(void)
+{
+	if (stream.fd < 0)
+		return;
+
+	if (stream.op == LIBC_BULK_WRITE) {
+		if (stream.fill != 0) {
+			bulk_hand_over(stream.fill);
+			stream.fill = 0;
+		}
+
+		while (stream.head != stream.tail)
+			bulk_take_back_write();
+	} else {
+		uint32_t unused = 0;
+
+		while (stream.head != stream.tail) {
+			struct libc_bulk *bulk = bulk_wait_head();
+
+			if (bulk->result > 0)
+				unused += bulk->result - stream.offset;
+
+			stream.offset = 0;
+			stream.head++;
+		}
+
+		// Give the data read ahead back to the file.
+		if (unused != 0) {
+			int eno;
+			uint32_t pos = libc_call(LIBC_LSEEK, stream.fd, 0, SEEK_CUR, 0, &eno);
+			libc_call(LIBC_LSEEK, stream.fd, pos - unused, SEEK_SET, 0, &eno);
+		}
+	}
+
+	stream.fd = -1;
+}
+
+static int bulk_stream_start(int fd, int op)
+{
+	bulk_stream_end();
+
+	if (fd == bulk_skip_fd)
+		return 0;
+
+	// Reading ahead would swallow data from pipes and terminals.
+	struct stat st;
+	int eno;
+	if (libc_call(LIBC_FSTAT, fd, (uint32_t)&st, 0, 0, &eno) != 0 || !S_ISREG(st.st_mode)) {
+		bulk_skip_fd = fd;
+		return 0;
+	}
+
+	callbuf->bulk_pool = (param_t)(uint32_t)bulk_pool;
+
+	stream.fd = fd;
+	stream.op = op;
+	stream.head = stream.tail = callbuf->bulk_tail;
+	stream.fill = 0;
+	stream.offset = 0;
+	stream.window = 1;
+	stream.eof = 0;
+
+	if (op == LIBC_BULK_READ)
+		bulk_read_ahead();
+
+	return 1;
+}
+
+// Ends the stream of fd, if any. Returns the error of a failed write behind
+// to fd, which is reported only once, or -1 if the stream could not be
+// ended, see bulk_lock.
+static int bulk_release(int fd)
+{
+	int err = 0;
+
+	if (!bulk_lock_take())
+		return -1;
+
+	if (stream.fd == fd)
+		bulk_stream_end();
+
+	if (bulk_error_fd == fd) {
+		err = bulk_error;
+		bulk_error_fd = -1;
+	}
+
+	if (bulk_skip_fd == fd)
+		bulk_skip_fd = -1;
+
+	if (bulk_read_fd == fd)
+		bulk_read_fd = -1;
+
+	bulk_lock_give();
+
+	return err;
+}
+
+// Ends the stream of fd, or any stream if fd is -1. Returns -1 with
+// *_errno set if that is not possible, see bulk_lock.
+static int bulk_flush(int fd, int *_errno)
+{
+	if (!bulk_lock_take()) {
+		*_errno = EBUSY;
+		return -1;
+	}
+
+	if (fd < 0 || stream.fd == fd)
+		bulk_stream_end();
+	if (bulk_read_fd == fd)
+		bulk_read_fd = -1;
+
+	bulk_lock_give();
+
+	return 0;
+}
+
+// Returns the number of bytes written to the bulk buffers, 0 if the stream
+// is not used for this write, or -1 with *_errno set for a failed write
+// behind or a nested call.
+static int bulk_write(int fd, const void *buf, size_t n, int *_errno)
+{
+	const uint8_t *src = buf;
+	int ret = n;
+
+	if (!bulk_lock_take()) {
+		*_errno = EBUSY;
+		return -1;
+	}
+
+	if (bulk_error_fd == fd) {
+		bulk_error_fd = -1;
+		*_errno = bulk_error;
+		ret = -1;
+		goto out;
+	}
+
+	if (stream.fd == fd && stream.op != LIBC_BULK_WRITE)
+		bulk_stream_end();
+
+	if (bulk_read_fd == fd)
+		bulk_read_fd = -1;
+
+	if (stream.fd != fd) {
+		if (n < BULK_MIN_SIZE || !bulk_stream_start(fd, LIBC_BULK_WRITE)) {
+			ret = 0;
+			goto out;
+		}
+	}
+
+	// Take back finished buffers early to see errors.
+	while (stream.head != stream.tail && bulk_head_done())
+		bulk_take_back_write();
+
+	while (n != 0) {
+		if (stream.fill == 0 && stream.tail - stream.head == LIBC_BULK_BUFFERS)
+			bulk_take_back_write();
+
+		uint32_t chunk = LIBC_BULK_BUFFER_SIZE - stream.fill;
+		if (chunk > n)
+			chunk = n;
+
+		memcpy(bulk_buf(stream.tail) + stream.fill, src, chunk);
+		stream.fill += chunk;
+		src += chunk;
+		n -= chunk;
+
+		if (stream.fill == LIBC_BULK_BUFFER_SIZE) {
+			bulk_hand_over(LIBC_BULK_BUFFER_SIZE);
+			stream.fill = 0;
+		}
+	}
+
+out:
+	bulk_lock_give();
+	return ret;
+}
+
+// Returns 1 if the read was done from the stream, with the result in *ret.
+static int bulk_read(int fd, void *ptr, size_t n, int *ret, int *_errno)
+{
+	uint8_t *dst = ptr;
+	size_t copied = 0;
+
+	if (!bulk_lock_take()) {
+		*_errno = EBUSY;
+		*ret = -1;
+		return 1;
+	}
+
+	if (stream.fd == fd && stream.op == LIBC_BULK_READ && stream.eof && stream.head == stream.tail) {
+		// Everything up to the former end of the file has been used, the
+		// file may have grown since.
+		bulk_stream_end();
+	}
+
+	if (stream.fd == fd && stream.op != LIBC_BULK_READ)
+		bulk_stream_end();
+
+	if (stream.fd != fd) {
+		if (n < BULK_MIN_SIZE || bulk_read_fd != fd || !bulk_stream_start(fd, LIBC_BULK_READ)) {
+			// A single large read is done directly; a read ahead would
+			// mostly fetch data that is not used.
+			if (n >= BULK_MIN_SIZE)
+				bulk_read_fd = fd;
+			bulk_lock_give();
+			return 0;
+		}
+	}
+
+	*ret = 0;
+
+	while (copied < n && stream.head != stream.tail) {
+		struct libc_bulk *bulk = bulk_wait_head();
+
+		if (bulk->result < 0) {
+			stream.eof = 1;
+			stream.offset = 0;
+			stream.head++;
+			if (copied == 0) {
+				*_errno = bulk->_errno;
+				*ret = -1;
+			}
+			break;
+		}
+
+		if (bulk->result < LIBC_BULK_BUFFER_SIZE)
+			stream.eof = 1;
+
+		uint32_t chunk = bulk->result - stream.offset;
+		if (chunk > n - copied)
+			chunk = n - copied;
+
+		memcpy(dst + copied, bulk_buf(stream.head) + stream.offset, chunk);
+		copied += chunk;
+		stream.offset += chunk;
+
+		if (stream.offset == (uint32_t)bulk->result) {
+			stream.offset = 0;
+			stream.head++;
+			if (stream.window < LIBC_BULK_BUFFERS)
+				stream.window *= 2;
+			bulk_read_ahead();
+		}
+	}
+
+	if (*ret == 0)
+		*ret = copied;
+
+	bulk_lock_give();
+	return 1;
+}
+
 int _write_r(struct _reent *r, int fd, const void *buf, size_t n)
 {
 	if (fd == 1 || fd == 2)
@@ -101,6 +599,10 @@ int _write_r(struct _reent *r, int fd, const void *buf, size_t n)
 	if (fd > 2)
 		dbg_libc("write %d %p %d\n", fd, buf, n);
 
+	int ret = bulk_write(fd, buf, n, &r->_errno);
+	if (ret != 0 || n == 0)
+		return ret;
+
 	return LIBC_CALL3(LIBC_WRITE, r->_errno, fd, buf, n);
 }
 
@@ -109,16 +611,24 @@ int _read_r(struct _reent *r, int fd, void *ptr, size_t n)
 	if (fd == 1 || fd == 2)
 		return -1;
 
+	int ret;
+	if (bulk_read(fd, ptr, n, &ret, &r->_errno))
+		return ret;
+
 	return LIBC_CALL3(LIBC_READ, r->_errno, fd, ptr, n);
 }
 
 off_t _lseek_r(struct _reent *r, int fd, off_t ptr, int dir)
 {
+	if (bulk_flush(fd, &r->_errno) != 0)
+		return -1;
 	return LIBC_CALL3(LIBC_LSEEK, r->_errno, fd, ptr, dir);
 }
 
 int _fstat_r(struct _reent *r, int fd, struct stat * st)
 {
+	if (bulk_flush(fd, &r->_errno) != 0)
+		return -1;
 	return LIBC_CALL2(LIBC_FSTAT, r->_errno, fd, st);
 }
 
@@ -129,11 +639,27 @@ int _open_r(struct _reent *r, const char *path, int c_flags)
 
 int _close_r(struct _reent *r, int fd)
 {
-	return LIBC_CALL1(LIBC_CLOSE, r->_errno, fd);
+	int err = bulk_release(fd);
+
+	if (err < 0) {
+		r->_errno = EBUSY;
+		return -1;
+	}
+
+	int ret = LIBC_CALL1(LIBC_CLOSE, r->_errno, fd);
+
+	if (err != 0) {
+		r->_errno = err;
+		return -1;
+	}
+
+	return ret;
 }
 
 int _unlink_r(struct _reent *r, const char *path)
 {
+	if (bulk_flush(-1, &r->_errno) != 0)
+		return -1;
 	return LIBC_CALL1(LIBC_UNLINK, r->_errno, path);
 }
 
@@ -230,11 +756,15 @@ char *getcwd(char *buf, size_t size)
 
 int _stat_r(struct _reent *r, const char *pathname, struct stat *buf)
 {
+	if (bulk_flush(-1, &r->_errno) != 0)
+		return -1;
 	return LIBC_CALL2(LIBC_STAT, r->_errno, pathname, buf);
 }
 
 int _rename_r(struct _reent *r, const char *oldpath, const char *newpath)
 {
+	if (bulk_flush(-1, &r->_errno) != 0)
+		return -1;
 	return LIBC_CALL2(LIBC_RENAME, r->_errno, oldpath, newpath);
 }
 
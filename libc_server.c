@@ -18,6 +18,7 @@
 #include <sys/time.h>
 #include <sys/wait.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -143,6 +144,8 @@ static void translate_dirent(struct awb_dirent *dst, struct dirent *src)
     dst->d_name[sizeof(dst->d_name) - 1] = 0;
 }
 
+_Static_assert(sizeof(struct awb_dirent) <= LIBC_COMPOUND_RETVAL_SIZE, "compound return value buffer too small");
+
 static void translate_timeval(struct newlib_timeval *ntv, const struct timeval *tv)
 {
     ntv->tv_sec = tv->tv_sec;
@@ -215,128 +218,448 @@ static int translate_fcntl_flags(int flags_in) {
     return flags_out;
 }
 
-int main(void)
+// Returns true if the call indicates an error by its return value.
+static int call_failed(int func, param_t retval)
 {
-    // Map shared memory communication regions.
-    // We use fixed ID mappings so we don't have to translate bare-metal pointers.
-
-    int mem_fd = open("/dev/mem", O_RDWR);
-    if (mem_fd < 0) {
-        perror("failed to open memory device");
-        return 0;
+    switch (func) {
+        case LIBC_OPENDIR:
+        case LIBC_READDIR:
+        case LIBC_GETCWD:
+            return retval == 0;
+        default:
+            return (int32_t)retval == -1;
     }
+}
 
-    // Map call ring buffer.
-    callbuf = (struct libc_call_buffer *)mmap((void *)LIBC_CALL_BUFFER_ADDR, sizeof(*callbuf), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, mem_fd, LIBC_CALL_BUFFER_ADDR);
-    if (callbuf == MAP_FAILED) {
-        perror("failed to map call buffer");
-        return 0;
+// Executes a libc call. A translated compound return value is written to
+// compound, which must hold at least LIBC_COMPOUND_RETVAL_SIZE bytes.
+static param_t do_call(int func, param_t *args, uint8_t *compound, uint32_t *_errno)
+{
+    // Replace fixed-size destination buffers with ones that are able to
+    // accommodate the corresponding Linux libc structures.
+
+    param_t trans_dest = 0;
+    switch (func) {
+        case LIBC_FSTAT:
+        case LIBC_STAT:
+            trans_dest = args[1];
+            args[1] = (param_t)malloc(sizeof(struct stat));
+            // XXX: handle OOM
+            break;
+        case LIBC_OPEN:
+            args[1] = translate_fcntl_flags(args[1]);
+            break;
+        case LIBC_GETTIMEOFDAY:
+            trans_dest = args[0];
+            args[0] = (param_t)malloc(sizeof(struct timeval));
+            // XXX: handle OOM
+            break;
+        default:
+            break;
     }
 
-    // Map BASIC program memory (text, data, bss)
-    // XXX: We would like to map up to 2GB here, but that fails for lack of
-    // available address space, so we leave 256MB unused on 2GB devices.
-    void *basic_mem = mmap((void *)0x49000000, 0x67000000, PROT_READ|PROT_WRITE, MAP_SHARED | MAP_FIXED, mem_fd, 0x49000000);
-    if (basic_mem == MAP_FAILED) {
-        perror("failed to map BASIC memory");
-        return 0;
+    // call libc function
+
+    call4 functor = libc_functors[func];
+    errno = 0;
+    param_t retval = functor(args[0], args[1], args[2], args[3]);
+    *_errno = errno;
+
+    // Translate data Linux libc data structures to their bare-metal equivalents.
+
+    switch (func) {
+        case LIBC_FSTAT:
+        case LIBC_STAT:
+            if (retval == 0)
+                translate_stat((struct newlib_stat *)trans_dest, (struct stat *)args[1]);
+            free((void *)args[1]);
+            args[1] = trans_dest;
+            break;
+        case LIBC_READDIR:
+            if (retval != 0) {
+                translate_dirent((struct awb_dirent *)compound, (struct dirent *)retval);
+                retval = (param_t)compound;
+            }
+            break;
+        case LIBC_GETTIMEOFDAY:
+            if (retval == 0)
+                translate_timeval((struct newlib_timeval *)trans_dest, (struct timeval *)args[0]);
+            free((void *)args[0]);
+            args[0] = trans_dest;
+            break;
+        default:
+            break;
     }
-    printf("BASIC mem at %p\n", basic_mem);
 
-    // We also need access to the BASIC stack because we may get pointers to it.
-    void *basic_stack = mmap((void *)0x8000, 0x8000, PROT_READ|PROT_WRITE, MAP_SHARED | MAP_FIXED, mem_fd, 0x48808000);
-    if (basic_stack == MAP_FAILED) {
-        perror("failed to map BASIC stack");
-        return 0;
+    return retval;
+}
+
+// Work handed from the dispatcher to the worker threads: either a
+// synchronous call slot, or a chain of linked SQEs copied out of the SQ.
+
+struct work {
+    struct work *next;
+    struct libc_call *sync_call;
+    int count;
+    struct libc_sqe sqes[];
+};
+
+struct work_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct work *head, *tail;
+};
+
+#define NUM_WORKERS 4
+
+static struct work_queue general_queue = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, NULL
+};
+
+// wait() reaps any child, including the one system() is waiting for or a
+// shell started by jhlibc_forkptyexec(). The calls that create or reap
+// child processes are therefore run one after the other, by a worker of
+// their own. A wait() for a child that keeps running holds up the calls
+// queued behind it.
+static struct work_queue process_queue = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, NULL
+};
+
+static int is_process_call(int func)
+{
+    return func == LIBC_WAIT || func == LIBC_SYSTEM || func == LIBC_JHLIBC_FORKPTYEXEC;
+}
+
+static pthread_mutex_t cq_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void post_cqe(const struct libc_sqe *sqe, param_t retval, uint32_t _errno, const uint8_t *compound)
+{
+    pthread_mutex_lock(&cq_lock);
+
+    // The client never has more calls in flight than there are CQ entries.
+    uint32_t idx = callbuf->cq_tail & (LIBC_CQ_SIZE - 1);
+    struct libc_cqe *cqe = &callbuf->cq[idx];
+
+    cqe->user_data = sqe->user_data;
+    cqe->_errno = _errno;
+    if (compound != NULL && retval == (param_t)compound) {
+        memcpy(callbuf->cq_compound_retval[idx], compound, LIBC_COMPOUND_RETVAL_SIZE);
+        retval = (param_t)callbuf->cq_compound_retval[idx];
     }
-    printf("BASIC stack at %p\n", basic_stack);
+    cqe->retval = retval;
 
-    // Tell BASIC we're ready for business.
-    if (callbuf->magic != LIBC_SERVER_READY_MAGIC) {
-        callbuf->read_pos = callbuf->write_pos = 0;
-        callbuf->magic = LIBC_SERVER_READY_MAGIC;
+    __atomic_store_n(&callbuf->cq_tail, callbuf->cq_tail + 1, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&cq_lock);
+}
+
+static void run_sync(struct libc_call *call)
+{
+#ifdef DEBUG
+    printf("proc libc call %d\n", call->func);
+#endif
+    call->retval = do_call(call->func, call->args, call->compound_retval, &call->_errno);
+    __atomic_store_n(&call->processed, 1, __ATOMIC_RELEASE);
+}
+
+static void run_chain(struct libc_sqe *sqes, int count)
+{
+    param_t link_retval = 0;
+    int link_failed = 0;
+
+    for (int i = 0; i < count; i++) {
+        struct libc_sqe *sqe = &sqes[i];
+        uint8_t compound[LIBC_COMPOUND_RETVAL_SIZE];
+        uint32_t _errno;
+
+#ifdef DEBUG
+        printf("proc async libc call %d\n", sqe->func);
+#endif
+
+        if (sqe->flags & LIBC_SQE_FD_FROM_LINK) {
+            if (i == 0 || link_failed) {
+                post_cqe(sqe, (param_t)-1, ECANCELED, NULL);
+                continue;
+            }
+            sqe->args[0] = link_retval;
+        }
+
+        param_t retval = do_call(sqe->func, sqe->args, compound, &_errno);
+
+        if (i == 0) {
+            link_retval = retval;
+            link_failed = call_failed(sqe->func, retval);
+        }
+
+        post_cqe(sqe, retval, _errno, compound);
     }
+}
+
+static void *worker(void *arg)
+{
+    struct work_queue *queue = arg;
 
     for (;;) {
-        // Wait until there is something to do.
-        time_t wait_start = time(NULL);
-        while (callbuf->read_pos == callbuf->write_pos) {
-            // When we're idling for a long time we schedule ourselves out a
-            // bit to avoid hogging the CPU.
-            if (time(NULL) > wait_start + 2)
-                usleep(1000);
-            else
-                asm("wfe");	// XXX: portability, anyone?
+        pthread_mutex_lock(&queue->lock);
+        while (queue->head == NULL)
+            pthread_cond_wait(&queue->cond, &queue->lock);
+        struct work *w = queue->head;
+        queue->head = w->next;
+        if (queue->head == NULL)
+            queue->tail = NULL;
+        pthread_mutex_unlock(&queue->lock);
+
+        if (w->sync_call)
+            run_sync(w->sync_call);
+        else
+            run_chain(w->sqes, w->count);
+
+        free(w);
+
+        // Wake up bare-metal cell.
+        comm_send_event();
+    }
+
+    return NULL;
+}
+
+static void queue_work(struct work *w)
+{
+    int process = 0;
+
+    if (w->sync_call) {
+        process = is_process_call(w->sync_call->func);
+    } else {
+        // A chain runs in order on one worker.
+        for (int i = 0; i < w->count; i++)
+            process |= is_process_call(w->sqes[i].func);
+    }
+
+    struct work_queue *queue = process ? &process_queue : &general_queue;
+
+    w->next = NULL;
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->tail)
+        queue->tail->next = w;
+    else
+        queue->head = w;
+    queue->tail = w;
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// Bulk transfers are done by a thread of their own, in ring order.
+
+static pthread_mutex_t bulk_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bulk_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t bulk_seen;	// descriptors seen by the dispatcher
+
+static void run_bulk(struct libc_bulk *bulk, uint8_t *buf)
+{
+    ssize_t done = 0;
+
+    errno = 0;
+
+    if (bulk->op == LIBC_BULK_READ) {
+        done = read(bulk->fd, buf, bulk->length);
+    } else {
+        // The client considers the data written, so don't stop short.
+        while ((size_t)done < bulk->length) {
+            ssize_t ret = write(bulk->fd, buf + done, bulk->length - done);
+            if (ret < 0) {
+                if (errno == EINTR)
+                    continue;
+                done = -1;
+                break;
+            }
+            done += ret;
         }
+    }
+
+    bulk->result = done;
+    bulk->_errno = errno;
+}
+
+static void *bulk_worker(void *arg)
+{
+    (void)arg;
+
+    uint32_t head = callbuf->bulk_head;
+
+    for (;;) {
+        pthread_mutex_lock(&bulk_lock);
+        while (head == bulk_seen)
+            pthread_cond_wait(&bulk_cond, &bulk_lock);
+        uint32_t tail = bulk_seen;
+        pthread_mutex_unlock(&bulk_lock);
 
-        struct libc_call *call = &callbuf->calls[callbuf->read_pos];
+        while (head != tail) {
+            uint32_t idx = head & (LIBC_BULK_BUFFERS - 1);
+            struct libc_bulk *bulk = &callbuf->bulk[idx];
+            uint8_t *buf = (uint8_t *)callbuf->bulk_pool + idx * LIBC_BULK_BUFFER_SIZE;
 
 #ifdef DEBUG
-        printf("proc libc call %d\n", call->func);
+            printf("bulk %s fd %d length %u\n", bulk->op == LIBC_BULK_READ ? "read" : "write", bulk->fd, bulk->length);
 #endif
+            run_bulk(bulk, buf);
 
-        // Replace fixed-size destination buffers with ones that are able to
-        // accommodate the corresponding Linux libc structures.
+            head++;
+            __atomic_store_n(&bulk->owner, LIBC_BULK_OWNER_CLIENT, __ATOMIC_RELEASE);
+            __atomic_store_n(&callbuf->bulk_head, head, __ATOMIC_RELEASE);
 
-        static param_t trans_dest;
-        switch (call->func) {
-            case LIBC_FSTAT:
-            case LIBC_STAT:
-                trans_dest = call->args[1];
-                call->args[1] = (param_t)malloc(sizeof(struct stat));
-                // XXX: handle OOM
-                break;
-            case LIBC_OPEN:
-                call->args[1] = translate_fcntl_flags(call->args[1]);
-                break;
-            case LIBC_GETTIMEOFDAY:
-                trans_dest = call->args[0];
-                call->args[0] = (param_t)malloc(sizeof(struct timeval));
-                // XXX: handle OOM
-                break;
-            default:
-                break;
+            // Wake up bare-metal cell.
+            comm_send_event();
         }
+    }
 
-        // call libc function
+    return NULL;
+}
 
-        call4 functor = libc_functors[call->func];
-        call->retval = functor(call->args[0], call->args[1], call->args[2], call->args[3]);
+// Hands pending synchronous calls and complete SQE chains to the workers.
+// Returns the number of work items queued.
+static int dispatch(void)
+{
+    int queued = 0;
 
-        // Translate data Linux libc data structures to their bare-metal equivalents.
+    for (int i = 0; i < LIBC_SYNC_SLOTS; i++) {
+        struct libc_call *call = &callbuf->sync_calls[i];
 
-        switch (call->func) {
-            case LIBC_FSTAT:
-            case LIBC_STAT:
-                if (call->retval == 0)
-                    translate_stat((struct newlib_stat *)trans_dest, (struct stat *)call->args[1]);
-                free((void *)call->args[1]);
-                call->args[1] = trans_dest;
-                break;
-            case LIBC_READDIR:
-                if (call->retval != 0) {
-                    translate_dirent((struct awb_dirent *)call->compound_retval,
-                                     (struct dirent *)call->retval);
-                    call->retval = (param_t)call->compound_retval;
-                }
-                break;
-            case LIBC_GETTIMEOFDAY:
-                if (call->retval == 0)
-                    translate_timeval((struct newlib_timeval *)trans_dest, (struct timeval *)call->args[0]);
-                free((void *)call->args[0]);
-                call->args[0] = trans_dest;
-                break;
-            default:
-                break;
+        if (__atomic_load_n(&call->pending, __ATOMIC_ACQUIRE)) {
+            call->pending = 0;
+
+            struct work *w = malloc(sizeof(*w));
+            // XXX: handle OOM
+            w->sync_call = call;
+            w->count = 0;
+            queue_work(w);
+            queued++;
         }
+    }
 
-        call->_errno = errno;
-        call->processed = 1;
+    uint32_t bulk_tail = __atomic_load_n(&callbuf->bulk_tail, __ATOMIC_ACQUIRE);
+    if (bulk_tail != bulk_seen) {
+        pthread_mutex_lock(&bulk_lock);
+        bulk_seen = bulk_tail;
+        pthread_cond_signal(&bulk_cond);
+        pthread_mutex_unlock(&bulk_lock);
+        queued++;
+    }
 
-        // Wake up bare-metal cell.
-        asm("sev");	// XXX: portability!
+    uint32_t head = callbuf->sq_head;
+    uint32_t tail = __atomic_load_n(&callbuf->sq_tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        // Find the end of the chain; an incomplete one waits for the rest.
+        uint32_t end = head;
+        while (end != tail && (callbuf->sq[end & (LIBC_SQ_SIZE - 1)].flags & LIBC_SQE_LINK))
+            end++;
+        if (end == tail)
+            break;
+        end++;
+
+        int count = end - head;
+        struct work *w = malloc(sizeof(*w) + count * sizeof(struct libc_sqe));
+        // XXX: handle OOM
+        w->sync_call = NULL;
+        w->count = count;
+        for (int i = 0; i < count; i++)
+            w->sqes[i] = callbuf->sq[(head + i) & (LIBC_SQ_SIZE - 1)];
+
+        head = end;
+        __atomic_store_n(&callbuf->sq_head, head, __ATOMIC_RELEASE);
+
+        queue_work(w);
+        queued++;
+    }
 
-        // Move to the next call in the ring buffer.
-        callbuf->read_pos = (callbuf->read_pos + 1) % LIBC_CALL_BUFFER_SIZE;
+    return queued;
+}
+
+int main(int argc, char **argv)
+{
+    // With a file argument, the call buffer is mapped from that file and no
+    // bare-metal memory is mapped. This allows testing with a Linux process
+    // as the client, which maps the same file at LIBC_CALL_BUFFER_ADDR and
+    // only passes pointers into the file.
+    int test_mode = argc > 1;
+
+    // Map shared memory communication regions.
+    // We use fixed ID mappings so we don't have to translate bare-metal pointers.
+
+    int mem_fd = open(test_mode ? argv[1] : "/dev/mem", O_RDWR);
+    if (mem_fd < 0) {
+        perror("failed to open memory device");
+        return 0;
+    }
+
+    // Map call ring buffer. In test mode, the rest of the file holds the
+    // client's buffers.
+    size_t map_size = sizeof(*callbuf);
+    struct stat st;
+    if (test_mode && fstat(mem_fd, &st) == 0 && (size_t)st.st_size > map_size)
+        map_size = st.st_size;
+
+    callbuf = (struct libc_call_buffer *)mmap((void *)LIBC_CALL_BUFFER_ADDR, map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, mem_fd, test_mode ? 0 : LIBC_CALL_BUFFER_ADDR);
+    if (callbuf == MAP_FAILED) {
+        perror("failed to map call buffer");
+        return 0;
+    }
+
+    if (!test_mode) {
+        // Map BASIC program memory (text, data, bss)
+        // XXX: We would like to map up to 2GB here, but that fails for lack of
+        // available address space, so we leave 256MB unused on 2GB devices.
+        void *basic_mem = mmap((void *)0x49000000, 0x67000000, PROT_READ|PROT_WRITE, MAP_SHARED | MAP_FIXED, mem_fd, 0x49000000);
+        if (basic_mem == MAP_FAILED) {
+            perror("failed to map BASIC memory");
+            return 0;
+        }
+        printf("BASIC mem at %p\n", basic_mem);
+
+        // We also need access to the BASIC stack because we may get pointers to it.
+        void *basic_stack = mmap((void *)0x8000, 0x8000, PROT_READ|PROT_WRITE, MAP_SHARED | MAP_FIXED, mem_fd, 0x48808000);
+        if (basic_stack == MAP_FAILED) {
+            perror("failed to map BASIC stack");
+            return 0;
+        }
+        printf("BASIC stack at %p\n", basic_stack);
+    }
+
+    // Slow calls (file systems on slow media) run on their own worker, so
+    // they don't hold up the others. The process calls have a worker of
+    // their own.
+    for (int i = 0; i <= NUM_WORKERS; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker, i < NUM_WORKERS ? &general_queue : &process_queue) != 0) {
+            perror("failed to create worker thread");
+            return 0;
+        }
+    }
+
+    // Tell BASIC we're ready for business.
+    if (callbuf->magic != LIBC_SERVER_READY_MAGIC) {
+        callbuf->sq_head = callbuf->sq_tail = 0;
+        callbuf->cq_head = callbuf->cq_tail = 0;
+        callbuf->bulk_head = callbuf->bulk_tail = 0;
+        callbuf->magic = LIBC_SERVER_READY_MAGIC;
+    }
+    bulk_seen = callbuf->bulk_head;
+
+    pthread_t bulk_thread;
+    if (pthread_create(&bulk_thread, NULL, bulk_worker, NULL) != 0) {
+        perror("failed to create bulk thread");
+        return 0;
+    }
+
+    // The doorbell count is taken before looking for work, so a call posted
+    // in between makes the wait return right away.
+    struct comm_waiter waiter;
+    comm_waiter_init(&waiter, &callbuf->doorbell);
+
+    for (;;) {
+        while (dispatch() != 0)
+            ;
+        comm_wait(&waiter, &callbuf->doorbell);
     }
 }
@@ -1,8 +1,12 @@
 // SPDX-License-Identifier: MIT
 // Copyright (c) 2023 Ulrich Hecht
 
+#ifndef _LIBC_SERVER_H
+#define _LIBC_SERVER_H
+
 #include <stdint.h>
 #include <limits.h>
+#include "comm_notify.h"
 
 #if !defined(INT_MAX) || !defined(LONG_MAX)
 #error INT_MAX/LONG_MAX not defined
@@ -46,14 +50,21 @@ enum libc_funcs {
     LIBC_LAST
 };
 
+// Synchronous calls
+
 // Data structure describing the libc function to be called.
 
-// The bare-metal client fills in the funcion index and arguments and sets
-// processed to 0, then adds the call to the ring buffer.
+// Every bare-metal core has its own call slot. The client fills in the
+// function index and arguments, sets processed to 0 and then pending to 1,
+// and rings the doorbell.
 
 // Once the server has executed, it sets retval and _errno and sets
 // processed to 1.
 
+// A core has one synchronous call in flight at most. A call made by an
+// interrupt handler while the interrupted code waits for its own call would
+// overwrite the slot; the client fails it with EBUSY instead.
+
 // If a pointer to a compound data type that had to be translated is
 // returned, the translated data is saved in compound_retval[], and retval
 // is set to point there, making the translation transparent to the client.
@@ -61,22 +72,109 @@ enum libc_funcs {
 // XXX: This currently relies on all libc functions having four arguments or
 // less, and thus don't need to use the stack.
 
+#define LIBC_COMPOUND_RETVAL_SIZE 260	// struct dirent
+
 struct libc_call {
     int func;
     param_t args[4];
     param_t retval;
     uint32_t _errno;
+    int pending;
     int processed;
-    uint8_t compound_retval[384];
+    uint8_t compound_retval[LIBC_COMPOUND_RETVAL_SIZE];
+};
+
+#define LIBC_SYNC_SLOTS 4	// one per core
+
+// Asynchronous calls
+
+// The submission queue (SQ) is written by the client and read by the server,
+// the completion queue (CQ) the other way round. Each index is only written
+// by one side, the other side reads it. Calls may complete in any order;
+// user_data is passed through to the completion entry to match them up.
+
+// An SQE with LIBC_SQE_LINK set is followed by another SQE of the same chain.
+// The calls of a chain are executed one after the other, in order. An SQE
+// with LIBC_SQE_FD_FROM_LINK gets the return value of the first call in the
+// chain as args[0], which makes open+read+close possible; it completes with
+// ECANCELED when that first call failed.
+
+// A compound return value (readdir) is stored with the completion entry and
+// stays valid until the client moves cq_head past it.
+
+#define LIBC_SQ_SIZE 32	// must be a power of 2
+#define LIBC_CQ_SIZE 32	// must be a power of 2
+
+#define LIBC_SQE_LINK		(1 << 0)
+#define LIBC_SQE_FD_FROM_LINK	(1 << 1)
+
+struct libc_sqe {
+    int func;
+    uint32_t flags;
+    uint64_t user_data;
+    param_t args[4];
+};
+
+struct libc_cqe {
+    uint64_t user_data;
+    param_t retval;
+    uint32_t _errno;
 };
 
-#define LIBC_CALL_BUFFER_SIZE 32
+// Bulk data channel
+
+// Large reads and writes of regular files are moved through a pool of
+// buffers provided by the client (bulk_pool). Buffer i belongs to descriptor
+// i; the descriptors are used as a ring and handed over with the owner field.
+// The client fills in op, fd and length (and the data for a write) and
+// hands the buffer to the server. The server processes the descriptors in
+// ring order, so the reads and writes of a file happen in sequence, sets
+// result and _errno and hands the buffer back.
+
+#define LIBC_BULK_BUFFERS	8	// must be a power of 2
+#define LIBC_BULK_BUFFER_SIZE	65536
+
+#define LIBC_BULK_OWNER_CLIENT	0
+#define LIBC_BULK_OWNER_SERVER	1
+
+#define LIBC_BULK_READ		0
+#define LIBC_BULK_WRITE		1
+
+struct libc_bulk {
+    uint32_t owner;
+    int op;
+    int fd;
+    uint32_t length;
+    int32_t result;	// bytes transferred, or -1
+    uint32_t _errno;
+};
 
-#define LIBC_SERVER_READY_MAGIC 0x00137590
+#define LIBC_SERVER_READY_MAGIC 0x00137593
 
 struct libc_call_buffer {
     uint32_t magic;
-    int read_pos;
-    int write_pos;
-    struct libc_call calls[LIBC_CALL_BUFFER_SIZE];
+    struct libc_call sync_calls[LIBC_SYNC_SLOTS];
+
+    uint32_t sq_head;	// written by the server
+    uint32_t sq_tail;	// written by the client
+    uint32_t cq_head;	// written by the client
+    uint32_t cq_tail;	// written by the server
+    struct libc_sqe sq[LIBC_SQ_SIZE];
+    struct libc_cqe cq[LIBC_CQ_SIZE];
+    uint8_t cq_compound_retval[LIBC_CQ_SIZE][LIBC_COMPOUND_RETVAL_SIZE];
+
+    param_t bulk_pool;	// LIBC_BULK_BUFFERS * LIBC_BULK_BUFFER_SIZE bytes
+    uint32_t bulk_head;	// written by the server
+    uint32_t bulk_tail;	// written by the client
+    struct libc_bulk bulk[LIBC_BULK_BUFFERS];
+
+    // Rung by the client after posting a synchronous call, SQEs or bulk
+    // buffers.
+    struct comm_doorbell doorbell;
 };
+
+// The buffer has to fit between LIBC_CALL_BUFFER_ADDR and the end of the
+// communication area.
+_Static_assert(sizeof(struct libc_call_buffer) <= 0x4000, "libc call buffer too large");
+
+#endif
@@ -231,6 +231,10 @@ a lot of data that needs to be copied, this should be set high. */
 #define IP_REASS_MAX_PBUFS      (10 * ((1500 + PBUF_POOL_BUFSIZE - 1) / PBUF_POOL_BUFSIZE))
 #define MEMP_NUM_REASSDATA      IP_REASS_MAX_PBUFS
 #define IP_FRAG                 1
+
+/* Custom pbufs wrap the EMAC receive buffers, see network.c */
+#define LWIP_SUPPORT_CUSTOM_PBUF 1
+
 #define IPV6_FRAG_COPYHEADER    1
 
 /* ---------- ICMP options ---------- */
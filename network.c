@@ -10,39 +10,180 @@
 #include "network.h"
 #include "util.h"
 #include "system.h"
+#include "smp.h"
 
 #include <device/emac.h>
 
+#include <stdbool.h>
 #include <string.h>
 
 extern void emac_eth_send(void*, int);
 extern int emac_eth_recv(uint8_t **);
 extern void emac_free_pkt(void);
 
+// Received frames are handed to lwIP in the EMAC buffer they arrived in.
+// The buffer is on loan from the EMAC until lwIP frees the pbuf.
+#define RX_PBUF_NUM 32
+#define RX_BUFFER_SIZE 2044 // CONFIG_ETH_RXSIZE in emac.c
+
+struct rx_pbuf {
+  struct pbuf_custom custom;
+  int32_t loan;
+  struct rx_pbuf *next_free;
+};
+
+static struct rx_pbuf rx_pbufs[RX_PBUF_NUM];
+static struct rx_pbuf *rx_pbuf_free_list;
+
+// Outgoing pbuf chains sent without copying are held until the EMAC is done with them.
+#define TX_PENDING_NUM 32 // Must be a power of 2
+#define TX_SEGMENTS_MAX 8
+#define TX_ZERO_COPY_MIN 128 // Smaller pbufs are copied into the descriptor buffer
+#define TX_TIMEOUT_MS 100
+
+static struct tx_pending {
+  struct pbuf *p;
+  uint32_t sequence;
+} tx_pending[TX_PENDING_NUM];
+static uint32_t tx_pending_head, tx_pending_tail;
+
+static uint8_t tx_flatten_buffer[1536] __attribute__((aligned(4)));
+
+static void rx_pbuf_free(struct pbuf *p)
+{
+  struct rx_pbuf *rp = (struct rx_pbuf *)p;
+
+  emac_eth_return(rp->loan);
+
+  rp->next_free = rx_pbuf_free_list;
+  rx_pbuf_free_list = rp;
+}
+
+static void rx_pbufs_init(void)
+{
+  rx_pbuf_free_list = NULL;
+
+  for (int i = 0; i < RX_PBUF_NUM; i++) {
+    rx_pbufs[i].custom.custom_free_function = rx_pbuf_free;
+    rx_pbufs[i].next_free = rx_pbuf_free_list;
+    rx_pbuf_free_list = &rx_pbufs[i];
+  }
+}
+
 static struct pbuf *eth_recv_pbuf(void)
 {
   uint8_t *eth_data;
   int eth_data_count = emac_eth_recv(&eth_data);
-  if (!eth_data_count)
+  if (eth_data_count <= 0)
     return NULL;
 
-  struct pbuf* p = pbuf_alloc(PBUF_RAW, eth_data_count, PBUF_POOL);
+  struct pbuf *p = NULL;
+  struct rx_pbuf *rp = rx_pbuf_free_list;
+
+  if (rp != NULL) {
+    int32_t loan = emac_eth_loan();
+
+    if (loan >= 0) {
+      rx_pbuf_free_list = rp->next_free;
+      rp->loan = loan;
+      p = pbuf_alloced_custom(PBUF_RAW, eth_data_count, PBUF_REF, &rp->custom,
+                              eth_data, RX_BUFFER_SIZE);
+    }
+  }
 
-  if(p != NULL)
-    pbuf_take(p, eth_data, eth_data_count);
+  // Out of loans: lwIP holds on to many frames (TCP out-of-order queue,
+  // reassembly), fall back to copying so the EMAC ring keeps running.
+  if (p == NULL) {
+    p = pbuf_alloc(PBUF_RAW, eth_data_count, PBUF_POOL);
+
+    if (p != NULL)
+      pbuf_take(p, eth_data, eth_data_count);
+  }
 
   emac_free_pkt();
 
   return p;
 }
 
+static void tx_pending_reclaim(void)
+{
+  while (tx_pending_tail != tx_pending_head) {
+    struct tx_pending *pending = &tx_pending[tx_pending_tail & (TX_PENDING_NUM - 1)];
+
+    if (!emac_eth_tx_done(pending->sequence))
+      break;
+
+    pbuf_free(pending->p);
+    tx_pending_tail++;
+  }
+}
+
+static err_t netif_output_flatten(struct pbuf *p)
+{
+  if (p->tot_len > sizeof(tx_flatten_buffer))
+    return ERR_BUF;
+
+  pbuf_copy_partial(p, tx_flatten_buffer, p->tot_len, 0);
+  emac_eth_send(tx_flatten_buffer, p->tot_len);
+
+  return ERR_OK;
+}
+
+// Each pbuf of the chain becomes a TX segment. Large pbufs get their own
+// descriptor pointing at the pbuf payload, small ones (headers) are merged
+// into the descriptor buffer. The chain is referenced until the frame is sent.
+// A PBUF_REF payload belongs to the caller once this returns, it is always
+// copied (as etharp.c does for the frames it queues).
 static err_t netif_output(struct netif *netif, struct pbuf *p)
 {
   (void)netif;
-  // XXX: This is a lot of copying. (emac_eth_send() copies the buffer, too.)
-  uint8_t send_buffer[p->tot_len];
-  pbuf_copy_partial(p, send_buffer, p->tot_len, 0);
-  emac_eth_send(send_buffer, p->tot_len);
+
+  tx_pending_reclaim();
+
+  struct emac_tx_segment segments[TX_SEGMENTS_MAX];
+  uint32_t count = 0;
+  bool zero_copy = false;
+  bool can_hold = (tx_pending_head - tx_pending_tail) < TX_PENDING_NUM;
+
+  for (struct pbuf *q = p; q != NULL; q = q->next) {
+    if (q->len == 0)
+      continue;
+
+    if (count == TX_SEGMENTS_MAX)
+      return netif_output_flatten(p);
+
+    segments[count].data = q->payload;
+    segments[count].length = q->len;
+
+    if (can_hold && q->len >= TX_ZERO_COPY_MIN && !PBUF_NEEDS_COPY(q)) {
+      segments[count].flags = EMAC_TX_SEGMENT_ZERO_COPY;
+      zero_copy = true;
+    } else {
+      segments[count].flags = EMAC_TX_SEGMENT_COPY;
+    }
+
+    count++;
+  }
+
+  if (count == 0)
+    return ERR_OK;
+
+  uint32_t sequence;
+  uint32_t timeout = sys_get_msec() + TX_TIMEOUT_MS;
+
+  while (emac_eth_send_segments(segments, count, &sequence) != 0) {
+    if ((int32_t)(sys_get_msec() - timeout) > 0)
+      return ERR_MEM;
+
+    tx_pending_reclaim();
+  }
+
+  if (zero_copy) {
+    pbuf_ref(p);
+    tx_pending[tx_pending_head & (TX_PENDING_NUM - 1)].p = p;
+    tx_pending[tx_pending_head & (TX_PENDING_NUM - 1)].sequence = sequence;
+    tx_pending_head++;
+  }
 
   return ERR_OK;
 }
@@ -76,14 +217,77 @@ static err_t _netif_init(struct netif *netif)
 
 struct netif netif_eth0 = {};
 
-void network_task(void)
+// Calls between the application and the core running lwIP. Each ring has
+// exactly one producer and one consumer, head and tail are only written by
+// their owner, so no lock is needed when the network runs on another core.
+#define CALL_RING_SIZE 64 // Must be a power of 2
+
+struct call_ring {
+  uint32_t head;
+  uint32_t tail;
+  struct {
+    network_func_t fn;
+    void *arg;
+  } entries[CALL_RING_SIZE];
+};
+
+static struct call_ring to_network;	// application -> lwIP
+static struct call_ring to_app;		// lwIP -> application
+
+static bool call_ring_put(struct call_ring *ring, network_func_t fn, void *arg)
 {
-  struct pbuf *p = NULL;
+  uint32_t head = ring->head;
+
+  if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == CALL_RING_SIZE)
+    return false;
+
+  ring->entries[head & (CALL_RING_SIZE - 1)].fn = fn;
+  ring->entries[head & (CALL_RING_SIZE - 1)].arg = arg;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+static int call_ring_run(struct call_ring *ring)
+{
+  uint32_t tail = ring->tail;
+  uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  int count = 0;
+
+  while (tail != head) {
+    network_func_t fn = ring->entries[tail & (CALL_RING_SIZE - 1)].fn;
+    void *arg = ring->entries[tail & (CALL_RING_SIZE - 1)].arg;
+    __atomic_store_n(&ring->tail, ++tail, __ATOMIC_RELEASE);
+
+    fn(arg);
+    count++;
+  }
+
+  return count;
+}
+
+bool network_call(network_func_t fn, void *arg)
+{
+  return call_ring_put(&to_network, fn, arg);
+}
+
+bool network_notify(network_func_t fn, void *arg)
+{
+  return call_ring_put(&to_app, fn, arg);
+}
+
+int network_notify_run(void)
+{
+  return call_ring_run(&to_app);
+}
 
-  if (!netif_is_link_up(&netif_eth0))
-    return;
+int network_task_budget(int max_frames, uint32_t max_usec)
+{
+  int frames = 0;
 
-  do {
+  call_ring_run(&to_network);
+
+  if (netif_is_link_up(&netif_eth0)) {
 #if 0	// XXX
     if(link_state_changed()) {
       if(link_is_up()) {
@@ -94,17 +298,43 @@ void network_task(void)
     }
 #endif
 
+    uint64_t start = sys_get_usec();
+
     /* Check for received frames, feed them to lwIP */
-    p = eth_recv_pbuf();
+    while (frames < max_frames) {
+      struct pbuf *p = eth_recv_pbuf();
+
+      if (p == NULL)
+        break;
 
-    if(p != NULL) {
       if(netif_eth0.input(p, &netif_eth0) != ERR_OK) {
         pbuf_free(p);
       }
+
+      frames++;
+
+      if (sys_get_usec() - start >= max_usec)
+        break;
     }
 
-    sys_check_timeouts();	/* lwip timers */
-  } while (p);
+    tx_pending_reclaim();
+  }
+
+  /* lwip timers */
+  if (sys_timeouts_sleeptime() == 0)
+    sys_check_timeouts();
+
+  return frames;
+}
+
+void network_task(void)
+{
+  network_task_budget(NETWORK_TASK_MAX_FRAMES, NETWORK_TASK_MAX_USEC);
+}
+
+void network_start_core(int cpuid, void *stack, uint32_t stack_size)
+{
+  smp_start_secondary_core(cpuid, network_task, stack, stack_size);
 }
 
 void network_if_start(void)
@@ -134,6 +364,8 @@ void network_init(void)
   emac_init();
   printf("emac inited\n");
 
+  rx_pbufs_init();
+
   // initialize IP stack
   lwip_init();
 
@@ -1,3 +1,6 @@
+#include <stdbool.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -7,6 +10,30 @@ void network_if_start(void);
 void network_if_stop(void);
 void network_task(void);
 
+// Default budget of network_task(): frames received per call, and the time
+// after which no further frame is taken.
+#define NETWORK_TASK_MAX_FRAMES 32
+#define NETWORK_TASK_MAX_USEC 500
+
+// Receives at most max_frames frames, stopping early once max_usec have
+// passed, and runs the lwIP timers that are due. Returns the number of frames.
+int network_task_budget(int max_frames, uint32_t max_usec);
+
+// Runs network_task() in a loop on a secondary core. From then on, lwIP must
+// only be used from that core: the application hands work to it with
+// network_call(), and lwIP callbacks hand results back with network_notify(),
+// which the application executes in network_notify_run().
+void network_start_core(int cpuid, void *stack, uint32_t stack_size);
+
+typedef void (*network_func_t)(void *arg);
+
+// Queue fn(arg) to run in lwIP context. Returns false when the queue is full.
+bool network_call(network_func_t fn, void *arg);
+// Queue fn(arg) to run in the application. Returns false when the queue is full.
+bool network_notify(network_func_t fn, void *arg);
+// Runs the queued notifications, returns how many were run.
+int network_notify_run(void);
+
 extern struct netif netif_eth0;
 
 #ifdef __cplusplus
@@ -123,7 +123,8 @@ int main(int argc, char **argv)
         // 0. We skip those.
         if (event.type != 0) {
             evbuf->events[evbuf->write_pos] = event;
-            evbuf->write_pos = (evbuf->write_pos + 1) % SDL_EVENT_BUFFER_SIZE;
+            __atomic_store_n(&evbuf->write_pos, (evbuf->write_pos + 1) % SDL_EVENT_BUFFER_SIZE, __ATOMIC_RELEASE);
+            comm_ring(&evbuf->doorbell);
         }
     }
 
@@ -24,10 +24,18 @@
 #include <SDL2/SDL_events.h>
 #endif
 
+#include "comm_notify.h"
+
 #define SDL_EVENT_BUFFER_SIZE 128
 
+// The server stores an event, then advances write_pos with release
+// semantics and rings the doorbell. The consumer has to read write_pos with
+// acquire semantics before reading the events; instead of polling it may
+// wait for the doorbell count to change.
+
 struct sdl_event_buffer {
     int read_pos;
     int write_pos;
     SDL_Event events[SDL_EVENT_BUFFER_SIZE];
+    struct comm_doorbell doorbell;
 };
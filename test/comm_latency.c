@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 Ulrich Hecht
+
+// Measures the round trip through comm_notify.h the way libc_server uses
+// it: a client rings the request doorbell and spins until the reply
+// doorbell rings, the server thread waits for requests with comm_wait().
+//
+// The requests come back to back (the server keeps spinning), with a pause
+// in between once the server has stopped spinning for long (it has gone to
+// sleep, which is the usual case for a program that does a libc call now
+// and then), and the same while busy threads keep every CPU loaded. Each
+// request must be answered exactly once.
+
+#include "../comm_notify.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define SAMPLES		400
+#define REPLY_TIMEOUT_NS	1000000000ULL	// 1 s
+
+static struct comm_doorbell request, reply;
+static struct comm_waiter waiter;	// the server's, read by settle()
+static volatile int server_ready;
+static volatile int server_stop;
+static volatile int load_stop;
+
+static void *server(void *arg)
+{
+    (void)arg;
+
+    comm_waiter_init(&waiter, &request);
+    server_ready = 1;
+
+    for (;;) {
+        comm_wait(&waiter, &request);
+        if (server_stop)
+            break;
+        comm_ring(&reply);
+    }
+
+    return NULL;
+}
+
+static void *load(void *arg)
+{
+    (void)arg;
+
+    volatile uint64_t x = 0;
+    while (!load_stop)
+        x++;
+
+    return NULL;
+}
+
+static void pause_ns(uint64_t ns)
+{
+    struct timespec ts = { ns / 1000000000ULL, ns % 1000000000ULL };
+    nanosleep(&ts, NULL);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Returns the round trip time, or 0 if the request was not answered.
+static uint64_t round_trip(void)
+{
+    uint32_t seen = comm_count(&reply);
+    uint64_t start = comm_now_ns();
+    comm_ring(&request);
+
+    while (comm_count(&reply) == seen) {
+        comm_wait_for_event();
+        if (comm_now_ns() - start > REPLY_TIMEOUT_NS)
+            break;
+    }
+    uint64_t rtt = comm_now_ns() - start;
+
+    return comm_count(&reply) == seen + 1 ? rtt : 0;
+}
+
+// Pauses longer than the server spins until it is back to the shortest
+// spin, so that the next requests find it asleep.
+static int settle(void)
+{
+    int lost = 0;
+
+    while (__atomic_load_n(&waiter.spin_ns, __ATOMIC_RELAXED) > COMM_SPIN_MIN_NS) {
+        pause_ns(__atomic_load_n(&waiter.spin_ns, __ATOMIC_RELAXED) + 1000000);
+        if (round_trip() == 0)
+            lost++;
+    }
+
+    return lost;
+}
+
+// Returns the number of requests that were not answered in time.
+static int run(const char *name, uint64_t gap_ns)
+{
+    static uint64_t rtt[SAMPLES];
+    int lost = 0;
+
+    for (int i = 0; i < SAMPLES; i++) {
+        if (gap_ns != 0)
+            pause_ns(gap_ns);
+
+        rtt[i] = round_trip();
+        if (rtt[i] == 0) {
+            rtt[i] = REPLY_TIMEOUT_NS;
+            lost++;
+        }
+    }
+
+    qsort(rtt, SAMPLES, sizeof(rtt[0]), cmp_u64);
+
+    printf("%-18s %8.1f %8.1f %8.1f %8.1f\n", name,
+           rtt[SAMPLES / 2] / 1000.0, rtt[SAMPLES * 9 / 10] / 1000.0,
+           rtt[SAMPLES * 99 / 100] / 1000.0, rtt[SAMPLES - 1] / 1000.0);
+
+    return lost;
+}
+
+int main(void)
+{
+    pthread_t server_thread;
+    if (pthread_create(&server_thread, NULL, server, NULL) != 0) {
+        perror("pthread_create");
+        return 1;
+    }
+
+    // A request before comm_waiter_init() would not be seen.
+    while (!server_ready)
+        sched_yield();
+
+    int lost = 0;
+
+    printf("round trip (us)        p50      p90      p99      max\n");
+    lost += run("back to back", 0);
+    lost += settle();
+    lost += run("idle, 2 ms gap", 2000000);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1)
+        cpus = 1;
+    pthread_t load_threads[cpus];
+    for (long i = 0; i < cpus; i++) {
+        if (pthread_create(&load_threads[i], NULL, load, NULL) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    lost += run("loaded, 2 ms gap", 2000000);
+
+    load_stop = 1;
+    for (long i = 0; i < cpus; i++)
+        pthread_join(load_threads[i], NULL);
+
+    server_stop = 1;
+    comm_ring(&request);
+    pthread_join(server_thread, NULL);
+
+    if (lost != 0) {
+        printf("comm_latency: FAIL, %d requests not answered\n", lost);
+        return 1;
+    }
+
+    printf("comm_latency: PASS\n");
+    return 0;
+}
@@ -0,0 +1,335 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 Ulrich Hecht
+
+// Runs libc_server in its test mode, with the call buffer in a file, and
+// acts as the bare-metal client: the file is mapped at LIBC_CALL_BUFFER_ADDR
+// here as well, and the arguments point into the rest of it.
+//
+// Checked are a synchronous call, SQE chains (a successful open+read+close,
+// and one whose open fails, which cancels the calls taking their fd from
+// it), readdir results kept with the CQEs, and that the calls creating or
+// reaping child processes run one after the other.
+
+#include "../libc_server.h"
+#include "../fixed_addr.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define AREA_OFFSET	0x4000		// after struct libc_call_buffer
+#define AREA_SIZE	0x10000
+#define TIMEOUT_NS	5000000000ULL	// 5 s
+
+// newlib's open() flags, see translate_fcntl_flags()
+#define NEWLIB_O_WRONLY	1
+#define NEWLIB_O_CREAT	0x0200
+#define NEWLIB_O_TRUNC	0x0400
+
+// as in ../dirent.h
+struct awb_dirent {
+    unsigned char d_type;
+    char d_name[256];
+};
+
+static struct libc_call_buffer *callbuf;
+static uint8_t *area;
+static uint32_t area_used;
+static uint32_t sq_tail;
+static int failed;
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL: " __VA_ARGS__); printf("\n"); failed = 1; } } while (0)
+
+// Returns a copy of s in the shared area, as an argument.
+static param_t arg_str(const char *s)
+{
+    char *p = (char *)area + area_used;
+    strcpy(p, s);
+    area_used += strlen(s) + 1;
+    return (param_t)p;
+}
+
+static param_t arg_buf(uint32_t size)
+{
+    uint8_t *p = area + area_used;
+    memset(p, 0, size);
+    area_used += size;
+    return (param_t)p;
+}
+
+static param_t sync_call(int func, param_t a0, param_t a1, param_t a2, uint32_t *_errno)
+{
+    struct libc_call *call = &callbuf->sync_calls[0];
+
+    call->func = func;
+    call->args[0] = a0;
+    call->args[1] = a1;
+    call->args[2] = a2;
+    call->args[3] = 0;
+    call->processed = 0;
+    __atomic_store_n(&call->pending, 1, __ATOMIC_RELEASE);
+    comm_ring(&callbuf->doorbell);
+
+    uint64_t start = comm_now_ns();
+    while (__atomic_load_n(&call->processed, __ATOMIC_ACQUIRE) == 0) {
+        if (comm_now_ns() - start > TIMEOUT_NS) {
+            printf("FAIL: synchronous call %d not answered\n", func);
+            exit(EXIT_FAILURE);
+        }
+        comm_wait_for_event();
+    }
+
+    *_errno = call->_errno;
+    return call->retval;
+}
+
+static struct libc_sqe *get_sqe(int func, param_t a0, param_t a1, param_t a2, uint32_t flags, uint64_t user_data)
+{
+    struct libc_sqe *sqe = &callbuf->sq[sq_tail++ & (LIBC_SQ_SIZE - 1)];
+
+    // Not libc_prep_call(), a DIR * of the server needs all of param_t.
+    sqe->func = func;
+    sqe->args[0] = a0;
+    sqe->args[1] = a1;
+    sqe->args[2] = a2;
+    sqe->args[3] = 0;
+    sqe->flags = flags;
+    sqe->user_data = user_data;
+
+    return sqe;
+}
+
+static void submit(void)
+{
+    __atomic_store_n(&callbuf->sq_tail, sq_tail, __ATOMIC_RELEASE);
+    comm_ring(&callbuf->doorbell);
+}
+
+// Collects count completions into cqes[], indexed by user_data.
+static void wait_cqes(struct libc_cqe *cqes, int count)
+{
+    uint64_t start = comm_now_ns();
+
+    while (count != 0) {
+        uint32_t head = callbuf->cq_head;
+
+        if (head == __atomic_load_n(&callbuf->cq_tail, __ATOMIC_ACQUIRE)) {
+            if (comm_now_ns() - start > TIMEOUT_NS) {
+                printf("FAIL: %d completions missing\n", count);
+                exit(EXIT_FAILURE);
+            }
+            comm_wait_for_event();
+            continue;
+        }
+
+        struct libc_cqe *cqe = &callbuf->cq[head & (LIBC_CQ_SIZE - 1)];
+        cqes[cqe->user_data] = *cqe;
+
+        // A compound return value is only valid until cq_head moves on.
+        if (cqe->retval == (param_t)callbuf->cq_compound_retval[head & (LIBC_CQ_SIZE - 1)]) {
+            struct awb_dirent *d = (struct awb_dirent *)(uintptr_t)cqe->retval;
+            char *copy = (char *)arg_buf(sizeof(d->d_name));
+            strcpy(copy, d->d_name);
+            cqes[cqe->user_data].retval = (param_t)copy;
+        }
+
+        __atomic_store_n(&callbuf->cq_head, head + 1, __ATOMIC_RELEASE);
+        count--;
+    }
+}
+
+static void test_sync(const char *dir)
+{
+    char path[256];
+    uint32_t eno;
+
+    snprintf(path, sizeof(path), "%s/sync", dir);
+    param_t p = arg_str(path);
+    param_t data = arg_str("written by a synchronous call");
+
+    int fd = sync_call(LIBC_OPEN, p, NEWLIB_O_WRONLY | NEWLIB_O_CREAT | NEWLIB_O_TRUNC, 0644, &eno);
+    CHECK(fd >= 0, "sync open: errno %u", eno);
+    int n = sync_call(LIBC_WRITE, fd, data, 29, &eno);
+    CHECK(n == 29, "sync write returned %d", n);
+    CHECK(sync_call(LIBC_CLOSE, fd, 0, 0, &eno) == 0, "sync close");
+
+    char buf[64] = { 0 };
+    int hfd = open(path, O_RDONLY);
+    CHECK(hfd >= 0 && read(hfd, buf, sizeof(buf)) == 29 && strcmp(buf, "written by a synchronous call") == 0,
+          "file contents \"%s\"", buf);
+    close(hfd);
+
+    int ret = sync_call(LIBC_OPEN, arg_str("/nonexistent/file"), 0, 0, &eno);
+    CHECK(ret == -1 && eno == ENOENT, "sync open of a missing file: %d, errno %u", ret, eno);
+}
+
+static void test_chains(const char *dir)
+{
+    char path[256];
+    struct libc_cqe cqes[6];
+
+    snprintf(path, sizeof(path), "%s/sync", dir);
+    param_t buf = arg_buf(64);
+
+    get_sqe(LIBC_OPEN, arg_str(path), 0, 0, LIBC_SQE_LINK, 0);
+    get_sqe(LIBC_READ, 0, buf, 64, LIBC_SQE_LINK | LIBC_SQE_FD_FROM_LINK, 1);
+    get_sqe(LIBC_CLOSE, 0, 0, 0, LIBC_SQE_FD_FROM_LINK, 2);
+
+    get_sqe(LIBC_OPEN, arg_str("/nonexistent/file"), 0, 0, LIBC_SQE_LINK, 3);
+    get_sqe(LIBC_READ, 0, buf, 64, LIBC_SQE_LINK | LIBC_SQE_FD_FROM_LINK, 4);
+    get_sqe(LIBC_CLOSE, 0, 0, 0, LIBC_SQE_FD_FROM_LINK, 5);
+
+    submit();
+    wait_cqes(cqes, 6);
+
+    CHECK((int)cqes[0].retval >= 0, "chain open: errno %u", cqes[0]._errno);
+    CHECK((int)cqes[1].retval == 29 && strcmp((char *)(uintptr_t)buf, "written by a synchronous call") == 0,
+          "chain read returned %d", (int)cqes[1].retval);
+    CHECK((int)cqes[2].retval == 0, "chain close: errno %u", cqes[2]._errno);
+
+    CHECK((int)cqes[3].retval == -1 && cqes[3]._errno == ENOENT, "failing open: %d, errno %u",
+          (int)cqes[3].retval, cqes[3]._errno);
+    for (int i = 4; i < 6; i++)
+        CHECK((int)cqes[i].retval == -1 && cqes[i]._errno == ECANCELED, "call %d after a failed open: %d, errno %u",
+              i, (int)cqes[i].retval, cqes[i]._errno);
+}
+
+static void test_readdir(const char *dir)
+{
+    char path[256];
+    uint32_t eno;
+    struct libc_cqe cqes[4];
+
+    snprintf(path, sizeof(path), "%s/dir", dir);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/dir/only", dir);
+    close(open(path, O_WRONLY | O_CREAT, 0644));
+
+    snprintf(path, sizeof(path), "%s/dir", dir);
+    param_t d = sync_call(LIBC_OPENDIR, arg_str(path), 0, 0, &eno);
+    CHECK(d != 0, "opendir: errno %u", eno);
+    if (d == 0)
+        return;
+
+    // In a chain, so that the calls on the DIR run one after the other.
+    for (int i = 0; i < 4; i++)
+        get_sqe(LIBC_READDIR, d, 0, 0, i < 3 ? LIBC_SQE_LINK : 0, i);
+    submit();
+    wait_cqes(cqes, 4);
+
+    int dot = 0, dotdot = 0, only = 0;
+    for (int i = 0; i < 3; i++) {
+        const char *name = (const char *)(uintptr_t)cqes[i].retval;
+        // Copied by wait_cqes() if it pointed to the CQE's compound value
+        if (name < (char *)area || name >= (char *)area + AREA_SIZE) {
+            CHECK(0, "readdir result %d is not kept with the CQE", i);
+            continue;
+        }
+        dot += strcmp(name, ".") == 0;
+        dotdot += strcmp(name, "..") == 0;
+        only += strcmp(name, "only") == 0;
+    }
+    CHECK(dot == 1 && dotdot == 1 && only == 1, "readdir entries");
+    CHECK(cqes[3].retval == 0, "readdir past the end");
+
+    sync_call(LIBC_CLOSEDIR, d, 0, 0, &eno);
+}
+
+static void test_process_calls(const char *dir)
+{
+    char cmd[300];
+    struct libc_cqe cqes[1];
+    uint32_t eno;
+
+    // The calls that create or reap children run one after the other: the
+    // second system() sees the file the first one creates late, and the
+    // wait() does not reap the shell of a system(), which would make it
+    // fail with ECHILD.
+    snprintf(cmd, sizeof(cmd), "sleep 0.2; touch %s/done; exit 3", dir);
+    get_sqe(LIBC_SYSTEM, arg_str(cmd), 0, 0, 0, 0);
+    submit();
+
+    // The dispatcher takes synchronous calls first; these are to queue up
+    // behind the system().
+    while (__atomic_load_n(&callbuf->sq_head, __ATOMIC_ACQUIRE) != sq_tail)
+        comm_wait_for_event();
+
+    snprintf(cmd, sizeof(cmd), "test -e %s/done", dir);
+    int status = sync_call(LIBC_SYSTEM, arg_str(cmd), 0, 0, &eno);
+    CHECK(status == 0, "system() ran alongside another: %d, errno %u", status, eno);
+
+    int ret = sync_call(LIBC_WAIT, 0, 0, 0, &eno);
+    CHECK(ret == -1 && eno == ECHILD, "wait() after system(): %d, errno %u", ret, eno);
+
+    wait_cqes(cqes, 1);
+    status = cqes[0].retval;
+    CHECK(status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 3, "system(): %d, errno %u", status, cqes[0]._errno);
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/libc_server_calls.XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    char file[256];
+    snprintf(file, sizeof(file), "%s/callbuf", dir);
+    int fd = open(file, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0 || ftruncate(fd, AREA_OFFSET + AREA_SIZE) != 0) {
+        perror(file);
+        return EXIT_FAILURE;
+    }
+
+    callbuf = mmap((void *)LIBC_CALL_BUFFER_ADDR, AREA_OFFSET + AREA_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_FIXED, fd, 0);
+    if (callbuf == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+    area = (uint8_t *)callbuf + AREA_OFFSET;
+
+    pid_t server = fork();
+    if (server == 0) {
+        execl("./libc_server", "libc_server", file, (char *)NULL);
+        perror("libc_server");
+        _exit(EXIT_FAILURE);
+    }
+
+    uint64_t start = comm_now_ns();
+    while (__atomic_load_n(&callbuf->magic, __ATOMIC_ACQUIRE) != LIBC_SERVER_READY_MAGIC) {
+        if (comm_now_ns() - start > TIMEOUT_NS) {
+            printf("FAIL: server not ready\n");
+            kill(server, SIGKILL);
+            return EXIT_FAILURE;
+        }
+        usleep(1000);
+    }
+
+    test_sync(dir);
+    test_chains(dir);
+    test_readdir(dir);
+    test_process_calls(dir);
+
+    kill(server, SIGKILL);
+    waitpid(server, NULL, 0);
+
+    char cmd[300];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    if (system(cmd) != 0)
+        printf("could not remove %s\n", dir);
+
+    if (failed)
+        return EXIT_FAILURE;
+
+    puts("libc_server_calls: PASS");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,444 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 Ulrich Hecht
+
+// Runs network.c with the lwIP core on the host, against a fake EMAC with
+// the interface of lib-h3/device/emac. The fake DMA only reads the TX
+// descriptors when the test runs it, so a zero-copy pbuf chain that is not
+// held until emac_eth_tx_done() shows up as corrupted data.
+//
+// The wire is a loopback: ARP requests for the peer are answered, and IPv4
+// frames come back with the MAC and IP addresses and the UDP ports swapped,
+// which leaves the checksums valid. Every datagram is checked when it is
+// received; the throughput is measured per datagram size.
+
+#include "../network.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lwip/udp.h"
+#include "lwip/stats.h"
+
+#define LOCAL_IP   PP_HTONL(LWIP_MAKEU32(10, 0, 0, 1))
+#define PEER_IP    PP_HTONL(LWIP_MAKEU32(10, 0, 0, 2))
+#define LOCAL_PORT 6454
+#define PEER_PORT  6455
+#define FRAME_HEADERS (14 + 20 + 8)
+
+static const uint8_t local_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static const uint8_t peer_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+
+// Fake EMAC, the same buffer numbers as emac.c
+#define EMAC_RX_BUFFER_NUM (48 + 96)
+#define EMAC_RX_LOAN_MAX   (96 - 16)
+#define EMAC_TX_DESCR_NUM  48
+#define EMAC_BUFSIZE       2048
+
+static uint8_t rx_buffers[EMAC_RX_BUFFER_NUM][EMAC_BUFSIZE];
+static uint16_t rx_free[EMAC_RX_BUFFER_NUM];
+static uint32_t rx_free_count;
+static struct {
+  uint16_t buffer;
+  uint16_t length;
+} rx_ready[EMAC_RX_BUFFER_NUM];
+static uint32_t rx_ready_head, rx_ready_tail;
+static bool rx_loaned[EMAC_RX_BUFFER_NUM];
+static uint32_t rx_loaned_count;
+static uint32_t rx_dropped;
+
+static struct {
+  uint32_t count;
+  struct emac_tx_segment segments[TX_SEGMENTS_MAX];
+  uint8_t copy[EMAC_BUFSIZE];
+} tx_frames[EMAC_TX_DESCR_NUM];
+static uint32_t tx_head, tx_tail;
+static uint32_t tx_inflight;
+static uint32_t tx_sequence, tx_completed;
+static uint32_t tx_busy;
+static uint64_t tx_zero_copy_bytes;
+
+void emac_init(void) {}
+void emac_start(bool reset_emac) { (void)reset_emac; }
+void emac_shutdown(void) {}
+void smp_start_secondary_core(int cpuid, secondary_task_t task, void *stack, uint32_t stack_size)
+{
+  (void)cpuid; (void)task; (void)stack; (void)stack_size;
+}
+
+int32_t hardware_get_mac_address(uint8_t *mac_address)
+{
+  memcpy(mac_address, local_mac, 6);
+  return 0;
+}
+
+uint64_t sys_get_usec(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+uint64_t sys_get_msec(void)
+{
+  return sys_get_usec() / 1000;
+}
+
+static void emac_fake_init(void)
+{
+  for (uint32_t i = 0; i < EMAC_RX_BUFFER_NUM; i++)
+    rx_free[i] = (uint16_t)i;
+
+  rx_free_count = EMAC_RX_BUFFER_NUM;
+}
+
+int emac_eth_recv(uint8_t **packetp)
+{
+  if (rx_ready_tail == rx_ready_head)
+    return -1;
+
+  *packetp = rx_buffers[rx_ready[rx_ready_tail % EMAC_RX_BUFFER_NUM].buffer];
+  return rx_ready[rx_ready_tail % EMAC_RX_BUFFER_NUM].length;
+}
+
+void emac_free_pkt(void)
+{
+  uint16_t buffer = rx_ready[rx_ready_tail++ % EMAC_RX_BUFFER_NUM].buffer;
+
+  if (!rx_loaned[buffer])
+    rx_free[rx_free_count++] = buffer;
+}
+
+int32_t emac_eth_loan(void)
+{
+  uint16_t buffer = rx_ready[rx_ready_tail % EMAC_RX_BUFFER_NUM].buffer;
+
+  if (rx_loaned_count >= EMAC_RX_LOAN_MAX)
+    return -1;
+
+  rx_loaned[buffer] = true;
+  rx_loaned_count++;
+
+  return buffer;
+}
+
+void emac_eth_return(int32_t token)
+{
+  if (token < 0 || token >= EMAC_RX_BUFFER_NUM || !rx_loaned[token]) {
+    printf("FAIL: emac_eth_return(%d) of a buffer which is not loaned\n", token);
+    exit(EXIT_FAILURE);
+  }
+
+  rx_loaned[token] = false;
+  rx_loaned_count--;
+  rx_free[rx_free_count++] = (uint16_t)token;
+}
+
+static void rx_frame(const uint8_t *frame, uint32_t length)
+{
+  if (rx_free_count == 0) {
+    rx_dropped++;
+    return;
+  }
+
+  uint16_t buffer = rx_free[--rx_free_count];
+  memcpy(rx_buffers[buffer], frame, length);
+  rx_ready[rx_ready_head % EMAC_RX_BUFFER_NUM].buffer = buffer;
+  rx_ready[rx_ready_head % EMAC_RX_BUFFER_NUM].length = (uint16_t)length;
+  rx_ready_head++;
+}
+
+int emac_eth_send_segments(const struct emac_tx_segment *segments, uint32_t count, uint32_t *sequence)
+{
+  if (tx_inflight + count > EMAC_TX_DESCR_NUM) {
+    tx_busy++;
+    return -1;
+  }
+
+  uint32_t offset = 0;
+  uint32_t slot = tx_head++ % EMAC_TX_DESCR_NUM;
+
+  tx_frames[slot].count = count;
+
+  for (uint32_t i = 0; i < count; i++) {
+    tx_frames[slot].segments[i] = segments[i];
+
+    if (segments[i].flags & EMAC_TX_SEGMENT_ZERO_COPY) {
+      tx_zero_copy_bytes += segments[i].length;
+    } else {
+      memcpy(&tx_frames[slot].copy[offset], segments[i].data, segments[i].length);
+      tx_frames[slot].segments[i].data = &tx_frames[slot].copy[offset];
+      offset += segments[i].length;
+    }
+  }
+
+  tx_inflight += count;
+  *sequence = tx_sequence++;
+
+  return 0;
+}
+
+bool emac_eth_tx_done(uint32_t sequence)
+{
+  return (int32_t)(tx_completed - sequence) > 0;
+}
+
+static void wire(const uint8_t *frame, uint32_t length);
+
+void emac_eth_send(void *packet, int len)
+{
+  const struct emac_tx_segment segment = { packet, (uint16_t)len, EMAC_TX_SEGMENT_COPY };
+  uint32_t sequence;
+
+  (void)sequence;
+
+  if (emac_eth_send_segments(&segment, 1, &sequence) != 0)
+    wire(packet, (uint32_t)len);	// the real driver waits, the data is sent the same
+}
+
+// The DMA sends the queued frames, reading the zero-copy data only now.
+static void emac_dma_run(void)
+{
+  static uint8_t frame[EMAC_BUFSIZE];
+
+  while (tx_tail != tx_head) {
+    uint32_t slot = tx_tail++ % EMAC_TX_DESCR_NUM;
+    uint32_t length = 0;
+
+    for (uint32_t i = 0; i < tx_frames[slot].count; i++) {
+      memcpy(&frame[length], tx_frames[slot].segments[i].data, tx_frames[slot].segments[i].length);
+      length += tx_frames[slot].segments[i].length;
+    }
+
+    tx_inflight -= tx_frames[slot].count;
+    tx_completed++;
+
+    wire(frame, length);
+  }
+}
+
+// Loopback wire
+static void wire(const uint8_t *frame, uint32_t length)
+{
+  static uint8_t reply[EMAC_BUFSIZE];
+  const uint16_t type = (uint16_t)((frame[12] << 8) | frame[13]);
+
+  if (type == ETHTYPE_ARP) {
+    // Request (1) for the peer
+    if (frame[21] != 1 || memcmp(&frame[38], &(uint32_t){ PEER_IP }, 4) != 0)
+      return;
+
+    memcpy(reply, frame, 42);
+    memcpy(&reply[0], &frame[6], 6);
+    memcpy(&reply[6], peer_mac, 6);
+    reply[21] = 2;
+    memcpy(&reply[22], peer_mac, 6);
+    memcpy(&reply[28], &frame[38], 4);
+    memcpy(&reply[32], &frame[22], 10);
+    rx_frame(reply, 60);
+  } else if (type == ETHTYPE_IP && frame[23] == IP_PROTO_UDP) {
+    memcpy(reply, frame, length);
+    memcpy(&reply[0], &frame[6], 6);
+    memcpy(&reply[6], peer_mac, 6);
+    memcpy(&reply[26], &frame[30], 4);
+    memcpy(&reply[30], &frame[26], 4);
+    memcpy(&reply[34], &frame[36], 2);
+    memcpy(&reply[36], &frame[34], 2);
+    rx_frame(reply, length);
+  }
+}
+
+// Application
+#define HOLD_MAX 40 // More than RX_PBUF_NUM, the rest fits in the PBUF_POOL
+
+static struct udp_pcb *pcb;
+static uint32_t rx_expected;
+static uint32_t rx_loaned_frames, rx_copied_frames;
+static uint32_t rx_errors;
+static struct pbuf *held[HOLD_MAX];
+static uint32_t held_count, hold;
+
+static uint8_t pattern(uint32_t sequence, uint32_t i)
+{
+  return (uint8_t)(sequence * 31 + i);
+}
+
+static void udp_received(void *arg, struct udp_pcb *upcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+  (void)arg; (void)upcb; (void)addr; (void)port;
+
+  uint32_t sequence;
+  bool ok = p->tot_len >= 4 && pbuf_copy_partial(p, &sequence, 4, 0) == 4 && sequence == rx_expected;
+
+  uint32_t offset = 0;
+
+  for (struct pbuf *q = p; ok && q != NULL; offset += q->len, q = q->next) {
+    for (uint32_t i = offset < 4 ? 4 - offset : 0; i < q->len; i++) {
+      if (((uint8_t *)q->payload)[i] != pattern(sequence, offset + i)) {
+        ok = false;
+        break;
+      }
+    }
+  }
+
+  if (!ok) {
+    if (rx_errors++ == 0)
+      printf("FAIL: datagram %u is not as sent\n", rx_expected);
+  }
+
+  rx_expected++;
+
+  // The wrapper of a loaned buffer is a custom pbuf
+  if (p->flags & PBUF_FLAG_IS_CUSTOM)
+    rx_loaned_frames++;
+  else
+    rx_copied_frames++;
+
+  if (held_count < hold) {
+    held[held_count++] = p;
+    return;
+  }
+
+  pbuf_free(p);
+
+  while (held_count != 0)
+    pbuf_free(held[--held_count]);
+}
+
+static void pump(void)
+{
+  emac_dma_run();
+  network_task_budget(NETWORK_TASK_MAX_FRAMES, NETWORK_TASK_MAX_USEC);
+}
+
+enum layout {
+  SINGLE,   // one pbuf with room for the headers
+  CHAINED,  // a payload pbuf behind a header pbuf
+  REF,      // PBUF_REF payload, overwritten once udp_sendto() returns
+};
+
+static bool send_datagram(uint32_t sequence, uint16_t size, enum layout layout)
+{
+  static uint8_t ref_buffer[1500];
+  struct pbuf *p;
+
+  if (layout == REF) {
+    p = pbuf_alloc(PBUF_TRANSPORT, size, PBUF_REF);
+    if (p != NULL)
+      p->payload = ref_buffer;
+  } else {
+    p = pbuf_alloc(layout == CHAINED ? PBUF_RAW : PBUF_TRANSPORT, size, PBUF_RAM);
+  }
+
+  if (p == NULL)
+    return false;
+
+  uint8_t *payload = p->payload;
+
+  for (uint32_t i = 0; i < size; i++)
+    payload[i] = pattern(sequence, i);
+
+  memcpy(payload, &sequence, 4);
+
+  ip_addr_t dst = IPADDR4_INIT(PEER_IP);
+  err_t err = udp_sendto(pcb, p, &dst, PEER_PORT);
+
+  pbuf_free(p);
+
+  // The caller owns a PBUF_REF payload again, the DMA has not run yet
+  if (layout == REF)
+    memset(ref_buffer, 0xAA, size);
+
+  return err == ERR_OK;
+}
+
+static bool run(const char *name, uint32_t count, uint16_t size, enum layout layout, uint32_t hold_frames)
+{
+  uint32_t first = rx_expected;
+  uint32_t sequence = first;
+  uint64_t zero_copy_bytes = tx_zero_copy_bytes;
+  uint32_t loaned = rx_loaned_frames, copied = rx_copied_frames;
+
+  hold = hold_frames;
+
+  uint64_t start = sys_get_usec();
+
+  while (sequence != first + count) {
+    if (send_datagram(sequence, size, layout))
+      sequence++;
+    else
+      pump();
+
+    if ((sequence & 7) == 0)
+      pump();
+  }
+
+  uint32_t idle = 0;
+
+  while (rx_expected != first + count && idle++ < 1000)
+    pump();
+
+  uint64_t elapsed = sys_get_usec() - start;
+
+  while (held_count != 0)
+    pbuf_free(held[--held_count]);
+
+  printf("%-22s %5u x %4u bytes %8.1f MiB/s %7.0f datagrams/s, TX zero-copy %3u%%, RX loaned %5u copied %5u\n",
+         name, count, size, (double)count * size / elapsed / 1.048576, (double)count * 1e6 / elapsed,
+         (unsigned)((tx_zero_copy_bytes - zero_copy_bytes) * 100 / ((uint64_t)count * (size + FRAME_HEADERS))),
+         rx_loaned_frames - loaned, rx_copied_frames - copied);
+
+  if (rx_expected != first + count) {
+    printf("FAIL: %s, %u of %u datagrams received\n", name, rx_expected - first, count);
+    return false;
+  }
+
+  return rx_errors == 0;
+}
+
+int main(void)
+{
+  ip4_addr_t ip = { LOCAL_IP };
+  ip4_addr_t mask = { PP_HTONL(LWIP_MAKEU32(255, 255, 255, 0)) };
+  ip4_addr_t gw = { 0 };
+
+  // network_init() without the clock gating of the EMAC
+  emac_fake_init();
+  rx_pbufs_init();
+  lwip_init();
+  netif_add(&netif_eth0, &ip, &mask, &gw, NULL, _netif_init, netif_input);
+  netif_set_default(&netif_eth0);
+  netif_set_up(&netif_eth0);
+  netif_set_link_up(&netif_eth0);
+
+  pcb = udp_new();
+  udp_bind(pcb, IP_ADDR_ANY, LOCAL_PORT);
+  udp_recv(pcb, udp_received, NULL);
+
+  // The first datagram waits for the ARP reply
+  if (!run("ARP", 1, 64, SINGLE, 0)
+      || !run("zero-copy", 20000, 1472, SINGLE, 0)
+      || !run("header + payload", 20000, 1472, CHAINED, 0)
+      || !run("volatile, copied", 20000, 1472, REF, 0)
+      || !run("small, copied", 50000, 64, SINGLE, 0)
+      || !run("held, out of loans", 5000, 1472, SINGLE, HOLD_MAX))
+    return EXIT_FAILURE;
+
+  // Everything is sent and freed: the loans and the pending chains are back
+  for (int i = 0; i < 10 && tx_pending_tail != tx_pending_head; i++)
+    pump();
+
+  if (rx_loaned_count != 0 || rx_free_count != EMAC_RX_BUFFER_NUM || tx_pending_tail != tx_pending_head) {
+    printf("FAIL: %u buffers on loan, %u free, %u chains pending\n", rx_loaned_count, rx_free_count, tx_pending_head - tx_pending_tail);
+    return EXIT_FAILURE;
+  }
+
+  if (lwip_stats.memp[MEMP_PBUF_POOL]->used != 0 || lwip_stats.mem.used != 0) {
+    printf("FAIL: %u pool pbufs, %u heap bytes in use\n", (unsigned)lwip_stats.memp[MEMP_PBUF_POOL]->used, (unsigned)lwip_stats.mem.used);
+    return EXIT_FAILURE;
+  }
+
+  printf("TX busy %u, RX dropped %u\n", tx_busy, rx_dropped);
+  puts("PASS");
+  return EXIT_SUCCESS;
+}